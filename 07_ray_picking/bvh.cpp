@@ -0,0 +1,295 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Bounding volume hierarchy for ray picking. See bvh.h for the node layout.    |
+\******************************************************************************/
+#include "bvh.h"
+#include <algorithm>
+#include <atomic>
+#include <float.h>
+#include <thread>
+
+#define BVH_NUM_BINS 12
+// relative costs of stepping into a node and of testing a primitive
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_INTERSECT_COST 1.0f
+
+static bvh_aabb_t empty_aabb() {
+  bvh_aabb_t b;
+  b.min = vec3( FLT_MAX, FLT_MAX, FLT_MAX );
+  b.max = vec3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+  return b;
+}
+
+static void grow_aabb( bvh_aabb_t& b, const bvh_aabb_t& o ) {
+  for ( int i = 0; i < 3; i++ ) {
+    b.min.v[i] = std::min( b.min.v[i], o.min.v[i] );
+    b.max.v[i] = std::max( b.max.v[i], o.max.v[i] );
+  }
+}
+
+/* half of the surface area - the factor of 2 cancels out in every SAH ratio */
+static float half_area( const bvh_aabb_t& b ) {
+  float dx = b.max.v[0] - b.min.v[0];
+  float dy = b.max.v[1] - b.min.v[1];
+  float dz = b.max.v[2] - b.min.v[2];
+  if ( dx < 0.0f || dy < 0.0f || dz < 0.0f ) { return 0.0f; }
+  return dx * dy + dy * dz + dz * dx;
+}
+
+static float centroid( const bvh_aabb_t& b, int axis ) { return 0.5f * ( b.min.v[axis] + b.max.v[axis] ); }
+
+/* recompute one node from its children, or from its primitive if a leaf */
+static void refit_node( bvh_t& bvh, const bvh_aabb_t* prim_boxes, int node ) {
+  bvh_node_t& n = bvh.nodes[node];
+  if ( 1 == n.count ) {
+    n.box  = prim_boxes[bvh.prim_ids[n.first]];
+    n.cost = BVH_INTERSECT_COST * half_area( n.box );
+    return;
+  }
+  const bvh_node_t& l = bvh.nodes[bvh_left( node )];
+  const bvh_node_t& r = bvh.nodes[bvh_right( bvh, node )];
+  n.box               = l.box;
+  grow_aabb( n.box, r.box );
+  n.cost = BVH_TRAVERSAL_COST * half_area( n.box ) + l.cost + r.cost;
+}
+
+/* children always have higher indices than their parent, so walking a
+subtree's node range backwards visits every child before its parent */
+static void refit_range( bvh_t& bvh, const bvh_aabb_t* prim_boxes, int first_node, int end_node ) {
+  for ( int i = end_node - 1; i >= first_node; i-- ) { refit_node( bvh, prim_boxes, i ); }
+}
+
+static float normalised_cost( const bvh_node_t& n ) {
+  float area = half_area( n.box );
+  return area > 0.0f ? n.cost / area : 0.0f;
+}
+
+/* build the subtree over prim_ids[first, first + count) into nodes starting at
+index node. the subtree always takes exactly 2 * count - 1 nodes */
+static void build_recursive( bvh_t& bvh, const bvh_aabb_t* prim_boxes, int node, int first, int count, int parent ) {
+  bvh_node_t& n = bvh.nodes[node];
+  n.first       = first;
+  n.count       = count;
+  n.parent      = parent;
+  if ( 1 == count ) {
+    refit_node( bvh, prim_boxes, node );
+    n.base_cost = normalised_cost( n );
+    return;
+  }
+
+  int* ids = &bvh.prim_ids[first];
+  // split along the longest axis of the primitive centroids
+  bvh_aabb_t cbox = empty_aabb();
+  for ( int i = 0; i < count; i++ ) {
+    for ( int a = 0; a < 3; a++ ) {
+      float c       = centroid( prim_boxes[ids[i]], a );
+      cbox.min.v[a] = std::min( cbox.min.v[a], c );
+      cbox.max.v[a] = std::max( cbox.max.v[a], c );
+    }
+  }
+  int axis = 0;
+  for ( int a = 1; a < 3; a++ ) {
+    if ( cbox.max.v[a] - cbox.min.v[a] > cbox.max.v[axis] - cbox.min.v[axis] ) { axis = a; }
+  }
+  float extent = cbox.max.v[axis] - cbox.min.v[axis];
+
+  int left_count = count / 2;
+  if ( extent > 0.0f ) {
+    // bin the centroids and sweep the bin boundaries for the cheapest split
+    bvh_aabb_t bin_boxes[BVH_NUM_BINS];
+    int bin_counts[BVH_NUM_BINS];
+    for ( int b = 0; b < BVH_NUM_BINS; b++ ) {
+      bin_boxes[b]  = empty_aabb();
+      bin_counts[b] = 0;
+    }
+    float bin_scale = (float)BVH_NUM_BINS / extent;
+    for ( int i = 0; i < count; i++ ) {
+      int b = std::min( BVH_NUM_BINS - 1, (int)( ( centroid( prim_boxes[ids[i]], axis ) - cbox.min.v[axis] ) * bin_scale ) );
+      bin_counts[b]++;
+      grow_aabb( bin_boxes[b], prim_boxes[ids[i]] );
+    }
+    float right_area[BVH_NUM_BINS];
+    int right_count[BVH_NUM_BINS];
+    bvh_aabb_t acc = empty_aabb();
+    int acc_count  = 0;
+    for ( int b = BVH_NUM_BINS - 1; b > 0; b-- ) {
+      grow_aabb( acc, bin_boxes[b] );
+      acc_count += bin_counts[b];
+      right_area[b]  = half_area( acc );
+      right_count[b] = acc_count;
+    }
+    acc            = empty_aabb();
+    acc_count      = 0;
+    float best     = FLT_MAX;
+    int best_split = 1;
+    for ( int b = 1; b < BVH_NUM_BINS; b++ ) {
+      grow_aabb( acc, bin_boxes[b - 1] );
+      acc_count += bin_counts[b - 1];
+      if ( 0 == acc_count || 0 == right_count[b] ) { continue; }
+      float cost = acc_count * half_area( acc ) + right_count[b] * right_area[b];
+      if ( cost < best ) {
+        best       = cost;
+        best_split = b;
+      }
+    }
+    float min_c  = cbox.min.v[axis];
+    int* mid     = std::partition( ids, ids + count, [&]( int id ) {
+      int b = std::min( BVH_NUM_BINS - 1, (int)( ( centroid( prim_boxes[id], axis ) - min_c ) * bin_scale ) );
+      return b < best_split;
+    } );
+    left_count = (int)( mid - ids );
+  }
+
+  int left  = bvh_left( node );
+  int right = node + 2 * left_count;
+  build_recursive( bvh, prim_boxes, left, first, left_count, node );
+  build_recursive( bvh, prim_boxes, right, first + left_count, count - left_count, node );
+  refit_node( bvh, prim_boxes, node );
+  bvh.nodes[node].base_cost = normalised_cost( bvh.nodes[node] );
+}
+
+void bvh_build( bvh_t& bvh, const bvh_aabb_t* prim_boxes, int prim_count ) {
+  bvh.nodes.clear();
+  bvh.prim_ids.resize( prim_count );
+  if ( prim_count < 1 ) { return; }
+  bvh.nodes.resize( 2 * prim_count - 1 );
+  for ( int i = 0; i < prim_count; i++ ) { bvh.prim_ids[i] = i; }
+  build_recursive( bvh, prim_boxes, 0, 0, prim_count, -1 );
+}
+
+void bvh_refit( bvh_t& bvh, const bvh_aabb_t* prim_boxes, int thread_count ) {
+  int node_count = (int)bvh.nodes.size();
+  if ( thread_count < 2 || node_count < bvh.min_parallel_nodes ) {
+    refit_range( bvh, prim_boxes, 0, node_count );
+    return;
+  }
+  // split the top of the tree until there are a few independent subtrees per
+  // thread. those are refit in parallel, then the few nodes above them
+  std::vector<int> subtrees( 1, 0 );
+  std::vector<int> top_nodes;
+  size_t wanted = (size_t)thread_count * 4;
+  while ( subtrees.size() < wanted ) {
+    std::vector<int> next;
+    for ( size_t i = 0; i < subtrees.size(); i++ ) {
+      int s = subtrees[i];
+      if ( bvh.nodes[s].count > 1 ) {
+        top_nodes.push_back( s );
+        next.push_back( bvh_left( s ) );
+        next.push_back( bvh_right( bvh, s ) );
+      } else {
+        next.push_back( s );
+      }
+    }
+    if ( next.size() == subtrees.size() ) { break; }
+    subtrees.swap( next );
+  }
+
+  std::atomic<int> next_subtree( 0 );
+  std::vector<std::thread> threads;
+  for ( int t = 0; t < thread_count; t++ ) {
+    threads.push_back( std::thread( [&]() {
+      for ( int i = next_subtree++; i < (int)subtrees.size(); i = next_subtree++ ) {
+        int s = subtrees[i];
+        refit_range( bvh, prim_boxes, s, s + 2 * bvh.nodes[s].count - 1 );
+      }
+    } ) );
+  }
+  for ( size_t t = 0; t < threads.size(); t++ ) { threads[t].join(); }
+
+  // parents were collected top-down, so finish them off bottom-up
+  for ( int i = (int)top_nodes.size() - 1; i >= 0; i-- ) { refit_node( bvh, prim_boxes, top_nodes[i] ); }
+}
+
+int bvh_update( bvh_t& bvh, const bvh_aabb_t* prim_boxes, int thread_count ) {
+  bvh_refit( bvh, prim_boxes, thread_count );
+  if ( bvh.nodes.empty() ) { return 0; }
+
+  // find the smallest subtrees that have degraded. if a node is worse than
+  // when it was built, but neither of its children are, then the problem is the
+  // split itself (children have drifted into each other), so rebuild there
+  int rebuilt = 0;
+  std::vector<int> stack( 1, 0 );
+  while ( !stack.empty() ) {
+    int node = stack.back();
+    stack.pop_back();
+    const bvh_node_t& n = bvh.nodes[node];
+    if ( n.count < 2 || normalised_cost( n ) <= n.base_cost * bvh.rebuild_threshold ) { continue; }
+    int l             = bvh_left( node );
+    int r             = bvh_right( bvh, node );
+    bool left_worse   = bvh.nodes[l].count > 1 && normalised_cost( bvh.nodes[l] ) > bvh.nodes[l].base_cost * bvh.rebuild_threshold;
+    bool right_worse  = bvh.nodes[r].count > 1 && normalised_cost( bvh.nodes[r] ) > bvh.nodes[r].base_cost * bvh.rebuild_threshold;
+    if ( left_worse || right_worse ) {
+      stack.push_back( l );
+      stack.push_back( r );
+      continue;
+    }
+    build_recursive( bvh, prim_boxes, node, n.first, n.count, n.parent );
+    rebuilt++;
+    // the new subtree is a different shape so its ancestors need new costs
+    for ( int p = bvh.nodes[node].parent; p >= 0; p = bvh.nodes[p].parent ) { refit_node( bvh, prim_boxes, p ); }
+  }
+  return rebuilt;
+}
+
+float bvh_sah_cost( const bvh_t& bvh ) {
+  if ( bvh.nodes.empty() ) { return 0.0f; }
+  return normalised_cost( bvh.nodes[0] );
+}
+
+/* slab test. returns distance to entry point, or FLT_MAX on a miss */
+static float ray_aabb( const bvh_aabb_t& b, const vec3& ray_origin, const vec3& inv_dir, float t_max ) {
+  float t_near = 0.0f;
+  float t_far  = t_max;
+  for ( int a = 0; a < 3; a++ ) {
+    float t0 = ( b.min.v[a] - ray_origin.v[a] ) * inv_dir.v[a];
+    float t1 = ( b.max.v[a] - ray_origin.v[a] ) * inv_dir.v[a];
+    if ( t0 > t1 ) { std::swap( t0, t1 ); }
+    t_near = std::max( t_near, t0 );
+    t_far  = std::min( t_far, t1 );
+    if ( t_near > t_far ) { return FLT_MAX; }
+  }
+  return t_near;
+}
+
+int bvh_ray_closest( const bvh_t& bvh, const vec3& ray_origin, const vec3& ray_dir, bvh_ray_prim_func prim_func, void* user_data, float* t_hit ) {
+  if ( bvh.nodes.empty() ) { return -1; }
+  vec3 inv_dir( 1.0f / ray_dir.v[0], 1.0f / ray_dir.v[1], 1.0f / ray_dir.v[2] );
+  int closest  = -1;
+  float t_best = FLT_MAX;
+  std::vector<int> stack;
+  stack.reserve( 64 );
+  if ( ray_aabb( bvh.nodes[0].box, ray_origin, inv_dir, t_best ) < FLT_MAX ) { stack.push_back( 0 ); }
+  while ( !stack.empty() ) {
+    int node = stack.back();
+    stack.pop_back();
+    const bvh_node_t& n = bvh.nodes[node];
+    if ( 1 == n.count ) {
+      float t = 0.0f;
+      int id  = bvh.prim_ids[n.first];
+      if ( prim_func( id, ray_origin, ray_dir, user_data, &t ) && t < t_best ) {
+        t_best  = t;
+        closest = id;
+      }
+      continue;
+    }
+    int l     = bvh_left( node );
+    int r     = bvh_right( bvh, node );
+    float t_l = ray_aabb( bvh.nodes[l].box, ray_origin, inv_dir, t_best );
+    float t_r = ray_aabb( bvh.nodes[r].box, ray_origin, inv_dir, t_best );
+    // push the far child first so the near one is popped and tested first
+    if ( t_l > t_r ) {
+      std::swap( l, r );
+      std::swap( t_l, t_r );
+    }
+    if ( t_r < FLT_MAX ) { stack.push_back( r ); }
+    if ( t_l < FLT_MAX ) { stack.push_back( l ); }
+  }
+  if ( closest > -1 ) { *t_hit = t_best; }
+  return closest;
+}
@@ -0,0 +1,69 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Bounding volume hierarchy for ray picking                                    |
+| One primitive per leaf, nodes stored in depth-first order so that the        |
+| subtree of a node holding k primitives is the contiguous range of 2k-1 nodes |
+| starting at that node. That lets us:                                         |
+| * refit any subtree bottom-up with a plain reverse loop over its range       |
+| * refit separate subtrees on separate threads without any locking            |
+| * rebuild a degraded subtree in place without touching the rest of the tree  |
+\******************************************************************************/
+#ifndef _BVH_H_
+#define _BVH_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+struct bvh_aabb_t {
+  vec3 min, max;
+};
+
+struct bvh_node_t {
+  bvh_aabb_t box;
+  int first;       // index of first primitive in bvh_t::prim_ids for this subtree
+  int count;       // number of primitives in subtree. 1 means this is a leaf
+  int parent;      // -1 for the root
+  float cost;      // SAH cost of subtree after most recent refit
+  float base_cost; // cost / surface area of subtree when it was last (re)built
+};
+
+struct bvh_t {
+  bvh_t() : rebuild_threshold( 1.3f ), min_parallel_nodes( 4096 ) {}
+  std::vector<bvh_node_t> nodes;
+  std::vector<int> prim_ids; // primitive indices, in leaf order
+  // if a subtree's cost / area grows past base_cost * this, bvh_update() rebuilds it
+  float rebuild_threshold;
+  // don't bother threading a refit of fewer nodes than this
+  int min_parallel_nodes;
+};
+
+/* children of an interior node. the left child always directly follows its
+parent, and the right child follows the whole left subtree */
+inline int bvh_left( int node ) { return node + 1; }
+inline int bvh_right( const bvh_t& bvh, int node ) { return node + 2 * bvh.nodes[node + 1].count; }
+
+/* builds a binned-SAH tree from scratch over prim_count primitive boxes */
+void bvh_build( bvh_t& bvh, const bvh_aabb_t* prim_boxes, int prim_count );
+/* recomputes every node's box and cost bottom-up from new primitive boxes,
+keeping the topology. subtrees are farmed out to thread_count threads */
+void bvh_refit( bvh_t& bvh, const bvh_aabb_t* prim_boxes, int thread_count );
+/* refit, then rebuild only the subtrees whose SAH cost, relative to their own
+surface area, has degraded by more than rebuild_threshold since they were
+built. returns number of subtrees rebuilt */
+int bvh_update( bvh_t& bvh, const bvh_aabb_t* prim_boxes, int thread_count );
+/* cost of the whole tree, normalised by the root surface area */
+float bvh_sah_cost( const bvh_t& bvh );
+
+/* callback to intersect a ray with one primitive. return true and set t on hit */
+typedef bool ( *bvh_ray_prim_func )( int prim_id, const vec3& ray_origin, const vec3& ray_dir, void* user_data, float* t );
+/* returns the id of the closest primitive hit by the ray, or -1. t_hit is set
+to the hit distance */
+int bvh_ray_closest( const bvh_t& bvh, const vec3& ray_origin, const vec3& ray_dir, bvh_ray_prim_func prim_func, void* user_data, float* t_hit );
+
+#endif
@@ -0,0 +1,148 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Faster matrix inverses. See fast_inverse.h                                   |
+\******************************************************************************/
+#include "fast_inverse.h"
+#include <stdio.h>
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define FAST_INVERSE_SSE
+#endif
+
+mat4 inverse( const mat4& m, transform_kind_t kind ) {
+  switch ( kind ) {
+  case TRANSFORM_AFFINE: return inverse_affine( m );
+  case TRANSFORM_RIGID: return inverse_rigid( m );
+  case TRANSFORM_PERSPECTIVE: return inverse_perspective( m );
+  default: return inverse_general( m );
+  }
+}
+
+#ifdef FAST_INVERSE_SSE
+#define SHUFFLE( a, b, x, y, z, w ) _mm_shuffle_ps( a, b, _MM_SHUFFLE( w, z, y, x ) )
+#define SWIZZLE( a, x, y, z, w ) SHUFFLE( a, a, x, y, z, w )
+
+/* each register holds a 2x2 matrix as a b / c d. these are A * B, adj(A) * B,
+and A * adj(B), where adj( a b / c d ) = d -b / -c a */
+static __m128 mat2_mul( __m128 a, __m128 b ) {
+  return _mm_add_ps( _mm_mul_ps( a, SWIZZLE( b, 0, 3, 0, 3 ) ), _mm_mul_ps( SWIZZLE( a, 1, 0, 3, 2 ), SWIZZLE( b, 2, 1, 2, 1 ) ) );
+}
+static __m128 mat2_adj_mul( __m128 a, __m128 b ) {
+  return _mm_sub_ps( _mm_mul_ps( SWIZZLE( a, 3, 3, 0, 0 ), b ), _mm_mul_ps( SWIZZLE( a, 1, 1, 2, 2 ), SWIZZLE( b, 2, 3, 0, 1 ) ) );
+}
+static __m128 mat2_mul_adj( __m128 a, __m128 b ) {
+  return _mm_sub_ps( _mm_mul_ps( a, SWIZZLE( b, 3, 0, 3, 0 ) ), _mm_mul_ps( SWIZZLE( a, 1, 0, 3, 2 ), SWIZZLE( b, 2, 1, 2, 1 ) ) );
+}
+
+/* the 4x4 matrix is split into 2x2 blocks A B / C D and inverted blockwise,
+reusing adj(A) * B and adj(D) * C for all four blocks of the result. the
+matrix is read as if it were row-major; that inverts its transpose, which is
+the transpose of the inverse, so it comes out right column-major too */
+mat4 inverse_general( const mat4& m ) {
+  __m128 c0 = _mm_loadu_ps( &m.m[0] );
+  __m128 c1 = _mm_loadu_ps( &m.m[4] );
+  __m128 c2 = _mm_loadu_ps( &m.m[8] );
+  __m128 c3 = _mm_loadu_ps( &m.m[12] );
+  __m128 A  = _mm_movelh_ps( c0, c1 );
+  __m128 B  = _mm_movehl_ps( c1, c0 );
+  __m128 C  = _mm_movelh_ps( c2, c3 );
+  __m128 D  = _mm_movehl_ps( c3, c2 );
+
+  // determinants of A, B, C, D
+  __m128 det_sub = _mm_sub_ps( _mm_mul_ps( SHUFFLE( c0, c2, 0, 2, 0, 2 ), SHUFFLE( c1, c3, 1, 3, 1, 3 ) ),
+    _mm_mul_ps( SHUFFLE( c0, c2, 1, 3, 1, 3 ), SHUFFLE( c1, c3, 0, 2, 0, 2 ) ) );
+  __m128 det_a = SWIZZLE( det_sub, 0, 0, 0, 0 );
+  __m128 det_b = SWIZZLE( det_sub, 1, 1, 1, 1 );
+  __m128 det_c = SWIZZLE( det_sub, 2, 2, 2, 2 );
+  __m128 det_d = SWIZZLE( det_sub, 3, 3, 3, 3 );
+
+  __m128 adj_d_c = mat2_adj_mul( D, C );
+  __m128 adj_a_b = mat2_adj_mul( A, B );
+  // adjugates of the result's blocks X Y / Z W
+  __m128 X = _mm_sub_ps( _mm_mul_ps( det_d, A ), mat2_mul( B, adj_d_c ) );
+  __m128 W = _mm_sub_ps( _mm_mul_ps( det_a, D ), mat2_mul( C, adj_a_b ) );
+  __m128 Y = _mm_sub_ps( _mm_mul_ps( det_b, C ), mat2_mul_adj( D, adj_a_b ) );
+  __m128 Z = _mm_sub_ps( _mm_mul_ps( det_c, B ), mat2_mul_adj( A, adj_d_c ) );
+
+  // |M| = |A||D| + |B||C| - trace( adj(A) B adj(D) C )
+  __m128 tr = _mm_mul_ps( adj_a_b, SWIZZLE( adj_d_c, 0, 2, 1, 3 ) );
+  tr        = _mm_add_ps( tr, SWIZZLE( tr, 2, 3, 0, 1 ) );
+  tr        = _mm_add_ps( tr, SWIZZLE( tr, 1, 0, 3, 2 ) );
+  __m128 det_m = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( det_a, det_d ), _mm_mul_ps( det_b, det_c ) ), tr );
+  if ( 0.0f == _mm_cvtss_f32( det_m ) ) {
+    fprintf( stderr, "WARNING. matrix has no determinant. can not invert\n" );
+    return m;
+  }
+  // 1/|M| with the signs of the adjugate
+  __m128 r_det = _mm_div_ps( _mm_setr_ps( 1.0f, -1.0f, -1.0f, 1.0f ), det_m );
+  X            = _mm_mul_ps( X, r_det );
+  Y            = _mm_mul_ps( Y, r_det );
+  Z            = _mm_mul_ps( Z, r_det );
+  W            = _mm_mul_ps( W, r_det );
+
+  // taking the adjugates of the blocks and storing them are one shuffle
+  mat4 r;
+  _mm_storeu_ps( &r.m[0], SHUFFLE( X, Y, 3, 1, 3, 1 ) );
+  _mm_storeu_ps( &r.m[4], SHUFFLE( X, Y, 2, 0, 2, 0 ) );
+  _mm_storeu_ps( &r.m[8], SHUFFLE( Z, W, 3, 1, 3, 1 ) );
+  _mm_storeu_ps( &r.m[12], SHUFFLE( Z, W, 2, 0, 2, 0 ) );
+  return r;
+}
+#else
+mat4 inverse_general( const mat4& m ) { return inverse( m ); }
+#endif
+
+/* the inverse of the top-left 3x3 M has rows that are cross products of M's
+columns, over its determinant. the translation t becomes -inverse(M) * t */
+mat4 inverse_affine( const mat4& m ) {
+  vec3 c0( m.m[0], m.m[1], m.m[2] );
+  vec3 c1( m.m[4], m.m[5], m.m[6] );
+  vec3 c2( m.m[8], m.m[9], m.m[10] );
+  vec3 r0   = cross( c1, c2 );
+  vec3 r1   = cross( c2, c0 );
+  vec3 r2   = cross( c0, c1 );
+  float det = dot( c0, r0 );
+  if ( 0.0f == det ) {
+    fprintf( stderr, "WARNING. matrix has no determinant. can not invert\n" );
+    return m;
+  }
+  float inv_det = 1.0f / det;
+  r0            = r0 * inv_det;
+  r1            = r1 * inv_det;
+  r2            = r2 * inv_det;
+  vec3 t( m.m[12], m.m[13], m.m[14] );
+  return mat4( r0.v[0], r1.v[0], r2.v[0], 0.0f, r0.v[1], r1.v[1], r2.v[1], 0.0f, r0.v[2], r1.v[2], r2.v[2], 0.0f, -dot( r0, t ), -dot( r1, t ), -dot( r2, t ),
+    1.0f );
+}
+
+/* a rotation's inverse is its transpose */
+mat4 inverse_rigid( const mat4& m ) {
+  vec3 c0( m.m[0], m.m[1], m.m[2] );
+  vec3 c1( m.m[4], m.m[5], m.m[6] );
+  vec3 c2( m.m[8], m.m[9], m.m[10] );
+  vec3 t( m.m[12], m.m[13], m.m[14] );
+  return mat4(
+    m.m[0], m.m[4], m.m[8], 0.0f, m.m[1], m.m[5], m.m[9], 0.0f, m.m[2], m.m[6], m.m[10], 0.0f, -dot( c0, t ), -dot( c1, t ), -dot( c2, t ), 1.0f );
+}
+
+/* perspective() only fills in sx, sy, sz, pz, and the -1 that copies -z into
+w. the inverse is just as sparse:
+  sx 0  0  0        1/sx 0    0    0
+  0  sy 0  0        0    1/sy 0    0
+  0  0  sz pz  ->   0    0    0    -1
+  0  0  -1 0        0    0    1/pz sz/pz */
+mat4 inverse_perspective( const mat4& m ) {
+  mat4 r  = zero_mat4();
+  r.m[0]  = 1.0f / m.m[0];
+  r.m[5]  = 1.0f / m.m[5];
+  r.m[11] = 1.0f / m.m[14];
+  r.m[14] = -1.0f;
+  r.m[15] = m.m[10] / m.m[14];
+  return r;
+}
@@ -0,0 +1,38 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Faster matrix inverses                                                       |
+| inverse() in maths_funcs works on any matrix, but most of the ones we invert |
+| have a known shape: a camera or model matrix is a rotation and translation,  |
+| maybe with a scale, and a projection matrix is mostly zeros. Telling         |
+| inverse() which kind of matrix it has lets it take a short cut. Anything     |
+| else goes through a general inverse done in 2x2 blocks with SSE.             |
+\******************************************************************************/
+#ifndef _FAST_INVERSE_H_
+#define _FAST_INVERSE_H_
+
+#include "maths_funcs.h"
+
+enum transform_kind_t {
+  TRANSFORM_GENERAL,    // any invertible matrix
+  TRANSFORM_AFFINE,     // bottom row is 0 0 0 1: rotation, scale, shear, translation
+  TRANSFORM_RIGID,      // rotation and translation only, no scale
+  TRANSFORM_PERSPECTIVE // made by perspective() in maths_funcs
+};
+
+// inverse of m, using the cheapest method for its kind. the result is wrong,
+// not just slow, if m isn't really of that kind
+mat4 inverse( const mat4& m, transform_kind_t kind );
+
+// the individual methods
+mat4 inverse_general( const mat4& m );
+mat4 inverse_affine( const mat4& m );
+mat4 inverse_rigid( const mat4& m );
+mat4 inverse_perspective( const mat4& m );
+
+#endif
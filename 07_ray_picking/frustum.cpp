@@ -0,0 +1,213 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| View frustum culling. See frustum.h                                          |
+\******************************************************************************/
+#include "frustum.h"
+#include <math.h>
+
+// the AVX functions are compiled for AVX on their own, so the rest of the
+// program doesn't need -mavx, and are only called if the CPU has it
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#include <immintrin.h>
+#define FRUSTUM_AVX
+#define FRUSTUM_AVX_FUNC __attribute__( ( target( "avx" ) ) )
+static bool cpu_has_avx() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports( "avx" ) != 0;
+}
+#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#include <immintrin.h>
+#include <intrin.h>
+#define FRUSTUM_AVX
+#define FRUSTUM_AVX_FUNC
+static bool cpu_has_avx() {
+  int info[4];
+  __cpuid( info, 1 );
+  bool os_saves_ymm = ( info[2] & ( 1 << 27 ) ) != 0;
+  bool has_avx      = ( info[2] & ( 1 << 28 ) ) != 0;
+  // the OS must also save the upper halves of the registers on task switches
+  return os_saves_ymm && has_avx && ( _xgetbv( 0 ) & 6 ) == 6;
+}
+#endif
+
+void frustum_from_mat4( const mat4& PV, frustum_t& frustum ) {
+  // Gribb and Hartmann: each plane is row 3 of the matrix plus or minus another
+  // row. m is column-major, so row r, column c is m[c * 4 + r]
+  for ( int p = 0; p < 6; p++ ) {
+    int row    = p / 2;
+    float sign = ( p % 2 ) ? -1.0f : 1.0f;
+    float* pl  = frustum.planes[p];
+    for ( int c = 0; c < 4; c++ ) { pl[c] = PV.m[c * 4 + 3] + sign * PV.m[c * 4 + row]; }
+    float len = sqrtf( pl[0] * pl[0] + pl[1] * pl[1] + pl[2] * pl[2] );
+    for ( int c = 0; c < 4; c++ ) { pl[c] /= len; }
+  }
+}
+
+void bounds_add_sphere( bounds_soa_t& bounds, const vec3& centre, float radius ) {
+  bounds.x.push_back( centre.v[0] );
+  bounds.y.push_back( centre.v[1] );
+  bounds.z.push_back( centre.v[2] );
+  bounds.radius.push_back( radius );
+  bounds.half_x.push_back( radius );
+  bounds.half_y.push_back( radius );
+  bounds.half_z.push_back( radius );
+}
+
+void bounds_add_box( bounds_soa_t& bounds, const vec3& box_min, const vec3& box_max ) {
+  float hx = ( box_max.v[0] - box_min.v[0] ) * 0.5f;
+  float hy = ( box_max.v[1] - box_min.v[1] ) * 0.5f;
+  float hz = ( box_max.v[2] - box_min.v[2] ) * 0.5f;
+  bounds.x.push_back( box_min.v[0] + hx );
+  bounds.y.push_back( box_min.v[1] + hy );
+  bounds.z.push_back( box_min.v[2] + hz );
+  bounds.radius.push_back( sqrtf( hx * hx + hy * hy + hz * hz ) );
+  bounds.half_x.push_back( hx );
+  bounds.half_y.push_back( hy );
+  bounds.half_z.push_back( hz );
+}
+
+void bounds_set_centre( bounds_soa_t& bounds, int i, const vec3& centre ) {
+  bounds.x[i] = centre.v[0];
+  bounds.y[i] = centre.v[1];
+  bounds.z[i] = centre.v[2];
+}
+
+// one object against all planes. the sphere is out if its centre is further
+// than its radius behind any plane
+static bool sphere_visible( const frustum_t& f, const bounds_soa_t& b, int i ) {
+  for ( int p = 0; p < 6; p++ ) {
+    const float* pl = f.planes[p];
+    float d         = ( pl[0] * b.x[i] + pl[1] * b.y[i] ) + ( pl[2] * b.z[i] + pl[3] );
+    if ( d < -b.radius[i] ) { return false; }
+  }
+  return true;
+}
+
+// the box's reach toward a plane is its half sizes dotted with the absolute
+// plane normal
+static bool box_visible( const frustum_t& f, const bounds_soa_t& b, int i ) {
+  for ( int p = 0; p < 6; p++ ) {
+    const float* pl = f.planes[p];
+    float d         = ( pl[0] * b.x[i] + pl[1] * b.y[i] ) + ( pl[2] * b.z[i] + pl[3] );
+    float r         = fabsf( pl[0] ) * b.half_x[i] + fabsf( pl[1] ) * b.half_y[i] + fabsf( pl[2] ) * b.half_z[i];
+    if ( d < -r ) { return false; }
+  }
+  return true;
+}
+
+#ifdef FRUSTUM_AVX
+// 8 objects per loop. the 8-bit mask of survivors is turned into indices
+// without branches: every lane writes its index, but the write position only
+// moves on for lanes that passed
+FRUSTUM_AVX_FUNC static int cull_spheres_avx( const frustum_t& f, const bounds_soa_t& b, int count, int* out ) {
+  __m256 px[6], py[6], pz[6], pw[6];
+  for ( int p = 0; p < 6; p++ ) {
+    px[p] = _mm256_set1_ps( f.planes[p][0] );
+    py[p] = _mm256_set1_ps( f.planes[p][1] );
+    pz[p] = _mm256_set1_ps( f.planes[p][2] );
+    pw[p] = _mm256_set1_ps( f.planes[p][3] );
+  }
+  __m256 zero = _mm256_setzero_ps();
+  int n       = 0;
+  for ( int i = 0; i < count; i += 8 ) {
+    __m256 x      = _mm256_loadu_ps( &b.x[i] );
+    __m256 y      = _mm256_loadu_ps( &b.y[i] );
+    __m256 z      = _mm256_loadu_ps( &b.z[i] );
+    __m256 neg_r  = _mm256_sub_ps( zero, _mm256_loadu_ps( &b.radius[i] ) );
+    __m256 inside = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+    for ( int p = 0; p < 6; p++ ) {
+      __m256 d = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( px[p], x ), _mm256_mul_ps( py[p], y ) ), _mm256_add_ps( _mm256_mul_ps( pz[p], z ), pw[p] ) );
+      inside   = _mm256_and_ps( inside, _mm256_cmp_ps( d, neg_r, _CMP_GE_OQ ) );
+    }
+    int mask = _mm256_movemask_ps( inside );
+    for ( int k = 0; k < 8; k++ ) {
+      out[n] = i + k;
+      n += ( mask >> k ) & 1;
+    }
+  }
+  return n;
+}
+
+FRUSTUM_AVX_FUNC static int cull_boxes_avx( const frustum_t& f, const bounds_soa_t& b, int count, int* out ) {
+  __m256 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+  for ( int p = 0; p < 6; p++ ) {
+    px[p] = _mm256_set1_ps( f.planes[p][0] );
+    py[p] = _mm256_set1_ps( f.planes[p][1] );
+    pz[p] = _mm256_set1_ps( f.planes[p][2] );
+    pw[p] = _mm256_set1_ps( f.planes[p][3] );
+    ax[p] = _mm256_set1_ps( fabsf( f.planes[p][0] ) );
+    ay[p] = _mm256_set1_ps( fabsf( f.planes[p][1] ) );
+    az[p] = _mm256_set1_ps( fabsf( f.planes[p][2] ) );
+  }
+  __m256 zero = _mm256_setzero_ps();
+  int n       = 0;
+  for ( int i = 0; i < count; i += 8 ) {
+    __m256 x      = _mm256_loadu_ps( &b.x[i] );
+    __m256 y      = _mm256_loadu_ps( &b.y[i] );
+    __m256 z      = _mm256_loadu_ps( &b.z[i] );
+    __m256 hx     = _mm256_loadu_ps( &b.half_x[i] );
+    __m256 hy     = _mm256_loadu_ps( &b.half_y[i] );
+    __m256 hz     = _mm256_loadu_ps( &b.half_z[i] );
+    __m256 inside = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+    for ( int p = 0; p < 6; p++ ) {
+      __m256 d = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( px[p], x ), _mm256_mul_ps( py[p], y ) ), _mm256_add_ps( _mm256_mul_ps( pz[p], z ), pw[p] ) );
+      __m256 r = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( ax[p], hx ), _mm256_mul_ps( ay[p], hy ) ), _mm256_mul_ps( az[p], hz ) );
+      inside   = _mm256_and_ps( inside, _mm256_cmp_ps( d, _mm256_sub_ps( zero, r ), _CMP_GE_OQ ) );
+    }
+    int mask = _mm256_movemask_ps( inside );
+    for ( int k = 0; k < 8; k++ ) {
+      out[n] = i + k;
+      n += ( mask >> k ) & 1;
+    }
+  }
+  return n;
+}
+
+static bool use_avx() {
+  static const bool has_avx = cpu_has_avx();
+  return has_avx;
+}
+#endif
+
+int frustum_cull_spheres( const frustum_t& frustum, const bounds_soa_t& bounds, int* visible_ids ) {
+  int count = (int)bounds.x.size();
+  int n = 0, i = 0;
+#ifdef FRUSTUM_AVX
+  if ( use_avx() ) {
+    i = count & ~7;
+    n = cull_spheres_avx( frustum, bounds, i, visible_ids );
+  }
+#endif
+  for ( ; i < count; i++ ) {
+    if ( sphere_visible( frustum, bounds, i ) ) { visible_ids[n++] = i; }
+  }
+  return n;
+}
+
+int frustum_cull_boxes( const frustum_t& frustum, const bounds_soa_t& bounds, int* visible_ids ) {
+  int count = (int)bounds.x.size();
+  int n = 0, i = 0;
+#ifdef FRUSTUM_AVX
+  if ( use_avx() ) {
+    i = count & ~7;
+    n = cull_boxes_avx( frustum, bounds, i, visible_ids );
+  }
+#endif
+  for ( ; i < count; i++ ) {
+    if ( box_visible( frustum, bounds, i ) ) { visible_ids[n++] = i; }
+  }
+  return n;
+}
+
+const char* frustum_cull_path() {
+#ifdef FRUSTUM_AVX
+  if ( use_avx() ) { return "AVX"; }
+#endif
+  return "scalar";
+}
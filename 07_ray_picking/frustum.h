@@ -0,0 +1,56 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| View frustum culling                                                         |
+| The 6 planes of the view volume come straight out of a projection * view     |
+| matrix. Bounds are kept one array per component so that a group of 8 can be  |
+| loaded into AVX registers and tested against each plane at once. Each        |
+| object has both a bounding sphere and a box, sharing one centre, so either   |
+| test can be used. Culling writes the indices of the objects that pass into a |
+| compact list, ready to loop over for drawing.                                |
+\******************************************************************************/
+#ifndef _FRUSTUM_H_
+#define _FRUSTUM_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+// planes are stored as a, b, c, d with a*x + b*y + c*z + d >= 0 inside, and
+// the normal a, b, c of unit length, so that the sum is a distance
+struct frustum_t {
+  float planes[6][4]; // left, right, bottom, top, near, far
+};
+
+// centres, sphere radii, and box half-sizes of a set of objects
+struct bounds_soa_t {
+  std::vector<float> x, y, z;
+  std::vector<float> radius;
+  std::vector<float> half_x, half_y, half_z;
+};
+
+// planes of the view volume of PV = projection * view, in world space. for
+// just P they are in eye space, and for P * V * M in M's local space
+void frustum_from_mat4( const mat4& PV, frustum_t& frustum );
+
+// a sphere. its box is the cube around it
+void bounds_add_sphere( bounds_soa_t& bounds, const vec3& centre, float radius );
+// a box. its sphere is the one through the box's corners
+void bounds_add_box( bounds_soa_t& bounds, const vec3& box_min, const vec3& box_max );
+// moves object i without changing its size
+void bounds_set_centre( bounds_soa_t& bounds, int i, const vec3& centre );
+
+// write the indices of objects that touch the frustum into visible_ids, in
+// order, and return how many there are. visible_ids needs room for every
+// object. a few objects just outside a corner of the frustum can pass
+int frustum_cull_spheres( const frustum_t& frustum, const bounds_soa_t& bounds, int* visible_ids );
+int frustum_cull_boxes( const frustum_t& frustum, const bounds_soa_t& bounds, int* visible_ids );
+
+// "AVX" or "scalar", whichever this CPU runs the tests with
+const char* frustum_cull_path();
+
+#endif
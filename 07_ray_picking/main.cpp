@@ -8,19 +8,41 @@
 |******************************************************************************|
 | Mouse Picking with Ray Casting .                                             |
 \******************************************************************************/
-#include "gl_utils.h"    // common opengl functions and small utilities like logs
-#include "maths_funcs.h" // my maths functions
-#include "obj_parser.h"  // my little Wavefront .obj mesh loader
-#include <GL/glew.h>     // include GLEW and new version of GL on Windows
-#include <GLFW/glfw3.h>  // GLFW helper library
+#include "bvh.h"          // bounding volume hierarchy to speed up ray picking
+#include "fast_inverse.h" // cheaper inverses of rigid, affine, and projection matrices
+#include "frustum.h"      // view frustum culling
+#include "gl_utils.h"     // common opengl functions and small utilities like logs
+#include "maths_funcs.h"  // my maths functions
+#include "obj_parser.h"   // my little Wavefront .obj mesh loader
+#include "scene_graph.h"  // parent/child transforms
+#include <GL/glew.h>      // include GLEW and new version of GL on Windows
+#include <GLFW/glfw3.h>   // GLFW helper library
+#include <algorithm>
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <thread>
+#include <vector>
 #define MESH_FILE "sphere.obj"
 #define VERTEX_SHADER_FILE "test_vs.glsl"
 #define FRAGMENT_SHADER_FILE "test_fs.glsl"
 #define NUM_SPHERES 4
+// the start-up benchmarks take seconds and hundreds of MB before the first
+// frame, so they only run when this is uncommented
+//#define RUN_BENCHMARKS
+// number of spheres in the start-up benchmark of BVH refit vs full rebuild
+#define BENCH_NUM_SPHERES 100000
+// number of bounding volumes in the start-up frustum culling benchmark
+#define BENCH_NUM_BOUNDS 4000000
+// number of points and vectors in the start-up maths functions benchmark
+#define BENCH_NUM_MATHS 1000000
+// number of matrices in the start-up inverse benchmark
+#define BENCH_NUM_INVERSES 200000
+// number of nodes in the start-up scene graph benchmark, and how many of them
+// move each frame
+#define BENCH_NUM_NODES 1000000
+#define BENCH_NUM_MOVING_NODES 10000
 
 // camera matrices. it's easier if they are global
 mat4 view_mat;
@@ -31,6 +53,24 @@ vec3 sphere_pos_wor[]     = { vec3( -2.0, 0.0, 0.0 ), vec3( 2.0, 0.0, 0.0 ), vec
 const float sphere_radius = 1.0f;
 // indicates which sphere is selected
 int g_selected_sphere = -1;
+// picking acceleration structure over the spheres. refit when they move
+bvh_t g_bvh;
+bvh_aabb_t g_sphere_boxes[NUM_SPHERES];
+int g_num_threads = 1;
+// bounding spheres for frustum culling, and the ones that passed this frame
+bounds_soa_t g_sphere_bounds;
+int g_visible_spheres[NUM_SPHERES];
+// the spheres are children of one root node, which gives their model matrices
+scene_graph_t g_scene;
+int g_sphere_nodes[NUM_SPHERES];
+
+/* axis-aligned box around each sphere, for the BVH */
+void update_sphere_boxes( const vec3* centres, int count, float radius, bvh_aabb_t* boxes ) {
+  for ( int i = 0; i < count; i++ ) {
+    boxes[i].min = vec3( centres[i].v[0] - radius, centres[i].v[1] - radius, centres[i].v[2] - radius );
+    boxes[i].max = vec3( centres[i].v[0] + radius, centres[i].v[1] + radius, centres[i].v[2] + radius );
+  }
+}
 
 /* takes mouse position on screen and return ray in world coords */
 vec3 get_ray_from_mouse( float mouse_x, float mouse_y ) {
@@ -43,10 +83,10 @@ vec3 get_ray_from_mouse( float mouse_x, float mouse_y ) {
   // clip space
   vec4 ray_clip = vec4( ray_nds.v[0], ray_nds.v[1], -1.0, 1.0 );
   // eye space
-  vec4 ray_eye = inverse( proj_mat ) * ray_clip;
+  vec4 ray_eye = inverse( proj_mat, TRANSFORM_PERSPECTIVE ) * ray_clip;
   ray_eye      = vec4( ray_eye.v[0], ray_eye.v[1], -1.0, 0.0 );
   // world space
-  vec3 ray_wor = vec3( inverse( view_mat ) * ray_eye );
+  vec3 ray_wor = vec3( inverse( view_mat, TRANSFORM_RIGID ) * ray_eye );
   // don't forget to normalise the vector at some point
   ray_wor = normalise( ray_wor );
   return ray_wor;
@@ -90,6 +130,233 @@ bool ray_sphere( vec3 ray_origin_wor, vec3 ray_direction_wor, vec3 sphere_centre
   return false;
 }
 
+/* lets the BVH call ray_sphere() for each sphere its ray reaches */
+bool ray_sphere_prim( int prim_id, const vec3& ray_origin, const vec3& ray_dir, void* user_data, float* t ) {
+  const vec3* centres = (const vec3*)user_data;
+  return ray_sphere( ray_origin, ray_dir, centres[prim_id], sphere_radius, t );
+}
+
+/* compares refitting a BVH over lots of moving spheres with building it again
+from scratch each frame. results go to the log */
+void benchmark_bvh_refit() {
+  std::vector<vec3> centres( BENCH_NUM_SPHERES );
+  std::vector<bvh_aabb_t> boxes( BENCH_NUM_SPHERES );
+  for ( int i = 0; i < BENCH_NUM_SPHERES; i++ ) {
+    centres[i] = vec3( (float)( rand() % 2000 ) * 0.1f, (float)( rand() % 2000 ) * 0.1f, (float)( rand() % 2000 ) * 0.1f );
+  }
+  update_sphere_boxes( &centres[0], BENCH_NUM_SPHERES, sphere_radius, &boxes[0] );
+  bvh_t bvh;
+  double start = glfwGetTime();
+  bvh_build( bvh, &boxes[0], BENCH_NUM_SPHERES );
+  double build_ms = ( glfwGetTime() - start ) * 1000.0;
+
+  const int frames  = 30;
+  double refit_ms   = 0.0;
+  double update_ms  = 0.0;
+  double rebuild_ms = 0.0;
+  int subtrees      = 0;
+  for ( int f = 0; f < frames; f++ ) {
+    // every sphere wobbles a little each frame
+    for ( int i = 0; i < BENCH_NUM_SPHERES; i++ ) {
+      centres[i].v[0] += 0.5f * sinf( (float)( i + f ) );
+      centres[i].v[1] += 0.5f * cosf( (float)( i * 3 + f ) );
+    }
+    update_sphere_boxes( &centres[0], BENCH_NUM_SPHERES, sphere_radius, &boxes[0] );
+    start = glfwGetTime();
+    bvh_refit( bvh, &boxes[0], g_num_threads );
+    refit_ms += ( glfwGetTime() - start ) * 1000.0;
+    start = glfwGetTime();
+    subtrees += bvh_update( bvh, &boxes[0], g_num_threads );
+    update_ms += ( glfwGetTime() - start ) * 1000.0;
+    bvh_t fresh;
+    start = glfwGetTime();
+    bvh_build( fresh, &boxes[0], BENCH_NUM_SPHERES );
+    rebuild_ms += ( glfwGetTime() - start ) * 1000.0;
+    if ( f == frames - 1 ) { gl_log( "BVH SAH cost after %i frames: refit+update %.2f, full rebuild %.2f\n", frames, bvh_sah_cost( bvh ), bvh_sah_cost( fresh ) ); }
+  }
+  gl_log( "BVH over %i spheres, %i threads: first build %.3fms\n", BENCH_NUM_SPHERES, g_num_threads, build_ms );
+  gl_log( "  per frame: refit %.3fms, refit+partial rebuild %.3fms (%.1f subtrees), full rebuild %.3fms\n", refit_ms / frames, update_ms / frames,
+    (float)subtrees / frames, rebuild_ms / frames );
+}
+
+/* times frustum culling of lots of spheres and boxes scattered around the
+camera, and writes the results to the log */
+void benchmark_frustum_culling() {
+  bounds_soa_t bounds;
+  for ( int i = 0; i < BENCH_NUM_BOUNDS; i++ ) {
+    vec3 centre( (float)( rand() % 2000 ) * 0.1f - 100.0f, (float)( rand() % 2000 ) * 0.1f - 100.0f, (float)( rand() % 2000 ) * 0.1f - 100.0f );
+    float half = (float)( rand() % 100 ) * 0.01f + 0.1f;
+    bounds_add_box( bounds, centre - half, centre + half );
+  }
+  mat4 PV = proj_mat * view_mat;
+  frustum_t frustum;
+  frustum_from_mat4( PV, frustum );
+  std::vector<int> visible( BENCH_NUM_BOUNDS );
+  const int runs = 10;
+  int sphere_count = 0, box_count = 0;
+  double start = glfwGetTime();
+  for ( int r = 0; r < runs; r++ ) { sphere_count = frustum_cull_spheres( frustum, bounds, &visible[0] ); }
+  double sphere_secs = ( glfwGetTime() - start ) / runs;
+  start              = glfwGetTime();
+  for ( int r = 0; r < runs; r++ ) { box_count = frustum_cull_boxes( frustum, bounds, &visible[0] ); }
+  double box_secs = ( glfwGetTime() - start ) / runs;
+  gl_log( "frustum culling %i bounds (%s): spheres %.3fms, %.1f M/s, %i visible. boxes %.3fms, %.1f M/s, %i visible\n", BENCH_NUM_BOUNDS, frustum_cull_path(),
+    sphere_secs * 1000.0, BENCH_NUM_BOUNDS / sphere_secs / 1e6, sphere_count, box_secs * 1000.0, BENCH_NUM_BOUNDS / box_secs / 1e6, box_count );
+}
+
+/* calls that can't be inlined, like the ones every file made when these
+operators were defined in maths_funcs.cpp. the maths benchmark times them
+against the inline ones */
+#if defined( _MSC_VER )
+#define BENCH_NOINLINE __declspec( noinline )
+#elif defined( __GNUC__ )
+#define BENCH_NOINLINE __attribute__( ( noinline ) )
+#else
+#define BENCH_NOINLINE
+#endif
+BENCH_NOINLINE static vec4 call_mul( const mat4& m, const vec4& v ) { return m * v; }
+BENCH_NOINLINE static mat4 call_mul( const mat4& a, const mat4& b ) { return a * b; }
+BENCH_NOINLINE static vec3 call_mul( const vec3& v, float s ) { return v * s; }
+BENCH_NOINLINE static vec3 call_add( const vec3& a, const vec3& b ) { return a + b; }
+BENCH_NOINLINE static vec3 call_sub( const vec3& a, const vec3& b ) { return a - b; }
+BENCH_NOINLINE static void call_add_to( vec3& a, const vec3& b ) { a += b; }
+BENCH_NOINLINE static vec3 call_cross( const vec3& a, const vec3& b ) { return cross( a, b ); }
+BENCH_NOINLINE static float call_dot( const vec3& a, const vec3& b ) { return dot( a, b ); }
+
+/* nanoseconds per mat4*vec4, per mat4*mat4, and per vec3 cross, dot, and
+arithmetic, with inline operators or through the calls above */
+struct maths_times_t {
+  double mat4_vec4, mat4_mat4, vec3_ops;
+  float check; // from each result, so the loops aren't optimised away
+};
+
+static maths_times_t time_maths_funcs( bool out_of_line, const mat4& M, const std::vector<vec4>& points, const std::vector<vec3>& a, const std::vector<vec3>& b ) {
+  maths_times_t times;
+  std::vector<vec4> transformed( BENCH_NUM_MATHS );
+  const int runs = 10;
+  double start   = glfwGetTime();
+  for ( int r = 0; r < runs; r++ ) {
+    if ( out_of_line ) {
+      for ( int i = 0; i < BENCH_NUM_MATHS; i++ ) { transformed[i] = call_mul( M, points[i] ); }
+    } else {
+      for ( int i = 0; i < BENCH_NUM_MATHS; i++ ) { transformed[i] = M * points[i]; }
+    }
+  }
+  times.mat4_vec4 = ( glfwGetTime() - start ) / ( runs * (double)BENCH_NUM_MATHS ) * 1e9;
+  mat4 chain      = identity_mat4();
+  start           = glfwGetTime();
+  for ( int i = 0; i < BENCH_NUM_MATHS; i++ ) {
+    chain       = out_of_line ? call_mul( chain, M ) : chain * M;
+    chain.m[15] = 1.0f; // keep it from drifting
+  }
+  times.mat4_mat4 = ( glfwGetTime() - start ) / (double)BENCH_NUM_MATHS * 1e9;
+  vec3 sum( 0.0f, 0.0f, 0.0f );
+  float dots = 0.0f;
+  start      = glfwGetTime();
+  for ( int r = 0; r < runs; r++ ) {
+    if ( out_of_line ) {
+      for ( int i = 0; i < BENCH_NUM_MATHS; i++ ) {
+        vec3 c = call_cross( a[i], b[i] );
+        call_add_to( sum, call_add( call_mul( call_sub( a[i], b[i] ), 0.5f ), c ) );
+        dots += call_dot( c, b[i] );
+      }
+    } else {
+      for ( int i = 0; i < BENCH_NUM_MATHS; i++ ) {
+        vec3 c = cross( a[i], b[i] );
+        sum += ( a[i] - b[i] ) * 0.5f + c;
+        dots += dot( c, b[i] );
+      }
+    }
+  }
+  times.vec3_ops = ( glfwGetTime() - start ) / ( runs * (double)BENCH_NUM_MATHS ) * 1e9;
+  times.check    = transformed[0].v[0] + chain.m[0] + dots + sum.v[0];
+  return times;
+}
+
+/* times the operators maths_funcs.h now defines inline against calls to the
+same operators that can't be inlined, which is what they cost when they were
+in maths_funcs.cpp */
+void benchmark_maths_funcs() {
+  std::vector<vec4> points( BENCH_NUM_MATHS );
+  std::vector<vec3> a( BENCH_NUM_MATHS ), b( BENCH_NUM_MATHS );
+  for ( int i = 0; i < BENCH_NUM_MATHS; i++ ) {
+    points[i] = vec4( (float)( rand() % 2000 ) * 0.1f, (float)( rand() % 2000 ) * 0.1f, (float)( rand() % 2000 ) * 0.1f, 1.0f );
+    a[i]      = vec3( points[i] );
+    b[i]      = vec3( points[i].v[2], points[i].v[0], points[i].v[1] );
+  }
+  mat4 M                 = rotate_y_deg( translate( identity_mat4(), vec3( 1.0f, 2.0f, 3.0f ) ), 30.0f );
+  maths_times_t inlined  = time_maths_funcs( false, M, points, a, b );
+  maths_times_t outlined = time_maths_funcs( true, M, points, a, b );
+  gl_log( "maths funcs inline vs out-of-line: mat4*vec4 %.2fns vs %.2fns (%.1fx), mat4*mat4 %.2fns vs %.2fns (%.1fx), vec3 cross+dot+arithmetic %.2fns vs %.2fns (%.1fx) "
+          "(%f %f)\n",
+    inlined.mat4_vec4, outlined.mat4_vec4, outlined.mat4_vec4 / inlined.mat4_vec4, inlined.mat4_mat4, outlined.mat4_mat4, outlined.mat4_mat4 / inlined.mat4_mat4,
+    inlined.vec3_ops, outlined.vec3_ops, outlined.vec3_ops / inlined.vec3_ops, inlined.check, outlined.check );
+}
+
+/* times inverting random rigid, affine, and projection matrices with the
+general inverse from maths_funcs and with the short cut for each kind, and
+logs the biggest difference between the two results */
+void benchmark_inverse() {
+  std::vector<mat4> rigid( BENCH_NUM_INVERSES ), affine( BENCH_NUM_INVERSES ), proj( BENCH_NUM_INVERSES );
+  for ( int i = 0; i < BENCH_NUM_INVERSES; i++ ) {
+    mat4 R    = rotate_z_deg( rotate_y_deg( rotate_x_deg( identity_mat4(), (float)( rand() % 360 ) ), (float)( rand() % 360 ) ), (float)( rand() % 360 ) );
+    mat4 T    = translate( identity_mat4(), vec3( (float)( rand() % 200 ) * 0.1f - 10.0f, (float)( rand() % 200 ) * 0.1f - 10.0f, (float)( rand() % 200 ) * 0.1f - 10.0f ) );
+    rigid[i]  = T * R;
+    affine[i] = rigid[i] * scale( identity_mat4(), vec3( (float)( rand() % 100 ) * 0.02f + 0.5f, 1.0f, (float)( rand() % 100 ) * 0.02f + 0.5f ) );
+    proj[i]   = perspective( (float)( rand() % 60 + 30 ), (float)( rand() % 100 ) * 0.01f + 1.0f, 0.1f, 100.0f );
+  }
+  const char* names[]       = { "general (SSE)", "affine", "rigid", "perspective" };
+  transform_kind_t kinds[]  = { TRANSFORM_GENERAL, TRANSFORM_AFFINE, TRANSFORM_RIGID, TRANSFORM_PERSPECTIVE };
+  std::vector<mat4>* sets[] = { &affine, &affine, &rigid, &proj };
+  std::vector<mat4> result( BENCH_NUM_INVERSES );
+  for ( int k = 0; k < 4; k++ ) {
+    const std::vector<mat4>& in = *sets[k];
+    double start                = glfwGetTime();
+    for ( int i = 0; i < BENCH_NUM_INVERSES; i++ ) { result[i] = inverse( in[i] ); }
+    double old_secs = glfwGetTime() - start;
+    float max_diff  = 0.0f;
+    for ( int i = 0; i < BENCH_NUM_INVERSES; i++ ) {
+      mat4 fast = inverse( in[i], kinds[k] );
+      for ( int j = 0; j < 16; j++ ) { max_diff = fmaxf( max_diff, fabsf( fast.m[j] - result[i].m[j] ) ); }
+    }
+    start = glfwGetTime();
+    for ( int i = 0; i < BENCH_NUM_INVERSES; i++ ) { result[i] = inverse( in[i], kinds[k] ); }
+    double fast_secs = glfwGetTime() - start;
+    gl_log( "inverse %s: %.2fns vs general %.2fns, max difference %g\n", names[k], fast_secs / BENCH_NUM_INVERSES * 1e9, old_secs / BENCH_NUM_INVERSES * 1e9,
+      max_diff );
+  }
+}
+
+/* builds a big scene graph of small trees, moves a few of its nodes each
+frame, and logs the time to update just the changed subtrees vs every node */
+void benchmark_scene_graph() {
+  scene_graph_t graph;
+  for ( int i = 0; i < BENCH_NUM_NODES; i++ ) {
+    // 1000 roots, then each node hangs off one near node ( i - 1000 ) / 8
+    int parent = i < 1000 ? -1 : ( i - 1000 ) / 8 + rand() % 4;
+    vec3 pos( (float)( rand() % 200 ) * 0.01f - 1.0f, (float)( rand() % 200 ) * 0.01f - 1.0f, (float)( rand() % 200 ) * 0.01f - 1.0f );
+    scene_graph_add( graph, std::min( parent, i - 1 ), pos, quat_from_axis_deg( (float)( rand() % 360 ), 0.0f, 1.0f, 0.0f ), vec3( 1.0f, 1.0f, 1.0f ) );
+  }
+  scene_graph_update( graph, g_num_threads );
+  const int frames   = 20;
+  int updated        = 0;
+  double update_secs = 0.0;
+  for ( int f = 0; f < frames; f++ ) {
+    for ( int k = 0; k < BENCH_NUM_MOVING_NODES; k++ ) {
+      int node = rand() % BENCH_NUM_NODES;
+      scene_graph_set_position( graph, node, graph.position[node] + vec3( 0.0f, 0.01f, 0.0f ) );
+    }
+    double start = glfwGetTime();
+    updated += scene_graph_update( graph, g_num_threads );
+    update_secs += glfwGetTime() - start;
+  }
+  double start = glfwGetTime();
+  scene_graph_update_all( graph );
+  double all_secs = glfwGetTime() - start;
+  gl_log( "scene graph %i nodes, %i moving, %i threads: dirty update %.3fms/frame (%i nodes), full update %.3fms\n", BENCH_NUM_NODES, BENCH_NUM_MOVING_NODES,
+    g_num_threads, update_secs / frames * 1000.0, updated / frames, all_secs * 1000.0 );
+}
+
 /* this function is called when the mouse buttons are clicked or un-clicked */
 void glfw_mouse_click_callback( GLFWwindow* window, int button, int action, int mods ) {
   // Note: could query if window has lost focus here
@@ -98,20 +365,11 @@ void glfw_mouse_click_callback( GLFWwindow* window, int button, int action, int
     glfwGetCursorPos( g_window, &xpos, &ypos );
     // work out ray
     vec3 ray_wor = get_ray_from_mouse( (float)xpos, (float)ypos );
-    // check ray against all spheres in scene
-    int closest_sphere_clicked = -1;
+    // check ray against the spheres in scene. the BVH skips spheres that the
+    // ray can't reach and returns only the closest one hit
     float closest_intersection = 0.0f;
-    for ( int i = 0; i < NUM_SPHERES; i++ ) {
-      float t_dist = 0.0f;
-      if ( ray_sphere( cam_pos, ray_wor, sphere_pos_wor[i], sphere_radius, &t_dist ) ) {
-        // if more than one sphere is in path of ray, only use the closest one
-        if ( -1 == closest_sphere_clicked || t_dist < closest_intersection ) {
-          closest_sphere_clicked = i;
-          closest_intersection   = t_dist;
-        }
-      }
-    } // endfor
-    g_selected_sphere = closest_sphere_clicked;
+    int closest_sphere_clicked = bvh_ray_closest( g_bvh, cam_pos, ray_wor, ray_sphere_prim, sphere_pos_wor, &closest_intersection );
+    g_selected_sphere          = closest_sphere_clicked;
     printf( "sphere %i was clicked\n", closest_sphere_clicked );
   }
 }
@@ -133,6 +391,14 @@ int main() {
   start_gl();
   // set a function to be called when the mouse is clicked
   glfwSetMouseButtonCallback( g_window, glfw_mouse_click_callback );
+  g_num_threads = (int)std::thread::hardware_concurrency();
+  if ( g_num_threads < 1 ) { g_num_threads = 1; }
+#ifdef RUN_BENCHMARKS
+  benchmark_bvh_refit();
+  benchmark_maths_funcs();
+  benchmark_inverse();
+  benchmark_scene_graph();
+#endif
   /*------------------------------CREATE
    * GEOMETRY-------------------------------*/
   GLfloat* vp       = NULL; // array of vertex points
@@ -180,9 +446,26 @@ int main() {
   vec4 up( 0.0f, 1.0f, 0.0f, 0.0f );
 
   /*---------------------------SET RENDERING DEFAULTS---------------------------*/
-  // unique model matrix for each sphere
-  mat4 model_mats[NUM_SPHERES];
-  for ( int i = 0; i < NUM_SPHERES; i++ ) { model_mats[i] = translate( identity_mat4(), sphere_pos_wor[i] ); }
+  // unique model matrix for each sphere, from its node in the scene graph
+  versor no_rotation = quat_from_axis_deg( 0.0f, 0.0f, 1.0f, 0.0f );
+  int sphere_root    = scene_graph_add( g_scene, -1, vec3( 0.0f, 0.0f, 0.0f ), no_rotation, vec3( 1.0f, 1.0f, 1.0f ) );
+  for ( int i = 0; i < NUM_SPHERES; i++ ) { g_sphere_nodes[i] = scene_graph_add( g_scene, sphere_root, sphere_pos_wor[i], no_rotation, vec3( 1.0f, 1.0f, 1.0f ) ); }
+  scene_graph_update( g_scene, 1 );
+  // build the picking BVH once. press M to set the spheres moving, after which
+  // the BVH is only refit each frame
+  update_sphere_boxes( sphere_pos_wor, NUM_SPHERES, sphere_radius, g_sphere_boxes );
+  bvh_build( g_bvh, g_sphere_boxes, NUM_SPHERES );
+  for ( int i = 0; i < NUM_SPHERES; i++ ) { bounds_add_sphere( g_sphere_bounds, sphere_pos_wor[i], sphere_radius ); }
+#ifdef RUN_BENCHMARKS
+  benchmark_frustum_culling();
+#endif
+  vec3 sphere_home_wor[NUM_SPHERES];
+  for ( int i = 0; i < NUM_SPHERES; i++ ) { sphere_home_wor[i] = sphere_pos_wor[i]; }
+  bool spheres_moving  = false;
+  bool move_key_down   = false;
+  double refit_ms      = 0.0;
+  int refit_frames     = 0;
+  double last_log_time = glfwGetTime();
 
   glEnable( GL_DEPTH_TEST );          // enable depth-testing
   glDepthFunc( GL_LESS );             // depth-testing interprets a smaller value as "closer"
@@ -204,18 +487,45 @@ int main() {
     glViewport( 0, 0, g_gl_framebuffer_width, g_gl_framebuffer_height );
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
+    if ( spheres_moving ) {
+      // bob the spheres up and down and update the BVH to match
+      for ( int i = 0; i < NUM_SPHERES; i++ ) {
+        sphere_pos_wor[i]      = sphere_home_wor[i];
+        sphere_pos_wor[i].v[1] = sphere_home_wor[i].v[1] + sinf( (float)current_seconds + (float)i );
+        scene_graph_set_position( g_scene, g_sphere_nodes[i], sphere_pos_wor[i] );
+        bounds_set_centre( g_sphere_bounds, i, sphere_pos_wor[i] );
+      }
+      scene_graph_update( g_scene, g_num_threads );
+      update_sphere_boxes( sphere_pos_wor, NUM_SPHERES, sphere_radius, g_sphere_boxes );
+      double refit_start = glfwGetTime();
+      bvh_update( g_bvh, g_sphere_boxes, g_num_threads );
+      refit_ms += ( glfwGetTime() - refit_start ) * 1000.0;
+      refit_frames++;
+      if ( current_seconds - last_log_time > 1.0 ) {
+        gl_log( "BVH refit %.4fms/frame\n", refit_ms / refit_frames );
+        refit_ms      = 0.0;
+        refit_frames  = 0;
+        last_log_time = current_seconds;
+      }
+    }
+
     glUseProgram( shader_programme );
     glUniformMatrix4fv( view_mat_location, 1, GL_FALSE, view_mat.m );
     glUniformMatrix4fv( proj_mat_location, 1, GL_FALSE, proj_mat.m );
     glBindVertexArray( vao );
 
-    for ( int i = 0; i < NUM_SPHERES; i++ ) {
+    // only draw spheres that are at least partly in view
+    frustum_t frustum;
+    frustum_from_mat4( proj_mat * view_mat, frustum );
+    int visible_count = frustum_cull_spheres( frustum, g_sphere_bounds, g_visible_spheres );
+    for ( int v = 0; v < visible_count; v++ ) {
+      int i = g_visible_spheres[v];
       if ( g_selected_sphere == i ) {
         glUniform1f( blue_location, 1.0f );
       } else {
         glUniform1f( blue_location, 0.0f );
       }
-      glUniformMatrix4fv( model_mat_location, 1, GL_FALSE, model_mats[i].m );
+      glUniformMatrix4fv( model_mat_location, 1, GL_FALSE, g_scene.world[g_sphere_nodes[i]].m );
       glDrawArrays( GL_TRIANGLES, 0, g_point_count );
     }
     // update other events like input handling
@@ -305,7 +615,14 @@ int main() {
       cam_pos = cam_pos + vec3( rgt ) * move.v[0];
       mat4 T  = translate( identity_mat4(), vec3( cam_pos ) );
 
-      view_mat = inverse( R ) * inverse( T );
+      view_mat = inverse( R, TRANSFORM_RIGID ) * inverse( T, TRANSFORM_RIGID );
+    }
+
+    if ( glfwGetKey( g_window, GLFW_KEY_M ) ) {
+      if ( !move_key_down ) { spheres_moving = !spheres_moving; }
+      move_key_down = true;
+    } else {
+      move_key_down = false;
     }
 
     if ( GLFW_PRESS == glfwGetKey( g_window, GLFW_KEY_ESCAPE ) ) { glfwSetWindowShouldClose( g_window, 1 ); }
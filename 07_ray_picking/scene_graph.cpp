@@ -0,0 +1,137 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Transform hierarchy. See scene_graph.h                                       |
+\******************************************************************************/
+#include "scene_graph.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// below this many nodes to recompute, starting threads costs more than it saves
+#define SCENE_GRAPH_MIN_PARALLEL_NODES 4096
+// dirty subtrees handed to a thread at a time
+#define SCENE_GRAPH_SUBTREES_PER_TASK 64
+
+static void mark_dirty( scene_graph_t& g, int node ) {
+  if ( g.dirty[node] ) { return; }
+  g.dirty[node] = 1;
+  g.dirty_nodes.push_back( node );
+}
+
+int scene_graph_add( scene_graph_t& g, int parent, const vec3& position, const versor& rotation, const vec3& scale ) {
+  int node = (int)g.parent.size();
+  g.parent.push_back( parent );
+  g.first_child.push_back( -1 );
+  g.next_sibling.push_back( -1 );
+  if ( parent >= 0 ) {
+    g.next_sibling[node]  = g.first_child[parent];
+    g.first_child[parent] = node;
+  }
+  g.position.push_back( position );
+  g.rotation.push_back( rotation );
+  g.scale.push_back( scale );
+  g.world.push_back( identity_mat4() );
+  g.dirty.push_back( 0 );
+  g.visited.push_back( 0 );
+  mark_dirty( g, node );
+  return node;
+}
+
+void scene_graph_set_position( scene_graph_t& g, int node, const vec3& position ) {
+  g.position[node] = position;
+  mark_dirty( g, node );
+}
+
+void scene_graph_set_rotation( scene_graph_t& g, int node, const versor& rotation ) {
+  g.rotation[node] = rotation;
+  mark_dirty( g, node );
+}
+
+void scene_graph_set_scale( scene_graph_t& g, int node, const vec3& scale ) {
+  g.scale[node] = scale;
+  mark_dirty( g, node );
+}
+
+/* parent's world matrix * translation * rotation * scale */
+static void update_world( scene_graph_t& g, int node ) {
+  mat4 local    = quat_to_mat4( g.rotation[node] );
+  const vec3& s = g.scale[node];
+  const vec3& p = g.position[node];
+  for ( int r = 0; r < 3; r++ ) {
+    local.m[r]     *= s.v[0];
+    local.m[4 + r] *= s.v[1];
+    local.m[8 + r] *= s.v[2];
+    local.m[12 + r] = p.v[r];
+  }
+  int parent    = g.parent[node];
+  g.world[node] = parent < 0 ? local : g.world[parent] * local;
+}
+
+/* appends node and everything below it to the update order, parents first */
+static void gather_subtree( scene_graph_t& g, int root ) {
+  size_t start = g.update_order.size();
+  g.update_order.push_back( root );
+  g.visited[root] = 1;
+  for ( size_t i = start; i < g.update_order.size(); i++ ) {
+    for ( int c = g.first_child[g.update_order[i]]; c >= 0; c = g.next_sibling[c] ) {
+      g.update_order.push_back( c );
+      g.visited[c] = 1;
+    }
+  }
+}
+
+int scene_graph_update( scene_graph_t& g, int thread_count ) {
+  /* a parent's index is always lower than its children's, so in sorted order
+  a dirty node's dirty ancestors come first and have already gathered it */
+  std::sort( g.dirty_nodes.begin(), g.dirty_nodes.end() );
+  g.update_order.clear();
+  g.subtree_starts.clear();
+  for ( size_t i = 0; i < g.dirty_nodes.size(); i++ ) {
+    int node      = g.dirty_nodes[i];
+    g.dirty[node] = 0;
+    if ( g.visited[node] ) { continue; }
+    g.subtree_starts.push_back( (int)g.update_order.size() );
+    gather_subtree( g, node );
+  }
+  g.dirty_nodes.clear();
+  int node_count    = (int)g.update_order.size();
+  int subtree_count = (int)g.subtree_starts.size();
+  g.subtree_starts.push_back( node_count );
+
+  /* subtrees don't overlap, and each one's parent isn't changing, so they can
+  be done in any order. within one, the order has parents first */
+  if ( thread_count < 2 || node_count < SCENE_GRAPH_MIN_PARALLEL_NODES ) {
+    for ( int i = 0; i < node_count; i++ ) { update_world( g, g.update_order[i] ); }
+  } else {
+    std::atomic<int> next_subtree( 0 );
+    std::vector<std::thread> threads;
+    for ( int t = 0; t < thread_count; t++ ) {
+      threads.push_back( std::thread( [&]() {
+        for ( ;; ) {
+          int first = next_subtree.fetch_add( SCENE_GRAPH_SUBTREES_PER_TASK );
+          if ( first >= subtree_count ) { break; }
+          int last = std::min( first + SCENE_GRAPH_SUBTREES_PER_TASK, subtree_count );
+          for ( int i = g.subtree_starts[first]; i < g.subtree_starts[last]; i++ ) { update_world( g, g.update_order[i] ); }
+        }
+      } ) );
+    }
+    for ( size_t t = 0; t < threads.size(); t++ ) { threads[t].join(); }
+  }
+  for ( int i = 0; i < node_count; i++ ) { g.visited[g.update_order[i]] = 0; }
+  return node_count;
+}
+
+void scene_graph_update_all( scene_graph_t& g ) {
+  int node_count = (int)g.parent.size();
+  for ( int i = 0; i < node_count; i++ ) {
+    update_world( g, i );
+    g.dirty[i] = 0;
+  }
+  g.dirty_nodes.clear();
+}
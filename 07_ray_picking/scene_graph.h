@@ -0,0 +1,56 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Transform hierarchy                                                          |
+| Each node has a position, rotation, and scale relative to its parent, and a  |
+| world matrix worked out from those and the parent's world matrix. Nodes are  |
+| kept in flat arrays, and a node can only be added after its parent, so a     |
+| parent always comes before its children. Changing a node marks it dirty;     |
+| an update recomputes the world matrices of dirty nodes and everything below  |
+| them, and nothing else. Separate dirty subtrees are shared between threads.  |
+\******************************************************************************/
+#ifndef _SCENE_GRAPH_H_
+#define _SCENE_GRAPH_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+struct scene_graph_t {
+  // one entry per node
+  std::vector<int> parent;       // -1 for a root
+  std::vector<int> first_child;  // -1 if none
+  std::vector<int> next_sibling; // -1 if none
+  std::vector<vec3> position;
+  std::vector<versor> rotation;
+  std::vector<vec3> scale;
+  std::vector<mat4> world; // valid for every node after scene_graph_update()
+  std::vector<unsigned char> dirty;
+
+  // nodes changed since the last update, and working space for the update
+  std::vector<int> dirty_nodes;
+  std::vector<unsigned char> visited;
+  std::vector<int> update_order;
+  std::vector<int> subtree_starts;
+};
+
+// adds a node and returns its index. parent is -1 for a root, or a node
+// already in the graph. new nodes are dirty
+int scene_graph_add( scene_graph_t& graph, int parent, const vec3& position, const versor& rotation, const vec3& scale );
+
+void scene_graph_set_position( scene_graph_t& graph, int node, const vec3& position );
+void scene_graph_set_rotation( scene_graph_t& graph, int node, const versor& rotation );
+void scene_graph_set_scale( scene_graph_t& graph, int node, const vec3& scale );
+
+// recomputes world matrices below every dirty node, on thread_count threads.
+// returns the number of nodes recomputed
+int scene_graph_update( scene_graph_t& graph, int thread_count );
+
+// recomputes every world matrix in order, ignoring the dirty flags
+void scene_graph_update_all( scene_graph_t& graph );
+
+#endif
@@ -0,0 +1,140 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Fast inverse tests                                                           |
+| Checks that M * inverse( M, kind ) comes out as the identity for random      |
+| rigid, affine, perspective and general matrices, including general ones      |
+| that are nearly singular, and that each is as accurate as the old inverse()  |
+| in maths_funcs. Build and run with "make -f Makefile.linux64 test".          |
+\******************************************************************************/
+#include "fast_inverse.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define TEST_MATRICES 10000
+// largest difference from the identity allowed for a well-behaved matrix
+#define TEST_TOLERANCE 1e-4f
+
+static int g_failures = 0;
+
+#define CHECK( cond )                                                       \
+  do {                                                                      \
+    if ( !( cond ) ) {                                                      \
+      fprintf( stderr, "FAILED %s:%i: %s\n", __FILE__, __LINE__, #cond );   \
+      g_failures++;                                                         \
+    }                                                                       \
+  } while ( 0 )
+
+static float random_float( float lo, float hi ) { return lo + ( hi - lo ) * (float)rand() / (float)RAND_MAX; }
+
+static vec3 random_vec3( float lo, float hi ) { return vec3( random_float( lo, hi ), random_float( lo, hi ), random_float( lo, hi ) ); }
+
+/* largest difference between any element of M * inverse and the identity */
+static float identity_error( const mat4& m, const mat4& inv ) {
+  mat4 p      = m * inv;
+  float error = 0.0f;
+  for ( int i = 0; i < 16; i++ ) { error = fmaxf( error, fabsf( p.m[i] - ( i % 5 == 0 ? 1.0f : 0.0f ) ) ); }
+  return error;
+}
+
+static mat4 random_rigid() {
+  mat4 R = rotate_z_deg( rotate_y_deg( rotate_x_deg( identity_mat4(), random_float( 0.0f, 360.0f ) ), random_float( 0.0f, 360.0f ) ), random_float( 0.0f, 360.0f ) );
+  return translate( identity_mat4(), random_vec3( -10.0f, 10.0f ) ) * R;
+}
+
+/* a rotation and translation with an uneven scale and a shear */
+static mat4 random_affine() {
+  mat4 S = scale( identity_mat4(), random_vec3( 0.25f, 4.0f ) );
+  mat4 H = identity_mat4();
+  H.m[4] = random_float( -1.0f, 1.0f );
+  H.m[8] = random_float( -1.0f, 1.0f );
+  return random_rigid() * S * H;
+}
+
+static mat4 random_perspective() { return perspective( random_float( 20.0f, 120.0f ), random_float( 0.5f, 2.5f ), random_float( 0.01f, 1.0f ), random_float( 10.0f, 1000.0f ) ); }
+
+/* any 4x4, kept away from singular by a heavier diagonal */
+static mat4 random_general() {
+  mat4 m;
+  for ( int i = 0; i < 16; i++ ) { m.m[i] = random_float( -1.0f, 1.0f ) + ( i % 5 == 0 ? 4.0f : 0.0f ); }
+  return m;
+}
+
+/* each kind against its own short cut and against the old inverse() */
+static void test_kinds() {
+  const char* names[]      = { "general", "affine", "rigid", "perspective" };
+  transform_kind_t kinds[] = { TRANSFORM_GENERAL, TRANSFORM_AFFINE, TRANSFORM_RIGID, TRANSFORM_PERSPECTIVE };
+  for ( int k = 0; k < 4; k++ ) {
+    float worst = 0.0f, worst_old = 0.0f;
+    for ( int i = 0; i < TEST_MATRICES; i++ ) {
+      mat4 m;
+      switch ( kinds[k] ) {
+      case TRANSFORM_AFFINE: m = random_affine(); break;
+      case TRANSFORM_RIGID: m = random_rigid(); break;
+      case TRANSFORM_PERSPECTIVE: m = random_perspective(); break;
+      default: m = random_general(); break;
+      }
+      worst     = fmaxf( worst, identity_error( m, inverse( m, kinds[k] ) ) );
+      worst_old = fmaxf( worst_old, identity_error( m, inverse( m ) ) );
+      // any affine or rigid matrix is also a general one
+      if ( TRANSFORM_PERSPECTIVE != kinds[k] ) { worst = fmaxf( worst, identity_error( m, inverse_general( m ) ) ); }
+    }
+    printf( "%s: largest error %g, old inverse() %g\n", names[k], worst, worst_old );
+    CHECK( worst < TEST_TOLERANCE );
+    CHECK( worst <= 2.0f * worst_old + 1e-6f );
+  }
+}
+
+/* a general matrix whose last column is nearly a mix of the others, so its
+determinant is tiny. the identity can't come out exactly, and how far off it is
+swings a lot from one matrix to the next, so the typical and the 99th
+percentile errors of the SSE inverse are held to those of the old one */
+static void test_near_singular() {
+  const float nearness[] = { 1e-2f, 1e-3f, 1e-4f };
+  for ( int n = 0; n < 3; n++ ) {
+    std::vector<float> errors, errors_old;
+    for ( int i = 0; i < TEST_MATRICES; i++ ) {
+      mat4 m  = random_general();
+      float a = random_float( -1.0f, 1.0f ), b = random_float( -1.0f, 1.0f );
+      for ( int r = 0; r < 4; r++ ) { m.m[12 + r] = a * m.m[r] + b * m.m[4 + r] + nearness[n] * random_float( -1.0f, 1.0f ); }
+      if ( 0.0f == determinant( m ) ) { continue; }
+      errors.push_back( identity_error( m, inverse_general( m ) ) );
+      errors_old.push_back( identity_error( m, inverse( m ) ) );
+      CHECK( errors.back() == errors.back() ); // not NaN
+    }
+    std::sort( errors.begin(), errors.end() );
+    std::sort( errors_old.begin(), errors_old.end() );
+    size_t median = errors.size() / 2, p99 = errors.size() * 99 / 100;
+    printf( "nearly singular by %g: median error %g, old %g; 99th percentile %g, old %g\n", nearness[n], errors[median], errors_old[median], errors[p99], errors_old[p99] );
+    CHECK( errors[median] <= 2.0f * errors_old[median] );
+    CHECK( errors[p99] <= 2.0f * errors_old[p99] );
+  }
+
+  // with no inverse at all, the matrix comes back, as from the old inverse()
+  mat4 singular = random_general();
+  for ( int r = 0; r < 4; r++ ) { singular.m[12 + r] = 2.0f * singular.m[r]; }
+  mat4 fast = inverse_general( singular );
+  bool same = true;
+  for ( int i = 0; i < 16; i++ ) { same = same && fast.m[i] == singular.m[i]; }
+  CHECK( same );
+}
+
+int main() {
+  srand( 1 );
+  test_kinds();
+  test_near_singular();
+  if ( g_failures ) {
+    fprintf( stderr, "%i checks failed\n", g_failures );
+    return 1;
+  }
+  printf( "fast_inverse_test passed\n" );
+  return 0;
+}
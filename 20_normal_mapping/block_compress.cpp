@@ -0,0 +1,545 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Block-compressed textures. See block_compress.h                              |
+\******************************************************************************/
+#include "block_compress.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define BLOCK_COMPRESS_SSE
+#endif
+
+// a thread is only worth starting for this many blocks
+#define BC_MIN_BLOCKS_PER_THREAD 1024
+// power iterations to find a block's principal colour axis
+#define BC_AXIS_ITERATIONS 8
+
+const char *bc_path() {
+#ifdef BLOCK_COMPRESS_SSE
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
+
+int bc_block_bytes( bc_format_t format ) { return format == BC_FORMAT_BC1 ? 8 : 16; }
+
+size_t bc_image_bytes( bc_format_t format, int width, int height ) {
+	return (size_t)( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * bc_block_bytes( format );
+}
+
+/* for each of the 16 texels, the nearest of steps + 1 evenly spaced points
+from "from" to "to", as 0 to steps. channels holds channel_count arrays of 16 */
+static void project_indices( const float *const *channels, int channel_count, const float *from,
+														 const float *to, int steps, int *out ) {
+	float d[3];
+	float dd = 0.0f;
+	for ( int c = 0; c < channel_count; c++ ) {
+		d[c] = to[c] - from[c];
+		dd += d[c] * d[c];
+	}
+	if ( dd <= 0.0f ) {
+		memset( out, 0, 16 * sizeof( int ) );
+		return;
+	}
+	float scale = (float)steps / dd;
+#ifdef BLOCK_COMPRESS_SSE
+	for ( int i = 0; i < 16; i += 4 ) {
+		__m128 t = _mm_setzero_ps();
+		for ( int c = 0; c < channel_count; c++ ) {
+			__m128 offset = _mm_sub_ps( _mm_loadu_ps( channels[c] + i ), _mm_set1_ps( from[c] ) );
+			t = _mm_add_ps( t, _mm_mul_ps( offset, _mm_set1_ps( d[c] ) ) );
+		}
+		t = _mm_add_ps( _mm_mul_ps( t, _mm_set1_ps( scale ) ), _mm_set1_ps( 0.5f ) );
+		t = _mm_min_ps( _mm_max_ps( t, _mm_setzero_ps() ), _mm_set1_ps( (float)steps ) );
+		_mm_storeu_si128( (__m128i *)( out + i ), _mm_cvttps_epi32( t ) );
+	}
+#else
+	for ( int i = 0; i < 16; i++ ) {
+		float t = 0.0f;
+		for ( int c = 0; c < channel_count; c++ ) {
+			t += ( channels[c][i] - from[c] ) * d[c];
+		}
+		t = std::min( std::max( t * scale + 0.5f, 0.0f ), (float)steps );
+		out[i] = (int)t;
+	}
+#endif
+}
+
+static int pack_565( const float *rgb ) {
+	int r = std::min( std::max( (int)( rgb[0] * ( 31.0f / 255.0f ) + 0.5f ), 0 ), 31 );
+	int g = std::min( std::max( (int)( rgb[1] * ( 63.0f / 255.0f ) + 0.5f ), 0 ), 63 );
+	int b = std::min( std::max( (int)( rgb[2] * ( 31.0f / 255.0f ) + 0.5f ), 0 ), 31 );
+	return ( r << 11 ) | ( g << 5 ) | b;
+}
+
+static void unpack_565( int c, int *rgb ) {
+	int r = ( c >> 11 ) & 31, g = ( c >> 5 ) & 63, b = c & 31;
+	rgb[0] = ( r << 3 ) | ( r >> 2 );
+	rgb[1] = ( g << 2 ) | ( g >> 4 );
+	rgb[2] = ( b << 3 ) | ( b >> 2 );
+}
+
+/* a 4-colour BC1 block from end points near hi and lo. returns the squared
+error, and writes the end points and each texel's step, 0 at c0 to 3 at c1 */
+static float try_end_points( const float *const *rgb, const float *hi, const float *lo, int *c0,
+														 int *c1, int *steps ) {
+	*c0 = pack_565( hi );
+	*c1 = pack_565( lo );
+	// c0 > c1 is what says 4 colours, not 3 and transparent black
+	if ( *c0 < *c1 ) {
+		std::swap( *c0, *c1 );
+	}
+	int e0[3], e1[3];
+	unpack_565( *c0, e0 );
+	unpack_565( *c1, e1 );
+	float from[3] = { (float)e0[0], (float)e0[1], (float)e0[2] };
+	float to[3] = { (float)e1[0], (float)e1[1], (float)e1[2] };
+	if ( *c0 == *c1 ) {
+		memset( steps, 0, 16 * sizeof( int ) );
+	} else {
+		project_indices( rgb, 3, from, to, 3, steps );
+	}
+	float error = 0.0f;
+	for ( int i = 0; i < 16; i++ ) {
+		float t = steps[i] / 3.0f;
+		for ( int c = 0; c < 3; c++ ) {
+			float d = from[c] + ( to[c] - from[c] ) * t - rgb[c][i];
+			error += d * d;
+		}
+	}
+	return error;
+}
+
+/* the end points that best fit the texels for the steps they were given */
+static bool refit_end_points( const float *const *rgb, const int *steps, float *hi, float *lo ) {
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+	for ( int i = 0; i < 16; i++ ) {
+		float b = steps[i] / 3.0f;
+		float a = 1.0f - b;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for ( int c = 0; c < 3; c++ ) {
+			ax[c] += a * rgb[c][i];
+			bx[c] += b * rgb[c][i];
+		}
+	}
+	float det = aa * bb - ab * ab;
+	if ( fabsf( det ) < 1e-6f ) {
+		return false;
+	}
+	for ( int c = 0; c < 3; c++ ) {
+		hi[c] = std::min( std::max( ( ax[c] * bb - bx[c] * ab ) / det, 0.0f ), 255.0f );
+		lo[c] = std::min( std::max( ( bx[c] * aa - ax[c] * ab ) / det, 0.0f ), 255.0f );
+	}
+	return true;
+}
+
+/* writes an 8-byte BC1 colour block for 16 RGBA texels */
+static void encode_colour( const unsigned char *texels, unsigned char *out ) {
+	float r[16], g[16], b[16];
+	const float *rgb[3] = { r, g, b };
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	float lowest[3] = { 255.0f, 255.0f, 255.0f }, highest[3] = { 0.0f, 0.0f, 0.0f };
+	for ( int i = 0; i < 16; i++ ) {
+		r[i] = texels[i * 4];
+		g[i] = texels[i * 4 + 1];
+		b[i] = texels[i * 4 + 2];
+		for ( int c = 0; c < 3; c++ ) {
+			mean[c] += rgb[c][i];
+			lowest[c] = std::min( lowest[c], rgb[c][i] );
+			highest[c] = std::max( highest[c], rgb[c][i] );
+		}
+	}
+	for ( int c = 0; c < 3; c++ ) {
+		mean[c] /= 16.0f;
+	}
+	// covariance, then its biggest eigenvector, starting from the bounding box
+	float cov[3][3] = { { 0.0f } };
+	for ( int i = 0; i < 16; i++ ) {
+		float d[3] = { r[i] - mean[0], g[i] - mean[1], b[i] - mean[2] };
+		for ( int j = 0; j < 3; j++ ) {
+			for ( int k = 0; k < 3; k++ ) {
+				cov[j][k] += d[j] * d[k];
+			}
+		}
+	}
+	float axis[3] = { highest[0] - lowest[0], highest[1] - lowest[1], highest[2] - lowest[2] };
+	for ( int it = 0; it < BC_AXIS_ITERATIONS; it++ ) {
+		float next[3];
+		for ( int j = 0; j < 3; j++ ) {
+			next[j] = cov[j][0] * axis[0] + cov[j][1] * axis[1] + cov[j][2] * axis[2];
+		}
+		float biggest = std::max( fabsf( next[0] ), std::max( fabsf( next[1] ), fabsf( next[2] ) ) );
+		if ( biggest <= 0.0f ) {
+			break;
+		}
+		for ( int j = 0; j < 3; j++ ) {
+			axis[j] = next[j] / biggest;
+		}
+	}
+	float len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float hi[3] = { mean[0], mean[1], mean[2] }, lo[3] = { mean[0], mean[1], mean[2] };
+	if ( len2 > 0.0f ) {
+		float tmin = 0.0f, tmax = 0.0f;
+		for ( int i = 0; i < 16; i++ ) {
+			float t = ( ( r[i] - mean[0] ) * axis[0] + ( g[i] - mean[1] ) * axis[1] +
+									( b[i] - mean[2] ) * axis[2] ) /
+								len2;
+			tmin = std::min( tmin, t );
+			tmax = std::max( tmax, t );
+		}
+		for ( int c = 0; c < 3; c++ ) {
+			hi[c] = std::min( std::max( mean[c] + axis[c] * tmax, 0.0f ), 255.0f );
+			lo[c] = std::min( std::max( mean[c] + axis[c] * tmin, 0.0f ), 255.0f );
+		}
+	}
+
+	int c0, c1, steps[16];
+	float error = try_end_points( rgb, hi, lo, &c0, &c1, steps );
+	if ( error > 0.0f && refit_end_points( rgb, steps, hi, lo ) ) {
+		int refit_c0, refit_c1, refit_steps[16];
+		float refit_error = try_end_points( rgb, hi, lo, &refit_c0, &refit_c1, refit_steps );
+		if ( refit_error < error ) {
+			c0 = refit_c0;
+			c1 = refit_c1;
+			memcpy( steps, refit_steps, sizeof( steps ) );
+		}
+	}
+
+	// palette order is c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+	static const unsigned int index_of_step[4] = { 0, 2, 3, 1 };
+	unsigned int indices = 0;
+	for ( int i = 0; i < 16; i++ ) {
+		indices |= index_of_step[steps[i]] << ( 2 * i );
+	}
+	out[0] = (unsigned char)( c0 & 0xFF );
+	out[1] = (unsigned char)( c0 >> 8 );
+	out[2] = (unsigned char)( c1 & 0xFF );
+	out[3] = (unsigned char)( c1 >> 8 );
+	for ( int i = 0; i < 4; i++ ) {
+		out[4 + i] = (unsigned char)( indices >> ( 8 * i ) );
+	}
+}
+
+/* writes an 8-byte BC4 block for one channel of 16 RGBA texels */
+static void encode_channel( const unsigned char *texels, int channel, unsigned char *out ) {
+	float v[16];
+	float lowest = 255.0f, highest = 0.0f;
+	for ( int i = 0; i < 16; i++ ) {
+		v[i] = texels[i * 4 + channel];
+		lowest = std::min( lowest, v[i] );
+		highest = std::max( highest, v[i] );
+	}
+	// a0 > a1 gives 8 values, a0, a1, and 6 evenly between
+	out[0] = (unsigned char)highest;
+	out[1] = (unsigned char)lowest;
+	memset( out + 2, 0, 6 );
+	if ( highest == lowest ) {
+		return;
+	}
+	const float *channels[1] = { v };
+	int steps[16];
+	project_indices( channels, 1, &lowest, &highest, 7, steps );
+	unsigned long long indices = 0;
+	for ( int i = 0; i < 16; i++ ) {
+		// step 7 is a0, step 0 is a1, and steps 6 down to 1 are indices 2 to 7
+		int index = steps[i] == 7 ? 0 : ( steps[i] == 0 ? 1 : 8 - steps[i] );
+		indices |= (unsigned long long)index << ( 3 * i );
+	}
+	for ( int i = 0; i < 6; i++ ) {
+		out[2 + i] = (unsigned char)( indices >> ( 8 * i ) );
+	}
+}
+
+static void decode_colour( const unsigned char *in, bool four_colours_only, unsigned char *texels ) {
+	int c0 = in[0] | ( in[1] << 8 ), c1 = in[2] | ( in[3] << 8 );
+	int palette[4][4];
+	unpack_565( c0, palette[0] );
+	unpack_565( c1, palette[1] );
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+	for ( int c = 0; c < 3; c++ ) {
+		if ( c0 > c1 || four_colours_only ) {
+			palette[2][c] = ( 2 * palette[0][c] + palette[1][c] ) / 3;
+			palette[3][c] = ( palette[0][c] + 2 * palette[1][c] ) / 3;
+		} else {
+			palette[2][c] = ( palette[0][c] + palette[1][c] ) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	if ( c0 <= c1 && !four_colours_only ) {
+		palette[3][3] = 0;
+	}
+	unsigned int indices = in[4] | ( in[5] << 8 ) | ( in[6] << 16 ) | ( (unsigned int)in[7] << 24 );
+	for ( int i = 0; i < 16; i++ ) {
+		const int *p = palette[( indices >> ( 2 * i ) ) & 3];
+		for ( int c = 0; c < 4; c++ ) {
+			texels[i * 4 + c] = (unsigned char)p[c];
+		}
+	}
+}
+
+static void decode_channel( const unsigned char *in, int channel, unsigned char *texels ) {
+	int a0 = in[0], a1 = in[1];
+	int values[8] = { a0, a1 };
+	if ( a0 > a1 ) {
+		for ( int i = 1; i < 7; i++ ) {
+			values[i + 1] = ( ( 7 - i ) * a0 + i * a1 ) / 7;
+		}
+	} else {
+		for ( int i = 1; i < 5; i++ ) {
+			values[i + 1] = ( ( 5 - i ) * a0 + i * a1 ) / 5;
+		}
+		values[6] = 0;
+		values[7] = 255;
+	}
+	unsigned long long indices = 0;
+	for ( int i = 0; i < 6; i++ ) {
+		indices |= (unsigned long long)in[2 + i] << ( 8 * i );
+	}
+	for ( int i = 0; i < 16; i++ ) {
+		texels[i * 4 + channel] = (unsigned char)values[( indices >> ( 3 * i ) ) & 7];
+	}
+}
+
+/* copies block bx, by into 16 RGBA texels, repeating the last row and column of
+images that aren't a multiple of 4 */
+static void gather_block( const unsigned char *pixels, int width, int height, int bx, int by,
+													unsigned char *texels ) {
+	for ( int y = 0; y < 4; y++ ) {
+		int sy = std::min( by * 4 + y, height - 1 );
+		for ( int x = 0; x < 4; x++ ) {
+			int sx = std::min( bx * 4 + x, width - 1 );
+			memcpy( texels + ( y * 4 + x ) * 4, pixels + ( (size_t)sy * width + sx ) * 4, 4 );
+		}
+	}
+}
+
+void bc_encode_image( bc_format_t format, const unsigned char *pixels, int width, int height,
+											unsigned char *blocks, int thread_count ) {
+	int blocks_x = ( width + 3 ) / 4, blocks_y = ( height + 3 ) / 4;
+	int block_bytes = bc_block_bytes( format );
+	int threads = std::max( 1, std::min( thread_count, blocks_x * blocks_y / BC_MIN_BLOCKS_PER_THREAD ) );
+	run_on_threads( threads, [&]( int t ) {
+		int end = share_start( blocks_y, t + 1, threads );
+		for ( int by = share_start( blocks_y, t, threads ); by < end; by++ ) {
+			unsigned char *out = blocks + (size_t)by * blocks_x * block_bytes;
+			for ( int bx = 0; bx < blocks_x; bx++, out += block_bytes ) {
+				unsigned char texels[16 * 4];
+				gather_block( pixels, width, height, bx, by, texels );
+				switch ( format ) {
+				case BC_FORMAT_BC1:
+					encode_colour( texels, out );
+					break;
+				case BC_FORMAT_BC3:
+					encode_channel( texels, 3, out );
+					encode_colour( texels, out + 8 );
+					break;
+				case BC_FORMAT_BC5:
+					encode_channel( texels, 0, out );
+					encode_channel( texels, 1, out + 8 );
+					break;
+				}
+			}
+		}
+	} );
+}
+
+void bc_decode_image( bc_format_t format, const unsigned char *blocks, int width, int height,
+											unsigned char *pixels ) {
+	int blocks_x = ( width + 3 ) / 4, blocks_y = ( height + 3 ) / 4;
+	int block_bytes = bc_block_bytes( format );
+	for ( int by = 0; by < blocks_y; by++ ) {
+		for ( int bx = 0; bx < blocks_x; bx++ ) {
+			const unsigned char *in = blocks + ( (size_t)by * blocks_x + bx ) * block_bytes;
+			unsigned char texels[16 * 4];
+			switch ( format ) {
+			case BC_FORMAT_BC1:
+				decode_colour( in, false, texels );
+				break;
+			case BC_FORMAT_BC3:
+				decode_colour( in + 8, true, texels );
+				decode_channel( in, 3, texels );
+				break;
+			case BC_FORMAT_BC5:
+				memset( texels, 0, sizeof( texels ) );
+				decode_channel( in, 0, texels );
+				decode_channel( in + 8, 1, texels );
+				for ( int i = 0; i < 16; i++ ) {
+					texels[i * 4 + 3] = 255;
+				}
+				break;
+			}
+			for ( int y = 0; y < 4 && by * 4 + y < height; y++ ) {
+				for ( int x = 0; x < 4 && bx * 4 + x < width; x++ ) {
+					memcpy( pixels + ( (size_t)( by * 4 + y ) * width + bx * 4 + x ) * 4,
+									texels + ( y * 4 + x ) * 4, 4 );
+				}
+			}
+		}
+	}
+}
+
+double bc_psnr( bc_format_t format, const unsigned char *a, const unsigned char *b, int count ) {
+	int first = 0, end = 3;
+	if ( format == BC_FORMAT_BC3 ) {
+		end = 4;
+	} else if ( format == BC_FORMAT_BC5 ) {
+		end = 2;
+	}
+	double sum = 0.0;
+	for ( int i = 0; i < count; i++ ) {
+		for ( int c = first; c < end; c++ ) {
+			double d = (double)a[i * 4 + c] - (double)b[i * 4 + c];
+			sum += d * d;
+		}
+	}
+	double mse = sum / ( (double)count * ( end - first ) );
+	// identical images would be infinite
+	return mse > 0.0 ? 10.0 * log10( 255.0 * 255.0 / mse ) : 99.0;
+}
+
+void bc_texture_bake( bc_texture_t &tex, bc_format_t format, const unsigned char *pixels,
+											int width, int height, const mip_settings_t &mip_settings,
+											int thread_count ) {
+	mip_chain_t mips;
+	mip_chain_build( mips, pixels, width, height, mip_settings, thread_count );
+	tex.format = format;
+	tex.levels.clear();
+	size_t total = 0;
+	for ( int l = 0; l <= (int)mips.levels.size(); l++ ) {
+		bc_level_t level;
+		level.width = l == 0 ? width : mips.levels[l - 1].width;
+		level.height = l == 0 ? height : mips.levels[l - 1].height;
+		level.offset = total;
+		level.size = bc_image_bytes( format, level.width, level.height );
+		tex.levels.push_back( level );
+		total += level.size;
+	}
+	tex.blocks.resize( total );
+	for ( size_t l = 0; l < tex.levels.size(); l++ ) {
+		const unsigned char *level_pixels = l == 0 ? pixels : mip_level_pixels( mips, (int)l - 1 );
+		bc_encode_image( format, level_pixels, tex.levels[l].width, tex.levels[l].height,
+										 &tex.blocks[tex.levels[l].offset], thread_count );
+	}
+}
+
+static void put_u32( unsigned char *out, unsigned int v ) {
+	for ( int i = 0; i < 4; i++ ) {
+		out[i] = (unsigned char)( v >> ( 8 * i ) );
+	}
+}
+
+static unsigned int get_u32( const unsigned char *in ) {
+	return in[0] | ( in[1] << 8 ) | ( in[2] << 16 ) | ( (unsigned int)in[3] << 24 );
+}
+
+bool bc_texture_save( const bc_texture_t &tex, const char *file_name ) {
+	FILE *file = fopen( file_name, "wb" );
+	if ( !file ) {
+		fprintf( stderr, "ERROR: could not open %s for writing\n", file_name );
+		return false;
+	}
+	unsigned char header[20];
+	memcpy( header, "BCTX", 4 );
+	put_u32( header + 4, (unsigned int)tex.format );
+	put_u32( header + 8, (unsigned int)tex.levels[0].width );
+	put_u32( header + 12, (unsigned int)tex.levels[0].height );
+	put_u32( header + 16, (unsigned int)tex.levels.size() );
+	bool ok = fwrite( header, 1, sizeof( header ), file ) == sizeof( header );
+	for ( size_t l = 0; ok && l < tex.levels.size(); l++ ) {
+		unsigned char size[4];
+		put_u32( size, (unsigned int)tex.levels[l].size );
+		ok = fwrite( size, 1, 4, file ) == 4 &&
+				 fwrite( &tex.blocks[tex.levels[l].offset], 1, tex.levels[l].size, file ) ==
+					 tex.levels[l].size;
+	}
+	fclose( file );
+	if ( !ok ) {
+		fprintf( stderr, "ERROR: could not write %s\n", file_name );
+	}
+	return ok;
+}
+
+/* reads the header, and lays out the levels as bc_texture_load() would */
+static bool read_header( FILE *file, bc_texture_t &tex ) {
+	unsigned char header[20] = { 0 };
+	bool ok = fread( header, 1, sizeof( header ), file ) == sizeof( header ) &&
+						memcmp( header, "BCTX", 4 ) == 0;
+	unsigned int format = ok ? get_u32( header + 4 ) : 0;
+	int width = (int)get_u32( header + 8 ), height = (int)get_u32( header + 12 );
+	int level_count = (int)get_u32( header + 16 );
+	ok = ok && ( format == BC_FORMAT_BC1 || format == BC_FORMAT_BC3 || format == BC_FORMAT_BC5 ) &&
+			 width > 0 && height > 0 && level_count > 0 && level_count <= 32;
+	tex.format = (bc_format_t)format;
+	tex.levels.clear();
+	tex.blocks.clear();
+	size_t total = 0;
+	for ( int l = 0; ok && l < level_count; l++ ) {
+		bc_level_t level;
+		level.width = width;
+		level.height = height;
+		level.offset = total;
+		level.size = bc_image_bytes( tex.format, width, height );
+		tex.levels.push_back( level );
+		total += level.size;
+		width = std::max( width / 2, 1 );
+		height = std::max( height / 2, 1 );
+	}
+	return ok;
+}
+
+bool bc_texture_load_header( bc_texture_t &tex, const char *file_name ) {
+	FILE *file = fopen( file_name, "rb" );
+	if ( !file ) {
+		return false;
+	}
+	bool ok = read_header( file, tex );
+	fclose( file );
+	if ( !ok ) {
+		fprintf( stderr, "ERROR: %s is not a valid block-compressed texture\n", file_name );
+		tex.levels.clear();
+	}
+	return ok;
+}
+
+long bc_level_file_offset( const bc_texture_t &tex, int level ) {
+	// the header, then a byte count before each level
+	return 20 + 4 * ( level + 1 ) + (long)tex.levels[level].offset;
+}
+
+bool bc_texture_load( bc_texture_t &tex, const char *file_name ) {
+	FILE *file = fopen( file_name, "rb" );
+	if ( !file ) {
+		return false;
+	}
+	bool ok = read_header( file, tex );
+	for ( size_t l = 0; ok && l < tex.levels.size(); l++ ) {
+		const bc_level_t &level = tex.levels[l];
+		unsigned char size[4];
+		ok = fread( size, 1, 4, file ) == 4 && get_u32( size ) == level.size;
+		if ( ok ) {
+			tex.blocks.resize( level.offset + level.size );
+			ok = fread( &tex.blocks[level.offset], 1, level.size, file ) == level.size;
+		}
+	}
+	fclose( file );
+	if ( !ok ) {
+		fprintf( stderr, "ERROR: %s is not a valid block-compressed texture\n", file_name );
+		tex.levels.clear();
+		tex.blocks.clear();
+	}
+	return ok;
+}
@@ -0,0 +1,86 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Block-compressed textures                                                    |
+| Encodes RGBA images into the formats GL can sample without unpacking them.   |
+| Every 4x4 block of texels becomes two end points and a 2 or 3-bit index per  |
+| texel into the values between them:                                          |
+| * BC1 (DXT1) - RGB in 8 bytes a block, 1/8 of RGBA. for colour maps          |
+| * BC3 (DXT5) - BC1 colour plus 8 bytes of alpha, 1/4 of RGBA. for sprites    |
+| * BC5 (RGTC2) - red and green in 8 bytes each. for normal maps, with z       |
+|   worked out in the shader                                                   |
+| Colour end points are along the block's principal axis, then refined by      |
+| least squares. Indices are picked 4 texels at a time with SSE, and blocks    |
+| are shared out over threads by rows. A baked texture, with all its mip       |
+| levels, saves to a small file that loads straight into                       |
+| glCompressedTexImage2D().                                                    |
+\******************************************************************************/
+#ifndef _BLOCK_COMPRESS_H_
+#define _BLOCK_COMPRESS_H_
+
+#include "mipmap.h"
+#include <stddef.h>
+#include <vector>
+
+enum bc_format_t { BC_FORMAT_BC1 = 1, BC_FORMAT_BC3 = 3, BC_FORMAT_BC5 = 5 };
+
+struct bc_level_t {
+	int width, height;
+	size_t offset, size; // in bc_texture_t::blocks
+};
+
+/* a texture baked into blocks, with mip levels 0 and on down to 1x1 */
+struct bc_texture_t {
+	bc_format_t format;
+	std::vector<bc_level_t> levels;
+	std::vector<unsigned char> blocks;
+
+	bc_texture_t() : format( BC_FORMAT_BC1 ) {}
+};
+
+/* bytes in one 4x4 block: 8 or 16 */
+int bc_block_bytes( bc_format_t format );
+
+/* bytes of blocks for an image of width x height */
+size_t bc_image_bytes( bc_format_t format, int width, int height );
+
+/* encodes width x height RGBA pixels into bc_image_bytes() of blocks, on up to
+thread_count threads. BC5 takes red and green */
+void bc_encode_image( bc_format_t format, const unsigned char *pixels, int width, int height,
+											unsigned char *blocks, int thread_count );
+
+/* unpacks blocks back into RGBA. channels the format doesn't keep come out as
+0 for colour and 255 for alpha */
+void bc_decode_image( bc_format_t format, const unsigned char *blocks, int width, int height,
+											unsigned char *pixels );
+
+/* peak signal to noise ratio in dB between two RGBA images of count pixels,
+over the channels the format keeps */
+double bc_psnr( bc_format_t format, const unsigned char *a, const unsigned char *b, int count );
+
+/* builds the mip chain of an RGBA image with mip_settings, then encodes every
+level */
+void bc_texture_bake( bc_texture_t &tex, bc_format_t format, const unsigned char *pixels,
+											int width, int height, const mip_settings_t &mip_settings,
+											int thread_count );
+
+/* the file is a header - "BCTX", then format, width, height, and level count as
+32-bit little-endian integers - followed by each level's byte count and blocks */
+bool bc_texture_save( const bc_texture_t &tex, const char *file_name );
+bool bc_texture_load( bc_texture_t &tex, const char *file_name );
+
+/* reads only the format and the size of each level, leaving blocks empty */
+bool bc_texture_load_header( bc_texture_t &tex, const char *file_name );
+
+/* where a level's blocks start in a file written by bc_texture_save() */
+long bc_level_file_offset( const bc_texture_t &tex, int level );
+
+/* "SSE" or "scalar" */
+const char *bc_path();
+
+#endif
@@ -8,8 +8,11 @@
 |******************************************************************************|
 | Normal mapping                                                               |
 \******************************************************************************/
+#include "block_compress.h"
 #include "gl_utils.h"
 #include "maths_funcs.h"
+#include "texture_loader.h"
+#include "texture_stream.h"
 #include <GL/glew.h>		// include GLEW and new version of GL on Windows
 #include <GLFW/glfw3.h> // GLFW helper library
 #include <assert.h>
@@ -24,13 +27,44 @@
 #include <time.h>
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
 #define GL_LOG_FILE "gl.log"
 #define NMAP_IMG_FILE "brickwork_normal-map.png"
+/* the normal map baked into BC5 blocks with all of its mipmaps. made from
+NMAP_IMG_FILE the first time the demo runs. delete it to bake again */
+#define NMAP_BC_FILE "brickwork_normal-map.bctx"
+/* draws with the normal map's mip tail straight away, and streams in the finer
+levels. comment out to load every level before the first frame */
+#define STREAM_NORMAL_MAP
+// bytes of blocks streamed textures may keep resident
+#define STREAM_BUDGET ( 32 * 1024 * 1024 )
+#define STREAM_IO_THREADS 2
+
+/* the start-up benchmarks take seconds and lots of memory before the first
+frame, so they only run when this is uncommented */
+//#define RUN_BENCHMARKS
+/* made-up BC1 textures written to the temp folder, streamed, and deleted by
+the benchmark */
+#define BENCH_STREAM_TEXTURES 64
+#define BENCH_STREAM_SIZE 1024
+// room for about 20 of them at full size
+#define BENCH_STREAM_BUDGET ( 16 * 1024 * 1024 )
+// textures in view at once, and frames before the view moves on by one
+#define BENCH_STREAM_VISIBLE 12
+#define BENCH_STREAM_FRAMES_PER_STEP 8
+// stands in for the time taken to draw a frame
+#define BENCH_STREAM_FRAME_MS 4
 
 // keep track of window size for things like the viewport and the mouse cursor
 int g_gl_width = 640;
 int g_gl_height = 480;
 GLFWwindow *g_window = NULL;
+int g_num_threads = 1;
+
+std::vector<GLuint> g_stream_textures; // GL texture of each streamed texture
 
 GLfloat *g_vp = NULL; // array of vertex points
 GLfloat *g_vn = NULL; // array of vertex normals
@@ -129,9 +163,276 @@ bool load_mesh( const char *file_name ) {
 	return true;
 }
 
+/* makes file_name, a block-compressed version of image_file_name with
+mipmaps, if it isn't there already */
+bool bake_compressed_texture( const char *image_file_name, const char *file_name,
+															bc_format_t format ) {
+	bc_texture_t tex;
+	FILE *file = fopen( file_name, "rb" );
+	if ( file ) {
+		fclose( file );
+		return true;
+	}
+	texture_cache_t cache;
+	const texture_image_t *image = texture_load( cache, image_file_name, true );
+	if ( !image ) {
+		return false;
+	}
+	// normal maps and other data aren't sRGB
+	mip_settings_t settings;
+	settings.srgb = format == BC_FORMAT_BC1 || format == BC_FORMAT_BC3;
+	double start = glfwGetTime();
+	bc_texture_bake( tex, format, image->pixels, image->width, image->height, settings,
+									 g_num_threads );
+	gl_log( "baked %s into %s, BC%i, %i levels, in %.3fms\n", image_file_name, file_name,
+					(int)format, (int)tex.levels.size(), ( glfwGetTime() - start ) * 1000.0 );
+	return bc_texture_save( tex, file_name );
+}
+
+GLenum compressed_gl_format( bc_format_t format ) {
+	if ( format == BC_FORMAT_BC1 ) {
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	} else if ( format == BC_FORMAT_BC3 ) {
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+	return GL_COMPRESSED_RG_RGTC2;
+}
+
+/* uploads a texture baked by bc_texture_save() with no unpacking */
+bool load_compressed_texture( const char *file_name, GLuint *tex ) {
+	bc_texture_t baked;
+	if ( !bc_texture_load( baked, file_name ) ) {
+		fprintf( stderr, "ERROR: could not load %s\n", file_name );
+		return false;
+	}
+	glGenTextures( 1, tex );
+	glBindTexture( GL_TEXTURE_2D, *tex );
+	for ( size_t l = 0; l < baked.levels.size(); l++ ) {
+		const bc_level_t &level = baked.levels[l];
+		glCompressedTexImage2D( GL_TEXTURE_2D, (GLint)l, compressed_gl_format( baked.format ),
+														level.width, level.height, 0, (GLsizei)level.size,
+														&baked.blocks[level.offset] );
+	}
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)baked.levels.size() - 1 );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+	GLfloat max_aniso = 0.0f;
+	glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_aniso );
+	glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_aniso );
+	return true;
+}
+
+/* the streamer's uploader. levels only ever come or go at the fine end, so
+moving GL_TEXTURE_BASE_LEVEL keeps the texture complete */
+void stream_upload( int texture, bc_format_t format, int level, const bc_level_t &size,
+										const unsigned char *blocks ) {
+	if ( texture >= (int)g_stream_textures.size() ) {
+		g_stream_textures.resize( texture + 1, 0 );
+	}
+	if ( !g_stream_textures[texture] ) {
+		glGenTextures( 1, &g_stream_textures[texture] );
+		glBindTexture( GL_TEXTURE_2D, g_stream_textures[texture] );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+		GLfloat max_aniso = 0.0f;
+		glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_aniso );
+		glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_aniso );
+	}
+	glBindTexture( GL_TEXTURE_2D, g_stream_textures[texture] );
+	glCompressedTexImage2D( GL_TEXTURE_2D, level, compressed_gl_format( format ), size.width,
+													size.height, 0, (GLsizei)size.size, blocks );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level );
+}
+
+void stream_evict( int texture, int level ) {
+	glBindTexture( GL_TEXTURE_2D, g_stream_textures[texture] );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1 );
+	// an empty image gives the level's memory back
+	glTexImage2D( GL_TEXTURE_2D, level, GL_RG8, 0, 0, 0, GL_RG, GL_UNSIGNED_BYTE, NULL );
+}
+
+/* the system's folder for temporary files, with a slash on the end */
+std::string temp_folder() {
+	const char *vars[] = { "TMPDIR", "TEMP", "TMP" };
+	for ( int i = 0; i < 3; i++ ) {
+		const char *dir = getenv( vars[i] );
+		if ( dir && dir[0] ) {
+			return std::string( dir ) + "/";
+		}
+	}
+#ifdef _WIN32
+	return "./";
+#else
+	return "/tmp/";
+#endif
+}
+
+/* writes BENCH_STREAM_TEXTURES made-up BC1 textures. then times getting to the
+first frame by loading them all, against adding them to a streamer, and walks
+a view along them under BENCH_STREAM_BUDGET, logging how well the budget held
+and how long each texture took to be complete once in view. uploads are faked,
+so this measures the I/O and residency side only. the files were just written,
+so they are likely in the OS's cache for both */
+void benchmark_texture_streaming() {
+	const int count = BENCH_STREAM_TEXTURES;
+	bc_texture_t tex;
+	tex.format = BC_FORMAT_BC1;
+	for ( int w = BENCH_STREAM_SIZE; w >= 1; w /= 2 ) {
+		bc_level_t level;
+		level.width = level.height = w;
+		level.offset = tex.blocks.size();
+		level.size = bc_image_bytes( tex.format, w, w );
+		tex.levels.push_back( level );
+		tex.blocks.resize( level.offset + level.size );
+	}
+	srand( 1 );
+	for ( size_t i = 0; i < tex.blocks.size(); i++ ) {
+		tex.blocks[i] = (unsigned char)( rand() & 255 );
+	}
+	std::string folder = temp_folder();
+	std::vector<std::string> names( count );
+	for ( int i = 0; i < count; i++ ) {
+		char name[64];
+		sprintf( name, "stream_bench_%02i.bctx", i );
+		names[i] = folder + name;
+		if ( !bc_texture_save( tex, names[i].c_str() ) ) {
+			// including the one that failed part way through
+			for ( int j = 0; j <= i; j++ ) {
+				remove( names[j].c_str() );
+			}
+			return;
+		}
+	}
+
+	double start = glfwGetTime();
+	size_t loaded_bytes = 0;
+	for ( int i = 0; i < count; i++ ) {
+		bc_texture_t loaded;
+		if ( bc_texture_load( loaded, names[i].c_str() ) ) {
+			loaded_bytes += loaded.blocks.size();
+		}
+	}
+	double load_all_secs = glfwGetTime() - start;
+
+	// stands in for GL, keeping its own count of what would be in video memory
+	size_t gpu_bytes = 0, gpu_peak = 0;
+	std::vector<std::vector<size_t> > gpu_levels( count, std::vector<size_t>( tex.levels.size() ) );
+	stream_uploader_t fake;
+	fake.upload = [&]( int t, bc_format_t, int l, const bc_level_t &size, const unsigned char * ) {
+		gpu_levels[t][l] = size.size;
+		gpu_bytes += size.size;
+		gpu_peak = std::max( gpu_peak, gpu_bytes );
+	};
+	fake.evict = [&]( int t, int l ) {
+		gpu_bytes -= gpu_levels[t][l];
+		gpu_levels[t][l] = 0;
+	};
+	texture_streamer_t ts;
+	texture_streamer_start( ts, BENCH_STREAM_BUDGET, STREAM_IO_THREADS, fake );
+	start = glfwGetTime();
+	for ( int i = 0; i < count; i++ ) {
+		texture_stream_add( ts, names[i].c_str() );
+	}
+	double add_all_secs = glfwGetTime() - start;
+	size_t tail_bytes = ts.used;
+
+	// when each texture came into view, and how long it then took to be complete
+	std::vector<double> seen( count, -1.0 ), latency( count, -1.0 );
+	int frames = ( count - BENCH_STREAM_VISIBLE + 1 ) * BENCH_STREAM_FRAMES_PER_STEP;
+	int frames_over = 0;
+	for ( int f = 0; f < frames; f++ ) {
+		double now = glfwGetTime();
+		int first = f / BENCH_STREAM_FRAMES_PER_STEP;
+		for ( int t = first; t < first + BENCH_STREAM_VISIBLE; t++ ) {
+			texture_stream_request( ts, t, 0 );
+			if ( seen[t] < 0.0 ) {
+				seen[t] = now;
+			}
+			if ( latency[t] < 0.0 && texture_stream_residency( ts, t ) == STREAM_COMPLETE ) {
+				latency[t] = now - seen[t];
+			}
+		}
+		texture_streamer_update( ts );
+		if ( gpu_bytes > BENCH_STREAM_BUDGET ) {
+			frames_over++;
+		}
+		std::this_thread::sleep_for( std::chrono::milliseconds( BENCH_STREAM_FRAME_MS ) );
+	}
+	texture_streamer_stop( ts );
+	int completed = 0;
+	double mean_latency = 0.0, max_latency = 0.0;
+	for ( int t = 0; t < count; t++ ) {
+		if ( latency[t] >= 0.0 ) {
+			completed++;
+			mean_latency += latency[t];
+			max_latency = std::max( max_latency, latency[t] );
+		}
+	}
+	mean_latency /= std::max( completed, 1 );
+
+	gl_log( "texture streaming, %i %ix%i BC1 textures: loading all %.1fMB took %.3fms, adding "
+					"mip tails of %.1fKB took %.3fms\n",
+					count, BENCH_STREAM_SIZE, BENCH_STREAM_SIZE, loaded_bytes / 1048576.0,
+					load_all_secs * 1000.0, tail_bytes / 1024.0, add_all_secs * 1000.0 );
+	gl_log( "  %i frames, %i in view, %i I/O threads, budget %.1fMB: peak %.1fMB, %i frames over, "
+					"%i uploads, %i evictions, %i dropped, %.1fMB read\n",
+					frames, BENCH_STREAM_VISIBLE, STREAM_IO_THREADS, BENCH_STREAM_BUDGET / 1048576.0,
+					gpu_peak / 1048576.0, frames_over, ts.uploads, ts.evictions, ts.dropped,
+					ts.bytes_read / 1048576.0 );
+	gl_log( "  %i of %i textures in view became complete, after %.3fms on average, %.3fms at "
+					"most\n",
+					completed, count, mean_latency * 1000.0, max_latency * 1000.0 );
+	for ( int i = 0; i < count; i++ ) {
+		remove( names[i].c_str() );
+	}
+}
+
+/* encodes a colour map, an alpha sprite, and the normal map into each of the
+formats meant for them, and logs the speed, size, and PSNR against the
+original */
+void benchmark_block_compression() {
+	const char *files[] = { "../09_texture_mapping/skulluvmap.png",
+													"../29_particle_systems/Droplet.png", NMAP_IMG_FILE };
+	const bc_format_t formats[] = { BC_FORMAT_BC1, BC_FORMAT_BC3, BC_FORMAT_BC5 };
+	texture_cache_t cache;
+	for ( int i = 0; i < 3; i++ ) {
+		const texture_image_t *image = texture_load( cache, files[i], true );
+		if ( !image ) {
+			continue;
+		}
+		int w = image->width, h = image->height;
+		std::vector<unsigned char> blocks( bc_image_bytes( formats[i], w, h ) );
+		std::vector<unsigned char> decoded( w * h * 4 );
+		const int runs = 10;
+		double start = glfwGetTime();
+		for ( int r = 0; r < runs; r++ ) {
+			bc_encode_image( formats[i], image->pixels, w, h, &blocks[0], g_num_threads );
+		}
+		double secs = ( glfwGetTime() - start ) / runs;
+		bc_decode_image( formats[i], &blocks[0], w, h, &decoded[0] );
+		gl_log( "BC%i %s, %s, %i threads: %ix%i in %.3fms (%.1fM texels/s), %i bytes from %i, "
+						"PSNR %.2fdB\n",
+						(int)formats[i], files[i], bc_path(), g_num_threads, w, h, secs * 1000.0,
+						(double)w * h / secs / 1000000.0, (int)blocks.size(), w * h * 4,
+						bc_psnr( formats[i], image->pixels, &decoded[0], w * h ) );
+	}
+}
+
 int main() {
 	restart_gl_log();
 	start_gl();
+	g_num_threads = (int)std::thread::hardware_concurrency();
+	if ( g_num_threads < 1 ) {
+		g_num_threads = 1;
+	}
+#ifdef RUN_BENCHMARKS
+	benchmark_block_compression();
+	benchmark_texture_streaming();
+#endif
 	// tell GL to only draw onto a pixel if the shape is closer to the viewer
 	glEnable( GL_DEPTH_TEST ); // enable depth-testing
 	glDepthFunc( GL_LESS );		 // depth-testing interprets a smaller value as "closer"
@@ -219,8 +520,29 @@ int main() {
 	glUniformMatrix4fv( proj_mat_location, 1, GL_FALSE, proj_mat );
 
 	// load normal map image into texture
-	GLuint nmap_tex;
-	( load_texture( NMAP_IMG_FILE, &nmap_tex ) );
+	GLuint nmap_tex = 0;
+#ifdef STREAM_NORMAL_MAP
+	stream_uploader_t uploader;
+	uploader.upload = stream_upload;
+	uploader.evict = stream_evict;
+	texture_streamer_t streamer;
+	texture_streamer_start( streamer, STREAM_BUDGET, STREAM_IO_THREADS, uploader );
+	int nmap_stream = -1;
+	if ( bake_compressed_texture( NMAP_IMG_FILE, NMAP_BC_FILE, BC_FORMAT_BC5 ) ) {
+		nmap_stream = texture_stream_add( streamer, NMAP_BC_FILE );
+	}
+	if ( nmap_stream >= 0 ) {
+		nmap_tex = g_stream_textures[nmap_stream];
+	} else {
+		( load_texture( NMAP_IMG_FILE, &nmap_tex ) );
+	}
+	bool nmap_complete = false;
+#else
+	if ( !bake_compressed_texture( NMAP_IMG_FILE, NMAP_BC_FILE, BC_FORMAT_BC5 ) ||
+			 !load_compressed_texture( NMAP_BC_FILE, &nmap_tex ) ) {
+		( load_texture( NMAP_IMG_FILE, &nmap_tex ) );
+	}
+#endif
 
 	glEnable( GL_CULL_FACE ); // cull face
 	glCullFace( GL_BACK );		// cull back face
@@ -237,6 +559,19 @@ int main() {
 		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 		glViewport( 0, 0, g_gl_width, g_gl_height );
 
+#ifdef STREAM_NORMAL_MAP
+		if ( nmap_stream >= 0 ) {
+			// the mesh fills much of the window, so it always wants the finest level
+			texture_stream_request( streamer, nmap_stream, 0 );
+			texture_streamer_update( streamer );
+			if ( !nmap_complete &&
+					 texture_stream_residency( streamer, nmap_stream ) == STREAM_COMPLETE ) {
+				gl_log( "normal map complete after %i frames\n", (int)streamer.frame );
+				nmap_complete = true;
+			}
+		}
+#endif
+		glBindTexture( GL_TEXTURE_2D, nmap_tex );
 		glUseProgram( shader_programme );
 		glBindVertexArray( vao );
 		// draw points 0-3 from the currently bound VAO with current in-use shader
@@ -294,6 +629,9 @@ int main() {
 		glfwSwapBuffers( g_window );
 	}
 
+#ifdef STREAM_NORMAL_MAP
+	texture_streamer_stop( streamer );
+#endif
 	// close GL context and any other GLFW resources
 	glfwTerminate();
 	return 0;
@@ -0,0 +1,66 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU mipmap generation                                                        |
+| Builds the whole chain of smaller images for an RGBA texture, instead of     |
+| leaving it to glGenerateMipmap(), which may average sRGB colours without     |
+| converting them to linear first, and needs a GL context. Colours go through  |
+| a lookup table to linear, are filtered with SSE, one pixel per register, and |
+| go back through another table. Each level is made from the one above it,     |
+| with its rows split over threads. Alpha-tested sprites can keep the same     |
+| fraction of texels over the cutoff at every level, so they don't fade out    |
+| with distance.                                                               |
+\******************************************************************************/
+#ifndef _MIPMAP_H_
+#define _MIPMAP_H_
+
+#include <stddef.h>
+#include <vector>
+
+enum mip_filter_t {
+	/* average of each 2x2 square, or up to 3x3 at the end of an odd size. fast,
+	but a bit blurry and aliased */
+	MIP_FILTER_BOX,
+	MIP_FILTER_KAISER // 8x8 Kaiser-windowed sinc. sharper, with less aliasing
+};
+
+struct mip_level_t {
+	int width, height;
+	size_t offset; // of its first byte in mip_chain_t::pixels
+	float alpha_scale; // alpha was multiplied by this to keep coverage, or 1
+};
+
+struct mip_chain_t {
+	// GL mip levels 1 and on, down to 1x1. level 0 is the image itself
+	std::vector<mip_level_t> levels;
+	std::vector<unsigned char> pixels; // RGBA, every level one after the other
+};
+
+struct mip_settings_t {
+	mip_filter_t filter;
+	bool srgb;					// filter colours in linear space. alpha is always linear
+	float alpha_cutoff; // keep the fraction of alpha >= this. 0 to leave alpha alone
+
+	mip_settings_t() : filter( MIP_FILTER_BOX ), srgb( true ), alpha_cutoff( 0.0f ) {}
+};
+
+/* builds every mip level below the RGBA image pixels, of width x height, on up
+to thread_count threads */
+void mip_chain_build( mip_chain_t &chain, const unsigned char *pixels, int width, int height,
+											const mip_settings_t &settings, int thread_count );
+
+/* the pixels of chain.levels[level], which is GL mip level level + 1 */
+unsigned char *mip_level_pixels( mip_chain_t &chain, int level );
+
+/* the fraction of count RGBA pixels with alpha >= cutoff */
+float mip_alpha_coverage( const unsigned char *pixels, int count, float cutoff );
+
+/* "SSE" or "scalar" */
+const char *mip_path();
+
+#endif
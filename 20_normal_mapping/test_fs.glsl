@@ -16,9 +16,11 @@ in vec4 test_tan;
 void main() {
 	vec3 Ia = vec3 (0.2, 0.2, 0.2);
 	
-	// sample the normal map and covert from 0:1 range to -1:1 range
-	vec3 normal_tan = texture (normal_map, st).rgb;
-	normal_tan = normalize (normal_tan * 2.0 - 1.0);
+	// sample the normal map and covert from 0:1 range to -1:1 range. only x and y
+	// are stored when the map is BC5 compressed, so z is worked out from them
+	vec3 normal_tan;
+	normal_tan.xy = texture (normal_map, st).rg * 2.0 - 1.0;
+	normal_tan.z = sqrt (max (1.0 - dot (normal_tan.xy, normal_tan.xy), 0.0));
 
 	// diffuse light equation done in tangent space
 	vec3 direction_to_light_tan = normalize (-light_dir_tan);
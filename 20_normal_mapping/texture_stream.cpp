@@ -0,0 +1,251 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Streaming texture residency. See texture_stream.h                            |
+\******************************************************************************/
+#include "texture_stream.h"
+#include <algorithm>
+#include <stdio.h>
+
+texture_streamer_t::texture_streamer_t()
+	: budget( 0 ), used( 0 ), peak_used( 0 ), frame( 0 ), quitting( false ), uploads( 0 ),
+		evictions( 0 ), dropped( 0 ), bytes_read( 0 ) {}
+
+texture_streamer_t::~texture_streamer_t() { texture_streamer_stop( *this ); }
+
+static bool read_level( const char *file_name, long file_offset, size_t size,
+												std::vector<unsigned char> &blocks ) {
+	FILE *file = fopen( file_name, "rb" );
+	if ( !file ) {
+		return false;
+	}
+	blocks.resize( size );
+	bool ok = fseek( file, file_offset, SEEK_SET ) == 0 &&
+						fread( &blocks[0], 1, size, file ) == size;
+	fclose( file );
+	return ok;
+}
+
+/* takes reads off the queue until told to quit */
+static void io_thread( texture_streamer_t *ts ) {
+	std::unique_lock<std::mutex> lock( ts->mutex );
+	while ( true ) {
+		ts->wake.wait( lock, [ts]() { return ts->quitting || !ts->reads.empty(); } );
+		if ( ts->quitting ) {
+			return;
+		}
+		stream_read_t read = ts->reads.front();
+		ts->reads.pop_front();
+		lock.unlock();
+		read.ok = read_level( read.file_name.c_str(), read.file_offset, read.size, read.blocks );
+		lock.lock();
+		ts->finished.push_back( stream_read_t() );
+		std::swap( ts->finished.back(), read );
+	}
+}
+
+void texture_streamer_start( texture_streamer_t &ts, size_t budget, int io_thread_count,
+														 const stream_uploader_t &uploader ) {
+	texture_streamer_stop( ts );
+	ts.budget = budget;
+	ts.uploader = uploader;
+	ts.quitting = false;
+	ts.uploads = ts.evictions = ts.dropped = 0;
+	ts.bytes_read = 0;
+	for ( int t = 0; t < std::max( io_thread_count, 1 ); t++ ) {
+		ts.io_threads.push_back( std::thread( io_thread, &ts ) );
+	}
+}
+
+void texture_streamer_stop( texture_streamer_t &ts ) {
+	{
+		std::lock_guard<std::mutex> lock( ts.mutex );
+		ts.quitting = true;
+		ts.reads.clear();
+	}
+	ts.wake.notify_all();
+	for ( size_t t = 0; t < ts.io_threads.size(); t++ ) {
+		ts.io_threads[t].join();
+	}
+	ts.io_threads.clear();
+	ts.finished.clear();
+	for ( size_t i = 0; i < ts.textures.size(); i++ ) {
+		ts.textures[i].loading_level = -1;
+	}
+}
+
+int texture_stream_add( texture_streamer_t &ts, const char *file_name ) {
+	stream_texture_t tex;
+	if ( !bc_texture_load_header( tex.header, file_name ) ) {
+		fprintf( stderr, "ERROR: could not stream %s\n", file_name );
+		return -1;
+	}
+	int level_count = (int)tex.header.levels.size();
+	tex.file_name = file_name;
+	tex.tail_level = level_count - 1;
+	while ( tex.tail_level > 0 && tex.header.levels[tex.tail_level - 1].width <= STREAM_TAIL_SIZE &&
+					tex.header.levels[tex.tail_level - 1].height <= STREAM_TAIL_SIZE ) {
+		tex.tail_level--;
+	}
+	// the tail is one run of bytes in the file, with each level's byte count between
+	long start = bc_level_file_offset( tex.header, tex.tail_level );
+	long end = bc_level_file_offset( tex.header, level_count - 1 ) +
+						 (long)tex.header.levels[level_count - 1].size;
+	std::vector<unsigned char> tail;
+	if ( !read_level( file_name, start, end - start, tail ) ) {
+		fprintf( stderr, "ERROR: could not read the mip tail of %s\n", file_name );
+		return -1;
+	}
+	int index = (int)ts.textures.size();
+	for ( int l = level_count - 1; l >= tex.tail_level; l-- ) {
+		const bc_level_t &level = tex.header.levels[l];
+		ts.uploader.upload( index, tex.header.format, l, level,
+												&tail[bc_level_file_offset( tex.header, l ) - start] );
+		ts.used += level.size;
+	}
+	ts.peak_used = std::max( ts.peak_used, ts.used );
+	tex.resident_level = tex.wanted_level = tex.tail_level;
+	tex.loading_level = -1;
+	tex.last_used = ts.frame;
+	ts.textures.push_back( tex );
+	return index;
+}
+
+void texture_stream_request( texture_streamer_t &ts, int texture, int level ) {
+	stream_texture_t &tex = ts.textures[texture];
+	tex.wanted_level = std::max( 0, std::min( level, tex.tail_level ) );
+	tex.last_used = ts.frame;
+}
+
+stream_residency_t texture_stream_residency( const texture_streamer_t &ts, int texture ) {
+	const stream_texture_t &tex = ts.textures[texture];
+	if ( tex.resident_level <= tex.wanted_level ) {
+		return STREAM_COMPLETE;
+	}
+	return tex.resident_level < tex.tail_level ? STREAM_PARTIAL : STREAM_TAIL;
+}
+
+/* the finest level make_room() may not evict from tex */
+static int kept_level( const texture_streamer_t &ts, const stream_texture_t &tex ) {
+	return tex.last_used == ts.frame ? tex.wanted_level : tex.tail_level;
+}
+
+/* bytes make_room() could free, if it had to */
+static size_t evictable_bytes( const texture_streamer_t &ts ) {
+	size_t bytes = 0;
+	for ( size_t i = 0; i < ts.textures.size(); i++ ) {
+		const stream_texture_t &tex = ts.textures[i];
+		for ( int l = tex.resident_level; l < kept_level( ts, tex ); l++ ) {
+			bytes += tex.header.levels[l].size;
+		}
+	}
+	return bytes;
+}
+
+/* evicts levels until size more bytes fit in the budget, never from keep.
+levels finer than their texture wants go first, then the finest level of
+whichever texture was used longest ago. textures used this frame keep what
+they want */
+static bool make_room( texture_streamer_t &ts, size_t size, int keep ) {
+	while ( ts.used + size > ts.budget ) {
+		int victim = -1;
+		bool victim_unwanted = false;
+		for ( int i = 0; i < (int)ts.textures.size(); i++ ) {
+			const stream_texture_t &tex = ts.textures[i];
+			if ( i == keep || tex.resident_level >= kept_level( ts, tex ) ) {
+				continue;
+			}
+			bool unwanted = tex.resident_level < tex.wanted_level;
+			if ( victim < 0 || ( unwanted && !victim_unwanted ) ||
+					 ( unwanted == victim_unwanted && tex.last_used < ts.textures[victim].last_used ) ) {
+				victim = i;
+				victim_unwanted = unwanted;
+			}
+		}
+		if ( victim < 0 ) {
+			return false;
+		}
+		stream_texture_t &tex = ts.textures[victim];
+		ts.used -= tex.header.levels[tex.resident_level].size;
+		ts.uploader.evict( victim, tex.resident_level );
+		tex.resident_level++;
+		ts.evictions++;
+	}
+	return true;
+}
+
+void texture_streamer_update( texture_streamer_t &ts ) {
+	std::vector<stream_read_t> finished;
+	{
+		std::lock_guard<std::mutex> lock( ts.mutex );
+		finished.swap( ts.finished );
+	}
+
+	for ( size_t r = 0; r < finished.size(); r++ ) {
+		stream_read_t &read = finished[r];
+		stream_texture_t &tex = ts.textures[read.texture];
+		tex.loading_level = -1;
+		if ( !read.ok ) {
+			fprintf( stderr, "ERROR: could not read level %i of %s\n", read.level,
+							 tex.file_name.c_str() );
+			ts.dropped++;
+			continue;
+		}
+		ts.bytes_read += read.size;
+		// levels must stay a run down to 1x1, and an eviction may have broken it
+		if ( read.level != tex.resident_level - 1 || read.level < tex.wanted_level ||
+				 !make_room( ts, read.size, read.texture ) ) {
+			ts.dropped++;
+			continue;
+		}
+		ts.uploader.upload( read.texture, tex.header.format, read.level,
+												tex.header.levels[read.level], &read.blocks[0] );
+		tex.resident_level = read.level;
+		ts.used += read.size;
+		ts.uploads++;
+	}
+
+	// start the next finer level of each texture drawn this frame that wants one,
+	// if there is, or could be made, room for it and the reads before it
+	size_t room = ts.budget + evictable_bytes( ts );
+	size_t reading = 0;
+	for ( size_t i = 0; i < ts.textures.size(); i++ ) {
+		if ( ts.textures[i].loading_level >= 0 ) {
+			reading += ts.textures[i].header.levels[ts.textures[i].loading_level].size;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock( ts.mutex );
+		for ( int i = 0; i < (int)ts.textures.size(); i++ ) {
+			stream_texture_t &tex = ts.textures[i];
+			if ( tex.last_used != ts.frame || tex.loading_level >= 0 ||
+					 tex.resident_level <= tex.wanted_level ) {
+				continue;
+			}
+			int level = tex.resident_level - 1;
+			size_t size = tex.header.levels[level].size;
+			if ( ts.used + reading + size > room ) {
+				continue;
+			}
+			reading += size;
+			tex.loading_level = level;
+			stream_read_t read;
+			read.texture = i;
+			read.level = level;
+			read.file_name = tex.file_name;
+			read.file_offset = bc_level_file_offset( tex.header, level );
+			read.size = size;
+			read.ok = false;
+			ts.reads.push_back( read );
+		}
+	}
+	ts.wake.notify_all();
+
+	ts.peak_used = std::max( ts.peak_used, ts.used );
+	ts.frame++;
+}
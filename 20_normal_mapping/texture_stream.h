@@ -0,0 +1,118 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Streaming texture residency                                                  |
+| Keeps only the mip levels of block-compressed textures that are wanted, in   |
+| a fixed memory budget. Adding a texture loads its mip tail - the levels of   |
+| STREAM_TAIL_SIZE texels or smaller - straight away, so it can be drawn on    |
+| the first frame. Finer levels are read from the .bctx file on background     |
+| I/O threads, one level at a time from coarse to fine, and uploaded at the    |
+| next update. When the budget is full, levels finer than a texture wants are  |
+| dropped first, then the finest levels of the least recently used textures.   |
+| The resident levels are always a run from resident_level down to 1x1, so GL  |
+| only has to move GL_TEXTURE_BASE_LEVEL. Uploads go through callbacks, which  |
+| can be faked to run without GL.                                              |
+\******************************************************************************/
+#ifndef _TEXTURE_STREAM_H_
+#define _TEXTURE_STREAM_H_
+
+#include "block_compress.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// levels this many texels wide and high, or smaller, are never evicted
+#define STREAM_TAIL_SIZE 64
+
+enum stream_residency_t {
+	STREAM_TAIL,		 // only the mip tail
+	STREAM_PARTIAL,	 // finer than the tail, but not yet the wanted level
+	STREAM_COMPLETE	 // the wanted level and everything below it
+};
+
+/* how the streamer talks to GL. called only from texture_stream_add() and
+texture_streamer_update(), on the thread that calls them */
+struct stream_uploader_t {
+	// put blocks into level of texture. the texture's base level is now level
+	std::function<void( int texture, bc_format_t format, int level, const bc_level_t &size,
+											 const unsigned char *blocks )>
+		upload;
+	// free level of texture. the texture's base level is now level + 1
+	std::function<void( int texture, int level )> evict;
+};
+
+struct stream_texture_t {
+	std::string file_name;
+	bc_texture_t header;	// format and levels. blocks stay empty
+	int tail_level;				// first level of the mip tail
+	int resident_level;		// finest level uploaded. every coarser one is too
+	int wanted_level;			// finest level asked for by texture_stream_request()
+	int loading_level;		// level being read, or -1
+	unsigned int last_used; // frame of the last texture_stream_request()
+};
+
+/* a level to read, handed to the I/O threads */
+struct stream_read_t {
+	int texture, level;
+	std::string file_name;
+	long file_offset;
+	size_t size;
+	std::vector<unsigned char> blocks;
+	bool ok;
+};
+
+struct texture_streamer_t {
+	std::vector<stream_texture_t> textures;
+	stream_uploader_t uploader;
+	size_t budget;		// bytes of blocks allowed to be resident
+	size_t used;			// bytes of blocks resident now
+	size_t peak_used; // most bytes ever resident after an update
+	unsigned int frame;
+
+	std::vector<std::thread> io_threads;
+	std::mutex mutex; // guards everything below
+	std::condition_variable wake;
+	std::deque<stream_read_t> reads;		 // waiting for an I/O thread
+	std::vector<stream_read_t> finished; // waiting for texture_streamer_update()
+	bool quitting;
+
+	// counts since texture_streamer_start()
+	int uploads, evictions, dropped; // dropped: read, but no longer wanted or no room
+	size_t bytes_read;
+
+	texture_streamer_t();
+	~texture_streamer_t();
+};
+
+/* starts io_thread_count I/O threads. budget is in bytes of blocks */
+void texture_streamer_start( texture_streamer_t &ts, size_t budget, int io_thread_count,
+														 const stream_uploader_t &uploader );
+
+/* stops the I/O threads, throwing away any reads they hadn't finished */
+void texture_streamer_stop( texture_streamer_t &ts );
+
+/* reads the header of a .bctx file and uploads its mip tail. returns the
+texture's index, or -1 if the file couldn't be read. the tail counts towards
+the budget but may go over it */
+int texture_stream_add( texture_streamer_t &ts, const char *file_name );
+
+/* asks for texture to have level and everything coarser resident. call every
+frame the texture is drawn, or it becomes a candidate for eviction */
+void texture_stream_request( texture_streamer_t &ts, int texture, int level );
+
+/* once a frame: uploads finished reads, evicts to stay in the budget, and
+starts reading the next level of each texture that wants a finer one */
+void texture_streamer_update( texture_streamer_t &ts );
+
+stream_residency_t texture_stream_residency( const texture_streamer_t &ts, int texture );
+
+#endif
@@ -0,0 +1,525 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Cube map image-based lighting. See cube_ibl.h                                |
+\******************************************************************************/
+#include "cube_ibl.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <functional>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// a thread is only worth starting for this many rows of texels
+#define CUBE_MIN_ROWS_PER_THREAD 16
+
+/* calls func( t, face, y ) for every row y of all six faces of size rows each,
+with the rows shared out over up to thread_count threads, and returns how many
+threads it used. t is the thread's index */
+static int for_each_row( int size, int thread_count,
+												 const std::function<void( int, int, int )> &func ) {
+	int rows = 6 * size;
+	int threads = std::max( 1, std::min( thread_count, rows / CUBE_MIN_ROWS_PER_THREAD ) );
+	run_on_threads( threads, [&]( int t ) {
+		int end = share_start( rows, t + 1, threads );
+		for ( int r = share_start( rows, t, threads ); r < end; r++ ) {
+			func( t, r / size, r % size );
+		}
+	} );
+	return threads;
+}
+
+static void normalise( float *v ) {
+	float len = sqrtf( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+	v[0] /= len;
+	v[1] /= len;
+	v[2] /= len;
+}
+
+void cube_map_from_faces( cube_map_t &cube, const unsigned char *const faces[6], int size,
+													bool srgb, int max_size, int thread_count ) {
+	float to_linear[256];
+	for ( int i = 0; i < 256; i++ ) {
+		double c = i / 255.0;
+		if ( srgb ) {
+			c = c <= 0.04045 ? c / 12.92 : pow( ( c + 0.055 ) / 1.055, 2.4 );
+		}
+		to_linear[i] = (float)c;
+	}
+	int out_size = size;
+	while ( out_size > max_size && out_size % 2 == 0 ) {
+		out_size /= 2;
+	}
+	const int factor = size / out_size;
+
+	cube.levels.assign( 1, cube_level_t() );
+	cube.levels[0].size = out_size;
+	for ( int f = 0; f < 6; f++ ) {
+		cube.levels[0].faces[f].resize( (size_t)out_size * out_size * 3 );
+	}
+	const float scale = 1.0f / ( factor * factor );
+	for_each_row( out_size, thread_count, [&]( int, int f, int y ) {
+		float *out = &cube.levels[0].faces[f][(size_t)y * out_size * 3];
+		for ( int x = 0; x < out_size; x++ ) {
+			float sum[3] = { 0.0f, 0.0f, 0.0f };
+			for ( int sy = y * factor; sy < ( y + 1 ) * factor; sy++ ) {
+				const unsigned char *in = faces[f] + ( (size_t)sy * size + x * factor ) * 4;
+				for ( int sx = 0; sx < factor; sx++, in += 4 ) {
+					sum[0] += to_linear[in[0]];
+					sum[1] += to_linear[in[1]];
+					sum[2] += to_linear[in[2]];
+				}
+			}
+			out[x * 3] = sum[0] * scale;
+			out[x * 3 + 1] = sum[1] * scale;
+			out[x * 3 + 2] = sum[2] * scale;
+		}
+	} );
+
+	while ( cube.levels.back().size > 1 ) {
+		cube.levels.push_back( cube_level_t() );
+		const cube_level_t &src = cube.levels[cube.levels.size() - 2];
+		cube_level_t &dst = cube.levels.back();
+		dst.size = src.size / 2;
+		for ( int f = 0; f < 6; f++ ) {
+			dst.faces[f].resize( (size_t)dst.size * dst.size * 3 );
+		}
+		for_each_row( dst.size, thread_count, [&]( int, int f, int y ) {
+			const float *row0 = &src.faces[f][(size_t)( y * 2 ) * src.size * 3];
+			const float *row1 = row0 + ( y * 2 + 1 < src.size ? src.size * 3 : 0 );
+			float *out = &dst.faces[f][(size_t)y * dst.size * 3];
+			for ( int x = 0; x < dst.size; x++ ) {
+				int a = x * 6, b = x * 2 + 1 < src.size ? x * 6 + 3 : x * 6;
+				for ( int c = 0; c < 3; c++ ) {
+					out[x * 3 + c] = 0.25f * ( row0[a + c] + row0[b + c] + row1[a + c] + row1[b + c] );
+				}
+			}
+		} );
+	}
+}
+
+/* GL's table of which axis each face is, and which ways s and t run on it */
+void cube_texel_dir( int face, int size, float x, float y, float *dir ) {
+	float u = 2.0f * x / size - 1.0f;
+	float v = 2.0f * y / size - 1.0f;
+	switch ( face ) {
+	case 0: dir[0] = 1.0f; dir[1] = -v; dir[2] = -u; break;
+	case 1: dir[0] = -1.0f; dir[1] = -v; dir[2] = u; break;
+	case 2: dir[0] = u; dir[1] = 1.0f; dir[2] = v; break;
+	case 3: dir[0] = u; dir[1] = -1.0f; dir[2] = -v; break;
+	case 4: dir[0] = u; dir[1] = -v; dir[2] = 1.0f; break;
+	default: dir[0] = -u; dir[1] = -v; dir[2] = -1.0f; break;
+	}
+	normalise( dir );
+}
+
+/* the face dir points at, and where on it, from 0 to 1 */
+static int face_of_dir( const float *dir, float *s, float *t ) {
+	float ax = fabsf( dir[0] ), ay = fabsf( dir[1] ), az = fabsf( dir[2] );
+	int face;
+	float sc, tc, ma;
+	if ( ax >= ay && ax >= az ) {
+		face = dir[0] > 0.0f ? 0 : 1;
+		ma = ax;
+		sc = dir[0] > 0.0f ? -dir[2] : dir[2];
+		tc = -dir[1];
+	} else if ( ay >= az ) {
+		face = dir[1] > 0.0f ? 2 : 3;
+		ma = ay;
+		sc = dir[0];
+		tc = dir[1] > 0.0f ? dir[2] : -dir[2];
+	} else {
+		face = dir[2] > 0.0f ? 4 : 5;
+		ma = az;
+		sc = dir[2] > 0.0f ? dir[0] : -dir[0];
+		tc = -dir[1];
+	}
+	*s = 0.5f * ( sc / ma + 1.0f );
+	*t = 0.5f * ( tc / ma + 1.0f );
+	return face;
+}
+
+/* the solid angle of the part of a face from the centre to x, y, in -1 to 1 */
+static double area_to( double x, double y ) { return atan2( x * y, sqrt( x * x + y * y + 1.0 ) ); }
+
+float cube_texel_solid_angle( int size, int x, int y ) {
+	double x0 = 2.0 * x / size - 1.0, x1 = 2.0 * ( x + 1 ) / size - 1.0;
+	double y0 = 2.0 * y / size - 1.0, y1 = 2.0 * ( y + 1 ) / size - 1.0;
+	return (float)( area_to( x1, y1 ) - area_to( x0, y1 ) - area_to( x1, y0 ) + area_to( x0, y0 ) );
+}
+
+/* bilinear, clamped at the edges of the face */
+static void sample_level( const cube_level_t &level, const float *dir, float *rgb ) {
+	float s, t;
+	int face = face_of_dir( dir, &s, &t );
+	int size = level.size;
+	float fx = std::min( std::max( s * size - 0.5f, 0.0f ), (float)( size - 1 ) );
+	float fy = std::min( std::max( t * size - 0.5f, 0.0f ), (float)( size - 1 ) );
+	int x0 = (int)fx, y0 = (int)fy;
+	int x1 = std::min( x0 + 1, size - 1 ), y1 = std::min( y0 + 1, size - 1 );
+	float wx = fx - x0, wy = fy - y0;
+	const float *texels = &level.faces[face][0];
+	const float *a = texels + ( (size_t)y0 * size + x0 ) * 3;
+	const float *b = texels + ( (size_t)y0 * size + x1 ) * 3;
+	const float *c = texels + ( (size_t)y1 * size + x0 ) * 3;
+	const float *d = texels + ( (size_t)y1 * size + x1 ) * 3;
+	for ( int i = 0; i < 3; i++ ) {
+		float top = a[i] + ( b[i] - a[i] ) * wx;
+		float bottom = c[i] + ( d[i] - c[i] ) * wx;
+		rgb[i] = top + ( bottom - top ) * wy;
+	}
+}
+
+void cube_map_sample( const cube_map_t &cube, const float *dir, float level, float *rgb ) {
+	level = std::min( std::max( level, 0.0f ), (float)( cube.levels.size() - 1 ) );
+	int l0 = (int)level;
+	float w = level - l0;
+	sample_level( cube.levels[l0], dir, rgb );
+	if ( w > 0.0f ) {
+		float finer[3] = { rgb[0], rgb[1], rgb[2] };
+		sample_level( cube.levels[l0 + 1], dir, rgb );
+		for ( int i = 0; i < 3; i++ ) {
+			rgb[i] = finer[i] + ( rgb[i] - finer[i] ) * w;
+		}
+	}
+}
+
+/* the real SH basis functions of bands 0 to 2 at unit direction d */
+static void sh9_basis( const float *d, float *y ) {
+	y[0] = 0.282095f;
+	y[1] = 0.488603f * d[1];
+	y[2] = 0.488603f * d[2];
+	y[3] = 0.488603f * d[0];
+	y[4] = 1.092548f * d[0] * d[1];
+	y[5] = 1.092548f * d[1] * d[2];
+	y[6] = 0.315392f * ( 3.0f * d[2] * d[2] - 1.0f );
+	y[7] = 1.092548f * d[0] * d[2];
+	y[8] = 0.546274f * ( d[0] * d[0] - d[1] * d[1] );
+}
+
+void cube_project_sh9( const cube_map_t &cube, int level, sh9_t &sh, int thread_count ) {
+	const cube_level_t &l = cube.levels[level];
+	// each thread adds up its own rows, in double so small texels aren't lost
+	std::vector<double> sums( (size_t)std::max( thread_count, 1 ) * 27, 0.0 );
+	int threads = for_each_row( l.size, thread_count, [&]( int t, int f, int y ) {
+		double *sum = &sums[t * 27];
+		const float *texel = &l.faces[f][(size_t)y * l.size * 3];
+		for ( int x = 0; x < l.size; x++, texel += 3 ) {
+			float dir[3], basis[9];
+			cube_texel_dir( f, l.size, x + 0.5f, y + 0.5f, dir );
+			sh9_basis( dir, basis );
+			float weight = cube_texel_solid_angle( l.size, x, y );
+			for ( int i = 0; i < 9; i++ ) {
+				double w = basis[i] * weight;
+				sum[i * 3] += texel[0] * w;
+				sum[i * 3 + 1] += texel[1] * w;
+				sum[i * 3 + 2] += texel[2] * w;
+			}
+		}
+	} );
+	for ( int i = 0; i < 27; i++ ) {
+		double total = 0.0;
+		for ( int t = 0; t < threads; t++ ) {
+			total += sums[t * 27 + i];
+		}
+		sh.c[i / 3][i % 3] = (float)total;
+	}
+}
+
+/* the cosine lobe's SH in each band is pi, 2pi/3, and pi/4 [Ramamoorthi and
+Hanrahan 2001]. over pi for the diffuse surface */
+void sh9_diffuse_from_radiance( sh9_t &sh ) {
+	const float band[9] = { 1.0f,	 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f,
+													0.25f, 0.25f,				0.25f,			 0.25f };
+	for ( int i = 0; i < 9; i++ ) {
+		for ( int c = 0; c < 3; c++ ) {
+			sh.c[i][c] *= band[i];
+		}
+	}
+}
+
+void sh9_evaluate( const sh9_t &sh, const float *dir, float *rgb ) {
+	float basis[9];
+	sh9_basis( dir, basis );
+	rgb[0] = rgb[1] = rgb[2] = 0.0f;
+	for ( int i = 0; i < 9; i++ ) {
+		rgb[0] += sh.c[i][0] * basis[i];
+		rgb[1] += sh.c[i][1] * basis[i];
+		rgb[2] += sh.c[i][2] * basis[i];
+	}
+}
+
+float cube_ggx_roughness( int level, int level_count ) {
+	return level_count > 1 ? (float)level / ( level_count - 1 ) : 0.0f;
+}
+
+/* GGX normal distribution, with alpha = roughness squared */
+static float ggx_d( float n_dot_h, float alpha ) {
+	float a2 = alpha * alpha;
+	float d = n_dot_h * n_dot_h * ( a2 - 1.0f ) + 1.0f;
+	return a2 / ( (float)M_PI * d * d );
+}
+
+/* bits of i mirrored about the binary point: the Hammersley point set's other
+coordinate */
+static float radical_inverse( unsigned int bits ) {
+	bits = ( bits << 16u ) | ( bits >> 16u );
+	bits = ( ( bits & 0x55555555u ) << 1u ) | ( ( bits & 0xAAAAAAAAu ) >> 1u );
+	bits = ( ( bits & 0x33333333u ) << 2u ) | ( ( bits & 0xCCCCCCCCu ) >> 2u );
+	bits = ( ( bits & 0x0F0F0F0Fu ) << 4u ) | ( ( bits & 0xF0F0F0F0u ) >> 4u );
+	bits = ( ( bits & 0x00FF00FFu ) << 8u ) | ( ( bits & 0xFF00FF00u ) >> 8u );
+	return bits * 2.3283064365386963e-10f;
+}
+
+/* a light direction around +z, with the mip level of cube to read it from */
+struct ggx_sample_t {
+	float l[3];
+	float n_dot_l;
+	float level;
+};
+
+/* the same samples serve every texel of a level, turned to face its normal */
+static std::vector<ggx_sample_t> ggx_samples( float roughness, int sample_count,
+																							int source_size ) {
+	float alpha = roughness * roughness;
+	// solid angle of one source texel, on average
+	float texel_angle = 4.0f * (float)M_PI / ( 6.0f * source_size * source_size );
+	std::vector<ggx_sample_t> samples;
+	for ( int i = 0; i < sample_count; i++ ) {
+		float u = ( i + 0.5f ) / sample_count, v = radical_inverse( i );
+		float cos_h = sqrtf( ( 1.0f - u ) / ( 1.0f + ( alpha * alpha - 1.0f ) * u ) );
+		float sin_h = sqrtf( 1.0f - cos_h * cos_h );
+		float phi = 2.0f * (float)M_PI * v;
+		float h[3] = { sin_h * cosf( phi ), sin_h * sinf( phi ), cos_h };
+		// reflect the view, which is the normal, +z, about h
+		ggx_sample_t s;
+		s.l[0] = 2.0f * cos_h * h[0];
+		s.l[1] = 2.0f * cos_h * h[1];
+		s.l[2] = 2.0f * cos_h * h[2] - 1.0f;
+		s.n_dot_l = s.l[2];
+		if ( s.n_dot_l <= 0.0f ) {
+			continue;
+		}
+		// the pdf of l is D * n.h / ( 4 v.h ), and n.h is v.h here
+		float pdf = ggx_d( cos_h, alpha ) * 0.25f;
+		float sample_angle = 1.0f / ( sample_count * pdf );
+		s.level = std::max( 0.0f, 0.5f * log2f( sample_angle / texel_angle ) );
+		samples.push_back( s );
+	}
+	return samples;
+}
+
+void cube_prefilter_ggx( const cube_map_t &cube, cube_map_t &out, int size, int level_count,
+												 int sample_count, int thread_count ) {
+	int source_size = cube.levels[0].size;
+	out.levels.assign( level_count, cube_level_t() );
+	for ( int l = 0; l < level_count; l++ ) {
+		cube_level_t &level = out.levels[l];
+		level.size = std::max( size >> l, 1 );
+		for ( int f = 0; f < 6; f++ ) {
+			level.faces[f].resize( (size_t)level.size * level.size * 3 );
+		}
+		float roughness = cube_ggx_roughness( l, level_count );
+		if ( roughness == 0.0f ) {
+			// a mirror. just the source, at the level the size of this one
+			float source_level = std::max( 0.0f, log2f( (float)source_size / level.size ) );
+			for_each_row( level.size, thread_count, [&]( int, int f, int y ) {
+				float *texel = &level.faces[f][(size_t)y * level.size * 3];
+				for ( int x = 0; x < level.size; x++, texel += 3 ) {
+					float dir[3];
+					cube_texel_dir( f, level.size, x + 0.5f, y + 0.5f, dir );
+					cube_map_sample( cube, dir, source_level, texel );
+				}
+			} );
+			continue;
+		}
+		std::vector<ggx_sample_t> samples = ggx_samples( roughness, sample_count, source_size );
+		for_each_row( level.size, thread_count, [&]( int, int f, int y ) {
+			float *texel = &level.faces[f][(size_t)y * level.size * 3];
+			for ( int x = 0; x < level.size; x++, texel += 3 ) {
+				float n[3], tangent[3], bitangent[3];
+				cube_texel_dir( f, level.size, x + 0.5f, y + 0.5f, n );
+				float up[3] = { 0.0f, 0.0f, 1.0f };
+				if ( fabsf( n[2] ) > 0.999f ) {
+					up[0] = 1.0f;
+					up[2] = 0.0f;
+				}
+				tangent[0] = up[1] * n[2] - up[2] * n[1];
+				tangent[1] = up[2] * n[0] - up[0] * n[2];
+				tangent[2] = up[0] * n[1] - up[1] * n[0];
+				normalise( tangent );
+				bitangent[0] = n[1] * tangent[2] - n[2] * tangent[1];
+				bitangent[1] = n[2] * tangent[0] - n[0] * tangent[2];
+				bitangent[2] = n[0] * tangent[1] - n[1] * tangent[0];
+				float sum[3] = { 0.0f, 0.0f, 0.0f }, weight = 0.0f;
+				for ( size_t i = 0; i < samples.size(); i++ ) {
+					const ggx_sample_t &s = samples[i];
+					float l[3], rgb[3];
+					for ( int c = 0; c < 3; c++ ) {
+						l[c] = tangent[c] * s.l[0] + bitangent[c] * s.l[1] + n[c] * s.l[2];
+					}
+					cube_map_sample( cube, l, s.level, rgb );
+					sum[0] += rgb[0] * s.n_dot_l;
+					sum[1] += rgb[1] * s.n_dot_l;
+					sum[2] += rgb[2] * s.n_dot_l;
+					weight += s.n_dot_l;
+				}
+				texel[0] = sum[0] / weight;
+				texel[1] = sum[1] / weight;
+				texel[2] = sum[2] / weight;
+			}
+		} );
+	}
+}
+
+void cube_diffuse_brute_force( const cube_map_t &cube, int level, const float *normal,
+															 float *rgb ) {
+	const cube_level_t &l = cube.levels[level];
+	double sum[3] = { 0.0, 0.0, 0.0 };
+	for ( int f = 0; f < 6; f++ ) {
+		for ( int y = 0; y < l.size; y++ ) {
+			for ( int x = 0; x < l.size; x++ ) {
+				float dir[3];
+				cube_texel_dir( f, l.size, x + 0.5f, y + 0.5f, dir );
+				float cos_theta = normal[0] * dir[0] + normal[1] * dir[1] + normal[2] * dir[2];
+				if ( cos_theta <= 0.0f ) {
+					continue;
+				}
+				double w = cos_theta * cube_texel_solid_angle( l.size, x, y );
+				const float *texel = &l.faces[f][( (size_t)y * l.size + x ) * 3];
+				sum[0] += texel[0] * w;
+				sum[1] += texel[1] * w;
+				sum[2] += texel[2] * w;
+			}
+		}
+	}
+	for ( int c = 0; c < 3; c++ ) {
+		rgb[c] = (float)( sum[c] / M_PI );
+	}
+}
+
+/* weights each texel's light l by D( h ) * n.l, which is what importance
+sampling D with n = v converges on */
+void cube_ggx_brute_force( const cube_map_t &cube, int level, const float *normal,
+													 float roughness, float *rgb ) {
+	const cube_level_t &l = cube.levels[level];
+	float alpha = roughness * roughness;
+	double sum[3] = { 0.0, 0.0, 0.0 }, weight = 0.0;
+	for ( int f = 0; f < 6; f++ ) {
+		for ( int y = 0; y < l.size; y++ ) {
+			for ( int x = 0; x < l.size; x++ ) {
+				float dir[3];
+				cube_texel_dir( f, l.size, x + 0.5f, y + 0.5f, dir );
+				float n_dot_l = normal[0] * dir[0] + normal[1] * dir[1] + normal[2] * dir[2];
+				if ( n_dot_l <= 0.0f ) {
+					continue;
+				}
+				float h[3] = { normal[0] + dir[0], normal[1] + dir[1], normal[2] + dir[2] };
+				normalise( h );
+				float n_dot_h = normal[0] * h[0] + normal[1] * h[1] + normal[2] * h[2];
+				double w = ggx_d( n_dot_h, alpha ) * n_dot_l * cube_texel_solid_angle( l.size, x, y );
+				const float *texel = &l.faces[f][( (size_t)y * l.size + x ) * 3];
+				sum[0] += texel[0] * w;
+				sum[1] += texel[1] * w;
+				sum[2] += texel[2] * w;
+				weight += w;
+			}
+		}
+	}
+	for ( int c = 0; c < 3; c++ ) {
+		rgb[c] = (float)( sum[c] / weight );
+	}
+}
+
+static void put_u32( unsigned char *out, unsigned int v ) {
+	for ( int i = 0; i < 4; i++ ) {
+		out[i] = (unsigned char)( v >> ( 8 * i ) );
+	}
+}
+
+static unsigned int get_u32( const unsigned char *in ) {
+	return in[0] | ( in[1] << 8 ) | ( in[2] << 16 ) | ( (unsigned int)in[3] << 24 );
+}
+
+static bool write_floats( FILE *file, const float *v, size_t count ) {
+	std::vector<unsigned char> bytes( count * 4 );
+	for ( size_t i = 0; i < count; i++ ) {
+		unsigned int bits;
+		memcpy( &bits, &v[i], 4 );
+		put_u32( &bytes[i * 4], bits );
+	}
+	return fwrite( &bytes[0], 1, bytes.size(), file ) == bytes.size();
+}
+
+static bool read_floats( FILE *file, float *v, size_t count ) {
+	std::vector<unsigned char> bytes( count * 4 );
+	if ( fread( &bytes[0], 1, bytes.size(), file ) != bytes.size() ) {
+		return false;
+	}
+	for ( size_t i = 0; i < count; i++ ) {
+		unsigned int bits = get_u32( &bytes[i * 4] );
+		memcpy( &v[i], &bits, 4 );
+	}
+	return true;
+}
+
+bool cube_ibl_save( const sh9_t &diffuse, const cube_map_t &specular, const char *file_name ) {
+	FILE *file = fopen( file_name, "wb" );
+	if ( !file ) {
+		fprintf( stderr, "ERROR: could not open %s for writing\n", file_name );
+		return false;
+	}
+	unsigned char header[12];
+	memcpy( header, "IBLX", 4 );
+	put_u32( header + 4, (unsigned int)specular.levels[0].size );
+	put_u32( header + 8, (unsigned int)specular.levels.size() );
+	bool ok = fwrite( header, 1, sizeof( header ), file ) == sizeof( header ) &&
+						write_floats( file, &diffuse.c[0][0], 27 );
+	for ( size_t l = 0; ok && l < specular.levels.size(); l++ ) {
+		const cube_level_t &level = specular.levels[l];
+		for ( int f = 0; ok && f < 6; f++ ) {
+			ok = write_floats( file, &level.faces[f][0], level.faces[f].size() );
+		}
+	}
+	fclose( file );
+	if ( !ok ) {
+		fprintf( stderr, "ERROR: could not write %s\n", file_name );
+	}
+	return ok;
+}
+
+bool cube_ibl_load( sh9_t &diffuse, cube_map_t &specular, const char *file_name ) {
+	FILE *file = fopen( file_name, "rb" );
+	if ( !file ) {
+		return false;
+	}
+	unsigned char header[12] = { 0 };
+	bool ok = fread( header, 1, sizeof( header ), file ) == sizeof( header ) &&
+						memcmp( header, "IBLX", 4 ) == 0;
+	int size = (int)get_u32( header + 4 ), level_count = (int)get_u32( header + 8 );
+	ok = ok && size > 0 && size <= 16384 && level_count > 0 && level_count <= 32 &&
+			 read_floats( file, &diffuse.c[0][0], 27 );
+	specular.levels.assign( ok ? level_count : 0, cube_level_t() );
+	for ( int l = 0; ok && l < level_count; l++ ) {
+		// halving as cube_prefilter_ggx() does
+		cube_level_t &level = specular.levels[l];
+		level.size = std::max( size >> l, 1 );
+		for ( int f = 0; ok && f < 6; f++ ) {
+			level.faces[f].resize( (size_t)level.size * level.size * 3 );
+			ok = read_floats( file, &level.faces[f][0], level.faces[f].size() );
+		}
+	}
+	fclose( file );
+	if ( !ok ) {
+		fprintf( stderr, "ERROR: %s is not a valid image-based lighting file\n", file_name );
+		specular.levels.clear();
+	}
+	return ok;
+}
@@ -0,0 +1,97 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Cube map image-based lighting                                                |
+| Works out, on the CPU, the two things a shader needs to light a surface with |
+| a cube map in one step each:                                                 |
+| * diffuse - the irradiance from every direction, which is so smooth that 9   |
+|   spherical harmonic (SH) coefficients per colour channel hold it to within  |
+|   a few percent. the shader evaluates a short polynomial of the normal       |
+| * specular - copies of the cube map blurred by the GGX lobe of a rising      |
+|   roughness, one per mip level. the shader looks up the reflected direction  |
+|   at the level for its roughness                                             |
+| Texels are weighted by the solid angle they cover. The work is shared over   |
+| threads by rows of all six faces. Brute-force versions that add up every     |
+| texel are here to check the fast ones against. Both results can be saved to  |
+| a file offline, and loaded at run time instead of being worked out again.    |
+\******************************************************************************/
+#ifndef _CUBE_IBL_H_
+#define _CUBE_IBL_H_
+
+#include <vector>
+
+/* one size of a cube map. faces in GL's order: +x, -x, +y, -y, +z, -z, with
+rows as given to glTexImage2D(). linear RGB floats, 3 per texel */
+struct cube_level_t {
+	int size; // width and height of each face
+	std::vector<float> faces[6];
+};
+
+struct cube_map_t {
+	std::vector<cube_level_t> levels; // level 0 largest, each half the last
+};
+
+/* 9 coefficients, each RGB, of bands 0 to 2 */
+struct sh9_t {
+	float c[9][3];
+};
+
+/* makes cube a float copy of six size x size RGBA faces, of at most max_size,
+averaging blocks of texels if it has to shrink them, with a box-filtered mip
+chain under it down to 1x1. sRGB faces are made linear first */
+void cube_map_from_faces( cube_map_t &cube, const unsigned char *const faces[6], int size,
+													bool srgb, int max_size, int thread_count );
+
+/* the unit direction through continuous texel coordinates x, y of a face of
+size x size texels. texel centres are at 0.5 */
+void cube_texel_dir( int face, int size, float x, float y, float *dir );
+
+/* the solid angle in steradians covered by texel x, y of a face */
+float cube_texel_solid_angle( int size, int x, int y );
+
+/* bilinear within a face, and linear between mip levels. level may be
+fractional */
+void cube_map_sample( const cube_map_t &cube, const float *dir, float level, float *rgb );
+
+/* projects the radiance in level of cube onto SH */
+void cube_project_sh9( const cube_map_t &cube, int level, sh9_t &sh, int thread_count );
+
+/* turns the SH of radiance into the SH of the light a white diffuse surface
+gives off, facing each way: irradiance convolved with the cosine lobe, over
+pi */
+void sh9_diffuse_from_radiance( sh9_t &sh );
+
+void sh9_evaluate( const sh9_t &sh, const float *dir, float *rgb );
+
+/* GGX roughness, from 0 to 1, that level of level_count prefiltered levels
+is blurred for */
+float cube_ggx_roughness( int level, int level_count );
+
+/* fills out with level_count levels, from size x size down, each cube blurred
+by the GGX lobe of its roughness, with the view along the normal. each texel
+takes sample_count importance samples, each from the mip level of cube whose
+texels are the size of the sample's share of the lobe */
+void cube_prefilter_ggx( const cube_map_t &cube, cube_map_t &out, int size, int level_count,
+												 int sample_count, int thread_count );
+
+/* the file is a header - "IBLX", then the specular map's face size and level
+count as 32-bit little-endian integers - followed by the 27 floats of the
+diffuse SH and every level's six faces, as 32-bit little-endian floats */
+bool cube_ibl_save( const sh9_t &diffuse, const cube_map_t &specular, const char *file_name );
+bool cube_ibl_load( sh9_t &diffuse, cube_map_t &specular, const char *file_name );
+
+/* every texel of level of cube, to check sh9_evaluate() of the diffuse SH
+against */
+void cube_diffuse_brute_force( const cube_map_t &cube, int level, const float *normal,
+															 float *rgb );
+
+/* every texel of level of cube, to check cube_prefilter_ggx() against */
+void cube_ggx_brute_force( const cube_map_t &cube, int level, const float *normal,
+													 float roughness, float *rgb );
+
+#endif
@@ -0,0 +1,194 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Equirectangular panoramas. See equirect.h                                    |
+\******************************************************************************/
+#include "equirect.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <functional>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <string.h>
+#include <vector>
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define EQUIRECT_SSE
+#endif
+
+// a thread is only worth starting for this many rows of texels
+#define EQUIRECT_MIN_ROWS_PER_THREAD 16
+
+/* each side's direction at its centre, and the ways s and t run across it, in
+GL's order. a texel's direction is centre + u * s + v * t, for u and v in
+-1 to 1 */
+static const float k_sides[6][9] = {
+	{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f },
+	{ -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f },
+	{ 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+	{ 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f },
+	{ 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f },
+	{ 0.0f, 0.0f, -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f }
+};
+
+const char *equirect_path() {
+#ifdef EQUIRECT_SSE
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
+
+/* calls func( row ) for rows 0 to count-1, shared out over up to thread_count
+threads */
+static void for_each_row( int count, int thread_count, const std::function<void( int )> &func ) {
+	int threads = std::max( 1, std::min( thread_count, count / EQUIRECT_MIN_ROWS_PER_THREAD ) );
+	run_on_threads( threads, [&]( int t ) {
+		int end = share_start( count, t + 1, threads );
+		for ( int r = share_start( count, t, threads ); r < end; r++ ) {
+			func( r );
+		}
+	} );
+}
+
+#ifdef EQUIRECT_SSE
+/* atan2 to within about 1e-5 radians, from a polynomial for atan on 0 to 1 */
+static inline __m128 atan2_ps( __m128 y, __m128 x ) {
+	const __m128 sign = _mm_set1_ps( -0.0f );
+	__m128 ax = _mm_andnot_ps( sign, x ), ay = _mm_andnot_ps( sign, y );
+	__m128 a = _mm_div_ps( _mm_min_ps( ax, ay ),
+												 _mm_max_ps( _mm_max_ps( ax, ay ), _mm_set1_ps( 1e-30f ) ) );
+	__m128 s = _mm_mul_ps( a, a );
+	__m128 r =
+		_mm_add_ps( _mm_mul_ps( _mm_set1_ps( -0.0464964749f ), s ), _mm_set1_ps( 0.15931422f ) );
+	r = _mm_sub_ps( _mm_mul_ps( r, s ), _mm_set1_ps( 0.327622764f ) );
+	r = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( r, s ), a ), a );
+	__m128 steep = _mm_cmpgt_ps( ay, ax );
+	r = _mm_or_ps( _mm_and_ps( steep, _mm_sub_ps( _mm_set1_ps( (float)M_PI_2 ), r ) ),
+								 _mm_andnot_ps( steep, r ) );
+	__m128 left = _mm_cmplt_ps( x, _mm_setzero_ps() );
+	r = _mm_or_ps( _mm_and_ps( left, _mm_sub_ps( _mm_set1_ps( (float)M_PI ), r ) ),
+								 _mm_andnot_ps( left, r ) );
+	return _mm_xor_ps( r, _mm_and_ps( y, sign ) );
+}
+
+static inline __m128 texel_ps( const unsigned char *texel ) {
+	int bytes;
+	memcpy( &bytes, texel, 4 );
+	__m128i zero = _mm_setzero_si128();
+	__m128i v = _mm_unpacklo_epi8( _mm_cvtsi32_si128( bytes ), zero );
+	return _mm_cvtepi32_ps( _mm_unpacklo_epi16( v, zero ) );
+}
+#endif
+
+/* filters the panorama at sx, sy, in texels with centres at 0.5 */
+static inline void bilinear( const unsigned char *pixels, int width, int height, float sx, float sy,
+														 unsigned char *out ) {
+	float fx0 = floorf( sx ), fy0 = floorf( sy );
+	float wx = sx - fx0, wy = sy - fy0;
+	// sx is never more than a texel outside the panorama
+	int x0 = (int)fx0;
+	x0 = x0 < 0 ? x0 + width : ( x0 >= width ? x0 - width : x0 );
+	int x1 = x0 + 1 == width ? 0 : x0 + 1;
+	int y0 = std::min( std::max( (int)fy0, 0 ), height - 1 );
+	int y1 = std::min( std::max( (int)fy0 + 1, 0 ), height - 1 );
+	const unsigned char *a = pixels + ( (size_t)y0 * width + x0 ) * 4;
+	const unsigned char *b = pixels + ( (size_t)y0 * width + x1 ) * 4;
+	const unsigned char *c = pixels + ( (size_t)y1 * width + x0 ) * 4;
+	const unsigned char *d = pixels + ( (size_t)y1 * width + x1 ) * 4;
+#ifdef EQUIRECT_SSE
+	__m128 sum = _mm_mul_ps( texel_ps( a ), _mm_set1_ps( ( 1.0f - wx ) * ( 1.0f - wy ) ) );
+	sum = _mm_add_ps( sum, _mm_mul_ps( texel_ps( b ), _mm_set1_ps( wx * ( 1.0f - wy ) ) ) );
+	sum = _mm_add_ps( sum, _mm_mul_ps( texel_ps( c ), _mm_set1_ps( ( 1.0f - wx ) * wy ) ) );
+	sum = _mm_add_ps( sum, _mm_mul_ps( texel_ps( d ), _mm_set1_ps( wx * wy ) ) );
+	__m128i v = _mm_cvtps_epi32( sum );
+	v = _mm_packus_epi16( _mm_packs_epi32( v, v ), v );
+	int bytes = _mm_cvtsi128_si32( v );
+	memcpy( out, &bytes, 4 );
+#else
+	for ( int i = 0; i < 4; i++ ) {
+		float top = a[i] + ( b[i] - a[i] ) * wx;
+		float bottom = c[i] + ( d[i] - c[i] ) * wx;
+		out[i] = (unsigned char)( top + ( bottom - top ) * wy + 0.5f );
+	}
+#endif
+}
+
+void equirect_to_cube( const unsigned char *pixels, int width, int height, int face_size,
+											 unsigned char *const faces[6], int thread_count ) {
+	const float du = 2.0f / face_size;
+	// panorama texels per radian of longitude and latitude
+	const float per_lon = width / ( 2.0f * (float)M_PI ), per_lat = height / (float)M_PI;
+	for_each_row( 6 * face_size, thread_count, [&]( int row ) {
+		int f = row / face_size, y = row % face_size;
+		const float *side = k_sides[f];
+		float v = ( y + 0.5f ) * du - 1.0f;
+		// the direction at u = 0 on this row
+		float base[3] = { side[0] + v * side[6], side[1] + v * side[7], side[2] + v * side[8] };
+		unsigned char *out = faces[f] + (size_t)y * face_size * 4;
+		float sx[4], sy[4];
+		for ( int x = 0; x < face_size; x += 4 ) {
+			float u0 = ( x + 0.5f ) * du - 1.0f;
+#ifdef EQUIRECT_SSE
+			__m128 u = _mm_add_ps( _mm_set1_ps( u0 ), _mm_mul_ps( _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f ),
+																														 _mm_set1_ps( du ) ) );
+			__m128 dx = _mm_add_ps( _mm_set1_ps( base[0] ), _mm_mul_ps( u, _mm_set1_ps( side[3] ) ) );
+			__m128 dy = _mm_add_ps( _mm_set1_ps( base[1] ), _mm_mul_ps( u, _mm_set1_ps( side[4] ) ) );
+			__m128 dz = _mm_add_ps( _mm_set1_ps( base[2] ), _mm_mul_ps( u, _mm_set1_ps( side[5] ) ) );
+			__m128 lon = atan2_ps( dx, _mm_sub_ps( _mm_setzero_ps(), dz ) );
+			__m128 across = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dz, dz ) ) );
+			__m128 lat = atan2_ps( dy, across );
+			_mm_storeu_ps( sx, _mm_add_ps( _mm_mul_ps( lon, _mm_set1_ps( per_lon ) ),
+																		 _mm_set1_ps( 0.5f * width - 0.5f ) ) );
+			_mm_storeu_ps( sy, _mm_sub_ps( _mm_set1_ps( 0.5f * height - 0.5f ),
+																		 _mm_mul_ps( lat, _mm_set1_ps( per_lat ) ) ) );
+#else
+			for ( int i = 0; i < 4; i++ ) {
+				float u = u0 + i * du;
+				float dx = base[0] + u * side[3], dy = base[1] + u * side[4], dz = base[2] + u * side[5];
+				sx[i] = atan2f( dx, -dz ) * per_lon + 0.5f * width - 0.5f;
+				sy[i] = 0.5f * height - 0.5f - atan2f( dy, sqrtf( dx * dx + dz * dz ) ) * per_lat;
+			}
+#endif
+			int n = std::min( 4, face_size - x );
+			for ( int i = 0; i < n; i++ ) {
+				bilinear( pixels, width, height, sx[i], sy[i], out + ( x + i ) * 4 );
+			}
+		}
+	} );
+}
+
+/* the side dir points at, and where on it, from 0 to 1 */
+static int side_of_dir( const float *dir, float *s, float *t ) {
+	float ax = fabsf( dir[0] ), ay = fabsf( dir[1] ), az = fabsf( dir[2] );
+	int f = ax >= ay && ax >= az ? ( dir[0] > 0.0f ? 0 : 1 )
+															 : ( ay >= az ? ( dir[1] > 0.0f ? 2 : 3 ) : ( dir[2] > 0.0f ? 4 : 5 ) );
+	const float *side = k_sides[f];
+	// along the side's centre direction, then across it
+	float ma = dir[0] * side[0] + dir[1] * side[1] + dir[2] * side[2];
+	*s = 0.5f * ( ( dir[0] * side[3] + dir[1] * side[4] + dir[2] * side[5] ) / ma + 1.0f );
+	*t = 0.5f * ( ( dir[0] * side[6] + dir[1] * side[7] + dir[2] * side[8] ) / ma + 1.0f );
+	return f;
+}
+
+void equirect_from_cube( const unsigned char *const faces[6], int face_size, unsigned char *pixels,
+												 int width, int height, int thread_count ) {
+	for_each_row( height, thread_count, [&]( int y ) {
+		float lat = (float)M_PI * ( 0.5f - ( y + 0.5f ) / height );
+		unsigned char *out = pixels + (size_t)y * width * 4;
+		for ( int x = 0; x < width; x++ ) {
+			float lon = 2.0f * (float)M_PI * ( ( x + 0.5f ) / width - 0.5f );
+			float dir[3] = { cosf( lat ) * sinf( lon ), sinf( lat ), -cosf( lat ) * cosf( lon ) };
+			float s, t;
+			int f = side_of_dir( dir, &s, &t );
+			int tx = std::min( (int)( s * face_size ), face_size - 1 );
+			int ty = std::min( (int)( t * face_size ), face_size - 1 );
+			memcpy( out + x * 4, faces[f] + ( (size_t)ty * face_size + tx ) * 4, 4 );
+		}
+	} );
+}
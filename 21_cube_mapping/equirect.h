@@ -0,0 +1,35 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Equirectangular panoramas                                                    |
+| Turns a panorama, with longitude across and latitude down, into the six      |
+| sides of a cube map, so skies can come as one image. Each texel of a side    |
+| finds its direction, then its longitude and latitude, 4 texels at a time     |
+| with SSE and a polynomial arctangent, and is then filtered bilinearly from   |
+| the panorama with one texel per register. Rows of all six sides are shared   |
+| out over threads. The panorama wraps around left to right.                   |
+\******************************************************************************/
+#ifndef _EQUIRECT_H_
+#define _EQUIRECT_H_
+
+/* fills six face_size x face_size RGBA sides, in GL's order: +x, -x, +y, -y,
++z, -z, from a width x height RGBA panorama, on up to thread_count threads.
+the middle of the panorama faces -z, its top row +y. filtering is of the
+bytes as they are, sRGB or not */
+void equirect_to_cube( const unsigned char *pixels, int width, int height, int face_size,
+											 unsigned char *const faces[6], int thread_count );
+
+/* the other way, taking the nearest texel of a side. for making panoramas to
+test with */
+void equirect_from_cube( const unsigned char *const faces[6], int face_size, unsigned char *pixels,
+												 int width, int height, int thread_count );
+
+/* "SSE" or "scalar" */
+const char *equirect_path();
+
+#endif
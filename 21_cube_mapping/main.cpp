@@ -8,25 +8,40 @@
 |******************************************************************************|
 | Cube Maps                                                                    |
 | You can swap the "reflect_vs.glsl" and "reflect_fs.glsl" for the refraction  |
-| versions. Comment one set out and uncomment the other                        |
+| versions. Comment one set out and uncomment the other, or define MONKEY_IBL  |
+| for image-based lighting                                                     |
 \******************************************************************************/
+#include "cube_ibl.h"    // diffuse and specular lighting from a cube map
+#include "equirect.h"    // panoramas into cube map sides
 #include "gl_utils.h"    // common opengl functions and small utilities like logs
 #include "maths_funcs.h" // my maths functions
 #include "obj_parser.h"  // my little Wavefront .obj mesh loader
-#include "stb_image.h"   // Sean Barrett's image loader - nothings.org
+#include "texture_loader.h" // image files into memory, with a cache
 #include <GL/glew.h>     // include GLEW and new version of GL on Windows
 #include <GLFW/glfw3.h>  // GLFW helper library
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
 #define MESH_FILE "suzanne.obj"
 
-/* choose pure reflection or pure refraction here. */
+/* choose pure reflection, pure refraction, or image-based lighting here. the
+lighting is only worked out from the cube map at start-up for the last */
+//#define MONKEY_IBL
+#ifdef MONKEY_IBL
+#define MONKEY_VERT_FILE "reflect_vs.glsl"
+#define MONKEY_FRAG_FILE "ibl_fs.glsl"
+#else
 #define MONKEY_VERT_FILE "reflect_vs.glsl"
 #define MONKEY_FRAG_FILE "reflect_fs.glsl"
 //#define MONKEY_VERT_FILE "refract_vs.glsl"
 //#define MONKEY_FRAG_FILE "refract_fs.glsl"
+#endif
+// roughness of the image-based lit surface, from mirror 0 to 1
+#define MONKEY_ROUGHNESS 0.3f
 
 #define CUBE_VERT_FILE "cube_vs.glsl"
 #define CUBE_FRAG_FILE "cube_fs.glsl"
@@ -36,11 +51,37 @@
 #define BOTTOM "negy.jpg"
 #define LEFT "negx.jpg"
 #define RIGHT "posx.jpg"
+/* the start-up benchmarks take seconds and lots of memory before the first
+frame, so they only run when this is uncommented */
+//#define RUN_BENCHMARKS
+/* a panorama, twice as wide as high, to use for the sky instead of the six
+sides above */
+//#define SKY_EQUIRECT_FILE "sky.jpg"
+#define SKY_EQUIRECT_FACE_SIZE 1024
+// the panorama made from the sides to benchmark turning back into sides
+#define BENCH_EQUIRECT_WIDTH 4096
+#define BENCH_EQUIRECT_FACE_SIZE 1024
+// the sides are shrunk to this before lighting is worked out from them
+#define IBL_SOURCE_SIZE 256
+// the prefiltered specular cube map, and how many rougher levels it has
+#define IBL_SPECULAR_SIZE 128
+#define IBL_SPECULAR_LEVELS 6
+#define IBL_SPECULAR_SAMPLES 128
+/* the lighting worked out from the sides, saved the first time the demo runs
+with MONKEY_IBL. delete it to work the lighting out again */
+#define IBL_BAKED_FILE "ibl.iblx"
+// random normals to check the lighting against brute force at
+#define BENCH_IBL_DIRECTIONS 64
+// the brute force adds up every texel of the source at this size
+#define BENCH_IBL_BRUTE_SIZE 64
 
 // keep track of window size for things like the viewport and the mouse cursor
 int g_gl_width      = 640;
 int g_gl_height     = 480;
 GLFWwindow* g_window = NULL;
+// decoded images, so reloading a cube map doesn't decode its sides again
+texture_cache_t g_textures;
+int g_num_threads = 1;
 
 /* big cube. returns Vertex Array Object */
 GLuint make_big_cube() {
@@ -77,24 +118,20 @@ GLuint make_big_cube() {
   return vao;
 }
 
-/* use stb_image to load an image file into memory, and then into one side of
-a cube-map texture. */
+/* load an image file into memory through the texture cache, and then into one
+side of a cube-map texture. sides aren't flipped like 2D textures are */
 bool load_cube_map_side( GLuint texture, GLenum side_target, const char* file_name ) {
   glBindTexture( GL_TEXTURE_CUBE_MAP, texture );
 
-  int x, y, n;
-  int force_channels        = 4;
-  unsigned char* image_data = stbi_load( file_name, &x, &y, &n, force_channels );
-  if ( !image_data ) {
-    fprintf( stderr, "ERROR: could not load %s\n", file_name );
-    return false;
-  }
+  const texture_image_t* image = texture_load( g_textures, file_name, false );
+  if ( !image ) { return false; }
+  int x = image->width;
+  int y = image->height;
   // non-power-of-2 dimensions check
   if ( ( x & ( x - 1 ) ) != 0 || ( y & ( y - 1 ) ) != 0 ) { fprintf( stderr, "WARNING: image %s is not power-of-2 dimensions\n", file_name ); }
 
   // copy image data into 'target' side of cube map
-  glTexImage2D( side_target, 0, GL_RGBA, x, y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data );
-  free( image_data );
+  glTexImage2D( side_target, 0, GL_RGBA, x, y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image->pixels );
   return true;
 }
 
@@ -105,6 +142,10 @@ void create_cube_map( const char* front, const char* back, const char* top, cons
   glActiveTexture( GL_TEXTURE0 );
   glGenTextures( 1, tex_cube );
 
+  // read all the sides at once, on as many threads, and decode them. load_cube_map_side() then finds them in the cache
+  const char* sides[6] = { front, back, top, bottom, left, right };
+  const texture_image_t* images[6];
+  texture_load_many( g_textures, sides, 6, false, images, g_num_threads );
   // load each image and copy into a side of the cube-map texture
   load_cube_map_side( *tex_cube, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, front );
   load_cube_map_side( *tex_cube, GL_TEXTURE_CUBE_MAP_POSITIVE_Z, back );
@@ -120,6 +161,224 @@ void create_cube_map( const char* front, const char* back, const char* top, cons
   glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 }
 
+/* turns a panorama into the six sides of a cube-map texture */
+bool create_cube_map_from_equirect( const char* file_name, int face_size, GLuint* tex_cube ) {
+  const texture_image_t* image = texture_load( g_textures, file_name, false );
+  if ( !image ) { return false; }
+  std::vector<unsigned char> sides( (size_t)face_size * face_size * 4 * 6 );
+  unsigned char* faces[6];
+  for ( int f = 0; f < 6; f++ ) { faces[f] = &sides[(size_t)face_size * face_size * 4 * f]; }
+  double start = glfwGetTime();
+  equirect_to_cube( image->pixels, image->width, image->height, face_size, faces, g_num_threads );
+  gl_log( "%s, %ix%i, made into %ix%i sides in %.3fms\n", file_name, image->width, image->height, face_size, face_size, ( glfwGetTime() - start ) * 1000.0 );
+
+  glActiveTexture( GL_TEXTURE0 );
+  glGenTextures( 1, tex_cube );
+  glBindTexture( GL_TEXTURE_CUBE_MAP, *tex_cube );
+  for ( int f = 0; f < 6; f++ ) {
+    glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_RGBA, face_size, face_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, faces[f] );
+  }
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+  return true;
+}
+
+/* loads the six sides one after another, then as one batch, each into a new
+cache. then makes a panorama of them, times turning it back into sides, and
+logs how close those come to the originals */
+void benchmark_cube_map_loading( const char* front, const char* back, const char* top, const char* bottom, const char* left, const char* right ) {
+  const char* names[6] = { right, left, top, bottom, back, front };
+  const texture_image_t* images[6];
+  double serial_secs, parallel_secs;
+  {
+    texture_cache_t cache;
+    double start = glfwGetTime();
+    for ( int f = 0; f < 6; f++ ) { images[f] = texture_load( cache, names[f], false ); }
+    serial_secs = glfwGetTime() - start;
+  }
+  texture_cache_t cache;
+  double start  = glfwGetTime();
+  int loaded    = texture_load_many( cache, names, 6, false, images, g_num_threads );
+  parallel_secs = glfwGetTime() - start;
+  gl_log( "cube map sides loaded in %.3fms one after another, %.3fms as a batch on %i threads\n", serial_secs * 1000.0, parallel_secs * 1000.0, g_num_threads );
+  if ( loaded < 6 ) { return; }
+  int size = images[0]->width;
+  const unsigned char* faces[6];
+  for ( int f = 0; f < 6; f++ ) {
+    if ( images[f]->width != size || images[f]->height != size ) { return; }
+    faces[f] = images[f]->pixels;
+  }
+
+  const int width = BENCH_EQUIRECT_WIDTH, height = BENCH_EQUIRECT_WIDTH / 2, face_size = BENCH_EQUIRECT_FACE_SIZE;
+  std::vector<unsigned char> panorama( (size_t)width * height * 4 );
+  equirect_from_cube( faces, size, &panorama[0], width, height, g_num_threads );
+  std::vector<unsigned char> sides( (size_t)face_size * face_size * 4 * 6 );
+  unsigned char* out[6];
+  for ( int f = 0; f < 6; f++ ) { out[f] = &sides[(size_t)face_size * face_size * 4 * f]; }
+  int thread_counts[2] = { 1, g_num_threads };
+  for ( int i = 0; i < ( g_num_threads > 1 ? 2 : 1 ); i++ ) {
+    const int runs = 5;
+    start          = glfwGetTime();
+    for ( int r = 0; r < runs; r++ ) { equirect_to_cube( &panorama[0], width, height, face_size, out, thread_counts[i] ); }
+    double secs = ( glfwGetTime() - start ) / runs;
+    gl_log( "  %ix%i panorama to %ix%i sides, %s, %i threads: %.3fms (%.1fM texels/s)\n", width, height, face_size, face_size, equirect_path(), thread_counts[i], secs * 1000.0,
+            6.0 * face_size * face_size / secs / 1000000.0 );
+  }
+  // against the original sides, averaged down to face_size
+  int factor    = size / face_size;
+  double errors = 0.0;
+  for ( int f = 0; f < 6; f++ ) {
+    for ( int y = 0; y < face_size; y++ ) {
+      for ( int x = 0; x < face_size; x++ ) {
+        for ( int c = 0; c < 3; c++ ) {
+          int sum = 0;
+          for ( int j = 0; j < factor; j++ ) {
+            for ( int i = 0; i < factor; i++ ) { sum += faces[f][( (size_t)( y * factor + j ) * size + x * factor + i ) * 4 + c]; }
+          }
+          double d = (double)sum / ( factor * factor ) - out[f][( (size_t)y * face_size + x ) * 4 + c];
+          errors += d * d;
+        }
+      }
+    }
+  }
+  double mse = errors / ( 6.0 * face_size * face_size * 3.0 );
+  gl_log( "  sides to panorama and back: PSNR %.2fdB\n", 10.0 * log10( 255.0 * 255.0 / mse ) );
+}
+
+#ifdef MONKEY_IBL
+/* loads the sides of a cube map into a float cube, in GL's order of faces */
+bool load_ibl_source( const char* front, const char* back, const char* top, const char* bottom, const char* left, const char* right, int max_size, cube_map_t* cube, int thread_count ) {
+  const char* names[6] = { right, left, top, bottom, back, front };
+  const unsigned char* faces[6];
+  int size = 0;
+  for ( int f = 0; f < 6; f++ ) {
+    const texture_image_t* image = texture_load( g_textures, names[f], false );
+    if ( !image ) { return false; }
+    if ( image->width != image->height || ( f > 0 && image->width != size ) ) {
+      fprintf( stderr, "ERROR: cube map sides must be square and the same size\n" );
+      return false;
+    }
+    size     = image->width;
+    faces[f] = image->pixels;
+  }
+  cube_map_from_faces( *cube, faces, size, true, max_size, thread_count );
+  return true;
+}
+
+/* works out the diffuse lighting from every direction as spherical harmonics,
+and the cube map blurred for rising roughness down its mip levels, or loads
+them from IBL_BAKED_FILE if it has been saved at these sizes. uploads the cube
+map to texture unit 1 */
+bool create_ibl( const char* front, const char* back, const char* top, const char* bottom, const char* left, const char* right, sh9_t* diffuse, GLuint* specular_cube ) {
+  double start = glfwGetTime();
+  cube_map_t specular;
+  if ( cube_ibl_load( *diffuse, specular, IBL_BAKED_FILE ) && IBL_SPECULAR_SIZE == specular.levels[0].size && IBL_SPECULAR_LEVELS == (int)specular.levels.size() ) {
+    gl_log( "image-based lighting loaded from %s in %.3fms\n", IBL_BAKED_FILE, ( glfwGetTime() - start ) * 1000.0 );
+  } else {
+    cube_map_t source;
+    if ( !load_ibl_source( front, back, top, bottom, left, right, IBL_SOURCE_SIZE, &source, g_num_threads ) ) { return false; }
+    cube_project_sh9( source, 0, *diffuse, g_num_threads );
+    sh9_diffuse_from_radiance( *diffuse );
+    cube_prefilter_ggx( source, specular, IBL_SPECULAR_SIZE, IBL_SPECULAR_LEVELS, IBL_SPECULAR_SAMPLES, g_num_threads );
+    gl_log( "image-based lighting worked out in %.3fms\n", ( glfwGetTime() - start ) * 1000.0 );
+    cube_ibl_save( *diffuse, specular, IBL_BAKED_FILE );
+  }
+
+  glActiveTexture( GL_TEXTURE1 );
+  glGenTextures( 1, specular_cube );
+  glBindTexture( GL_TEXTURE_CUBE_MAP, *specular_cube );
+  for ( int l = 0; l < IBL_SPECULAR_LEVELS; l++ ) {
+    const cube_level_t& level = specular.levels[l];
+    for ( int f = 0; f < 6; f++ ) {
+      glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, l, GL_RGB16F, level.size, level.size, 0, GL_RGB, GL_FLOAT, &level.faces[f][0] );
+    }
+  }
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, IBL_SPECULAR_LEVELS - 1 );
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+  // blurry levels are only a few texels across, so filter across their edges
+  glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
+  glActiveTexture( GL_TEXTURE0 );
+  return true;
+}
+
+/* a random unit vector */
+vec3 random_direction() {
+  vec3 d;
+  do {
+    d = vec3( rand() / (float)RAND_MAX * 2.0f - 1.0f, rand() / (float)RAND_MAX * 2.0f - 1.0f, rand() / (float)RAND_MAX * 2.0f - 1.0f );
+  } while ( length2( d ) > 1.0f || length2( d ) < 0.0001f );
+  return normalise( d );
+}
+
+/* relative difference between two colours */
+float colour_error( const float* a, const float* b ) {
+  return ( fabsf( a[0] - b[0] ) + fabsf( a[1] - b[1] ) + fabsf( a[2] - b[2] ) ) / ( b[0] + b[1] + b[2] );
+}
+
+/* times the lighting steps on one thread and on all of them, and checks them
+against adding up every texel of the source at BENCH_IBL_DIRECTIONS normals */
+void benchmark_ibl( const char* front, const char* back, const char* top, const char* bottom, const char* left, const char* right ) {
+  cube_map_t source, specular;
+  sh9_t diffuse;
+  int thread_counts[2] = { 1, g_num_threads };
+  for ( int i = 0; i < ( g_num_threads > 1 ? 2 : 1 ); i++ ) {
+    int threads   = thread_counts[i];
+    double start  = glfwGetTime();
+    if ( !load_ibl_source( front, back, top, bottom, left, right, IBL_SOURCE_SIZE, &source, threads ) ) { return; }
+    double loaded = glfwGetTime();
+    cube_project_sh9( source, 0, diffuse, threads );
+    sh9_diffuse_from_radiance( diffuse );
+    double projected = glfwGetTime();
+    cube_prefilter_ggx( source, specular, IBL_SPECULAR_SIZE, IBL_SPECULAR_LEVELS, IBL_SPECULAR_SAMPLES, threads );
+    double filtered = glfwGetTime();
+    gl_log( "image-based lighting, %i threads: sides to %ix%i floats in %.3fms, SH in %.3fms, %i GGX levels from %ix%i, %i samples, in %.3fms\n", threads, source.levels[0].size,
+            source.levels[0].size, ( loaded - start ) * 1000.0, ( projected - loaded ) * 1000.0, IBL_SPECULAR_LEVELS, IBL_SPECULAR_SIZE, IBL_SPECULAR_SIZE, IBL_SPECULAR_SAMPLES,
+            ( filtered - projected ) * 1000.0 );
+  }
+
+  int brute_level = 0;
+  while ( brute_level + 1 < (int)source.levels.size() && source.levels[brute_level].size > BENCH_IBL_BRUTE_SIZE ) { brute_level++; }
+  std::vector<vec3> normals( BENCH_IBL_DIRECTIONS );
+  srand( 1 );
+  for ( int i = 0; i < BENCH_IBL_DIRECTIONS; i++ ) { normals[i] = random_direction(); }
+  float mean = 0.0f, worst = 0.0f;
+  double brute_secs = 0.0;
+  for ( int i = 0; i < BENCH_IBL_DIRECTIONS; i++ ) {
+    float fast[3], slow[3];
+    sh9_evaluate( diffuse, normals[i].v, fast );
+    double start = glfwGetTime();
+    cube_diffuse_brute_force( source, brute_level, normals[i].v, slow );
+    brute_secs += glfwGetTime() - start;
+    float error = colour_error( fast, slow );
+    mean += error / BENCH_IBL_DIRECTIONS;
+    worst = fmaxf( worst, error );
+  }
+  gl_log( "  diffuse SH against brute force at %ix%i: %.2f%% out on average, %.2f%% at most. brute force took %.3fms a normal\n", source.levels[brute_level].size,
+          source.levels[brute_level].size, mean * 100.0f, worst * 100.0f, brute_secs * 1000.0 / BENCH_IBL_DIRECTIONS );
+  for ( int l = 1; l < IBL_SPECULAR_LEVELS; l++ ) {
+    float roughness = cube_ggx_roughness( l, IBL_SPECULAR_LEVELS );
+    mean = worst = 0.0f;
+    for ( int i = 0; i < BENCH_IBL_DIRECTIONS; i++ ) {
+      float fast[3], slow[3];
+      cube_map_sample( specular, normals[i].v, (float)l, fast );
+      cube_ggx_brute_force( source, brute_level, normals[i].v, roughness, slow );
+      float error = colour_error( fast, slow );
+      mean += error / BENCH_IBL_DIRECTIONS;
+      worst = fmaxf( worst, error );
+    }
+    gl_log( "  GGX level %i, roughness %.2f, %ix%i, against brute force: %.2f%% out on average, %.2f%% at most\n", l, roughness, specular.levels[l].size, specular.levels[l].size,
+            mean * 100.0f, worst * 100.0f );
+  }
+}
+#endif
+
 // camera matrices. it's easier if they are global
 mat4 view_mat;
 mat4 proj_mat;
@@ -131,12 +390,29 @@ int main() {
   restart_gl_log();
   // start GL context and O/S window using the GLFW helper library
   start_gl();
+  g_num_threads = (int)std::thread::hardware_concurrency();
+  if ( g_num_threads < 1 ) { g_num_threads = 1; }
 
   /*---------------------------------CUBE
    * MAP-----------------------------------*/
   GLuint cube_vao = make_big_cube();
   GLuint cube_map_texture;
+#ifdef RUN_BENCHMARKS
+  benchmark_cube_map_loading( FRONT, BACK, TOP, BOTTOM, LEFT, RIGHT );
+#endif
+#ifdef SKY_EQUIRECT_FILE
+  if ( !create_cube_map_from_equirect( SKY_EQUIRECT_FILE, SKY_EQUIRECT_FACE_SIZE, &cube_map_texture ) ) { create_cube_map( FRONT, BACK, TOP, BOTTOM, LEFT, RIGHT, &cube_map_texture ); }
+#else
   create_cube_map( FRONT, BACK, TOP, BOTTOM, LEFT, RIGHT, &cube_map_texture );
+#endif
+#ifdef MONKEY_IBL
+#ifdef RUN_BENCHMARKS
+  benchmark_ibl( FRONT, BACK, TOP, BOTTOM, LEFT, RIGHT );
+#endif
+  sh9_t ibl_diffuse;
+  GLuint ibl_specular_texture = 0;
+  if ( !create_ibl( FRONT, BACK, TOP, BOTTOM, LEFT, RIGHT, &ibl_diffuse, &ibl_specular_texture ) ) { memset( &ibl_diffuse, 0, sizeof( ibl_diffuse ) ); }
+#endif
   /*------------------------------CREATE
    * GEOMETRY-------------------------------*/
   GLfloat* vp       = NULL; // array of vertex points
@@ -172,6 +448,12 @@ int main() {
   int monkey_M_location = glGetUniformLocation( monkey_sp, "M" );
   int monkey_V_location = glGetUniformLocation( monkey_sp, "V" );
   int monkey_P_location = glGetUniformLocation( monkey_sp, "P" );
+#ifdef MONKEY_IBL
+  int monkey_sh_location        = glGetUniformLocation( monkey_sp, "sh" );
+  int monkey_specular_location  = glGetUniformLocation( monkey_sp, "specular_texture" );
+  int monkey_roughness_location = glGetUniformLocation( monkey_sp, "roughness" );
+  int monkey_max_level_location = glGetUniformLocation( monkey_sp, "max_level" );
+#endif
 
   // cube-map shaders
   GLuint cube_sp = create_programme_from_files( CUBE_VERT_FILE, CUBE_FRAG_FILE );
@@ -205,6 +487,12 @@ int main() {
   glUseProgram( monkey_sp );
   glUniformMatrix4fv( monkey_V_location, 1, GL_FALSE, view_mat.m );
   glUniformMatrix4fv( monkey_P_location, 1, GL_FALSE, proj_mat.m );
+#ifdef MONKEY_IBL
+  glUniform3fv( monkey_sh_location, 9, &ibl_diffuse.c[0][0] );
+  glUniform1i( monkey_specular_location, 1 );
+  glUniform1f( monkey_roughness_location, MONKEY_ROUGHNESS );
+  glUniform1f( monkey_max_level_location, (float)( IBL_SPECULAR_LEVELS - 1 ) );
+#endif
   glUseProgram( cube_sp );
   glUniformMatrix4fv( cube_V_location, 1, GL_FALSE, R.m );
   glUniformMatrix4fv( cube_P_location, 1, GL_FALSE, proj_mat.m );
@@ -0,0 +1,228 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Texture loader. See texture_loader.h                                         |
+\******************************************************************************/
+#include "texture_loader.h"
+#include "stb_image.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/* a file that wasn't in the cache by path */
+struct pending_file_t {
+	int index; // in the caller's list
+	std::vector<unsigned char> bytes;
+	unsigned long long hash;
+	bool read;
+	int decode; // job that decodes it, or -1 if it was cached by contents
+};
+
+struct decode_job_t {
+	int pending; // first file with these contents
+	texture_image_t *image;
+};
+
+/* calls func( i ) for i from 0 to count-1 on up to thread_count threads, each
+taking the next i when it finishes one. files take very different times */
+static void for_each_file( int count, int thread_count, const std::function<void( int )> &func ) {
+	std::atomic<int> next( 0 );
+	run_on_threads( std::max( 1, std::min( thread_count, count ) ), [&]( int ) {
+		for ( int i = next++; i < count; i = next++ ) {
+			func( i );
+		}
+	} );
+}
+
+static bool read_file( const char *file_name, std::vector<unsigned char> &bytes ) {
+	FILE *file = fopen( file_name, "rb" );
+	if ( !file ) {
+		return false;
+	}
+	fseek( file, 0, SEEK_END );
+	long size = ftell( file );
+	fseek( file, 0, SEEK_SET );
+	bool ok = size > 0;
+	if ( ok ) {
+		bytes.resize( size );
+		ok = fread( &bytes[0], 1, size, file ) == (size_t)size;
+	}
+	fclose( file );
+	return ok;
+}
+
+/* 64-bit FNV-1a */
+static unsigned long long hash_bytes( const unsigned char *bytes, size_t size ) {
+	unsigned long long hash = 14695981039346656037ull;
+	for ( size_t i = 0; i < size; i++ ) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void texture_flip_rows( unsigned char *pixels, int width_in_bytes, int height ) {
+	std::vector<unsigned char> row( width_in_bytes );
+	for ( int top = 0, bottom = height - 1; top < bottom; top++, bottom-- ) {
+		unsigned char *top_row = pixels + (size_t)top * width_in_bytes;
+		unsigned char *bottom_row = pixels + (size_t)bottom * width_in_bytes;
+		memcpy( &row[0], top_row, width_in_bytes );
+		memcpy( top_row, bottom_row, width_in_bytes );
+		memcpy( bottom_row, &row[0], width_in_bytes );
+	}
+}
+
+/* stb_image 2.10 keeps the reason for the last failure, and the zlib tables it
+builds the first time it needs them, in globals, so only one thread at a time
+may be inside it */
+static std::mutex g_stbi_mutex;
+
+static texture_image_t *decode( const std::vector<unsigned char> &bytes, bool flip ) {
+	int x, y, n;
+	unsigned char *pixels;
+	{
+		std::lock_guard<std::mutex> lock( g_stbi_mutex );
+		pixels = stbi_load_from_memory( &bytes[0], (int)bytes.size(), &x, &y, &n, 4 );
+	}
+	if ( !pixels ) {
+		return NULL;
+	}
+	if ( flip ) {
+		texture_flip_rows( pixels, x * 4, y );
+	}
+	texture_image_t *image = new texture_image_t;
+	image->pixels = pixels;
+	image->width = x;
+	image->height = y;
+	image->file_channels = n;
+	image->flipped = flip;
+	image->content_hash = 0;
+	return image;
+}
+
+const texture_image_t *texture_load( texture_cache_t &cache, const char *file_name, bool flip ) {
+	const texture_image_t *image = NULL;
+	texture_load_many( cache, &file_name, 1, flip, &image, 1 );
+	return image;
+}
+
+int texture_load_many( texture_cache_t &cache, const char *const *file_names, int count,
+											 bool flip, const texture_image_t **images, int thread_count ) {
+	std::vector<pending_file_t> pending;
+	for ( int i = 0; i < count; i++ ) {
+		std::map<std::pair<std::string, bool>, texture_image_t *>::iterator it =
+			cache.by_path.find( std::make_pair( std::string( file_names[i] ), flip ) );
+		if ( it != cache.by_path.end() ) {
+			images[i] = it->second;
+			cache.hits++;
+			continue;
+		}
+		images[i] = NULL;
+		pending.push_back( pending_file_t() );
+		pending.back().index = i;
+	}
+	if ( pending.empty() ) {
+		return count;
+	}
+
+	for_each_file( (int)pending.size(), thread_count, [&]( int p ) {
+		pending_file_t &f = pending[p];
+		f.read = read_file( file_names[f.index], f.bytes );
+		f.hash = f.read ? hash_bytes( &f.bytes[0], f.bytes.size() ) : 0;
+	} );
+
+	// only the first of any files with the same contents is decoded
+	std::vector<decode_job_t> jobs;
+	std::map<unsigned long long, int> job_of_hash;
+	for ( size_t p = 0; p < pending.size(); p++ ) {
+		pending_file_t &f = pending[p];
+		f.decode = -1;
+		if ( !f.read ) {
+			fprintf( stderr, "ERROR: could not read %s\n", file_names[f.index] );
+			continue;
+		}
+		std::map<std::pair<unsigned long long, bool>, texture_image_t *>::iterator it =
+			cache.by_content.find( std::make_pair( f.hash, flip ) );
+		if ( it != cache.by_content.end() ) {
+			images[f.index] = it->second;
+			cache.by_path[std::make_pair( std::string( file_names[f.index] ), flip )] = it->second;
+			cache.hits++;
+			continue;
+		}
+		std::map<unsigned long long, int>::iterator job = job_of_hash.find( f.hash );
+		if ( job != job_of_hash.end() ) {
+			f.decode = job->second;
+			continue;
+		}
+		f.decode = (int)jobs.size();
+		job_of_hash[f.hash] = f.decode;
+		decode_job_t added = { (int)p, NULL };
+		jobs.push_back( added );
+	}
+
+	/* decode() takes turns in stb_image, but the threads still flip rows and
+	free the files' bytes while another decodes */
+	for_each_file( (int)jobs.size(), thread_count, [&]( int j ) {
+		pending_file_t &f = pending[jobs[j].pending];
+		jobs[j].image = decode( f.bytes, flip );
+		if ( jobs[j].image ) {
+			jobs[j].image->content_hash = f.hash;
+		}
+		std::vector<unsigned char>().swap( f.bytes );
+	} );
+
+	for ( size_t j = 0; j < jobs.size(); j++ ) {
+		if ( jobs[j].image ) {
+			cache.by_content[std::make_pair( jobs[j].image->content_hash, flip )] = jobs[j].image;
+			cache.decodes++;
+		}
+	}
+	for ( size_t p = 0; p < pending.size(); p++ ) {
+		const pending_file_t &f = pending[p];
+		if ( f.decode < 0 ) {
+			continue;
+		}
+		texture_image_t *image = jobs[f.decode].image;
+		if ( !image ) {
+			fprintf( stderr, "ERROR: could not decode %s\n", file_names[f.index] );
+			continue;
+		}
+		images[f.index] = image;
+		cache.by_path[std::make_pair( std::string( file_names[f.index] ), flip )] = image;
+		if ( jobs[f.decode].pending != (int)p ) {
+			cache.hits++;
+		}
+	}
+
+	int loaded = 0;
+	for ( int i = 0; i < count; i++ ) {
+		if ( images[i] ) {
+			loaded++;
+		}
+	}
+	return loaded;
+}
+
+void texture_cache_clear( texture_cache_t &cache ) {
+	std::map<std::pair<unsigned long long, bool>, texture_image_t *>::iterator it;
+	for ( it = cache.by_content.begin(); it != cache.by_content.end(); ++it ) {
+		stbi_image_free( it->second->pixels );
+		delete it->second;
+	}
+	cache.by_content.clear();
+	cache.by_path.clear();
+	cache.decodes = 0;
+	cache.hits = 0;
+}
+
+texture_cache_t::~texture_cache_t() { texture_cache_clear( *this ); }
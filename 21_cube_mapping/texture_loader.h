@@ -0,0 +1,64 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Texture loader with a cache                                                  |
+| Loads image files into memory as 4-channel pixels ready for glTexImage2D(),  |
+| using Sean Barrett's stb_image. A batch of files is read and hashed on a     |
+| pool of threads, which take turns to decode them, as this stb_image isn't    |
+| thread-safe. Decoded images are kept in a cache keyed by the file's          |
+| contents, so loading the same path twice, or an identical copy of a file     |
+| from another folder, only decodes once. No GL calls - uploading is left to   |
+| the caller. Copy this and texture_loader.cpp into a demo to use it.          |
+\******************************************************************************/
+#ifndef _TEXTURE_LOADER_H_
+#define _TEXTURE_LOADER_H_
+
+#include <map>
+#include <string>
+#include <utility>
+
+struct texture_image_t {
+	unsigned char *pixels; // RGBA, width * height * 4 bytes. owned by the cache
+	int width, height;
+	int file_channels; // channels in the file, before being made up to 4
+	bool flipped;			 // rows are bottom to top, as GL expects, rather than as in the file
+	unsigned long long content_hash; // of the file's bytes
+};
+
+struct texture_cache_t {
+	// every image loaded, by hash of the file and whether it was flipped
+	std::map<std::pair<unsigned long long, bool>, texture_image_t *> by_content;
+	// the same images again by path, so a repeated load needs no file access
+	std::map<std::pair<std::string, bool>, texture_image_t *> by_path;
+	// since the cache was made or cleared
+	int decodes;
+	int hits;
+
+	texture_cache_t() : decodes( 0 ), hits( 0 ) {}
+	~texture_cache_t();
+};
+
+/* loads a file through the cache, or returns NULL if it can't be read or
+decoded. with flip the rows are reversed so that the bottom row comes first,
+for 2D textures; cube map sides are left the way they are in the file */
+const texture_image_t *texture_load( texture_cache_t &cache, const char *file_name, bool flip );
+
+/* loads count files through the cache, writing each one's image, or NULL, to
+images. files not already cached are read on up to thread_count threads, and
+decoded one at a time, each identical file only once. returns how many
+loaded */
+int texture_load_many( texture_cache_t &cache, const char *const *file_names, int count,
+											 bool flip, const texture_image_t **images, int thread_count );
+
+/* frees every image in the cache. pointers returned before are then invalid */
+void texture_cache_clear( texture_cache_t &cache );
+
+/* reverses the order of height rows of width_in_bytes bytes each */
+void texture_flip_rows( unsigned char *pixels, int width_in_bytes, int height );
+
+#endif
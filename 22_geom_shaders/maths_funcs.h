@@ -21,55 +21,64 @@
 #define ONE_DEG_IN_RAD ( 2.0 * M_PI ) / 360.0 // 0.017444444
 #define ONE_RAD_IN_DEG 360.0 / ( 2.0 * M_PI ) // 57.2957795
 
+/* the small functions are defined at the bottom of this file so they can be
+inlined wherever they're used. on C++11 compilers they're also constexpr, so
+constant vectors and matrices like identity_mat4() are built at compile time.
+older compilers, like Visual Studio 2012, just get inline functions */
+#if __cplusplus >= 201103L || ( defined( _MSC_VER ) && _MSC_VER >= 1900 )
+#define MATHS_FUNCS_HAS_CONSTEXPR
+#define MATHS_CONSTEXPR constexpr
+#else
+#define MATHS_CONSTEXPR inline
+#endif
+
 struct vec2;
 struct vec3;
 struct vec4;
 struct versor;
 
 struct vec2 {
-	vec2();
-	vec2( float x, float y );
+	vec2() {}
+	MATHS_CONSTEXPR vec2( float x, float y );
 	float v[2];
 };
 
 struct vec3 {
-	vec3();
+	vec3() {}
 	// create from 3 scalars
-	vec3( float x, float y, float z );
+	MATHS_CONSTEXPR vec3( float x, float y, float z );
 	// create from vec2 and a scalar
-	vec3( const vec2 &vv, float z );
+	MATHS_CONSTEXPR vec3( const vec2 &vv, float z );
 	// create from truncated vec4
-	vec3( const vec4 &vv );
+	MATHS_CONSTEXPR vec3( const vec4 &vv );
 	// add vector to vector
-	vec3 operator+( const vec3 &rhs );
+	MATHS_CONSTEXPR vec3 operator+( const vec3 &rhs ) const;
 	// add scalar to vector
-	vec3 operator+( float rhs );
+	MATHS_CONSTEXPR vec3 operator+( float rhs ) const;
 	// because user's expect this too
 	vec3 &operator+=( const vec3 &rhs );
 	// subtract vector from vector
-	vec3 operator-( const vec3 &rhs );
+	MATHS_CONSTEXPR vec3 operator-( const vec3 &rhs ) const;
 	// add vector to vector
-	vec3 operator-( float rhs );
+	MATHS_CONSTEXPR vec3 operator-( float rhs ) const;
 	// because users expect this too
 	vec3 &operator-=( const vec3 &rhs );
 	// multiply with scalar
-	vec3 operator*( float rhs );
+	MATHS_CONSTEXPR vec3 operator*( float rhs ) const;
 	// because users expect this too
 	vec3 &operator*=( float rhs );
 	// divide vector by scalar
-	vec3 operator/( float rhs );
-	// because users expect this too
-	vec3 &operator=( const vec3 &rhs );
+	MATHS_CONSTEXPR vec3 operator/( float rhs ) const;
 
 	// internal data
 	float v[3];
 };
 
 struct vec4 {
-	vec4();
-	vec4( float x, float y, float z, float w );
-	vec4( const vec2 &vv, float z, float w );
-	vec4( const vec3 &vv, float w );
+	vec4() {}
+	MATHS_CONSTEXPR vec4( float x, float y, float z, float w );
+	MATHS_CONSTEXPR vec4( const vec2 &vv, float z, float w );
+	MATHS_CONSTEXPR vec4( const vec3 &vv, float w );
 	float v[4];
 };
 
@@ -78,9 +87,9 @@ a d g
 b e h
 c f i */
 struct mat3 {
-	mat3();
-	mat3( float a, float b, float c, float d, float e, float f, float g, float h,
-				float i );
+	mat3() {}
+	MATHS_CONSTEXPR mat3( float a, float b, float c, float d, float e, float f, float g,
+												float h, float i );
 	float m[9];
 };
 
@@ -90,13 +99,13 @@ struct mat3 {
 2 6 10 14
 3 7 11 15*/
 struct mat4 {
-	mat4();
+	mat4() {}
 	// note! this is entering components in ROW-major order
-	mat4( float a, float b, float c, float d, float e, float f, float g, float h,
-				float i, float j, float k, float l, float mm, float n, float o, float p );
-	vec4 operator*( const vec4 &rhs );
-	mat4 operator*( const mat4 &rhs );
-	mat4 &operator=( const mat4 &rhs );
+	MATHS_CONSTEXPR mat4( float a, float b, float c, float d, float e, float f, float g,
+												float h, float i, float j, float k, float l, float mm, float n,
+												float o, float p );
+	MATHS_CONSTEXPR vec4 operator*( const vec4 &rhs ) const;
+	mat4 operator*( const mat4 &rhs ) const;
 	float m[16];
 };
 
@@ -116,18 +125,18 @@ void print( const mat3 &m );
 void print( const mat4 &m );
 // vector functions
 float length( const vec3 &v );
-float length2( const vec3 &v );
+MATHS_CONSTEXPR float length2( const vec3 &v );
 vec3 normalise( const vec3 &v );
-float dot( const vec3 &a, const vec3 &b );
-vec3 cross( const vec3 &a, const vec3 &b );
+MATHS_CONSTEXPR float dot( const vec3 &a, const vec3 &b );
+MATHS_CONSTEXPR vec3 cross( const vec3 &a, const vec3 &b );
 float get_squared_dist( vec3 from, vec3 to );
 float direction_to_heading( vec3 d );
 vec3 heading_to_direction( float degrees );
 // matrix functions
-mat3 zero_mat3();
-mat3 identity_mat3();
-mat4 zero_mat4();
-mat4 identity_mat4();
+MATHS_CONSTEXPR mat3 zero_mat3();
+MATHS_CONSTEXPR mat3 identity_mat3();
+MATHS_CONSTEXPR mat4 zero_mat4();
+MATHS_CONSTEXPR mat4 identity_mat4();
 float determinant( const mat4 &mm );
 mat4 inverse( const mat4 &mm );
 mat4 transpose( const mat4 &mm );
@@ -150,4 +159,205 @@ versor slerp( const versor &q, const versor &r );
 versor normalise( versor &q );
 void print( const versor &q );
 versor slerp( versor &q, versor &r, float t );
+/*-----------------------------INLINE DEFINITIONS-----------------------------*/
+#ifdef MATHS_FUNCS_HAS_CONSTEXPR
+constexpr vec2::vec2( float x, float y ) : v{ x, y } {}
+constexpr vec3::vec3( float x, float y, float z ) : v{ x, y, z } {}
+constexpr vec3::vec3( const vec2 &vv, float z ) : v{ vv.v[0], vv.v[1], z } {}
+constexpr vec3::vec3( const vec4 &vv ) : v{ vv.v[0], vv.v[1], vv.v[2] } {}
+constexpr vec4::vec4( float x, float y, float z, float w ) : v{ x, y, z, w } {}
+constexpr vec4::vec4( const vec2 &vv, float z, float w ) : v{ vv.v[0], vv.v[1], z, w } {}
+constexpr vec4::vec4( const vec3 &vv, float w ) : v{ vv.v[0], vv.v[1], vv.v[2], w } {}
+/* note: entered in COLUMNS */
+constexpr mat3::mat3( float a, float b, float c, float d, float e, float f, float g,
+											float h, float i )
+		: m{ a, b, c, d, e, f, g, h, i } {}
+/* note: entered in COLUMNS */
+constexpr mat4::mat4( float a, float b, float c, float d, float e, float f, float g,
+											float h, float i, float j, float k, float l, float mm, float n,
+											float o, float p )
+		: m{ a, b, c, d, e, f, g, h, i, j, k, l, mm, n, o, p } {}
+#else
+inline vec2::vec2( float x, float y ) {
+	v[0] = x;
+	v[1] = y;
+}
+
+inline vec3::vec3( float x, float y, float z ) {
+	v[0] = x;
+	v[1] = y;
+	v[2] = z;
+}
+
+inline vec3::vec3( const vec2 &vv, float z ) {
+	v[0] = vv.v[0];
+	v[1] = vv.v[1];
+	v[2] = z;
+}
+
+inline vec3::vec3( const vec4 &vv ) {
+	v[0] = vv.v[0];
+	v[1] = vv.v[1];
+	v[2] = vv.v[2];
+}
+
+inline vec4::vec4( float x, float y, float z, float w ) {
+	v[0] = x;
+	v[1] = y;
+	v[2] = z;
+	v[3] = w;
+}
+
+inline vec4::vec4( const vec2 &vv, float z, float w ) {
+	v[0] = vv.v[0];
+	v[1] = vv.v[1];
+	v[2] = z;
+	v[3] = w;
+}
+
+inline vec4::vec4( const vec3 &vv, float w ) {
+	v[0] = vv.v[0];
+	v[1] = vv.v[1];
+	v[2] = vv.v[2];
+	v[3] = w;
+}
+
+/* note: entered in COLUMNS */
+inline mat3::mat3( float a, float b, float c, float d, float e, float f, float g,
+									 float h, float i ) {
+	m[0] = a;
+	m[1] = b;
+	m[2] = c;
+	m[3] = d;
+	m[4] = e;
+	m[5] = f;
+	m[6] = g;
+	m[7] = h;
+	m[8] = i;
+}
+
+/* note: entered in COLUMNS */
+inline mat4::mat4( float a, float b, float c, float d, float e, float f, float g,
+									 float h, float i, float j, float k, float l, float mm, float n,
+									 float o, float p ) {
+	m[0] = a;
+	m[1] = b;
+	m[2] = c;
+	m[3] = d;
+	m[4] = e;
+	m[5] = f;
+	m[6] = g;
+	m[7] = h;
+	m[8] = i;
+	m[9] = j;
+	m[10] = k;
+	m[11] = l;
+	m[12] = mm;
+	m[13] = n;
+	m[14] = o;
+	m[15] = p;
+}
+#endif
+
+MATHS_CONSTEXPR vec3 vec3::operator+( const vec3 &rhs ) const {
+	return vec3( v[0] + rhs.v[0], v[1] + rhs.v[1], v[2] + rhs.v[2] );
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator+( float rhs ) const {
+	return vec3( v[0] + rhs, v[1] + rhs, v[2] + rhs );
+}
+
+inline vec3 &vec3::operator+=( const vec3 &rhs ) {
+	v[0] += rhs.v[0];
+	v[1] += rhs.v[1];
+	v[2] += rhs.v[2];
+	return *this; // return self
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator-( const vec3 &rhs ) const {
+	return vec3( v[0] - rhs.v[0], v[1] - rhs.v[1], v[2] - rhs.v[2] );
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator-( float rhs ) const {
+	return vec3( v[0] - rhs, v[1] - rhs, v[2] - rhs );
+}
+
+inline vec3 &vec3::operator-=( const vec3 &rhs ) {
+	v[0] -= rhs.v[0];
+	v[1] -= rhs.v[1];
+	v[2] -= rhs.v[2];
+	return *this;
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator*( float rhs ) const {
+	return vec3( v[0] * rhs, v[1] * rhs, v[2] * rhs );
+}
+
+inline vec3 &vec3::operator*=( float rhs ) {
+	v[0] = v[0] * rhs;
+	v[1] = v[1] * rhs;
+	v[2] = v[2] * rhs;
+	return *this;
+}
+
+MATHS_CONSTEXPR vec3 vec3::operator/( float rhs ) const {
+	return vec3( v[0] / rhs, v[1] / rhs, v[2] / rhs );
+}
+
+// squared length
+MATHS_CONSTEXPR float length2( const vec3 &v ) {
+	return v.v[0] * v.v[0] + v.v[1] * v.v[1] + v.v[2] * v.v[2];
+}
+
+MATHS_CONSTEXPR float dot( const vec3 &a, const vec3 &b ) {
+	return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
+}
+
+MATHS_CONSTEXPR vec3 cross( const vec3 &a, const vec3 &b ) {
+	return vec3( a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2],
+							 a.v[0] * b.v[1] - a.v[1] * b.v[0] );
+}
+
+MATHS_CONSTEXPR mat3 zero_mat3() {
+	return mat3( 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f );
+}
+
+MATHS_CONSTEXPR mat3 identity_mat3() {
+	return mat3( 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f );
+}
+
+MATHS_CONSTEXPR mat4 zero_mat4() {
+	return mat4( 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+							 0.0f, 0.0f, 0.0f, 0.0f, 0.0f );
+}
+
+MATHS_CONSTEXPR mat4 identity_mat4() {
+	return mat4( 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+							 0.0f, 0.0f, 0.0f, 0.0f, 1.0f );
+}
+
+MATHS_CONSTEXPR vec4 mat4::operator*( const vec4 &rhs ) const {
+	// 0x + 4y + 8z + 12w etc.
+	return vec4( m[0] * rhs.v[0] + m[4] * rhs.v[1] + m[8] * rhs.v[2] + m[12] * rhs.v[3],
+							 m[1] * rhs.v[0] + m[5] * rhs.v[1] + m[9] * rhs.v[2] + m[13] * rhs.v[3],
+							 m[2] * rhs.v[0] + m[6] * rhs.v[1] + m[10] * rhs.v[2] + m[14] * rhs.v[3],
+							 m[3] * rhs.v[0] + m[7] * rhs.v[1] + m[11] * rhs.v[2] + m[15] * rhs.v[3] );
+}
+
+inline mat4 mat4::operator*( const mat4 &rhs ) const {
+	mat4 r;
+	int r_index = 0;
+	for ( int col = 0; col < 4; col++ ) {
+		for ( int row = 0; row < 4; row++ ) {
+			float sum = 0.0f;
+			for ( int i = 0; i < 4; i++ ) {
+				sum += rhs.m[i + col * 4] * m[row + i * 4];
+			}
+			r.m[r_index] = sum;
+			r_index++;
+		}
+	}
+	return r;
+}
+
 #endif
@@ -15,6 +15,8 @@
 #include "obj_parser.h"	// my little Wavefront .obj mesh loader
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"	 // Sean Barrett's image loader - nothings.org
+#include "std140.h"			 // uniform block layouts checked at compile time
+#include "ubo_arena.h"	 // per-frame uniform buffer sub-allocation
 #include <GL/glew.h>		 // include GLEW and new version of GL on Windows
 #include <GLFW/glfw3.h>	// GLFW helper library
 #include <assert.h>
@@ -39,10 +41,43 @@
 #define LEFT "negx.jpg"
 #define RIGHT "posx.jpg"
 
-typedef struct Cam_Vars {
+#define NUM_MONKEYS 5
+#define CAM_BLOCK_BINDING 0
+#define OBJECT_BLOCK_BINDING 1
+// bytes of uniform blocks each frame can use, and frames the GPU can be behind
+#define UBO_ARENA_FRAME_SIZE 65536
+#define UBO_ARENA_FRAMES 3
+
+/* the uniform blocks, member for member as in the shaders. these won't
+compile if they don't match std140's layout */
+struct cam_block_t {
 	mat4 P; // 16 floats for my projection matrix
 	mat4 V; // 16 floats for my view matrix
-} Cam_Vars;
+};
+enum {
+	CAM_BLOCK_P = STD140_OFFSET( 0, mat4 ),
+	CAM_BLOCK_V = STD140_OFFSET( STD140_AFTER( CAM_BLOCK_P, mat4 ), mat4 ),
+	CAM_BLOCK_SIZE = STD140_SIZE( STD140_AFTER( CAM_BLOCK_V, mat4 ) )
+};
+STD140_CHECK_MEMBER( cam_block_t, P, CAM_BLOCK_P );
+STD140_CHECK_MEMBER( cam_block_t, V, CAM_BLOCK_V );
+STD140_CHECK_SIZE( cam_block_t, CAM_BLOCK_SIZE );
+
+struct object_block_t {
+	mat4 M;			 // model matrix
+	vec3 tint;	 // multiplies the colour from the cube map
+	float ratio; // of refractive indices. std140 packs it in after tint
+};
+enum {
+	OBJECT_BLOCK_M = STD140_OFFSET( 0, mat4 ),
+	OBJECT_BLOCK_TINT = STD140_OFFSET( STD140_AFTER( OBJECT_BLOCK_M, mat4 ), vec3 ),
+	OBJECT_BLOCK_RATIO = STD140_OFFSET( STD140_AFTER( OBJECT_BLOCK_TINT, vec3 ), float ),
+	OBJECT_BLOCK_SIZE = STD140_SIZE( STD140_AFTER( OBJECT_BLOCK_RATIO, float ) )
+};
+STD140_CHECK_MEMBER( object_block_t, M, OBJECT_BLOCK_M );
+STD140_CHECK_MEMBER( object_block_t, tint, OBJECT_BLOCK_TINT );
+STD140_CHECK_MEMBER( object_block_t, ratio, OBJECT_BLOCK_RATIO );
+STD140_CHECK_SIZE( object_block_t, OBJECT_BLOCK_SIZE );
 
 // keep track of window size for things like the viewport and the mouse cursor
 int g_gl_width = 640;
@@ -138,7 +173,7 @@ void create_cube_map( const char *front, const char *back, const char *top,
 // camera matrices. it's easier if they are global
 mat4 view_mat;
 mat4 proj_mat;
-vec3 cam_pos( 0.0f, 0.0f, 5.0f );
+vec3 cam_pos( 0.0f, 0.0f, 7.0f );
 
 int main() {
 	/*--------------------------------START
@@ -191,7 +226,6 @@ int main() {
 	// shaders for "Suzanne" mesh
 	GLuint monkey_sp =
 		create_programme_from_files( MONKEY_VERT_FILE, MONKEY_FRAG_FILE );
-	int monkey_M_location = glGetUniformLocation( monkey_sp, "M" );
 
 	/* NOTE: seems to report V as invalid -1 now. good! */
 
@@ -205,21 +239,26 @@ int main() {
 	int cube_V_location = glGetUniformLocation( cube_sp, "cam_R" );
 	// int cube_P_location = glGetUniformLocation (cube_sp, "P");
 
-	GLuint cam_block_buffer;
-	glGenBuffers( 1, &cam_block_buffer );
-	glBindBuffer( GL_UNIFORM_BUFFER, cam_block_buffer );
-	glBufferData( GL_UNIFORM_BUFFER, sizeof( mat4 ) * 2, NULL, GL_DYNAMIC_DRAW );
+	/* every frame's blocks are sub-allocated from one buffer, and bound by range
+	to a binding point for each draw */
+	ubo_arena_t ubo_arena;
+	if ( !ubo_arena_create( ubo_arena, UBO_ARENA_FRAME_SIZE, UBO_ARENA_FRAMES ) ) {
+		return 1;
+	}
+	printf( "uniform buffer arena is %s\n",
+					ubo_arena.persistent ? "persistently mapped" : "uploaded each frame" );
 
 	/*
-	Bind the block to each of the shader programmes that will use it
-	THIS IS UNNEEDED WITH JUST A SINGLE BLOCK BUT ALLOWS >1 BLOCKS */
-	int block_id = 0;
+	Bind the blocks to each of the shader programmes that will use them */
 	GLuint uniform_block_index_monkey =
 		glGetUniformBlockIndex( monkey_sp, "cam_block" );
-	glUniformBlockBinding( monkey_sp, uniform_block_index_monkey, block_id );
+	glUniformBlockBinding( monkey_sp, uniform_block_index_monkey, CAM_BLOCK_BINDING );
+	GLuint object_block_index_monkey =
+		glGetUniformBlockIndex( monkey_sp, "object_block" );
+	glUniformBlockBinding( monkey_sp, object_block_index_monkey, OBJECT_BLOCK_BINDING );
 	GLuint uniform_block_index_cube_sp =
 		glGetUniformBlockIndex( cube_sp, "cam_block" );
-	glUniformBlockBinding( cube_sp, uniform_block_index_cube_sp, block_id );
+	glUniformBlockBinding( cube_sp, uniform_block_index_cube_sp, CAM_BLOCK_BINDING );
 
 /*-------------------------------CREATE CAMERA--------------------------------*/
 #define ONE_DEG_IN_RAD ( 2.0 * M_PI ) / 360.0 // 0.017444444
@@ -252,18 +291,15 @@ int main() {
 	glUseProgram( cube_sp );
 	glUniformMatrix4fv( cube_V_location, 1, GL_FALSE, R.m );
 	// glUniformMatrix4fv (cube_P_location, 1, GL_FALSE, proj_mat.m);
-	// unique model matrix for each sphere
-	mat4 model_mat = identity_mat4();
-
-	glBindBufferBase( GL_UNIFORM_BUFFER, block_id, cam_block_buffer );
-	Cam_Vars *cam_ubo_ptr = (Cam_Vars *)glMapBufferRange(
-		GL_UNIFORM_BUFFER, 0, sizeof( Cam_Vars ),
-		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
-
-	cam_ubo_ptr->P = proj_mat;
-	cam_ubo_ptr->V = view_mat;
-
-	glUnmapBuffer( GL_UNIFORM_BUFFER );
+	// a row of monkeys, each with its own model matrix, tint, and refraction
+	object_block_t monkeys[NUM_MONKEYS];
+	for ( int i = 0; i < NUM_MONKEYS; i++ ) {
+		float t = (float)i / (float)( NUM_MONKEYS - 1 );
+		monkeys[i].M = translate( identity_mat4(),
+															vec3( ( i - ( NUM_MONKEYS - 1 ) * 0.5f ) * 2.5f, 0.0f, 0.0f ) );
+		monkeys[i].tint = vec3( 1.0f - 0.4f * t, 0.8f + 0.2f * t, 0.6f + 0.4f * t );
+		monkeys[i].ratio = 1.0f / ( 1.1f + 0.4f * t );
+	}
 
 	glEnable( GL_DEPTH_TEST ); // enable depth-testing
 	glDepthFunc( GL_LESS );		 // depth-testing interprets a smaller value as "closer"
@@ -286,6 +322,20 @@ int main() {
 		// wipe the drawing surface clear
 		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
+		/* write all of this frame's uniform blocks, then make them visible to GL
+		once, before the draws that read them */
+		ubo_arena_begin_frame( ubo_arena );
+		cam_block_t cam_block;
+		cam_block.P = proj_mat;
+		cam_block.V = view_mat;
+		ubo_slice_t cam_slice = ubo_arena_push( ubo_arena, &cam_block, sizeof( cam_block ) );
+		ubo_slice_t monkey_slices[NUM_MONKEYS];
+		for ( int i = 0; i < NUM_MONKEYS; i++ ) {
+			monkey_slices[i] = ubo_arena_push( ubo_arena, &monkeys[i], sizeof( object_block_t ) );
+		}
+		ubo_arena_flush( ubo_arena );
+		ubo_arena_bind( ubo_arena, cam_slice, CAM_BLOCK_BINDING );
+
 		// render a sky-box using the cube-map texture
 		glDepthMask( GL_FALSE );
 		glUseProgram( cube_sp );
@@ -298,8 +348,14 @@ int main() {
 
 		glUseProgram( monkey_sp );
 		glBindVertexArray( vao );
-		glUniformMatrix4fv( monkey_M_location, 1, GL_FALSE, model_mat.m );
-		glDrawArrays( GL_TRIANGLES, 0, g_point_count );
+		for ( int i = 0; i < NUM_MONKEYS; i++ ) {
+			if ( !monkey_slices[i].data ) {
+				continue; // didn't fit in the arena
+			}
+			ubo_arena_bind( ubo_arena, monkey_slices[i], OBJECT_BLOCK_BINDING );
+			glDrawArrays( GL_TRIANGLES, 0, g_point_count );
+		}
+		ubo_arena_end_frame( ubo_arena );
 		// update other events like input handling
 		glfwPollEvents();
 
@@ -388,22 +444,6 @@ int main() {
 
 			view_mat = inverse( R ) * inverse( T );
 
-			glBindBufferBase( GL_UNIFORM_BUFFER, block_id, cam_block_buffer );
-			float *cam_ubo_ptr =
-				(float *)glMapBufferRange( GL_UNIFORM_BUFFER, 0, sizeof( float ) * 32,
-																	 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
-																		 GL_MAP_UNSYNCHRONIZED_BIT );
-			memcpy( &cam_ubo_ptr[0], proj_mat.m, sizeof( float ) * 16 );
-			memcpy( &cam_ubo_ptr[16], view_mat.m, sizeof( float ) * 16 );
-
-			glUnmapBuffer( GL_UNIFORM_BUFFER );
-
-			/*			glBindBufferBase (GL_UNIFORM_BUFFER, block_id,
-				 cam_block_buffer);
-															glBufferSubData (
-																			GL_UNIFORM_BUFFER, sizeof (mat4), sizeof
-				 (mat4), view_mat.m);*/
-
 			// cube-map view matrix has rotation, but not translation
 			glUseProgram( cube_sp );
 			glUniformMatrix4fv( cube_V_location, 1, GL_FALSE, inverse( R ).m );
@@ -416,6 +456,11 @@ int main() {
 		glfwSwapBuffers( g_window );
 	}
 
+	gl_log( "uniform buffer arena: %s, peak %i bytes a frame, waited for the GPU %i times\n",
+					ubo_arena.persistent ? "persistent" : "uploaded", (int)ubo_arena.ring.peak_used,
+					ubo_arena.waits );
+	ubo_arena_destroy( ubo_arena );
+
 	// close GL context and any other GLFW resources
 	glfwTerminate();
 	return 0;
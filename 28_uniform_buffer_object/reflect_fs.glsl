@@ -10,6 +10,13 @@ layout (std140) uniform cam_block {
 	mat4 V;
 };
 
+/* per-object uniforms */
+layout (std140) uniform object_block {
+	mat4 M; // model matrix
+	vec3 tint;
+	float ratio; // of refractive indices
+};
+
 out vec4 frag_colour;
 
 void main () {
@@ -21,5 +28,5 @@ void main () {
 	// convert from eye to world space
 	reflected = vec3 (inverse (V) * vec4 (reflected, 0.0));
 
-	frag_colour = texture (cube_texture, reflected);
+	frag_colour = texture (cube_texture, reflected) * vec4 (tint, 1.0);
 }
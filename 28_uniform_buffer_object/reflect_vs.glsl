@@ -9,7 +9,13 @@ layout (std140) uniform cam_block {
 	mat4 V;
 };
 
-uniform mat4 M; // model matrix
+/* per-object uniforms */
+layout (std140) uniform object_block {
+	mat4 M; // model matrix
+	vec3 tint;
+	float ratio; // of refractive indices
+};
+
 out vec3 pos_eye;
 out vec3 n_eye;
 
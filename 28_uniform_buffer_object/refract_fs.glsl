@@ -10,6 +10,13 @@ layout (std140) uniform cam_block {
 	mat4 V;
 };
 
+/* per-object uniforms */
+layout (std140) uniform object_block {
+	mat4 M; // model matrix
+	vec3 tint;
+	float ratio; // of refractive indices
+};
+
 out vec4 frag_colour;
 
 void main () {
@@ -17,9 +24,8 @@ void main () {
 	vec3 incident_eye = normalize (pos_eye);
 	vec3 normal = normalize (n_eye);
 
-	float ratio = 1.0 /1.3333;
 	vec3 refracted = refract (incident_eye, normal, ratio);
 	refracted = vec3 (inverse (V) * vec4 (refracted, 0.0));
 
-	frag_colour = texture (cube_texture, refracted);
+	frag_colour = texture (cube_texture, refracted) * vec4 (tint, 1.0);
 }
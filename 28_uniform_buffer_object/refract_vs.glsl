@@ -2,7 +2,6 @@
 
 layout(location = 0) in vec3 vp; // positions from mesh
 layout(location = 1) in vec3 vn; // normals from mesh
-uniform mat4 M; // model matrix
 
 /* virtual camera uniforms */
 layout (std140) uniform cam_block {
@@ -10,6 +9,13 @@ layout (std140) uniform cam_block {
 	mat4 V;
 };
 
+/* per-object uniforms */
+layout (std140) uniform object_block {
+	mat4 M; // model matrix
+	vec3 tint;
+	float ratio; // of refractive indices
+};
+
 out vec3 pos_eye;
 out vec3 n_eye;
 
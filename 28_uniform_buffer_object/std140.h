@@ -0,0 +1,77 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| std140 uniform block layouts                                                 |
+| A uniform block declared "layout (std140)" puts each member at an offset set |
+| by fixed rules: scalars on 4 bytes, vec2 on 8, vec3, vec4 and matrices on    |
+| 16, a vec3 leaving room for a scalar after it, and the block's size rounded  |
+| up to 16. STD140_OFFSET(), STD140_AFTER() and STD140_SIZE() work out the     |
+| offsets one member at a time, as enum constants, from the member types.      |
+| STD140_CHECK_MEMBER() and STD140_CHECK_SIZE() then static_assert that a C++  |
+| struct puts every member in the same place, so it can be copied whole into a |
+| uniform buffer. A struct that doesn't match won't compile. There are no      |
+| variadic templates or constexpr, so that Visual Studio 2012 builds it too.   |
+\******************************************************************************/
+#ifndef _STD140_H_
+#define _STD140_H_
+
+#include "maths_funcs.h"
+#include <stddef.h>
+
+/* size and base alignment in a std140 block. types std140 lays out
+differently from C++, like mat3, whose columns are padded to vec4s, have
+none, and so can't be used */
+template <typename T> struct std140_type;
+template <> struct std140_type<float> {
+	enum { size = 4, align = 4 };
+};
+template <> struct std140_type<int> {
+	enum { size = 4, align = 4 };
+};
+template <> struct std140_type<unsigned int> {
+	enum { size = 4, align = 4 };
+};
+template <> struct std140_type<vec2> {
+	enum { size = 8, align = 8 };
+};
+template <> struct std140_type<vec3> {
+	enum { size = 12, align = 16 };
+};
+template <> struct std140_type<vec4> {
+	enum { size = 16, align = 16 };
+};
+template <> struct std140_type<mat4> {
+	enum { size = 64, align = 16 };
+};
+/* array elements are padded out to 16 bytes, which C++ arrays of anything
+smaller than a vec4 aren't */
+template <typename T, size_t N> struct std140_type<T[N]> {
+	static_assert( std140_type<T>::size % 16 == 0,
+								 "std140 pads array elements to 16 bytes. use arrays of vec4 or mat4" );
+	enum { size = std140_type<T>::size * N, align = 16 };
+};
+
+#define STD140_ROUND_UP( bytes, align ) ( ( ( bytes ) + ( align ) - 1 ) / ( align ) * ( align ) )
+
+/* offset of a member of type, after members that end at end. the first
+member's end is 0 */
+#define STD140_OFFSET( end, type )                                                            \
+	STD140_ROUND_UP( (size_t)( end ), (size_t)std140_type<type>::align )
+/* where a member of type at offset ends */
+#define STD140_AFTER( offset, type ) ( (size_t)( offset ) + (size_t)std140_type<type>::size )
+/* size of a block whose last member ends at end */
+#define STD140_SIZE( end ) STD140_ROUND_UP( (size_t)( end ), (size_t)16 )
+
+#define STD140_CHECK_MEMBER( type, member, offset )                                           \
+	static_assert( offsetof( type, member ) == (size_t)( offset ),                                \
+								 #type "::" #member " is not where std140 puts it" )
+#define STD140_CHECK_SIZE( type, size )                                                       \
+	static_assert( sizeof( type ) == (size_t)( size ),                                          \
+								 #type " is not the size of its std140 block. pad it to a multiple of 16" )
+
+#endif
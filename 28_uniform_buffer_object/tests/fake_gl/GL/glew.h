@@ -0,0 +1,62 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Stand-in for GLEW, for tests                                                 |
+| Just the types, enums, and functions ubo_arena.cpp uses, with the same       |
+| values as the real glew.h. The test defines the functions, keeping buffers   |
+| in memory and fences as counters, so the arena runs with no GL context.      |
+\******************************************************************************/
+#ifndef _FAKE_GLEW_H_
+#define _FAKE_GLEW_H_
+
+#include <stddef.h>
+
+typedef unsigned int GLenum;
+typedef unsigned int GLbitfield;
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef int GLsizei;
+typedef unsigned char GLboolean;
+typedef ptrdiff_t GLintptr;
+typedef ptrdiff_t GLsizeiptr;
+typedef unsigned long long GLuint64;
+typedef struct __GLsync *GLsync;
+
+#define GL_DYNAMIC_DRAW 0x88E8
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_PERSISTENT_BIT 0x00000040
+#define GL_MAP_COHERENT_BIT 0x00000080
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_ALREADY_SIGNALED 0x911A
+#define GL_TIMEOUT_EXPIRED 0x911B
+#define GL_CONDITION_SATISFIED 0x911C
+#define GL_WAIT_FAILED 0x911D
+#define GL_UNIFORM_BUFFER 0x8A11
+#define GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 0x8A34
+
+// set by the test to pretend the driver does or doesn't have the extension
+extern bool g_fake_arb_buffer_storage;
+#define GLEW_ARB_buffer_storage g_fake_arb_buffer_storage
+
+void glGetIntegerv( GLenum pname, GLint *data );
+void glGenBuffers( GLsizei n, GLuint *buffers );
+void glDeleteBuffers( GLsizei n, const GLuint *buffers );
+void glBindBuffer( GLenum target, GLuint buffer );
+void glBindBufferRange( GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+												GLsizeiptr size );
+void glBufferData( GLenum target, GLsizeiptr size, const void *data, GLenum usage );
+void glBufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void *data );
+void glBufferStorage( GLenum target, GLsizeiptr size, const void *data, GLbitfield flags );
+void *glMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access );
+GLboolean glUnmapBuffer( GLenum target );
+GLsync glFenceSync( GLenum condition, GLbitfield flags );
+GLenum glClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout );
+void glDeleteSync( GLsync sync );
+
+#endif
@@ -0,0 +1,322 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Uniform buffer arena tests                                                   |
+| Checks the ring's offsets, alignment, and overflow, then runs the arena for  |
+| several frames on fake GL, both persistently mapped and uploaded, checking   |
+| that blocks land where their slices say, that only what was written is       |
+| uploaded, that a region is only reused after waiting on its fence, and that  |
+| nothing is left behind. Build and run with "make -f Makefile.linux64 test".  |
+\******************************************************************************/
+#include "ubo_arena.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define TEST_ALIGNMENT 256
+#define TEST_FRAME_SIZE 1000 // rounds up to 1024
+#define TEST_FRAMES_IN_FLIGHT 3
+#define TEST_FRAMES 8
+
+static int g_failures = 0;
+
+#define CHECK( cond )                                                         \
+	do {                                                                        \
+		if ( !( cond ) ) {                                                        \
+			fprintf( stderr, "FAILED %s:%i: %s\n", __FILE__, __LINE__, #cond );     \
+			g_failures++;                                                           \
+		}                                                                         \
+	} while ( 0 )
+
+/*--------------------------------FAKE GL-----------------------------------*/
+bool g_fake_arb_buffer_storage = false;
+
+struct fake_gl_t {
+	std::vector<std::vector<unsigned char> > buffers; // contents, by name - 1
+	std::vector<bool> buffer_live;
+	GLuint bound;
+	bool mapped;
+	bool map_fails;
+	int sub_data_calls;
+	GLintptr sub_data_offset; // of the last glBufferSubData()
+	GLsizeiptr sub_data_size;
+	GLuint range_index, range_buffer; // of the last glBindBufferRange()
+	GLintptr range_offset;
+	GLsizeiptr range_size;
+	// polls each fence has left before the GPU gets to it. -1 once deleted
+	std::vector<int> fence_polls;
+	int fence_lag; // polls a new fence starts with
+	int live_fences;
+	int flushing_waits; // glClientWaitSync() calls with GL_SYNC_FLUSH_COMMANDS_BIT
+};
+static fake_gl_t g_gl;
+
+static void fake_gl_reset( bool buffer_storage ) {
+	g_gl = fake_gl_t();
+	g_gl.bound = 0;
+	g_gl.mapped = g_gl.map_fails = false;
+	g_gl.sub_data_calls = 0;
+	g_gl.sub_data_offset = g_gl.sub_data_size = -1;
+	g_gl.range_index = g_gl.range_buffer = 0;
+	g_gl.range_offset = g_gl.range_size = -1;
+	g_gl.fence_lag = 0;
+	g_gl.live_fences = 0;
+	g_gl.flushing_waits = 0;
+	g_fake_arb_buffer_storage = buffer_storage;
+}
+
+static std::vector<unsigned char> &bound_buffer() {
+	CHECK( g_gl.bound > 0 && g_gl.bound <= g_gl.buffers.size() && g_gl.buffer_live[g_gl.bound - 1] );
+	return g_gl.buffers[g_gl.bound - 1];
+}
+
+void glGetIntegerv( GLenum pname, GLint *data ) {
+	CHECK( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT == pname );
+	*data = TEST_ALIGNMENT;
+}
+
+void glGenBuffers( GLsizei n, GLuint *buffers ) {
+	for ( GLsizei i = 0; i < n; i++ ) {
+		g_gl.buffers.push_back( std::vector<unsigned char>() );
+		g_gl.buffer_live.push_back( true );
+		buffers[i] = (GLuint)g_gl.buffers.size();
+	}
+}
+
+void glDeleteBuffers( GLsizei n, const GLuint *buffers ) {
+	for ( GLsizei i = 0; i < n; i++ ) {
+		if ( buffers[i] ) {
+			CHECK( g_gl.buffer_live[buffers[i] - 1] );
+			g_gl.buffer_live[buffers[i] - 1] = false;
+		}
+	}
+}
+
+void glBindBuffer( GLenum target, GLuint buffer ) {
+	CHECK( GL_UNIFORM_BUFFER == target );
+	g_gl.bound = buffer;
+}
+
+void glBindBufferRange( GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+												GLsizeiptr size ) {
+	CHECK( GL_UNIFORM_BUFFER == target );
+	CHECK( offset % TEST_ALIGNMENT == 0 );
+	g_gl.range_index = index;
+	g_gl.range_buffer = buffer;
+	g_gl.range_offset = offset;
+	g_gl.range_size = size;
+}
+
+void glBufferData( GLenum target, GLsizeiptr size, const void *data, GLenum usage ) {
+	CHECK( GL_UNIFORM_BUFFER == target && NULL == data && GL_DYNAMIC_DRAW == usage );
+	bound_buffer().assign( size, 0 );
+}
+
+void glBufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void *data ) {
+	CHECK( GL_UNIFORM_BUFFER == target );
+	std::vector<unsigned char> &buffer = bound_buffer();
+	CHECK( offset >= 0 && size > 0 && offset + size <= (GLsizeiptr)buffer.size() );
+	memcpy( &buffer[offset], data, size );
+	g_gl.sub_data_calls++;
+	g_gl.sub_data_offset = offset;
+	g_gl.sub_data_size = size;
+}
+
+void glBufferStorage( GLenum target, GLsizeiptr size, const void *data, GLbitfield flags ) {
+	CHECK( GL_UNIFORM_BUFFER == target && NULL == data );
+	CHECK( ( flags & GL_MAP_PERSISTENT_BIT ) && ( flags & GL_MAP_COHERENT_BIT ) );
+	bound_buffer().assign( size, 0 );
+}
+
+void *glMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access ) {
+	CHECK( GL_UNIFORM_BUFFER == target && 0 == offset );
+	CHECK( ( access & GL_MAP_PERSISTENT_BIT ) && ( access & GL_MAP_COHERENT_BIT ) );
+	std::vector<unsigned char> &buffer = bound_buffer();
+	CHECK( length == (GLsizeiptr)buffer.size() );
+	if ( g_gl.map_fails ) {
+		return NULL;
+	}
+	g_gl.mapped = true;
+	return &buffer[0];
+}
+
+GLboolean glUnmapBuffer( GLenum target ) {
+	CHECK( GL_UNIFORM_BUFFER == target && g_gl.mapped );
+	bound_buffer();
+	g_gl.mapped = false;
+	return 1;
+}
+
+static size_t fence_index( GLsync sync ) { return (size_t)sync - 1; }
+
+GLsync glFenceSync( GLenum condition, GLbitfield flags ) {
+	CHECK( GL_SYNC_GPU_COMMANDS_COMPLETE == condition && 0 == flags );
+	g_gl.fence_polls.push_back( g_gl.fence_lag );
+	g_gl.live_fences++;
+	return (GLsync)g_gl.fence_polls.size();
+}
+
+GLenum glClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout ) {
+	int &polls = g_gl.fence_polls[fence_index( sync )];
+	CHECK( polls >= 0 );
+	if ( flags & GL_SYNC_FLUSH_COMMANDS_BIT ) {
+		g_gl.flushing_waits++;
+	}
+	if ( polls > 0 ) {
+		polls--;
+		return GL_TIMEOUT_EXPIRED;
+	}
+	return timeout ? GL_CONDITION_SATISFIED : GL_ALREADY_SIGNALED;
+}
+
+void glDeleteSync( GLsync sync ) {
+	int &polls = g_gl.fence_polls[fence_index( sync )];
+	CHECK( polls >= 0 );
+	polls = -1;
+	g_gl.live_fences--;
+}
+
+/*----------------------------------TESTS-----------------------------------*/
+static void test_ring() {
+	ubo_ring_t ring;
+	ubo_ring_init( ring, TEST_FRAME_SIZE, TEST_FRAMES_IN_FLIGHT, TEST_ALIGNMENT );
+	CHECK( 1024 == ring.region_size );
+	CHECK( 0 == ubo_ring_alloc( ring, 64 ) );
+	CHECK( 256 == ubo_ring_alloc( ring, 10 ) );
+	CHECK( 512 == ubo_ring_alloc( ring, 512 ) ); // fills the region exactly
+	CHECK( 1024 == ring.used );
+	CHECK( UBO_RING_FULL == ubo_ring_alloc( ring, 1 ) );
+	CHECK( UBO_RING_FULL == ubo_ring_alloc( ring, 0 ) );
+	CHECK( 2 == ring.overflows );
+
+	ubo_ring_next( ring );
+	CHECK( 1 == ring.region && 0 == ring.used );
+	CHECK( 1024 == ubo_ring_alloc( ring, 100 ) );
+	CHECK( UBO_RING_FULL == ubo_ring_alloc( ring, 2000 ) );
+	ubo_ring_next( ring );
+	CHECK( 2048 == ubo_ring_alloc( ring, 4 ) );
+	ubo_ring_next( ring );
+	CHECK( 0 == ring.region );
+	CHECK( 1024 == ring.peak_used );
+}
+
+/* a frame's worth of made-up block contents */
+static void fill_block( unsigned char *block, size_t size, int frame, int n ) {
+	for ( size_t i = 0; i < size; i++ ) {
+		block[i] = (unsigned char)( 1 + frame * 31 + n * 7 + i );
+	}
+}
+
+static void test_frames( bool buffer_storage ) {
+	fake_gl_reset( buffer_storage );
+	g_gl.fence_lag = 2; // the GPU is still on a region when it comes round again
+	ubo_arena_t arena;
+	CHECK( ubo_arena_create( arena, TEST_FRAME_SIZE, TEST_FRAMES_IN_FLIGHT ) );
+	CHECK( arena.persistent == buffer_storage );
+	CHECK( 0 == g_gl.bound );
+	const std::vector<unsigned char> &gpu = g_gl.buffers[arena.buffer - 1];
+	CHECK( 3072 == gpu.size() );
+
+	unsigned char big[64], small[16], late[16];
+	for ( int f = 0; f < TEST_FRAMES; f++ ) {
+		size_t base = (size_t)( f % TEST_FRAMES_IN_FLIGHT ) * 1024;
+		int fences_before = g_gl.live_fences;
+		ubo_arena_begin_frame( arena );
+		// a region's fence is only there once it has been used
+		CHECK( g_gl.live_fences == fences_before - ( f >= TEST_FRAMES_IN_FLIGHT ? 1 : 0 ) );
+		CHECK( arena.waits == std::max( 0, f - TEST_FRAMES_IN_FLIGHT + 1 ) );
+
+		fill_block( big, sizeof( big ), f, 0 );
+		fill_block( small, sizeof( small ), f, 1 );
+		ubo_slice_t a = ubo_arena_push( arena, big, sizeof( big ) );
+		ubo_slice_t b = ubo_arena_push( arena, small, sizeof( small ) );
+		CHECK( a.data && (size_t)a.offset == base && 64 == a.size );
+		CHECK( b.data && (size_t)b.offset == base + 256 && 16 == b.size );
+		if ( buffer_storage ) {
+			// written straight into the mapping
+			CHECK( 0 == memcmp( &gpu[a.offset], big, sizeof( big ) ) );
+		} else if ( f >= TEST_FRAMES_IN_FLIGHT ) {
+			// the region still has the frame before last's blocks
+			CHECK( 0 != memcmp( &gpu[a.offset], big, sizeof( big ) ) );
+		}
+		ubo_arena_flush( arena );
+		CHECK( 0 == memcmp( &gpu[a.offset], big, sizeof( big ) ) );
+		CHECK( 0 == memcmp( &gpu[b.offset], small, sizeof( small ) ) );
+		if ( buffer_storage ) {
+			CHECK( 0 == g_gl.sub_data_calls );
+		} else {
+			CHECK( (size_t)g_gl.sub_data_offset == base && 272 == g_gl.sub_data_size );
+			int calls = g_gl.sub_data_calls;
+			ubo_arena_flush( arena ); // nothing new
+			CHECK( calls == g_gl.sub_data_calls );
+		}
+		ubo_arena_bind( arena, b, 1 );
+		CHECK( 1 == g_gl.range_index && arena.buffer == g_gl.range_buffer );
+		CHECK( b.offset == g_gl.range_offset && b.size == g_gl.range_size );
+
+		// a block added after the flush goes up with the end of the frame
+		fill_block( late, sizeof( late ), f, 2 );
+		ubo_slice_t c = ubo_arena_push( arena, late, sizeof( late ) );
+		CHECK( c.data && (size_t)c.offset == base + 512 );
+		ubo_arena_end_frame( arena );
+		CHECK( 0 == memcmp( &gpu[c.offset], late, sizeof( late ) ) );
+		if ( !buffer_storage ) {
+			CHECK( (size_t)g_gl.sub_data_offset == base + 272 && 256 == g_gl.sub_data_size );
+		}
+		CHECK( g_gl.live_fences == std::min( f + 1, TEST_FRAMES_IN_FLIGHT ) );
+	}
+	CHECK( g_gl.flushing_waits > 0 );
+	CHECK( 528 == arena.ring.peak_used );
+	CHECK( 0 == arena.ring.overflows );
+
+	GLuint buffer = arena.buffer;
+	ubo_arena_destroy( arena );
+	CHECK( 0 == g_gl.live_fences );
+	CHECK( !g_gl.mapped );
+	CHECK( !g_gl.buffer_live[buffer - 1] );
+	CHECK( 0 == arena.buffer && NULL == arena.memory );
+}
+
+static void test_full_region() {
+	fake_gl_reset( true );
+	ubo_arena_t arena;
+	CHECK( ubo_arena_create( arena, 256, 2 ) );
+	unsigned char block[200] = { 0 };
+	ubo_arena_begin_frame( arena );
+	CHECK( NULL != ubo_arena_push( arena, block, sizeof( block ) ).data );
+	ubo_slice_t full = ubo_arena_push( arena, block, sizeof( block ) );
+	CHECK( NULL == full.data && 0 == full.offset && 0 == full.size );
+	CHECK( 1 == arena.ring.overflows );
+	ubo_arena_end_frame( arena );
+	ubo_arena_destroy( arena );
+}
+
+static void test_map_fails() {
+	fake_gl_reset( true );
+	g_gl.map_fails = true;
+	ubo_arena_t arena;
+	fprintf( stderr, "expect an error about mapping next:\n" );
+	CHECK( !ubo_arena_create( arena, TEST_FRAME_SIZE, TEST_FRAMES_IN_FLIGHT ) );
+	CHECK( 0 == arena.buffer );
+	CHECK( 1 == g_gl.buffers.size() && !g_gl.buffer_live[0] );
+}
+
+int main() {
+	test_ring();
+	test_frames( true );
+	test_frames( false );
+	test_full_region();
+	test_map_fails();
+	if ( g_failures ) {
+		fprintf( stderr, "%i checks failed\n", g_failures );
+		return 1;
+	}
+	printf( "ubo_arena_test passed\n" );
+	return 0;
+}
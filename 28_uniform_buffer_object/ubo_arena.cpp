@@ -0,0 +1,165 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Uniform buffer arena. See ubo_arena.h                                        |
+\******************************************************************************/
+#include "ubo_arena.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// nanoseconds to wait on a fence before checking it again
+#define UBO_FENCE_TIMEOUT 1000000
+
+void ubo_ring_init( ubo_ring_t &ring, size_t region_size, int region_count, size_t alignment ) {
+	assert( alignment > 0 && ( alignment & ( alignment - 1 ) ) == 0 );
+	assert( region_count > 0 );
+	ring.alignment = alignment;
+	ring.region_size = ( region_size + alignment - 1 ) & ~( alignment - 1 );
+	ring.region_count = region_count;
+	ring.region = 0;
+	ring.used = 0;
+	ring.peak_used = 0;
+	ring.overflows = 0;
+}
+
+size_t ubo_ring_alloc( ubo_ring_t &ring, size_t size ) {
+	size_t start = ( ring.used + ring.alignment - 1 ) & ~( ring.alignment - 1 );
+	if ( size == 0 || start > ring.region_size || size > ring.region_size - start ) {
+		ring.overflows++;
+		return UBO_RING_FULL;
+	}
+	ring.used = start + size;
+	if ( ring.used > ring.peak_used ) {
+		ring.peak_used = ring.used;
+	}
+	return (size_t)ring.region * ring.region_size + start;
+}
+
+void ubo_ring_next( ubo_ring_t &ring ) {
+	ring.region = ( ring.region + 1 ) % ring.region_count;
+	ring.used = 0;
+}
+
+bool ubo_arena_create( ubo_arena_t &arena, size_t frame_size, int frames_in_flight ) {
+	GLint alignment = 0;
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment );
+	if ( alignment < 1 ) {
+		alignment = 256; // the most any implementation is allowed to ask for
+	}
+	ubo_ring_init( arena.ring, frame_size, frames_in_flight, (size_t)alignment );
+	GLsizeiptr total = (GLsizeiptr)( arena.ring.region_size * frames_in_flight );
+	arena.fences.assign( frames_in_flight, (GLsync)0 );
+	arena.flushed = 0;
+	arena.waits = 0;
+
+	glGenBuffers( 1, &arena.buffer );
+	glBindBuffer( GL_UNIFORM_BUFFER, arena.buffer );
+	arena.persistent = GLEW_ARB_buffer_storage ? true : false;
+	if ( arena.persistent ) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage( GL_UNIFORM_BUFFER, total, NULL, flags );
+		arena.memory = (unsigned char *)glMapBufferRange( GL_UNIFORM_BUFFER, 0, total, flags );
+		if ( !arena.memory ) {
+			fprintf( stderr, "ERROR: could not map uniform buffer arena of %li bytes\n",
+							 (long)total );
+			glDeleteBuffers( 1, &arena.buffer );
+			arena.buffer = 0;
+			return false;
+		}
+	} else {
+		glBufferData( GL_UNIFORM_BUFFER, total, NULL, GL_DYNAMIC_DRAW );
+		arena.staging.resize( total );
+		arena.memory = &arena.staging[0];
+	}
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+	return true;
+}
+
+void ubo_arena_destroy( ubo_arena_t &arena ) {
+	for ( size_t i = 0; i < arena.fences.size(); i++ ) {
+		if ( arena.fences[i] ) {
+			glDeleteSync( arena.fences[i] );
+		}
+	}
+	arena.fences.clear();
+	if ( arena.persistent && arena.buffer ) {
+		glBindBuffer( GL_UNIFORM_BUFFER, arena.buffer );
+		glUnmapBuffer( GL_UNIFORM_BUFFER );
+		glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+	}
+	glDeleteBuffers( 1, &arena.buffer );
+	arena.buffer = 0;
+	arena.memory = NULL;
+	arena.staging.clear();
+}
+
+void ubo_arena_begin_frame( ubo_arena_t &arena ) {
+	GLsync &fence = arena.fences[arena.ring.region];
+	if ( fence ) {
+		GLenum status = glClientWaitSync( fence, 0, 0 );
+		if ( GL_TIMEOUT_EXPIRED == status ) {
+			arena.waits++;
+			do {
+				status = glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, UBO_FENCE_TIMEOUT );
+			} while ( GL_TIMEOUT_EXPIRED == status );
+		}
+		if ( GL_WAIT_FAILED == status ) {
+			fprintf( stderr, "ERROR: waiting on uniform buffer arena fence failed\n" );
+		}
+		glDeleteSync( fence );
+		fence = 0;
+	}
+	arena.flushed = 0;
+}
+
+ubo_slice_t ubo_arena_alloc( ubo_arena_t &arena, size_t size ) {
+	ubo_slice_t slice;
+	size_t offset = ubo_ring_alloc( arena.ring, size );
+	if ( UBO_RING_FULL == offset ) {
+		slice.data = NULL;
+		slice.offset = 0;
+		slice.size = 0;
+		return slice;
+	}
+	slice.data = arena.memory + offset;
+	slice.offset = (GLintptr)offset;
+	slice.size = (GLsizeiptr)size;
+	return slice;
+}
+
+ubo_slice_t ubo_arena_push( ubo_arena_t &arena, const void *block, size_t size ) {
+	ubo_slice_t slice = ubo_arena_alloc( arena, size );
+	if ( slice.data ) {
+		memcpy( slice.data, block, size );
+	}
+	return slice;
+}
+
+void ubo_arena_flush( ubo_arena_t &arena ) {
+	// coherent mappings are seen by GL as they are written
+	if ( arena.persistent || arena.ring.used <= arena.flushed ) {
+		return;
+	}
+	size_t start = (size_t)arena.ring.region * arena.ring.region_size + arena.flushed;
+	glBindBuffer( GL_UNIFORM_BUFFER, arena.buffer );
+	glBufferSubData( GL_UNIFORM_BUFFER, (GLintptr)start,
+									 (GLsizeiptr)( arena.ring.used - arena.flushed ), arena.memory + start );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+	arena.flushed = arena.ring.used;
+}
+
+void ubo_arena_bind( const ubo_arena_t &arena, const ubo_slice_t &slice, GLuint binding ) {
+	glBindBufferRange( GL_UNIFORM_BUFFER, binding, arena.buffer, slice.offset, slice.size );
+}
+
+void ubo_arena_end_frame( ubo_arena_t &arena ) {
+	ubo_arena_flush( arena );
+	arena.fences[arena.ring.region] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	ubo_ring_next( arena.ring );
+}
@@ -0,0 +1,95 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Uniform buffer arena                                                         |
+| One uniform buffer, split into a region per frame in flight, that each       |
+| frame's uniform blocks are sub-allocated from in turn. A block is copied     |
+| into the region, and bound for a draw with glBindBufferRange(), in place of  |
+| a glUniform*() call per member. Before a region is written again, the arena  |
+| waits on the fence set after the frame that last used it, so the GPU is      |
+| never reading what is being written. Where ARB_buffer_storage is available,  |
+| the buffer is mapped once, persistently, and blocks are written straight     |
+| into it. Otherwise they are written to a copy in memory, which is uploaded   |
+| in one glBufferSubData() per frame. The allocator itself, ubo_ring_t, only   |
+| does arithmetic on offsets, so it runs without GL.                           |
+\******************************************************************************/
+#ifndef _UBO_ARENA_H_
+#define _UBO_ARENA_H_
+
+#include <GL/glew.h>
+#include <stddef.h>
+#include <vector>
+
+// ubo_ring_alloc() when a block doesn't fit in what is left of the region
+#define UBO_RING_FULL ( (size_t)-1 )
+
+struct ubo_ring_t {
+	size_t region_size; // bytes per frame. a multiple of alignment
+	size_t alignment;		// every allocation starts on a multiple of this
+	int region_count;
+	int region;				// the region being written this frame
+	size_t used;			// bytes of it allocated so far
+	size_t peak_used; // most bytes allocated in any one frame
+	int overflows;		// allocations that didn't fit
+};
+
+/* region_size is rounded up to a multiple of alignment, which must be a
+power of two */
+void ubo_ring_init( ubo_ring_t &ring, size_t region_size, int region_count, size_t alignment );
+
+/* offset from the start of the buffer of size bytes in this frame's region,
+or UBO_RING_FULL */
+size_t ubo_ring_alloc( ubo_ring_t &ring, size_t size );
+
+/* moves on to the next region, empty, wrapping around after the last */
+void ubo_ring_next( ubo_ring_t &ring );
+
+/* a block's place in the arena. data is NULL if it didn't fit */
+struct ubo_slice_t {
+	void *data;
+	GLintptr offset;
+	GLsizeiptr size;
+};
+
+struct ubo_arena_t {
+	ubo_ring_t ring;
+	GLuint buffer;
+	bool persistent;									 // mapped for good, or copied in each frame
+	unsigned char *memory;						 // the mapping, or staging
+	std::vector<unsigned char> staging; // a copy of the buffer, if not persistent
+	std::vector<GLsync> fences;				 // one per region, set after its frame's draws
+	size_t flushed;										 // bytes of this region already uploaded
+	int waits;												 // times a frame had to wait for the GPU
+};
+
+/* frame_size bytes for each of frames_in_flight frames */
+bool ubo_arena_create( ubo_arena_t &arena, size_t frame_size, int frames_in_flight );
+
+void ubo_arena_destroy( ubo_arena_t &arena );
+
+/* waits until the GPU is done with the region this frame will write */
+void ubo_arena_begin_frame( ubo_arena_t &arena );
+
+/* room for size bytes in this frame's region */
+ubo_slice_t ubo_arena_alloc( ubo_arena_t &arena, size_t size );
+
+/* copies a block in, returning where it went */
+ubo_slice_t ubo_arena_push( ubo_arena_t &arena, const void *block, size_t size );
+
+/* makes blocks written so far this frame visible to GL. call it before the
+draws that read them */
+void ubo_arena_flush( ubo_arena_t &arena );
+
+/* binds slice to a uniform block binding point */
+void ubo_arena_bind( const ubo_arena_t &arena, const ubo_slice_t &slice, GLuint binding );
+
+/* sets the fence for this frame's region, after its last draw, and moves on to
+the next region */
+void ubo_arena_end_frame( ubo_arena_t &arena );
+
+#endif
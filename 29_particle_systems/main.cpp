@@ -11,14 +11,21 @@
 
 #include "gl_utils.h"
 #include "maths_funcs.h"
+#include "particle_emitters.h"
+#include "particle_grid.h"
+#include "particle_sort.h"
+#include "particle_system.h"
 #include <GL/glew.h>		// include GLEW and new version of GL on Windows
 #include <GLFW/glfw3.h> // GLFW helper library
+#include <algorithm>
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <thread>
+#include <vector>
 #define GL_LOG_FILE "gl.log"
 
 int g_gl_width = 640;
@@ -26,6 +33,46 @@ int g_gl_height = 480;
 GLFWwindow *g_window = NULL;
 
 #define PARTICLE_COUNT 300
+/* simulate particles on the CPU and stream their positions to the GPU every
+frame. comment out to use the original particles, worked out in the shader */
+#define CPU_PARTICLES
+#ifdef CPU_PARTICLES
+#define PARTICLE_VS "particles_vs.glsl"
+#else
+#define PARTICLE_VS "test_vs.glsl"
+#endif
+/* the CPU particles come from a square of EMITTER_GRID x EMITTER_GRID
+fountains sharing a pool of CPU_PARTICLE_CAPACITY particles. the middle one
+also bursts every EMITTER_BURST_INTERVAL seconds */
+#define CPU_PARTICLE_CAPACITY 100000
+#define CPU_PARTICLE_LIFETIME 3.0f
+#define EMITTER_GRID 3
+#define EMITTER_SPACING 1.0f
+#define EMITTER_RATE 1000.0f
+#define EMITTER_BURST_COUNT 2000
+#define EMITTER_BURST_INTERVAL 1.5f
+/* the CPU particles push each other apart when closer than
+PARTICLE_REPEL_DISTANCE, and bounce off a sphere and a back wall. comment out
+to let them pass through each other and everything but the ground */
+#define PARTICLE_COLLISIONS
+#define PARTICLE_REPEL_DISTANCE 0.05f
+#define PARTICLE_REPEL_STIFFNESS 2.0f
+#define COLLIDER_SPHERE_RADIUS 0.4f
+#define COLLIDER_WALL_Z -1.4f
+#define COLLIDER_RESTITUTION 0.5f
+/* the start-up benchmarks take seconds and lots of memory before the first
+frame, so they only run when this is uncommented */
+//#define RUN_BENCHMARKS
+/* particles in the start-up simulation benchmark */
+#define BENCH_NUM_PARTICLES 4000000
+/* the sorting benchmark runs on 100k particles, then 10 times more, up to this */
+#define BENCH_SORT_MAX_PARTICLES 10000000
+/* emitters in the start-up emitter stress test */
+#define BENCH_NUM_EMITTERS 5000
+/* particles in the start-up collision benchmark */
+#define BENCH_GRID_PARTICLES 1000000
+
+int g_num_threads = 1;
 
 /* create initial attribute values for particles. return a VAO */
 GLuint gen_particles() {
@@ -69,16 +116,289 @@ GLuint gen_particles() {
 	return vao;
 }
 
+/* create empty position, life, and back-to-front index buffers for up to
+CPU_PARTICLE_CAPACITY particles, refilled every frame. return a VAO */
+GLuint gen_cpu_particles( GLuint *points_vbo, GLuint *life_vbo, GLuint *index_vbo ) {
+	glGenBuffers( 1, points_vbo );
+	glBindBuffer( GL_ARRAY_BUFFER, *points_vbo );
+	glBufferData( GL_ARRAY_BUFFER, CPU_PARTICLE_CAPACITY * 3 * sizeof( float ), NULL,
+								GL_STREAM_DRAW );
+	glGenBuffers( 1, life_vbo );
+	glBindBuffer( GL_ARRAY_BUFFER, *life_vbo );
+	glBufferData( GL_ARRAY_BUFFER, CPU_PARTICLE_CAPACITY * sizeof( float ), NULL,
+								GL_STREAM_DRAW );
+
+	GLuint vao;
+	glGenVertexArrays( 1, &vao );
+	glBindVertexArray( vao );
+	glBindBuffer( GL_ARRAY_BUFFER, *points_vbo );
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 0, NULL );
+	glBindBuffer( GL_ARRAY_BUFFER, *life_vbo );
+	glVertexAttribPointer( 1, 1, GL_FLOAT, GL_FALSE, 0, NULL );
+	glEnableVertexAttribArray( 0 );
+	glEnableVertexAttribArray( 1 );
+	// the index buffer binding is part of the VAO
+	glGenBuffers( 1, index_vbo );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, *index_vbo );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, CPU_PARTICLE_CAPACITY * sizeof( unsigned int ),
+								NULL, GL_STREAM_DRAW );
+
+	return vao;
+}
+
+/* adds the demo's fountains around centre. distances suit the small scene */
+void add_emitters( particle_emitters_t &es, const vec3 &centre ) {
+	es.lod_distances[0] = 5.0f;
+	es.lod_distances[1] = 10.0f;
+	es.lod_distances[2] = 20.0f;
+	for ( int i = 0; i < EMITTER_GRID * EMITTER_GRID; i++ ) {
+		int x = i % EMITTER_GRID - EMITTER_GRID / 2;
+		int z = i / EMITTER_GRID - EMITTER_GRID / 2;
+		particle_emitter_t e;
+		e.pos = centre + vec3( x * EMITTER_SPACING, 0.0f, z * EMITTER_SPACING );
+		e.vel = vec3( 0.0f, 1.0f, 0.0f );
+		e.spread = 0.5f;
+		e.lifetime = CPU_PARTICLE_LIFETIME;
+		e.rate = EMITTER_RATE;
+		if ( x == 0 && z == 0 ) {
+			e.burst_count = EMITTER_BURST_COUNT;
+			e.burst_interval = EMITTER_BURST_INTERVAL;
+		}
+		if ( particle_emitter_add( es, e ) < 0 ) {
+			gl_log_err( "ERROR: no room in the particle pool for emitter %i\n", i );
+		}
+	}
+}
+
+/* runs the simulation on lots of particles, some of which die part-way, and
+logs how many particles are updated per second */
+void benchmark_particles() {
+	particle_system_t ps;
+	particle_system_init( ps, BENCH_NUM_PARTICLES );
+	for ( int i = 0; i < BENCH_NUM_PARTICLES; i++ ) {
+		float randx = ( (float)rand() / (float)RAND_MAX ) * 1.0f - 0.5f;
+		float randz = ( (float)rand() / (float)RAND_MAX ) * 1.0f - 0.5f;
+		float lifetime = ( (float)rand() / (float)RAND_MAX ) * 3.0f;
+		particle_spawn( ps, vec3( 0.0f, 0.0f, 0.0f ), vec3( randx, 1.0f, randz ), lifetime );
+	}
+	std::vector<float> points( BENCH_NUM_PARTICLES * 3 );
+	std::vector<float> life( BENCH_NUM_PARTICLES );
+	const int runs = 20;
+	double update_secs = 0.0, write_secs = 0.0;
+	long long updated = 0;
+	for ( int r = 0; r < runs; r++ ) {
+		updated += ps.count;
+		double start = glfwGetTime();
+		particle_system_update( ps, 1.0f / 60.0f, g_num_threads );
+		double mid = glfwGetTime();
+		particle_system_write_vertices( ps, &points[0], &life[0], NULL, g_num_threads );
+		write_secs += glfwGetTime() - mid;
+		update_secs += mid - start;
+	}
+	gl_log( "particle update, %s, %i threads: %.3fms per step of %i particles "
+					"(%.1fM particles/s). vertex write: %.3fms. %i still alive\n",
+					particle_system_path(), g_num_threads, update_secs * 1000.0 / runs,
+					BENCH_NUM_PARTICLES, (double)updated / update_secs / 1000000.0,
+					write_secs * 1000.0 / runs, ps.count );
+}
+
+/* sorts particles scattered through a box back to front with std::sort on
+their depths, then with particle_sort() from scratch, then again with nothing
+moved and after the camera has turned 1 degree, which use the previous order.
+last, a tenth of the particles die and the rest are packed together the way
+particle_system_update() does, moving their ids with them */
+void benchmark_particle_sort() {
+	for ( int n = 100000; n <= BENCH_SORT_MAX_PARTICLES; n *= 10 ) {
+		std::vector<float> points( n * 3 );
+		for ( int i = 0; i < n * 3; i++ ) {
+			points[i] = ( (float)rand() / (float)RAND_MAX ) * 20.0f - 10.0f;
+		}
+		mat4 V = translate( identity_mat4(), vec3( 0.0f, 0.0f, -30.0f ) );
+
+		double start = glfwGetTime();
+		std::vector<float> depths( n );
+		std::vector<unsigned int> order( n );
+		for ( int i = 0; i < n; i++ ) {
+			const float *p = &points[i * 3];
+			depths[i] = -( V.m[2] * p[0] + V.m[6] * p[1] + V.m[10] * p[2] + V.m[14] );
+			order[i] = i;
+		}
+		std::sort( order.begin(), order.end(), [&]( unsigned int a, unsigned int b ) {
+			return depths[a] > depths[b];
+		} );
+		double std_sort_ms = ( glfwGetTime() - start ) * 1000.0;
+
+		std::vector<unsigned int> ids( n );
+		for ( int i = 0; i < n; i++ ) {
+			ids[i] = i;
+		}
+		particle_sort_t s;
+		start = glfwGetTime();
+		particle_sort( s, &points[0], &ids[0], n, V, g_num_threads );
+		double radix_ms = ( glfwGetTime() - start ) * 1000.0;
+		start = glfwGetTime();
+		bool still_warm = particle_sort( s, &points[0], &ids[0], n, V, g_num_threads );
+		double still_ms = ( glfwGetTime() - start ) * 1000.0;
+		V = rotate_y_deg( identity_mat4(), 1.0f ) * V;
+		start = glfwGetTime();
+		bool turned_warm = particle_sort( s, &points[0], &ids[0], n, V, g_num_threads );
+		double turned_ms = ( glfwGetTime() - start ) * 1000.0;
+
+		int alive = n;
+		for ( int i = 0; i < alive; i++ ) {
+			if ( rand() % 10 == 0 ) {
+				alive--;
+				memcpy( &points[i * 3], &points[alive * 3], 3 * sizeof( float ) );
+				ids[i] = ids[alive];
+			}
+		}
+		start = glfwGetTime();
+		bool packed_warm = particle_sort( s, &points[0], &ids[0], alive, V, g_num_threads );
+		double packed_ms = ( glfwGetTime() - start ) * 1000.0;
+		gl_log( "particle sort of %i, %i threads: std::sort %.3fms, radix %.3fms, "
+						"unmoved %.3fms (%s), camera turned %.3fms (%s), "
+						"tenth died %.3fms (%s)\n",
+						n, g_num_threads, std_sort_ms, radix_ms, still_ms,
+						still_warm ? "incremental" : "radix", turned_ms,
+						turned_warm ? "incremental" : "radix", packed_ms,
+						packed_warm ? "incremental" : "radix" );
+	}
+}
+
+/* BENCH_NUM_EMITTERS emitters scattered over 200x200 units around the camera,
+each with its own rate and some bursting, run for 2 seconds of frames. then
+the same again with every emitter kept at full detail */
+void benchmark_emitters() {
+	std::vector<particle_emitter_t> settings( BENCH_NUM_EMITTERS );
+	for ( int i = 0; i < BENCH_NUM_EMITTERS; i++ ) {
+		settings[i].pos = vec3( ( (float)rand() / (float)RAND_MAX ) * 200.0f - 100.0f, 0.0f,
+														( (float)rand() / (float)RAND_MAX ) * 200.0f - 100.0f );
+		settings[i].rate = 20.0f + (float)( rand() % 80 );
+		settings[i].lifetime = 2.0f;
+		if ( i % 10 == 0 ) {
+			settings[i].burst_count = 50;
+			settings[i].burst_interval = 1.0f;
+		}
+	}
+	for ( int use_lod = 1; use_lod >= 0; use_lod-- ) {
+		particle_emitters_t es;
+		// the worst case for any of the emitters above is 6 blocks
+		particle_emitters_init( es, BENCH_NUM_EMITTERS * 6 * EMITTER_BLOCK_SIZE );
+		if ( !use_lod ) {
+			for ( int l = 0; l < EMITTER_NUM_LODS - 1; l++ ) {
+				es.lod_distances[l] = 1e9f;
+			}
+		}
+		for ( int i = 0; i < BENCH_NUM_EMITTERS; i++ ) {
+			particle_emitter_add( es, settings[i] );
+		}
+		std::vector<float> points( es.pool.capacity * 3 );
+		std::vector<float> life( es.pool.capacity );
+		const int frames = 120;
+		double update_secs = 0.0, write_secs = 0.0;
+		long long emitters_updated = 0;
+		int drawn = 0;
+		for ( int f = 0; f < frames; f++ ) {
+			double start = glfwGetTime();
+			particle_emitters_update( es, vec3( 0.0f, 1.7f, 0.0f ), 1.0f / 60.0f, g_num_threads );
+			double mid = glfwGetTime();
+			drawn = particle_emitters_write_vertices( es, &points[0], &life[0], NULL, g_num_threads );
+			write_secs += glfwGetTime() - mid;
+			update_secs += mid - start;
+			emitters_updated += es.emitters_updated;
+		}
+		gl_log( "%i emitters, %s, %i threads: update %.3fms, write %.3fms per frame. %i "
+						"emitters updated per frame, %i particles alive, %i drawn, %i dropped\n",
+						BENCH_NUM_EMITTERS, use_lod ? "LOD" : "no LOD", g_num_threads,
+						update_secs * 1000.0 / frames, write_secs * 1000.0 / frames,
+						(int)( emitters_updated / frames ), es.particles_alive, drawn,
+						es.particles_dropped );
+	}
+}
+
+/* BENCH_GRID_PARTICLES particles scattered through a box about one per
+cell, and moving. times building the grid, pushing neighbours apart, and
+bouncing them off a few spheres and a plane */
+void benchmark_particle_grid() {
+	const float cell = 0.1f;
+	float side = cell * powf( (float)BENCH_GRID_PARTICLES, 1.0f / 3.0f );
+	particle_system_t ps;
+	particle_system_init( ps, BENCH_GRID_PARTICLES );
+	for ( int i = 0; i < BENCH_GRID_PARTICLES; i++ ) {
+		vec3 pos( ( (float)rand() / (float)RAND_MAX ) * side,
+							( (float)rand() / (float)RAND_MAX ) * side,
+							( (float)rand() / (float)RAND_MAX ) * side );
+		vec3 vel( ( (float)rand() / (float)RAND_MAX ) - 0.5f, 0.0f,
+							( (float)rand() / (float)RAND_MAX ) - 0.5f );
+		particle_spawn( ps, pos, vel, 1000.0f );
+	}
+	particle_grid_t grid;
+	particle_grid_init( grid, BENCH_GRID_PARTICLES, cell );
+	const int runs = 5;
+	double build_secs = 0.0, repel_secs = 0.0, sphere_secs = 0.0, plane_secs = 0.0;
+	int sphere_moved = 0, plane_moved = 0;
+	for ( int r = 0; r < runs; r++ ) {
+		double start = glfwGetTime();
+		particle_grid_build( grid, ps, NULL, ps.count, g_num_threads );
+		double built = glfwGetTime();
+		particle_grid_repel( grid, ps, 1.0f, 1.0f / 60.0f, g_num_threads );
+		double repelled = glfwGetTime();
+		for ( int s = 0; s < 4; s++ ) {
+			vec3 centre( side * ( 0.2f + 0.2f * s ), side * 0.5f, side * 0.5f );
+			sphere_moved += particle_grid_collide_sphere( grid, ps, centre, side * 0.05f, 0.5f );
+		}
+		double spheres = glfwGetTime();
+		plane_moved += particle_collide_plane( ps, NULL, ps.count, vec3( 0.0f, 1.0f, 0.0f ),
+																					 side * 0.1f, 0.5f, g_num_threads );
+		double planes = glfwGetTime();
+		build_secs += built - start;
+		repel_secs += repelled - built;
+		sphere_secs += spheres - repelled;
+		plane_secs += planes - spheres;
+	}
+	gl_log( "particle grid of %i, %i threads: build %.3fms, repel %.3fms, 4 spheres %.3fms "
+					"(%i moved), plane %.3fms (%i moved)\n",
+					BENCH_GRID_PARTICLES, g_num_threads, build_secs * 1000.0 / runs,
+					repel_secs * 1000.0 / runs, sphere_secs * 1000.0 / runs, sphere_moved / runs,
+					plane_secs * 1000.0 / runs, plane_moved / runs );
+}
+
 int main() {
 	restart_gl_log();
 	// use GLFW and GLEW to start GL context. see gl_utils.cpp for details
 	start_gl();
+	g_num_threads = (int)std::thread::hardware_concurrency();
+	if ( g_num_threads < 1 ) {
+		g_num_threads = 1;
+	}
+#ifdef RUN_BENCHMARKS
+	benchmark_particles();
+	benchmark_particle_sort();
+	benchmark_emitters();
+	benchmark_particle_grid();
+#endif
 
+#ifdef CPU_PARTICLES
+	GLuint points_vbo, life_vbo, index_vbo;
+	GLuint vao = gen_cpu_particles( &points_vbo, &life_vbo, &index_vbo );
+	particle_emitters_t emitters;
+	particle_emitters_init( emitters, CPU_PARTICLE_CAPACITY );
+	particle_sort_t particle_order;
+	std::vector<float> particle_points( CPU_PARTICLE_CAPACITY * 3 );
+	std::vector<float> particle_life( CPU_PARTICLE_CAPACITY );
+	std::vector<unsigned int> particle_ids( CPU_PARTICLE_CAPACITY );
+#ifdef PARTICLE_COLLISIONS
+	particle_grid_t particle_grid;
+	particle_grid_init( particle_grid, CPU_PARTICLE_CAPACITY, PARTICLE_REPEL_DISTANCE );
+	std::vector<unsigned int> live_particles( CPU_PARTICLE_CAPACITY );
+#endif
+#else
 	/* create buffer of particle initial attributes and a VAO */
 	GLuint vao = gen_particles();
+#endif
 
 	GLuint shader_programme =
-		create_programme_from_files( "test_vs.glsl", "test_fs.glsl" );
+		create_programme_from_files( PARTICLE_VS, "test_fs.glsl" );
 
 #define ONE_DEG_IN_RAD ( 2.0 * M_PI ) / 360.0 // 0.017444444
 	// input variables
@@ -107,23 +427,28 @@ int main() {
 
 	/* make up a world position for the emitter */
 	vec3 emitter_world_pos( 0.0f, 0.0f, 0.0f );
+#ifdef CPU_PARTICLES
+	add_emitters( emitters, emitter_world_pos );
+#endif
 
 	// locations of view and projection matrices
 	int V_loc = glGetUniformLocation( shader_programme, "V" );
 	assert( V_loc > -1 );
 	int P_loc = glGetUniformLocation( shader_programme, "P" );
 	assert( P_loc > -1 );
+	glUseProgram( shader_programme );
+	glUniformMatrix4fv( V_loc, 1, GL_FALSE, view_mat.m );
+	glUniformMatrix4fv( P_loc, 1, GL_FALSE, proj_mat );
+#ifndef CPU_PARTICLES
 	int emitter_pos_wor_loc =
 		glGetUniformLocation( shader_programme, "emitter_pos_wor" );
 	assert( emitter_pos_wor_loc > -1 );
 	int elapsed_system_time_loc =
 		glGetUniformLocation( shader_programme, "elapsed_system_time" );
 	assert( elapsed_system_time_loc > -1 );
-	glUseProgram( shader_programme );
-	glUniformMatrix4fv( V_loc, 1, GL_FALSE, view_mat.m );
-	glUniformMatrix4fv( P_loc, 1, GL_FALSE, proj_mat );
 	glUniform3f( emitter_pos_wor_loc, emitter_world_pos.v[0], emitter_world_pos.v[1],
 							 emitter_world_pos.v[2] );
+#endif
 
 	// load texture
 	GLuint tex;
@@ -164,12 +489,58 @@ int main() {
 		glBindTexture( GL_TEXTURE_2D, tex );
 		glUseProgram( shader_programme );
 
+#ifdef CPU_PARTICLES
+		/* spawn, move, and kill every emitter's particles, then write all of the
+		survivors out together and work out the order to draw them in */
+		particle_emitters_update( emitters, vec3( cam_pos[0], cam_pos[1], cam_pos[2] ),
+															(float)elapsed_seconds, g_num_threads );
+		// once is enough to know a slice is too small
+		static bool dropped_logged = false;
+		if ( !dropped_logged && emitters.particles_dropped > 0 ) {
+			gl_log_err( "ERROR: %i particles dropped by emitters with full slices of the pool\n",
+									emitters.particles_dropped );
+			dropped_logged = true;
+		}
+#ifdef PARTICLE_COLLISIONS
+		/* collisions change velocities, and positions of particles caught inside
+		something, so the next update carries them on */
+		int collide_count = particle_emitters_list_particles( emitters, &live_particles[0] );
+		particle_grid_build( particle_grid, emitters.pool, &live_particles[0], collide_count,
+												 g_num_threads );
+		particle_grid_repel( particle_grid, emitters.pool, PARTICLE_REPEL_STIFFNESS,
+												 (float)elapsed_seconds, g_num_threads );
+		particle_grid_collide_sphere( particle_grid, emitters.pool,
+																	emitter_world_pos + vec3( 0.5f, -0.5f, 0.5f ),
+																	COLLIDER_SPHERE_RADIUS, COLLIDER_RESTITUTION );
+		particle_collide_plane( emitters.pool, &live_particles[0], collide_count,
+														vec3( 0.0f, 0.0f, 1.0f ), COLLIDER_WALL_Z, COLLIDER_RESTITUTION,
+														g_num_threads );
+#endif
+		int live_count = particle_emitters_write_vertices( emitters, &particle_points[0],
+																											 &particle_life[0], &particle_ids[0],
+																											 g_num_threads );
+		// blending needs the furthest particles drawn first
+		particle_sort( particle_order, &particle_points[0], &particle_ids[0], live_count, view_mat,
+									 g_num_threads );
+		glBindVertexArray( vao );
+		if ( live_count > 0 ) {
+			glBindBuffer( GL_ARRAY_BUFFER, points_vbo );
+			glBufferSubData( GL_ARRAY_BUFFER, 0, live_count * 3 * sizeof( float ),
+											 &particle_points[0] );
+			glBindBuffer( GL_ARRAY_BUFFER, life_vbo );
+			glBufferSubData( GL_ARRAY_BUFFER, 0, live_count * sizeof( float ), &particle_life[0] );
+			glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, live_count * sizeof( unsigned int ),
+											 &particle_order.order[0] );
+		}
+		glDrawElements( GL_POINTS, live_count, GL_UNSIGNED_INT, NULL );
+#else
 		/* update time in shaders */
 		glUniform1f( elapsed_system_time_loc, (GLfloat)current_seconds );
 
 		glBindVertexArray( vao );
 		// draw points 0-3 from the currently bound VAO with current in-use shader
 		glDrawArrays( GL_POINTS, 0, PARTICLE_COUNT );
+#endif
 		glDisable( GL_BLEND );
 		glDepthMask( GL_TRUE );
 		glDisable( GL_PROGRAM_POINT_SIZE );
@@ -216,7 +587,7 @@ int main() {
 			mat4 T = translate( identity_mat4(), vec3( -cam_pos[0], -cam_pos[1],
 																								 -cam_pos[2] ) ); // cam translation
 			mat4 R = rotate_y_deg( identity_mat4(), -cam_yaw );					//
-			mat4 view_mat = R * T;
+			view_mat = R * T;
 			glUniformMatrix4fv( V_loc, 1, GL_FALSE, view_mat.m );
 		}
 
@@ -0,0 +1,274 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Particle emitters. See particle_emitters.h                                   |
+\******************************************************************************/
+#include "particle_emitters.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <math.h>
+#include <string.h>
+
+// emitters handed to a thread at a time
+#define EMITTERS_PER_TASK 32
+
+/* calls func( i ) for i from 0 to count-1, on up to thread_count threads that
+take EMITTERS_PER_TASK at a time */
+static void for_each_task( int count, int thread_count, const std::function<void( int )> &func ) {
+	int tasks = ( count + EMITTERS_PER_TASK - 1 ) / EMITTERS_PER_TASK;
+	std::atomic<int> next( 0 );
+	run_on_threads( std::max( 1, std::min( thread_count, tasks ) ), [&]( int ) {
+		for ( ;; ) {
+			int first = next.fetch_add( EMITTERS_PER_TASK );
+			if ( first >= count ) {
+				break;
+			}
+			int last = std::min( first + EMITTERS_PER_TASK, count );
+			for ( int i = first; i < last; i++ ) {
+				func( i );
+			}
+		}
+	} );
+}
+
+void particle_emitters_init( particle_emitters_t &es, int capacity ) {
+	int blocks = capacity / EMITTER_BLOCK_SIZE;
+	particle_system_init( es.pool, blocks * EMITTER_BLOCK_SIZE );
+	es.emitters.clear();
+	es.free_emitters.clear();
+	es.free_starts.assign( 1, 0 );
+	es.free_sizes.assign( 1, blocks );
+	es.frame = 0;
+	es.emitters_updated = 0;
+	es.particles_alive = 0;
+	es.particles_dropped = 0;
+}
+
+/* the most particles e can have alive at once. particles are only killed at
+an update, so they can outlive their lifetime by a frame, and a burst can
+still be alive when the next ceil( lifetime / interval ) of them go off.
+further LODs spawn fewer particles in proportion to their longer frames */
+static int max_alive( const particle_emitter_t &e ) {
+	float n = e.rate * ( e.lifetime + EMITTER_MAX_DT );
+	if ( e.burst_count > 0 ) {
+		int bursts =
+			e.burst_interval > 0.0f ? (int)ceilf( e.lifetime / e.burst_interval ) + 1 : 1;
+		n += (float)( e.burst_count * bursts );
+	}
+	// one spare for a rate that doesn't divide into whole frames
+	return (int)ceilf( n ) + 1;
+}
+
+/* first fit. returns the first block, or -1 if no free slice is big enough */
+static int alloc_blocks( particle_emitters_t &es, int blocks ) {
+	for ( size_t i = 0; i < es.free_starts.size(); i++ ) {
+		if ( es.free_sizes[i] < blocks ) {
+			continue;
+		}
+		int start = es.free_starts[i];
+		es.free_starts[i] += blocks;
+		es.free_sizes[i] -= blocks;
+		if ( es.free_sizes[i] == 0 ) {
+			es.free_starts.erase( es.free_starts.begin() + i );
+			es.free_sizes.erase( es.free_sizes.begin() + i );
+		}
+		return start;
+	}
+	return -1;
+}
+
+/* puts a slice back in order, joining it to free neighbours */
+static void free_blocks( particle_emitters_t &es, int start, int blocks ) {
+	size_t i = std::upper_bound( es.free_starts.begin(), es.free_starts.end(), start ) -
+						 es.free_starts.begin();
+	es.free_starts.insert( es.free_starts.begin() + i, start );
+	es.free_sizes.insert( es.free_sizes.begin() + i, blocks );
+	if ( i + 1 < es.free_starts.size() && start + blocks == es.free_starts[i + 1] ) {
+		es.free_sizes[i] += es.free_sizes[i + 1];
+		es.free_starts.erase( es.free_starts.begin() + i + 1 );
+		es.free_sizes.erase( es.free_sizes.begin() + i + 1 );
+	}
+	if ( i > 0 && es.free_starts[i - 1] + es.free_sizes[i - 1] == start ) {
+		es.free_sizes[i - 1] += es.free_sizes[i];
+		es.free_starts.erase( es.free_starts.begin() + i );
+		es.free_sizes.erase( es.free_sizes.begin() + i );
+	}
+}
+
+int particle_emitter_add( particle_emitters_t &es, const particle_emitter_t &e ) {
+	int blocks = ( max_alive( e ) + EMITTER_BLOCK_SIZE - 1 ) / EMITTER_BLOCK_SIZE;
+	int first_block = alloc_blocks( es, blocks );
+	if ( first_block < 0 ) {
+		return -1;
+	}
+	int index;
+	if ( es.free_emitters.empty() ) {
+		index = (int)es.emitters.size();
+		es.emitters.push_back( e );
+	} else {
+		index = es.free_emitters.back();
+		es.free_emitters.pop_back();
+		es.emitters[index] = e;
+	}
+	particle_emitter_t &added = es.emitters[index];
+	added.start = first_block * EMITTER_BLOCK_SIZE;
+	added.capacity = blocks * EMITTER_BLOCK_SIZE;
+	added.count = 0;
+	added.lod = 0;
+	added.pending_dt = 0.0f;
+	added.spawn_due = 0.0f;
+	added.burst_timer = added.burst_interval;
+	added.bursts_due = added.burst_count;
+	added.dropped = 0;
+	added.seed = 2654435761u * (unsigned int)( index + 1 );
+	added.in_use = true;
+	return index;
+}
+
+void particle_emitter_remove( particle_emitters_t &es, int index ) {
+	particle_emitter_t &e = es.emitters[index];
+	free_blocks( es, e.start / EMITTER_BLOCK_SIZE, e.capacity / EMITTER_BLOCK_SIZE );
+	e.in_use = false;
+	e.count = 0;
+	es.free_emitters.push_back( index );
+}
+
+void particle_emitter_burst( particle_emitters_t &es, int index, int count ) {
+	es.emitters[index].bursts_due += count;
+}
+
+/* xorshift. a number from -1 to 1 */
+static float rand_signed( unsigned int &seed ) {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return (float)( seed >> 8 ) * ( 2.0f / 16777216.0f ) - 1.0f;
+}
+
+static void spawn( particle_system_t &pool, particle_emitter_t &e, int n ) {
+	if ( n > e.capacity - e.count ) {
+		e.dropped += n - ( e.capacity - e.count );
+		n = e.capacity - e.count;
+	}
+	for ( int k = 0; k < n; k++ ) {
+		int i = e.start + e.count++;
+		pool.px[i] = e.pos.v[0];
+		pool.py[i] = e.pos.v[1];
+		pool.pz[i] = e.pos.v[2];
+		pool.vx[i] = e.vel.v[0] + rand_signed( e.seed ) * e.spread;
+		pool.vy[i] = e.vel.v[1] + rand_signed( e.seed ) * e.spread;
+		pool.vz[i] = e.vel.v[2] + rand_signed( e.seed ) * e.spread;
+		pool.age[i] = 0.0f;
+		pool.lifetime[i] = e.lifetime;
+		pool.ids[i] ^= 1; // see particle_system_t::ids
+	}
+}
+
+/* moves an emitter's particles on by all the time since its last update, then
+spawns what it owes */
+static void update_emitter( particle_system_t &pool, particle_emitter_t &e ) {
+	float dt = e.pending_dt;
+	e.pending_dt = 0.0f;
+	e.dropped = 0;
+	e.count = particle_system_update_range( pool, e.start, e.start + e.count, dt );
+	if ( e.lod == EMITTER_NUM_LODS - 1 ) {
+		e.bursts_due = 0;
+		return;
+	}
+	e.spawn_due += e.rate * dt / (float)( 1 << e.lod );
+	if ( e.burst_interval > 0.0f ) {
+		for ( e.burst_timer -= dt; e.burst_timer <= 0.0f; e.burst_timer += e.burst_interval ) {
+			e.bursts_due += e.burst_count >> e.lod;
+		}
+	}
+	int n = (int)e.spawn_due;
+	e.spawn_due -= (float)n;
+	spawn( pool, e, n + e.bursts_due );
+	e.bursts_due = 0;
+}
+
+void particle_emitters_update( particle_emitters_t &es, const vec3 &cam_pos, float dt,
+															 int thread_count ) {
+	dt = std::min( dt, EMITTER_MAX_DT );
+	es.due_emitters.clear();
+	for ( int i = 0; i < (int)es.emitters.size(); i++ ) {
+		particle_emitter_t &e = es.emitters[i];
+		if ( !e.in_use ) {
+			continue;
+		}
+		e.pending_dt += dt;
+		float dist_sq = length2( e.pos - cam_pos );
+		e.lod = 0;
+		while ( e.lod < EMITTER_NUM_LODS - 1 &&
+						dist_sq > es.lod_distances[e.lod] * es.lod_distances[e.lod] ) {
+			e.lod++;
+		}
+		// emitters on the same LOD take turns, so the work is spread over frames
+		int interval = 1 << e.lod;
+		if ( ( es.frame + i ) % interval == 0 ) {
+			es.due_emitters.push_back( i );
+		}
+	}
+	for_each_task( (int)es.due_emitters.size(), thread_count, [&]( int i ) {
+		update_emitter( es.pool, es.emitters[es.due_emitters[i]] );
+	} );
+	es.frame++;
+	es.emitters_updated = (int)es.due_emitters.size();
+	es.particles_alive = 0;
+	for ( size_t i = 0; i < es.emitters.size(); i++ ) {
+		es.particles_alive += es.emitters[i].count;
+	}
+	for ( size_t i = 0; i < es.due_emitters.size(); i++ ) {
+		es.particles_dropped += es.emitters[es.due_emitters[i]].dropped;
+	}
+}
+
+int particle_emitters_list_particles( const particle_emitters_t &es, unsigned int *indices ) {
+	int total = 0;
+	for ( size_t i = 0; i < es.emitters.size(); i++ ) {
+		const particle_emitter_t &e = es.emitters[i];
+		for ( int p = e.start; p < e.start + e.count; p++ ) {
+			indices[total++] = p;
+		}
+	}
+	return total;
+}
+
+int particle_emitters_write_vertices( particle_emitters_t &es, float *points, float *life,
+																			unsigned int *ids, int thread_count ) {
+	int emitter_count = (int)es.emitters.size();
+	es.draw_offsets.resize( emitter_count );
+	int total = 0;
+	for ( int i = 0; i < emitter_count; i++ ) {
+		const particle_emitter_t &e = es.emitters[i];
+		es.draw_offsets[i] = total;
+		if ( e.in_use && e.lod < EMITTER_NUM_LODS - 1 ) {
+			total += e.count;
+		}
+	}
+	for_each_task( emitter_count, thread_count, [&]( int i ) {
+		const particle_emitter_t &e = es.emitters[i];
+		if ( !e.in_use || e.lod == EMITTER_NUM_LODS - 1 ) {
+			return;
+		}
+		const particle_system_t &pool = es.pool;
+		int out = es.draw_offsets[i];
+		for ( int p = e.start; p < e.start + e.count; p++, out++ ) {
+			points[out * 3] = pool.px[p];
+			points[out * 3 + 1] = pool.py[p];
+			points[out * 3 + 2] = pool.pz[p];
+			life[out] = pool.age[p] / pool.lifetime[p];
+		}
+		if ( ids ) {
+			memcpy( ids + es.draw_offsets[i], &pool.ids[e.start], e.count * sizeof( unsigned int ) );
+		}
+	} );
+	return total;
+}
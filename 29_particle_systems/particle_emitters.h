@@ -0,0 +1,122 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Many particle emitters sharing one pool of particles                         |
+| The pool is a single particle system's arrays, allocated once. Each emitter  |
+| is given its own slice of it, sized in blocks for as many particles as it    |
+| can have alive at once, and a removed emitter's slice goes back on a free    |
+| list for the next one. Emitters further from the camera spawn fewer          |
+| particles and are updated less often, with the time they missed; past the    |
+| last LOD distance they stop spawning and aren't drawn. Every emitter's live  |
+| particles are written out together, to be drawn with one call.               |
+\******************************************************************************/
+#ifndef _PARTICLE_EMITTERS_H_
+#define _PARTICLE_EMITTERS_H_
+
+#include "maths_funcs.h"
+#include "particle_system.h"
+#include <vector>
+
+// pool slices are a whole number of blocks of this many particles
+#define EMITTER_BLOCK_SIZE 64
+/* each LOD halves the spawn rate and doubles the frames between updates.
+LOD EMITTER_NUM_LODS - 1 is beyond the last distance: no spawning or drawing */
+#define EMITTER_NUM_LODS 4
+/* longer frames are simulated as this many seconds, so that a slice sized for
+the particles an emitter can have alive is never short */
+#define EMITTER_MAX_DT 0.1f
+
+struct particle_emitter_t {
+	vec3 pos;
+	vec3 vel;							// average start velocity
+	float spread;					// each part of the start velocity varies by up to this
+	float lifetime;				// seconds
+	float rate;						// particles per second, at full detail
+	int burst_count;			// particles per burst
+	float burst_interval; // seconds between bursts, or 0 for no repeating bursts
+
+	// managed by the emitter system
+	int start, capacity, count; // slice of the pool, and its particles alive
+	int lod;
+	float pending_dt; // time since this emitter was last updated
+	float spawn_due;	// particles owed to the spawn rate
+	float burst_timer;
+	int bursts_due; // particles owed to bursts
+	int dropped;		// spawns at its last update that found the slice full
+	unsigned int seed;
+	bool in_use;
+
+	particle_emitter_t()
+		: pos( 0.0f, 0.0f, 0.0f ), vel( 0.0f, 1.0f, 0.0f ), spread( 0.5f ), lifetime( 3.0f ),
+			rate( 100.0f ), burst_count( 0 ), burst_interval( 0.0f ), start( 0 ), capacity( 0 ),
+			count( 0 ), lod( 0 ), pending_dt( 0.0f ), spawn_due( 0.0f ), burst_timer( 0.0f ),
+			bursts_due( 0 ), dropped( 0 ), seed( 1 ), in_use( false ) {}
+};
+
+struct particle_emitters_t {
+	particle_system_t pool; // physics settings are shared by every emitter
+	std::vector<particle_emitter_t> emitters;
+	std::vector<int> free_emitters;
+	// unused slices of the pool, in blocks, in order of start
+	std::vector<int> free_starts, free_sizes;
+	/* camera distances at which emitters drop to the next LOD. the defaults
+	suit a scene a couple of hundred units across */
+	float lod_distances[EMITTER_NUM_LODS - 1];
+	int frame;
+
+	// from the last update
+	int emitters_updated;
+	int particles_alive;
+	/* spawns that found their emitter's slice full, since init. anything but 0
+	means a slice was sized too small */
+	int particles_dropped;
+
+	// working space
+	std::vector<int> due_emitters;
+	std::vector<int> draw_offsets;
+
+	particle_emitters_t()
+		: frame( 0 ), emitters_updated( 0 ), particles_alive( 0 ), particles_dropped( 0 ) {
+		lod_distances[0] = 25.0f;
+		lod_distances[1] = 50.0f;
+		lod_distances[2] = 100.0f;
+	}
+};
+
+/* allocates a pool of capacity particles and removes every emitter */
+void particle_emitters_init( particle_emitters_t &es, int capacity );
+
+/* adds an emitter with the settings in e, starting a burst straight away if
+it has one. returns its index, or -1 if the pool has no room for it */
+int particle_emitter_add( particle_emitters_t &es, const particle_emitter_t &e );
+
+/* removes an emitter and its particles, and frees its slice of the pool */
+void particle_emitter_remove( particle_emitters_t &es, int index );
+
+/* spawns count extra particles from an emitter at its next update */
+void particle_emitter_burst( particle_emitters_t &es, int index, int count );
+
+/* picks each emitter's LOD from its distance to cam_pos, then spawns, moves,
+and kills the particles of the emitters due an update this frame, on
+thread_count threads. dt is capped at EMITTER_MAX_DT */
+void particle_emitters_update( particle_emitters_t &es, const vec3 &cam_pos, float dt,
+															 int thread_count );
+
+/* writes the pool index of every live particle of every emitter, drawn or
+not, to indices, e.g. for particle_grid_build(), and returns how many there
+are. indices needs room for the pool's capacity */
+int particle_emitters_list_particles( const particle_emitters_t &es, unsigned int *indices );
+
+/* writes every drawn emitter's live particles one after the other, xyz to
+points, 0 to 1 life to life, and their pool ids to ids unless it is NULL, and
+returns how many were written. the buffers need room for the pool's
+capacity */
+int particle_emitters_write_vertices( particle_emitters_t &es, float *points, float *life,
+																			unsigned int *ids, int thread_count );
+
+#endif
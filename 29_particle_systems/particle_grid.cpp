@@ -0,0 +1,294 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Spatial hash grid for particle collisions. See particle_grid.h               |
+\******************************************************************************/
+#include "particle_grid.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <math.h>
+
+// below this many particles per thread, starting threads costs more than it saves
+#define PARTICLE_GRID_MIN_PER_THREAD 16384
+
+/* floor( v * inv_cell_size ) without a library call */
+static int cell_coord( float v, float inv_cell_size ) {
+	float s = v * inv_cell_size;
+	int i = (int)s;
+	return i - ( s < (float)i );
+}
+
+/* y and z are multiplied by large primes, from Teschner et al. 2003,
+"Optimized Spatial Hashing for Collision Detection of Deformable Objects". x
+isn't, so cells next to each other along x are next to each other in the
+table, and a neighbour query's rows of 3 cells are in the same cache lines */
+static unsigned int bucket_of_cell( int ix, int iy, int iz, int table_size ) {
+	unsigned int h = (unsigned int)ix + (unsigned int)iy * 19349663u + (unsigned int)iz * 83492791u;
+	return h & (unsigned int)( table_size - 1 );
+}
+
+void particle_grid_init( particle_grid_t &grid, int max_particles, float cell_size ) {
+	grid.cell_size = cell_size;
+	grid.table_size = 1;
+	while ( grid.table_size < max_particles * 2 ) {
+		grid.table_size *= 2;
+	}
+	grid.bucket_starts.assign( grid.table_size + 1, 0 );
+	grid.entries.resize( max_particles );
+	grid.keys.resize( max_particles );
+	grid.tmp_entries.resize( max_particles );
+	grid.tmp_keys.resize( max_particles );
+	grid.count = 0;
+}
+
+/* one stable counting-sort pass on the digit_bits bits of the bucket numbers
+from shift up. each thread counts its share into its own table, then copies
+it to where its share of each digit starts */
+static void counting_pass( particle_grid_t &grid, const unsigned int *keys_in,
+													 const particle_grid_entry_t *in, unsigned int *keys_out,
+													 particle_grid_entry_t *out, int count, int shift, int digit_bits,
+													 int thread_count ) {
+	int digits = 1 << digit_bits;
+	unsigned int digit_mask = (unsigned int)digits - 1;
+	grid.counts.assign( thread_count * digits, 0 );
+	run_on_threads( thread_count, [&]( int t ) {
+		int *counts = &grid.counts[t * digits];
+		int end = share_start( count, t + 1, thread_count );
+		for ( int i = share_start( count, t, thread_count ); i < end; i++ ) {
+			counts[( keys_in[i] >> shift ) & digit_mask]++;
+		}
+	} );
+	for ( int d = 0, sum = 0; d < digits; d++ ) {
+		for ( int t = 0; t < thread_count; t++ ) {
+			int c = grid.counts[t * digits + d];
+			grid.counts[t * digits + d] = sum;
+			sum += c;
+		}
+	}
+	run_on_threads( thread_count, [&]( int t ) {
+		int *offsets = &grid.counts[t * digits];
+		int end = share_start( count, t + 1, thread_count );
+		for ( int i = share_start( count, t, thread_count ); i < end; i++ ) {
+			int dst = offsets[( keys_in[i] >> shift ) & digit_mask]++;
+			keys_out[dst] = keys_in[i];
+			out[dst] = in[i];
+		}
+	} );
+}
+
+void particle_grid_build( particle_grid_t &grid, const particle_system_t &ps,
+													const unsigned int *indices, int count, int thread_count ) {
+	grid.count = count;
+	thread_count = std::max( 1, std::min( thread_count, count / PARTICLE_GRID_MIN_PER_THREAD ) );
+	int table_size = grid.table_size;
+	float inv_cell_size = 1.0f / grid.cell_size;
+
+	run_on_threads( thread_count, [&]( int t ) {
+		int end = share_start( count, t + 1, thread_count );
+		for ( int i = share_start( count, t, thread_count ); i < end; i++ ) {
+			unsigned int p = indices ? indices[i] : i;
+			particle_grid_entry_t &e = grid.entries[i];
+			e.x = ps.px[p];
+			e.y = ps.py[p];
+			e.z = ps.pz[p];
+			e.particle = p;
+			grid.keys[i] =
+				bucket_of_cell( cell_coord( e.x, inv_cell_size ), cell_coord( e.y, inv_cell_size ),
+												cell_coord( e.z, inv_cell_size ), table_size );
+		}
+	} );
+
+	/* sort by bucket. a single counting sort would need a count for every bucket
+	per thread, or atomic counts, which are slow to update at random. two
+	passes over half the bits each need small tables and write in long runs */
+	int table_bits = 0;
+	while ( ( 1 << table_bits ) < table_size ) {
+		table_bits++;
+	}
+	int low_bits = ( table_bits + 1 ) / 2;
+	counting_pass( grid, &grid.keys[0], &grid.entries[0], &grid.tmp_keys[0], &grid.tmp_entries[0],
+								 count, 0, low_bits, thread_count );
+	counting_pass( grid, &grid.tmp_keys[0], &grid.tmp_entries[0], &grid.keys[0], &grid.entries[0],
+								 count, low_bits, table_bits - low_bits, thread_count );
+
+	/* each bucket starts at the first entry with a bucket number at least as
+	high. each thread fills in the buckets up to each of its entries */
+	run_on_threads( thread_count, [&]( int t ) {
+		int start = share_start( count, t, thread_count );
+		int end = share_start( count, t + 1, thread_count );
+		for ( int i = start; i < end; i++ ) {
+			int first = i > 0 ? (int)grid.keys[i - 1] + 1 : 0;
+			for ( int b = first; b <= (int)grid.keys[i]; b++ ) {
+				grid.bucket_starts[b] = i;
+			}
+		}
+	} );
+	int first = count > 0 ? (int)grid.keys[count - 1] + 1 : 0;
+	for ( int b = first; b <= table_size; b++ ) {
+		grid.bucket_starts[b] = count;
+	}
+}
+
+/* the acceleration given to a particle at x, y, z by entries start to end-1,
+which are in neighbouring cells, or share a bucket with one */
+static vec3 repulsion( const particle_grid_entry_t *entries, int start, int end, float x,
+											 float y, float z, float h, float stiffness ) {
+	float inv_h = 1.0f / h;
+	float ax = 0.0f, ay = 0.0f, az = 0.0f;
+	for ( int j = start; j < end; j++ ) {
+		float ox = x - entries[j].x, oy = y - entries[j].y, oz = z - entries[j].z;
+		float r_sq = ox * ox + oy * oy + oz * oz;
+		// also skips itself, and any other particle in exactly the same place
+		if ( r_sq >= h * h || r_sq == 0.0f ) {
+			continue;
+		}
+		float r = sqrtf( r_sq );
+		float w = 1.0f - r * inv_h;
+		float s = stiffness * w * w / r;
+		ax += ox * s;
+		ay += oy * s;
+		az += oz * s;
+	}
+	return vec3( ax, ay, az );
+}
+
+void particle_grid_repel( const particle_grid_t &grid, particle_system_t &ps, float stiffness,
+													float dt, int thread_count ) {
+	int count = grid.count;
+	thread_count = std::max( 1, std::min( thread_count, count / PARTICLE_GRID_MIN_PER_THREAD ) );
+	float h = grid.cell_size;
+	float inv_h = 1.0f / h;
+	/* in bucket order, so neighbouring particles are usually near in memory.
+	each entry only writes its own particle's velocity */
+	run_on_threads( thread_count, [&]( int t ) {
+		int end = share_start( count, t + 1, thread_count );
+		for ( int k = share_start( count, t, thread_count ); k < end; k++ ) {
+			float x = grid.entries[k].x, y = grid.entries[k].y, z = grid.entries[k].z;
+			int ix = cell_coord( x, inv_h ), iy = cell_coord( y, inv_h ), iz = cell_coord( z, inv_h );
+			vec3 a( 0.0f, 0.0f, 0.0f );
+			auto repel_range = [&]( int start, int end ) {
+				a += repulsion( &grid.entries[0], start, end, x, y, z, h, stiffness );
+			};
+			/* the 3 cells along x in each of the 9 rows around the particle are 3
+			buckets in a row, so their entries are one run. that only works if no
+			two rows share a bucket, and no row wraps around the end of the table */
+			unsigned int rows[9];
+			bool rows_apart = true;
+			for ( int r = 0; r < 9; r++ ) {
+				rows[r] = bucket_of_cell( ix - 1, iy + r % 3 - 1, iz + r / 3 - 1, grid.table_size );
+				rows_apart &= rows[r] + 3 <= (unsigned int)grid.table_size;
+				for ( int q = 0; q < r; q++ ) {
+					rows_apart &= rows[r] >= rows[q] + 3 || rows[q] >= rows[r] + 3;
+				}
+			}
+			if ( rows_apart ) {
+				for ( int r = 0; r < 9; r++ ) {
+					repel_range( grid.bucket_starts[rows[r]], grid.bucket_starts[rows[r] + 3] );
+				}
+			} else {
+				// visit each of the 27 buckets once
+				unsigned int visited[27];
+				int num_visited = 0;
+				for ( int c = 0; c < 27; c++ ) {
+					unsigned int b =
+						bucket_of_cell( ix + c % 3 - 1, iy + c / 3 % 3 - 1, iz + c / 9 - 1, grid.table_size );
+					if ( std::find( visited, visited + num_visited, b ) != visited + num_visited ) {
+						continue;
+					}
+					visited[num_visited++] = b;
+					repel_range( grid.bucket_starts[b], grid.bucket_starts[b + 1] );
+				}
+			}
+			unsigned int p = grid.entries[k].particle;
+			ps.vx[p] += a.v[0] * dt;
+			ps.vy[p] += a.v[1] * dt;
+			ps.vz[p] += a.v[2] * dt;
+		}
+	} );
+}
+
+/* moves particle p depth along the unit normal n, and bounces it off the
+surface if it is heading into it */
+static void push_out( particle_system_t &ps, unsigned int p, const vec3 &n, float depth,
+											float restitution ) {
+	ps.px[p] += n.v[0] * depth;
+	ps.py[p] += n.v[1] * depth;
+	ps.pz[p] += n.v[2] * depth;
+	float vn = ps.vx[p] * n.v[0] + ps.vy[p] * n.v[1] + ps.vz[p] * n.v[2];
+	if ( vn < 0.0f ) {
+		float k = -( 1.0f + restitution ) * vn;
+		ps.vx[p] += n.v[0] * k;
+		ps.vy[p] += n.v[1] * k;
+		ps.vz[p] += n.v[2] * k;
+	}
+}
+
+int particle_grid_collide_sphere( const particle_grid_t &grid, particle_system_t &ps,
+																	const vec3 &centre, float radius, float restitution ) {
+	float inv_h = 1.0f / grid.cell_size;
+	int lo[3], hi[3];
+	long long cells = 1;
+	for ( int i = 0; i < 3; i++ ) {
+		lo[i] = cell_coord( centre.v[i] - radius, inv_h );
+		hi[i] = cell_coord( centre.v[i] + radius, inv_h );
+		cells *= hi[i] - lo[i] + 1;
+	}
+	int moved = 0;
+	/* a bucket can be visited more than once through different cells, which is
+	harmless: a particle already pushed out isn't inside any more */
+	auto visit_bucket = [&]( int b ) {
+		for ( int j = grid.bucket_starts[b]; j < grid.bucket_starts[b + 1]; j++ ) {
+			unsigned int p = grid.entries[j].particle;
+			vec3 d( ps.px[p] - centre.v[0], ps.py[p] - centre.v[1], ps.pz[p] - centre.v[2] );
+			float dist_sq = length2( d );
+			if ( dist_sq >= radius * radius || dist_sq == 0.0f ) {
+				continue;
+			}
+			float dist = sqrtf( dist_sq );
+			push_out( ps, p, d / dist, radius - dist, restitution );
+			moved++;
+		}
+	};
+	// a sphere covering more cells than there are buckets might as well check every bucket
+	if ( cells >= grid.table_size ) {
+		for ( int b = 0; b < grid.table_size; b++ ) {
+			visit_bucket( b );
+		}
+		return moved;
+	}
+	for ( int iz = lo[2]; iz <= hi[2]; iz++ ) {
+		for ( int iy = lo[1]; iy <= hi[1]; iy++ ) {
+			for ( int ix = lo[0]; ix <= hi[0]; ix++ ) {
+				visit_bucket( bucket_of_cell( ix, iy, iz, grid.table_size ) );
+			}
+		}
+	}
+	return moved;
+}
+
+int particle_collide_plane( particle_system_t &ps, const unsigned int *indices, int count,
+														const vec3 &normal, float d, float restitution, int thread_count ) {
+	thread_count = std::max( 1, std::min( thread_count, count / PARTICLE_GRID_MIN_PER_THREAD ) );
+	std::vector<int> moved( thread_count, 0 );
+	run_on_threads( thread_count, [&]( int t ) {
+		int end = share_start( count, t + 1, thread_count );
+		for ( int i = share_start( count, t, thread_count ); i < end; i++ ) {
+			unsigned int p = indices ? indices[i] : i;
+			float dist = normal.v[0] * ps.px[p] + normal.v[1] * ps.py[p] + normal.v[2] * ps.pz[p] - d;
+			if ( dist < 0.0f ) {
+				push_out( ps, p, normal, -dist, restitution );
+				moved[t]++;
+			}
+		}
+	} );
+	int total = 0;
+	for ( int t = 0; t < thread_count; t++ ) {
+		total += moved[t];
+	}
+	return total;
+}
@@ -0,0 +1,75 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Spatial hash grid for particle collisions                                    |
+| Space is cut into cubes of cell_size, and each cube is hashed into a fixed   |
+| table of buckets, so the grid needs no bounds. It is rebuilt every frame by  |
+| a counting sort on the bucket numbers, in two passes of half the bits each,  |
+| with every step split over threads. Particles within cell_size of a point    |
+| are then in the 27 cells around it. Used for pushing particles apart, and    |
+| for finding the particles near a sphere. Planes don't need the grid.         |
+\******************************************************************************/
+#ifndef _PARTICLE_GRID_H_
+#define _PARTICLE_GRID_H_
+
+#include "maths_funcs.h"
+#include "particle_system.h"
+#include <vector>
+
+/* a particle and where it was when the grid was built. kept together so that
+copying one into its bucket, or reading it back, touches one cache line */
+struct particle_grid_entry_t {
+	float x, y, z;
+	unsigned int particle;
+};
+
+struct particle_grid_t {
+	float cell_size;
+	int table_size; // buckets. a power of two
+	// particles in bucket b are entries bucket_starts[b] to bucket_starts[b + 1] - 1
+	std::vector<int> bucket_starts;
+	std::vector<particle_grid_entry_t> entries; // by bucket
+	int count;
+
+	// working space
+	std::vector<unsigned int> keys; // bucket of each entry
+	std::vector<particle_grid_entry_t> tmp_entries;
+	std::vector<unsigned int> tmp_keys;
+	std::vector<int> counts;
+
+	particle_grid_t() : cell_size( 1.0f ), table_size( 0 ), count( 0 ) {}
+};
+
+/* sets up a grid for up to max_particles particles, with a table twice that
+size rounded up to a power of two */
+void particle_grid_init( particle_grid_t &grid, int max_particles, float cell_size );
+
+/* sorts particles into the grid. if indices is NULL, these are particles 0 to
+count-1 of ps, otherwise those listed in indices */
+void particle_grid_build( particle_grid_t &grid, const particle_system_t &ps,
+													const unsigned int *indices, int count, int thread_count );
+
+/* pushes apart every pair of particles in the grid closer than its cell size.
+a neighbour at distance r adds stiffness * ( 1 - r / cell_size )^2 to the
+acceleration away from it, applied to the velocity for dt seconds. writes only
+velocities, so positions are unchanged until the next update */
+void particle_grid_repel( const particle_grid_t &grid, particle_system_t &ps, float stiffness,
+													float dt, int thread_count );
+
+/* moves particles in the grid that are inside a sphere out to its surface, and
+bounces them off it, keeping restitution of the speed into it. returns how
+many were moved */
+int particle_grid_collide_sphere( const particle_grid_t &grid, particle_system_t &ps,
+																	const vec3 &centre, float radius, float restitution );
+
+/* the same for particles behind the plane dot( normal, p ) = d, for particles
+0 to count-1 or those listed in indices. normal must be unit length */
+int particle_collide_plane( particle_system_t &ps, const unsigned int *indices, int count,
+														const vec3 &normal, float d, float restitution, int thread_count );
+
+#endif
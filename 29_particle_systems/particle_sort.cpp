@@ -0,0 +1,262 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Back-to-front particle sorting. See particle_sort.h                          |
+\******************************************************************************/
+#include "particle_sort.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <float.h>
+
+// below this many particles per thread, starting threads costs more than it saves
+#define PARTICLE_SORT_MIN_PER_THREAD 16384
+/* the insertion sort gives up after moving entries this many places in total,
+per particle. the radix sort reads and writes everything about 4 times */
+#define PARTICLE_SORT_MOVES_PER_PARTICLE 2
+/* the insertion sort isn't tried if more than 1 in this many neighbours in the
+previous order are the wrong way around */
+#define PARTICLE_SORT_MAX_DESCENTS_DIVISOR 32
+/* nor if more than 1 in this many particles are new since the previous order.
+they are sorted on their own and merged in */
+#define PARTICLE_SORT_MAX_NEW_DIVISOR 8
+
+/* works out a key for each particle. further away gets a lower key */
+static void make_keys( particle_sort_t &s, const float *points, int count, const mat4 &V,
+											 int thread_count ) {
+	std::vector<float> mins( thread_count, FLT_MAX ), maxs( thread_count, -FLT_MAX );
+	run_on_threads( thread_count, [&]( int t ) {
+		int end = share_start( count, t + 1, thread_count );
+		float lo = FLT_MAX, hi = -FLT_MAX;
+		for ( int i = share_start( count, t, thread_count ); i < end; i++ ) {
+			// distance in front of the camera is minus the eye-space z
+			const float *p = &points[i * 3];
+			float d = -( V.m[2] * p[0] + V.m[6] * p[1] + V.m[10] * p[2] + V.m[14] );
+			s.depths[i] = d;
+			lo = std::min( lo, d );
+			hi = std::max( hi, d );
+		}
+		mins[t] = lo;
+		maxs[t] = hi;
+	} );
+	float lo = *std::min_element( mins.begin(), mins.end() );
+	float hi = *std::max_element( maxs.begin(), maxs.end() );
+	float scale = hi > lo ? 65535.0f / ( hi - lo ) : 0.0f;
+	run_on_threads( thread_count, [&]( int t ) {
+		int end = share_start( count, t + 1, thread_count );
+		for ( int i = share_start( count, t, thread_count ); i < end; i++ ) {
+			float k = std::min( ( hi - s.depths[i] ) * scale, 65535.0f );
+			s.particle_keys[i] = (unsigned short)k;
+		}
+	} );
+}
+
+/* looks up the key of each entry in s.order, and returns how many of the
+first kept entries have a higher key than the one after them */
+static int order_keys( particle_sort_t &s, int count, int kept, int thread_count ) {
+	std::vector<int> descents( thread_count, 0 );
+	run_on_threads( thread_count, [&]( int t ) {
+		int start = share_start( count, t, thread_count );
+		int end = share_start( count, t + 1, thread_count );
+		int n = 0;
+		for ( int i = start; i < end; i++ ) {
+			s.keys[i] = s.particle_keys[s.order[i]];
+		}
+		for ( int i = std::max( start, 1 ); i < std::min( end, kept ); i++ ) {
+			n += s.keys[i - 1] > s.keys[i];
+		}
+		descents[t] = n;
+	} );
+	// pairs that straddle two shares
+	int n = 0;
+	for ( int t = 0; t < thread_count; t++ ) {
+		int start = share_start( count, t, thread_count );
+		n += descents[t] + ( start > 0 && start < kept && s.keys[start - 1] > s.keys[start] );
+	}
+	return n;
+}
+
+/* sorts keys and order together by insertion, stopping once it has moved
+entries more than max_moves places. returns false if it stopped early */
+static bool insertion_sort( unsigned short *keys, unsigned int *order, int count,
+														long long max_moves ) {
+	long long moves = 0;
+	for ( int i = 1; i < count; i++ ) {
+		unsigned short k = keys[i];
+		if ( keys[i - 1] <= k ) {
+			continue;
+		}
+		unsigned int o = order[i];
+		int j = i;
+		for ( ; j > 0 && keys[j - 1] > k; j-- ) {
+			keys[j] = keys[j - 1];
+			order[j] = order[j - 1];
+		}
+		keys[j] = k;
+		order[j] = o;
+		moves += i - j;
+		if ( moves > max_moves ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* sorts the entries of s.order from kept on, the particles new since the
+previous order, and merges them into the sorted entries before them, from the
+back */
+static void merge_new( particle_sort_t &s, int count, int kept ) {
+	s.tmp_order.assign( s.order.begin() + kept, s.order.begin() + count );
+	const unsigned short *particle_keys = &s.particle_keys[0];
+	std::sort( s.tmp_order.begin(), s.tmp_order.end(),
+						 [particle_keys]( unsigned int a, unsigned int b ) {
+							 return particle_keys[a] < particle_keys[b];
+						 } );
+	int i = kept - 1;
+	for ( int j = count - kept - 1, out = count - 1; j >= 0; out-- ) {
+		unsigned short k = particle_keys[s.tmp_order[j]];
+		if ( i >= 0 && s.keys[i] > k ) {
+			s.keys[out] = s.keys[i];
+			s.order[out] = s.order[i];
+			i--;
+		} else {
+			s.keys[out] = k;
+			s.order[out] = s.tmp_order[j];
+			j--;
+		}
+	}
+}
+
+/* one stable counting-sort pass on the 8 bits of the keys from shift up.
+each thread counts its share, then copies it to where its share of each
+digit starts. returns false, having done nothing, if every key has the same
+digit */
+static bool radix_pass( particle_sort_t &s, const unsigned short *keys_in,
+												const unsigned int *order_in, unsigned short *keys_out,
+												unsigned int *order_out, int count, int shift, int thread_count ) {
+	s.counts.assign( thread_count * 256, 0 );
+	run_on_threads( thread_count, [&]( int t ) {
+		int *counts = &s.counts[t * 256];
+		int end = share_start( count, t + 1, thread_count );
+		for ( int i = share_start( count, t, thread_count ); i < end; i++ ) {
+			counts[( keys_in[i] >> shift ) & 255]++;
+		}
+	} );
+	int sum = 0;
+	for ( int d = 0; d < 256; d++ ) {
+		int digit_start = sum;
+		for ( int t = 0; t < thread_count; t++ ) {
+			int c = s.counts[t * 256 + d];
+			s.counts[t * 256 + d] = sum;
+			sum += c;
+		}
+		if ( sum - digit_start == count ) {
+			return false;
+		}
+	}
+	run_on_threads( thread_count, [&]( int t ) {
+		int *offsets = &s.counts[t * 256];
+		int end = share_start( count, t + 1, thread_count );
+		for ( int i = share_start( count, t, thread_count ); i < end; i++ ) {
+			int dst = offsets[( keys_in[i] >> shift ) & 255]++;
+			keys_out[dst] = keys_in[i];
+			order_out[dst] = order_in[i];
+		}
+	} );
+	return true;
+}
+
+/* turns last frame's order, kept as ids, into this frame's indices. particles
+that have died are dropped, and new ones go on the back. returns how many came
+from the previous order */
+static int reuse_order( particle_sort_t &s, const unsigned int *ids, int count ) {
+	for ( int i = 0; i < count; i++ ) {
+		unsigned int id = ids ? ids[i] : (unsigned int)i;
+		if ( id >= s.index_of_id.size() ) {
+			s.index_of_id.resize( id + 1, PARTICLE_SORT_NO_INDEX );
+		}
+		s.index_of_id[id] = i;
+	}
+	s.order.resize( count );
+	int kept = 0;
+	for ( size_t i = 0; i < s.order_ids.size(); i++ ) {
+		unsigned int id = s.order_ids[i];
+		if ( id < s.index_of_id.size() && s.index_of_id[id] != PARTICLE_SORT_NO_INDEX ) {
+			s.order[kept++] = s.index_of_id[id];
+			s.index_of_id[id] = PARTICLE_SORT_NO_INDEX;
+		}
+	}
+	int n = kept;
+	for ( int i = 0; i < count; i++ ) {
+		unsigned int id = ids ? ids[i] : (unsigned int)i;
+		if ( s.index_of_id[id] != PARTICLE_SORT_NO_INDEX ) {
+			s.order[n++] = i;
+			s.index_of_id[id] = PARTICLE_SORT_NO_INDEX;
+		}
+	}
+	return kept;
+}
+
+/* ids of the entries of the finished order, for the next frame */
+static void remember_order( particle_sort_t &s, const unsigned int *ids, int count ) {
+	s.order_ids.resize( count );
+	for ( int i = 0; i < count; i++ ) {
+		s.order_ids[i] = ids ? ids[s.order[i]] : s.order[i];
+	}
+}
+
+bool particle_sort( particle_sort_t &s, const float *points, const unsigned int *ids,
+										int count, const mat4 &V, int thread_count ) {
+	int kept = reuse_order( s, ids, count );
+	if ( count == 0 ) {
+		s.order_ids.clear();
+		return true;
+	}
+	s.keys.resize( count );
+	s.particle_keys.resize( count );
+	s.depths.resize( count );
+	thread_count = std::max( 1, std::min( thread_count, count / PARTICLE_SORT_MIN_PER_THREAD ) );
+	make_keys( s, points, count, V, thread_count );
+
+	/* when the camera and particles have hardly moved, the previous order only
+	needs a few entries moving, and the few new particles merging in. otherwise,
+	start again from particle order, which the radix sort doesn't mind and is
+	quicker to look keys up in */
+	if ( kept > 0 && count - kept <= count / PARTICLE_SORT_MAX_NEW_DIVISOR ) {
+		int descents = order_keys( s, count, kept, thread_count );
+		if ( descents <= kept / PARTICLE_SORT_MAX_DESCENTS_DIVISOR &&
+				 insertion_sort( &s.keys[0], &s.order[0], kept,
+												 (long long)kept * PARTICLE_SORT_MOVES_PER_PARTICLE ) ) {
+			merge_new( s, count, kept );
+			remember_order( s, ids, count );
+			return true;
+		}
+	}
+	s.keys.swap( s.particle_keys );
+	for ( int i = 0; i < count; i++ ) {
+		s.order[i] = i;
+	}
+	/* least significant byte first. a pass that would do nothing is skipped, so
+	the result can end up in either pair of arrays */
+	s.tmp_keys.resize( count );
+	s.tmp_order.resize( count );
+	for ( int shift = 0; shift < 16; shift += 8 ) {
+		if ( radix_pass( s, &s.keys[0], &s.order[0], &s.tmp_keys[0], &s.tmp_order[0], count,
+										 shift, thread_count ) ) {
+			s.keys.swap( s.tmp_keys );
+			s.order.swap( s.tmp_order );
+		}
+	}
+	remember_order( s, ids, count );
+	return false;
+}
+
+void particle_sort_reset( particle_sort_t &s ) {
+	s.order.clear();
+	s.keys.clear();
+	s.order_ids.clear();
+}
@@ -0,0 +1,58 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Back-to-front particle sorting                                               |
+| Blended particles drawn with the depth mask off have to be drawn furthest    |
+| first. Each particle's distance from the camera is quantised to a 16-bit key |
+| over the range the particles cover, and the result is an index buffer to     |
+| draw with glDrawElements(). From one frame to the next the order hardly      |
+| changes, so the previous order is used as the starting point and fixed up    |
+| with an insertion sort, and particles born since are sorted on their own and |
+| merged in. If that would take too many moves, a 2-pass radix sort, split over|
+| threads, does the whole thing instead. Particles are moved around the arrays |
+| as others die, so the previous order is kept as particle ids, which stay with|
+| the particles, and looked up again each frame.                               |
+\******************************************************************************/
+#ifndef _PARTICLE_SORT_H_
+#define _PARTICLE_SORT_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+// particle_sort_t::index_of_id for an id not in this frame's particles
+#define PARTICLE_SORT_NO_INDEX 0xFFFFFFFFu
+
+struct particle_sort_t {
+	std::vector<unsigned int> order; // particle indices, furthest first
+	std::vector<unsigned short> keys; // key of each entry in order
+	std::vector<unsigned int> order_ids; // id of each entry in order
+	/* this frame's index of each particle id. PARTICLE_SORT_NO_INDEX between
+	sorts */
+	std::vector<unsigned int> index_of_id;
+	// working space
+	std::vector<unsigned short> particle_keys; // key of each particle
+	std::vector<unsigned int> tmp_order;
+	std::vector<unsigned short> tmp_keys;
+	std::vector<float> depths;
+	std::vector<int> counts;
+};
+
+/* sorts particles 0 to count-1, positioned at points[i * 3] to points[i * 3 + 2]
+as written for the VAO, back to front as seen by the view matrix V. ids[i] is
+particle i's id, which must be different for each particle and stay with it
+from frame to frame, like particle_system_t::ids. with ids NULL, a particle's
+index is its id. the previous order of the particles still alive is the
+starting point. returns true if fixing up the previous order was enough, or
+false if it had to do a full radix sort */
+bool particle_sort( particle_sort_t &s, const float *points, const unsigned int *ids,
+										int count, const mat4 &V, int thread_count );
+
+/* forgets the previous order, so the next sort starts from scratch */
+void particle_sort_reset( particle_sort_t &s );
+
+#endif
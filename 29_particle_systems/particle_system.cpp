@@ -0,0 +1,277 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU particle simulation. See particle_system.h                               |
+\******************************************************************************/
+#include "particle_system.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <string.h>
+
+// the AVX function is compiled for AVX on its own, so the rest of the
+// program doesn't need -mavx, and is only called if the CPU has it
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#include <immintrin.h>
+#define PARTICLES_AVX
+#define PARTICLES_AVX_FUNC __attribute__( ( target( "avx" ) ) )
+static bool cpu_has_avx() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "avx" ) != 0;
+}
+#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#include <immintrin.h>
+#include <intrin.h>
+#define PARTICLES_AVX
+#define PARTICLES_AVX_FUNC
+static bool cpu_has_avx() {
+	int info[4];
+	__cpuid( info, 1 );
+	bool os_saves_ymm = ( info[2] & ( 1 << 27 ) ) != 0;
+	bool has_avx = ( info[2] & ( 1 << 28 ) ) != 0;
+	// the OS must also save the upper halves of the registers on task switches
+	return os_saves_ymm && has_avx && ( _xgetbv( 0 ) & 6 ) == 6;
+}
+#endif
+
+/* start of thread t's share of count particles. shares start on a multiple of
+8 so that each one's AVX loop lines up */
+static int share_start_8( int count, int t, int thread_count ) {
+	if ( t >= thread_count ) {
+		return count;
+	}
+	return (int)( (long long)count * t / thread_count ) & ~7;
+}
+
+void particle_system_init( particle_system_t &ps, int capacity ) {
+	ps.px.resize( capacity );
+	ps.py.resize( capacity );
+	ps.pz.resize( capacity );
+	ps.vx.resize( capacity );
+	ps.vy.resize( capacity );
+	ps.vz.resize( capacity );
+	ps.age.resize( capacity );
+	ps.lifetime.resize( capacity );
+	ps.ids.resize( capacity );
+	for ( int i = 0; i < capacity; i++ ) {
+		ps.ids[i] = i * 2;
+	}
+	ps.capacity = capacity;
+	ps.count = 0;
+}
+
+int particle_spawn( particle_system_t &ps, const vec3 &pos, const vec3 &vel, float lifetime ) {
+	if ( ps.count >= ps.capacity ) {
+		return -1;
+	}
+	int i = ps.count++;
+	ps.px[i] = pos.v[0];
+	ps.py[i] = pos.v[1];
+	ps.pz[i] = pos.v[2];
+	ps.vx[i] = vel.v[0];
+	ps.vy[i] = vel.v[1];
+	ps.vz[i] = vel.v[2];
+	ps.age[i] = 0.0f;
+	ps.lifetime[i] = lifetime;
+	ps.ids[i] ^= 1;
+	return i;
+}
+
+/* n particles from index src to index dst, over dead ones. their ids are
+swapped, so the dead ones' ids are left behind at src */
+static void move_particles( particle_system_t &ps, int src, int dst, int n ) {
+	float *arrays[] = { &ps.px[0], &ps.py[0], &ps.pz[0], &ps.vx[0],
+											&ps.vy[0], &ps.vz[0], &ps.age[0], &ps.lifetime[0] };
+	for ( int a = 0; a < 8; a++ ) {
+		memcpy( arrays[a] + dst, arrays[a] + src, n * sizeof( float ) );
+	}
+	std::swap_ranges( ps.ids.begin() + src, ps.ids.begin() + src + n, ps.ids.begin() + dst );
+}
+
+/* everything a step needs, worked out once */
+struct step_consts_t {
+	float gx, gy, gz; // gravity * dt
+	float keep;				// 1 - drag * dt
+	float dt, ground_y, restitution, friction;
+};
+
+/* one step for particle i. the order of operations is the same as the AVX
+version, so both give exactly the same results */
+static void step_particle( particle_system_t &ps, const step_consts_t &k, int i ) {
+	float vx = ( ps.vx[i] + k.gx ) * k.keep;
+	float vy = ( ps.vy[i] + k.gy ) * k.keep;
+	float vz = ( ps.vz[i] + k.gz ) * k.keep;
+	float px = ps.px[i] + vx * k.dt;
+	float py = ps.py[i] + vy * k.dt;
+	float pz = ps.pz[i] + vz * k.dt;
+	if ( py < k.ground_y ) {
+		py = k.ground_y;
+		vy = -vy * k.restitution;
+		vx = vx * k.friction;
+		vz = vz * k.friction;
+	}
+	ps.px[i] = px;
+	ps.py[i] = py;
+	ps.pz[i] = pz;
+	ps.vx[i] = vx;
+	ps.vy[i] = vy;
+	ps.vz[i] = vz;
+	ps.age[i] = ps.age[i] + k.dt;
+}
+
+#ifdef PARTICLES_AVX
+/* 8 particles per loop from start to end, which is a multiple of 8 on */
+PARTICLES_AVX_FUNC static void step_particles_avx( particle_system_t &ps, const step_consts_t &k,
+																									 int start, int end ) {
+	__m256 gx = _mm256_set1_ps( k.gx ), gy = _mm256_set1_ps( k.gy ), gz = _mm256_set1_ps( k.gz );
+	__m256 keep = _mm256_set1_ps( k.keep ), dt = _mm256_set1_ps( k.dt );
+	__m256 ground = _mm256_set1_ps( k.ground_y );
+	__m256 neg_restitution = _mm256_set1_ps( -k.restitution );
+	__m256 friction = _mm256_set1_ps( k.friction );
+	for ( int i = start; i < end; i += 8 ) {
+		__m256 vx = _mm256_mul_ps( _mm256_add_ps( _mm256_loadu_ps( &ps.vx[i] ), gx ), keep );
+		__m256 vy = _mm256_mul_ps( _mm256_add_ps( _mm256_loadu_ps( &ps.vy[i] ), gy ), keep );
+		__m256 vz = _mm256_mul_ps( _mm256_add_ps( _mm256_loadu_ps( &ps.vz[i] ), gz ), keep );
+		__m256 px = _mm256_add_ps( _mm256_loadu_ps( &ps.px[i] ), _mm256_mul_ps( vx, dt ) );
+		__m256 py = _mm256_add_ps( _mm256_loadu_ps( &ps.py[i] ), _mm256_mul_ps( vy, dt ) );
+		__m256 pz = _mm256_add_ps( _mm256_loadu_ps( &ps.pz[i] ), _mm256_mul_ps( vz, dt ) );
+		// bounce the lanes that went through the ground
+		__m256 hit = _mm256_cmp_ps( py, ground, _CMP_LT_OQ );
+		py = _mm256_blendv_ps( py, ground, hit );
+		vy = _mm256_blendv_ps( vy, _mm256_mul_ps( vy, neg_restitution ), hit );
+		vx = _mm256_blendv_ps( vx, _mm256_mul_ps( vx, friction ), hit );
+		vz = _mm256_blendv_ps( vz, _mm256_mul_ps( vz, friction ), hit );
+		_mm256_storeu_ps( &ps.px[i], px );
+		_mm256_storeu_ps( &ps.py[i], py );
+		_mm256_storeu_ps( &ps.pz[i], pz );
+		_mm256_storeu_ps( &ps.vx[i], vx );
+		_mm256_storeu_ps( &ps.vy[i], vy );
+		_mm256_storeu_ps( &ps.vz[i], vz );
+		_mm256_storeu_ps( &ps.age[i], _mm256_add_ps( _mm256_loadu_ps( &ps.age[i] ), dt ) );
+	}
+}
+
+static bool use_avx() {
+	static const bool has_avx = cpu_has_avx();
+	return has_avx;
+}
+#endif
+
+static step_consts_t make_step_consts( const particle_system_t &ps, float dt ) {
+	step_consts_t k;
+	k.gx = ps.gravity.v[0] * dt;
+	k.gy = ps.gravity.v[1] * dt;
+	k.gz = ps.gravity.v[2] * dt;
+	k.keep = std::max( 1.0f - ps.drag * dt, 0.0f );
+	k.dt = dt;
+	k.ground_y = ps.ground_y;
+	k.restitution = ps.restitution;
+	k.friction = ps.friction;
+	return k;
+}
+
+/* steps particles start to end-1, then packs the survivors at the front of
+that range by moving the range's last live particle into each dead one's
+place. returns how many survived */
+static int update_share( particle_system_t &ps, const step_consts_t &k, int start, int end ) {
+	int i = start;
+#ifdef PARTICLES_AVX
+	if ( use_avx() ) {
+		i = start + ( ( end - start ) & ~7 );
+		step_particles_avx( ps, k, start, i );
+	}
+#endif
+	for ( ; i < end; i++ ) {
+		step_particle( ps, k, i );
+	}
+	int live_end = end;
+	for ( i = start; i < live_end; ) {
+		if ( ps.age[i] >= ps.lifetime[i] ) {
+			live_end--;
+			move_particles( ps, live_end, i, 1 );
+		} else {
+			i++;
+		}
+	}
+	return live_end - start;
+}
+
+void particle_system_update( particle_system_t &ps, float dt, int thread_count ) {
+	step_consts_t k = make_step_consts( ps, dt );
+	thread_count = std::max( 1, std::min( thread_count, ps.count / 1024 ) );
+
+	std::vector<int> live( thread_count );
+	run_on_threads( thread_count, [&]( int t ) {
+		int start = share_start_8( ps.count, t, thread_count );
+		int end = share_start_8( ps.count, t + 1, thread_count );
+		live[t] = update_share( ps, k, start, end );
+	} );
+
+	/* each share now has its survivors at its front and a gap behind them.
+	fill the gaps, first to last, with blocks of particles taken from the back
+	of the last non-empty share */
+	int total = 0;
+	for ( int t = 0; t < thread_count; t++ ) {
+		total += live[t];
+	}
+	int lo = 0, hi = thread_count - 1;
+	int hi_start = share_start_8( ps.count, hi, thread_count );
+	int hi_end = hi_start + live[hi]; // one past the last particle not yet moved
+	int gap = live[0];								// first dead slot
+	int gap_end = share_start_8( ps.count, 1, thread_count );
+	while ( gap < total ) {
+		if ( gap == gap_end ) {
+			lo++;
+			gap = share_start_8( ps.count, lo, thread_count ) + live[lo];
+			gap_end = share_start_8( ps.count, lo + 1, thread_count );
+			continue;
+		}
+		if ( hi_end == hi_start ) {
+			hi--;
+			hi_start = share_start_8( ps.count, hi, thread_count );
+			hi_end = hi_start + live[hi];
+			continue;
+		}
+		int n = std::min( gap_end - gap, hi_end - hi_start );
+		n = std::min( n, total - gap );
+		move_particles( ps, hi_end - n, gap, n );
+		gap += n;
+		hi_end -= n;
+	}
+	ps.count = total;
+}
+
+int particle_system_update_range( particle_system_t &ps, int start, int end, float dt ) {
+	return update_share( ps, make_step_consts( ps, dt ), start, end );
+}
+
+void particle_system_write_vertices( const particle_system_t &ps, float *points, float *life,
+																		 unsigned int *ids, int thread_count ) {
+	thread_count = std::max( 1, std::min( thread_count, ps.count / 1024 ) );
+	run_on_threads( thread_count, [&]( int t ) {
+		int start = share_start_8( ps.count, t, thread_count );
+		int end = share_start_8( ps.count, t + 1, thread_count );
+		for ( int i = start; i < end; i++ ) {
+			points[i * 3] = ps.px[i];
+			points[i * 3 + 1] = ps.py[i];
+			points[i * 3 + 2] = ps.pz[i];
+			life[i] = ps.age[i] / ps.lifetime[i];
+		}
+		if ( ids ) {
+			memcpy( ids + start, &ps.ids[start], ( end - start ) * sizeof( unsigned int ) );
+		}
+	} );
+}
+
+const char *particle_system_path() {
+#ifdef PARTICLES_AVX
+	if ( use_avx() ) {
+		return "AVX";
+	}
+#endif
+	return "scalar";
+}
@@ -0,0 +1,74 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU particle simulation                                                      |
+| Particles are kept one array per component, so that 8 can be integrated at   |
+| once with AVX. Live particles are always packed at the front of the arrays:  |
+| spawning appends, and a particle that dies is replaced by the last live one, |
+| so there is no free list to search. Updates are split over threads, each of  |
+| which packs its own share; the shares are then moved together. The output is |
+| the same as the demo's VAO wants: an array of xyz points and one float each. |
+| Every particle also has an id that stays with it as it is moved, so that     |
+| something kept from one frame to the next, like a draw order, can find it.   |
+\******************************************************************************/
+#ifndef _PARTICLE_SYSTEM_H_
+#define _PARTICLE_SYSTEM_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+struct particle_system_t {
+	std::vector<float> px, py, pz; // positions
+	std::vector<float> vx, vy, vz; // velocities
+	std::vector<float> age, lifetime; // seconds
+	/* a different id, below 2 * capacity, in every slot, dead or alive. a moved
+	particle takes its id with it, and the dead particle's id is left in the slot
+	it moved from. spawning flips the id's lowest bit, so that a particle never
+	has the id of one that died since the last frame */
+	std::vector<unsigned int> ids;
+	int count; // live particles, at indices 0 to count - 1
+	int capacity;
+
+	vec3 gravity;
+	float drag; // fraction of velocity lost per second
+	/* particles bounce off the plane y = ground_y, keeping restitution of their
+	vertical speed and friction of their horizontal speed */
+	float ground_y;
+	float restitution;
+	float friction;
+
+	particle_system_t()
+		: count( 0 ), capacity( 0 ), gravity( 0.0f, -1.0f, 0.0f ), drag( 0.0f ), ground_y( -1.0f ),
+			restitution( 0.5f ), friction( 0.9f ) {}
+};
+
+/* allocates room for capacity particles and removes any live ones */
+void particle_system_init( particle_system_t &ps, int capacity );
+
+/* adds a particle, returning its index, or -1 if the system is full */
+int particle_spawn( particle_system_t &ps, const vec3 &pos, const vec3 &vel, float lifetime );
+
+/* moves every particle on by dt seconds and removes those that have lived
+out their lifetime. uses thread_count threads */
+void particle_system_update( particle_system_t &ps, float dt, int thread_count );
+
+/* the same for just particles start to end-1, packing the ones still alive at
+the front of that range and returning how many there are. ps.count is left
+alone, so that the arrays can be shared out between several owners */
+int particle_system_update_range( particle_system_t &ps, int start, int end, float dt );
+
+/* writes count xyz positions to points and count values from 0 at birth to 1
+at death to life, to go straight into the VAO's two buffers, and each
+particle's id to ids, unless it is NULL */
+void particle_system_write_vertices( const particle_system_t &ps, float *points, float *life,
+																		 unsigned int *ids, int thread_count );
+
+/* "AVX" or "scalar", whichever this CPU integrates with */
+const char *particle_system_path();
+
+#endif
@@ -0,0 +1,17 @@
+/* shader to draw particles that were moved on the CPU */
+#version 410 core
+
+layout (location = 0) in vec3 vp; // position in world coordinates
+layout (location = 1) in float life; // 0 at birth to 1 at death
+
+uniform mat4 V, P;
+
+// the fragment shader can use this for it's output colour's alpha component 
+out float opacity;
+
+void main() {
+	// gradually make particle fade to invisible over its lifetime
+	opacity = 1.0 - life;
+	gl_Position = P * V * vec4 (vp, 1.0);
+	gl_PointSize = 15.0; // size in pixels
+}
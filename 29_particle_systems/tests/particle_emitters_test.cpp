@@ -0,0 +1,139 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Particle emitter tests                                                       |
+| Checks without GL that no emitter ever runs out of room in its slice of the  |
+| pool: the demo's fountains and bursting fountain, and emitters like the      |
+| benchmark's, at steady and uneven frame rates and with the camera moving     |
+| them between LODs. Also checks that spawns past a full slice are counted.    |
+| Build and run with "make -f Makefile.linux64 test".                          |
+\******************************************************************************/
+#include "particle_emitters.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// seconds of frames to run each case for
+#define TEST_SECONDS 12.0f
+
+static int g_failures = 0;
+
+#define CHECK( cond )                                                         \
+	do {                                                                        \
+		if ( !( cond ) ) {                                                        \
+			fprintf( stderr, "FAILED %s:%i: %s\n", __FILE__, __LINE__, #cond );     \
+			g_failures++;                                                           \
+		}                                                                         \
+	} while ( 0 )
+
+enum frames_kind_t { FRAMES_144HZ, FRAMES_60HZ, FRAMES_30HZ, FRAMES_UNEVEN, FRAMES_STALLS };
+
+static float random_float( float lo, float hi ) {
+	return lo + ( hi - lo ) * (float)rand() / (float)RAND_MAX;
+}
+
+static float frame_dt( frames_kind_t kind ) {
+	switch ( kind ) {
+	case FRAMES_144HZ: return 1.0f / 144.0f;
+	case FRAMES_60HZ: return 1.0f / 60.0f;
+	case FRAMES_30HZ: return 1.0f / 30.0f;
+	case FRAMES_UNEVEN: return random_float( 0.002f, 0.08f );
+	// now and then a frame far longer than EMITTER_MAX_DT
+	default: return rand() % 20 == 0 ? random_float( 0.1f, 2.0f ) : random_float( 0.005f, 0.1f );
+	}
+}
+
+/* the demo's 3x3 fountains, the middle one also bursting */
+static void add_demo_emitters( particle_emitters_t &es ) {
+	for ( int i = 0; i < 9; i++ ) {
+		particle_emitter_t e;
+		e.pos = vec3( (float)( i % 3 - 1 ), 0.0f, (float)( i / 3 - 1 ) );
+		e.lifetime = 3.0f;
+		e.rate = 1000.0f;
+		if ( 4 == i ) {
+			e.burst_count = 2000;
+			e.burst_interval = 1.5f;
+		}
+		CHECK( particle_emitter_add( es, e ) >= 0 );
+	}
+}
+
+/* like the benchmark's, with bursts at intervals that do and don't divide the
+lifetime, and a one-off burst */
+static void add_mixed_emitters( particle_emitters_t &es ) {
+	for ( int i = 0; i < 200; i++ ) {
+		particle_emitter_t e;
+		e.pos = vec3( random_float( -40.0f, 40.0f ), 0.0f, random_float( -40.0f, 40.0f ) );
+		e.lifetime = random_float( 0.5f, 4.0f );
+		e.rate = random_float( 0.0f, 500.0f );
+		if ( i % 4 == 0 ) {
+			e.burst_count = 1 + rand() % 300;
+			e.burst_interval = i % 8 == 0 ? random_float( 0.05f, 2.0f ) : 0.0f;
+		}
+		CHECK( particle_emitter_add( es, e ) >= 0 );
+	}
+}
+
+static void test_no_drops( bool demo, frames_kind_t kind, bool moving_camera, const char *name ) {
+	particle_emitters_t es;
+	particle_emitters_init( es, 4000000 );
+	if ( demo ) {
+		add_demo_emitters( es );
+	} else {
+		add_mixed_emitters( es );
+	}
+	int most_alive = 0;
+	float t = 0.0f;
+	while ( t < TEST_SECONDS ) {
+		float dt = frame_dt( kind );
+		t += dt;
+		// the camera sweeps in and out, so emitters change LOD as they go
+		vec3 cam_pos( 0.0f, 1.7f, moving_camera ? 60.0f * ( t - (int)t ) : 0.0f );
+		particle_emitters_update( es, cam_pos, dt, 2 );
+		most_alive = es.particles_alive > most_alive ? es.particles_alive : most_alive;
+	}
+	printf( "%s: most particles alive %i, dropped %i\n", name, most_alive, es.particles_dropped );
+	CHECK( most_alive > 0 );
+	CHECK( 0 == es.particles_dropped );
+}
+
+/* bursts asked for on top of an emitter's own don't fit, and are counted */
+static void test_drops_counted() {
+	particle_emitters_t es;
+	particle_emitters_init( es, 100000 );
+	particle_emitter_t e;
+	e.rate = 100.0f;
+	int index = particle_emitter_add( es, e );
+	CHECK( index >= 0 );
+	particle_emitters_update( es, vec3( 0.0f, 0.0f, 0.0f ), 1.0f / 60.0f, 1 );
+	CHECK( 0 == es.particles_dropped );
+	int room = es.emitters[index].capacity - es.emitters[index].count;
+	particle_emitter_burst( es, index, room + 1000 );
+	particle_emitters_update( es, vec3( 0.0f, 0.0f, 0.0f ), 1.0f / 60.0f, 1 );
+	CHECK( es.emitters[index].count == es.emitters[index].capacity );
+	// the rate's particle or two this frame didn't fit either
+	CHECK( es.particles_dropped >= 1000 && es.particles_dropped <= 1002 );
+}
+
+int main() {
+	srand( 1 );
+	test_no_drops( true, FRAMES_144HZ, false, "demo, 144Hz" );
+	test_no_drops( true, FRAMES_60HZ, false, "demo, 60Hz" );
+	test_no_drops( true, FRAMES_30HZ, false, "demo, 30Hz" );
+	test_no_drops( true, FRAMES_UNEVEN, false, "demo, uneven frames" );
+	test_no_drops( true, FRAMES_STALLS, false, "demo, stalls" );
+	test_no_drops( false, FRAMES_60HZ, true, "mixed, 60Hz, LODs" );
+	test_no_drops( false, FRAMES_UNEVEN, true, "mixed, uneven frames, LODs" );
+	test_no_drops( false, FRAMES_STALLS, true, "mixed, stalls, LODs" );
+	test_drops_counted();
+	if ( g_failures ) {
+		fprintf( stderr, "%i checks failed\n", g_failures );
+		return 1;
+	}
+	printf( "particle_emitters_test passed\n" );
+	return 0;
+}
@@ -0,0 +1,142 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Particle sort tests                                                          |
+| Checks without GL that particle_sort() puts particles back to front, that    |
+| particle ids stay a shuffle of the pool's slots as particles die, and that   |
+| the previous order is still used after dead particles' slots are filled.     |
+| Build and run with "make -f Makefile.linux64 test".                          |
+\******************************************************************************/
+#include "particle_sort.h"
+#include "particle_system.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_CAPACITY 40000
+#define TEST_FRAMES 30
+#define TEST_SPAWNS_PER_FRAME 300
+
+static int g_failures = 0;
+
+#define CHECK( cond )                                                         \
+	do {                                                                        \
+		if ( !( cond ) ) {                                                        \
+			fprintf( stderr, "FAILED %s:%i: %s\n", __FILE__, __LINE__, #cond );     \
+			g_failures++;                                                           \
+		}                                                                         \
+	} while ( 0 )
+
+static float random_float( float lo, float hi ) {
+	return lo + ( hi - lo ) * (float)rand() / (float)RAND_MAX;
+}
+
+/* every particle once, and each further away than the next */
+static bool back_to_front( const particle_sort_t &s, const float *points, int count,
+													 const mat4 &V ) {
+	if ( (int)s.order.size() != count ) {
+		return false;
+	}
+	std::vector<bool> seen( count, false );
+	float last_depth = 1e30f;
+	for ( int i = 0; i < count; i++ ) {
+		unsigned int p = s.order[i];
+		if ( p >= (unsigned int)count || seen[p] ) {
+			return false;
+		}
+		seen[p] = true;
+		const float *xyz = &points[p * 3];
+		float depth = -( V.m[2] * xyz[0] + V.m[6] * xyz[1] + V.m[10] * xyz[2] + V.m[14] );
+		// keys are 16 bits, so particles this close together may swap
+		if ( depth > last_depth + 0.01f ) {
+			return false;
+		}
+		last_depth = depth;
+	}
+	return true;
+}
+
+/* one id for each slot, whichever way its lowest bit is */
+static bool ids_are_slots( const particle_system_t &ps ) {
+	std::vector<unsigned int> sorted( ps.ids );
+	std::sort( sorted.begin(), sorted.end() );
+	for ( int i = 0; i < ps.capacity; i++ ) {
+		if ( sorted[i] / 2 != (unsigned int)i ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* a still camera over slowly drifting particles, some of which die and are
+replaced every frame. after the first frame the sort should never have to
+start again */
+static void test_frames() {
+	particle_system_t ps;
+	particle_system_init( ps, TEST_CAPACITY );
+	ps.gravity = vec3( 0.0f, 0.0f, 0.0f );
+	ps.ground_y = -1e9f;
+	for ( int i = 0; i < TEST_CAPACITY; i++ ) {
+		vec3 pos( random_float( -10.0f, 10.0f ), random_float( -10.0f, 10.0f ),
+							random_float( -10.0f, 10.0f ) );
+		vec3 vel( random_float( -0.001f, 0.001f ), random_float( -0.001f, 0.001f ),
+							random_float( -0.001f, 0.001f ) );
+		particle_spawn( ps, pos, vel, random_float( 0.05f, 2.0f ) );
+	}
+	mat4 V = translate( identity_mat4(), vec3( 0.0f, 0.0f, -30.0f ) );
+	std::vector<float> points( TEST_CAPACITY * 3 ), life( TEST_CAPACITY );
+	std::vector<unsigned int> ids( TEST_CAPACITY );
+	particle_sort_t s, by_index;
+	int warm_frames = 0;
+	for ( int f = 0; f < TEST_FRAMES; f++ ) {
+		particle_system_update( ps, 1.0f / 60.0f, 4 );
+		for ( int n = 0; n < TEST_SPAWNS_PER_FRAME; n++ ) {
+			vec3 pos( random_float( -10.0f, 10.0f ), random_float( -10.0f, 10.0f ),
+								random_float( -10.0f, 10.0f ) );
+			particle_spawn( ps, pos, vec3( 0.0f, 0.0f, 0.0f ), 1.0f );
+		}
+		CHECK( ids_are_slots( ps ) );
+		particle_system_write_vertices( ps, &points[0], &life[0], &ids[0], 4 );
+		bool warm = particle_sort( s, &points[0], &ids[0], ps.count, V, 4 );
+		CHECK( back_to_front( s, &points[0], ps.count, V ) );
+		particle_sort( by_index, &points[0], NULL, ps.count, V, 4 );
+		CHECK( back_to_front( by_index, &points[0], ps.count, V ) );
+		if ( f > 0 ) {
+			CHECK( warm );
+			warm_frames += warm ? 1 : 0;
+		}
+	}
+	printf( "%i of %i frames sorted from the previous order, %i particles alive\n", warm_frames,
+					TEST_FRAMES - 1, ps.count );
+}
+
+/* every particle gone, then a few back */
+static void test_empty() {
+	particle_sort_t s;
+	float points[6] = { 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, -2.0f };
+	unsigned int ids[2] = { 7, 3 };
+	mat4 V = identity_mat4();
+	particle_sort( s, points, ids, 2, V, 1 );
+	CHECK( back_to_front( s, points, 2, V ) );
+	CHECK( particle_sort( s, points, ids, 0, V, 1 ) );
+	CHECK( s.order.empty() );
+	particle_sort( s, points, ids, 2, V, 1 );
+	CHECK( back_to_front( s, points, 2, V ) );
+}
+
+int main() {
+	srand( 1 );
+	test_empty();
+	test_frames();
+	if ( g_failures ) {
+		fprintf( stderr, "%i checks failed\n", g_failures );
+		return 1;
+	}
+	printf( "particle_sort_test passed\n" );
+	return 0;
+}
@@ -17,97 +17,6 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 
-/*--------------------------------CONSTRUCTORS--------------------------------*/
-vec2::vec2() {}
-
-vec2::vec2( float x, float y ) {
-	v[0] = x;
-	v[1] = y;
-}
-
-vec3::vec3() {}
-
-vec3::vec3( float x, float y, float z ) {
-	v[0] = x;
-	v[1] = y;
-	v[2] = z;
-}
-
-vec3::vec3( const vec2 &vv, float z ) {
-	v[0] = vv.v[0];
-	v[1] = vv.v[1];
-	v[2] = z;
-}
-
-vec3::vec3( const vec4 &vv ) {
-	v[0] = vv.v[0];
-	v[1] = vv.v[1];
-	v[2] = vv.v[2];
-}
-
-vec4::vec4() {}
-
-vec4::vec4( float x, float y, float z, float w ) {
-	v[0] = x;
-	v[1] = y;
-	v[2] = z;
-	v[3] = w;
-}
-
-vec4::vec4( const vec2 &vv, float z, float w ) {
-	v[0] = vv.v[0];
-	v[1] = vv.v[1];
-	v[2] = z;
-	v[3] = w;
-}
-
-vec4::vec4( const vec3 &vv, float w ) {
-	v[0] = vv.v[0];
-	v[1] = vv.v[1];
-	v[2] = vv.v[2];
-	v[3] = w;
-}
-
-mat3::mat3() {}
-
-/* note: entered in COLUMNS */
-mat3::mat3( float a, float b, float c, float d, float e, float f, float g, float h,
-						float i ) {
-	m[0] = a;
-	m[1] = b;
-	m[2] = c;
-	m[3] = d;
-	m[4] = e;
-	m[5] = f;
-	m[6] = g;
-	m[7] = h;
-	m[8] = i;
-}
-
-mat4::mat4() {}
-
-/* note: entered in COLUMNS */
-mat4::mat4( float a, float b, float c, float d, float e, float f, float g, float h,
-						float i, float j, float k, float l, float mm, float n, float o,
-						float p ) {
-	m[0] = a;
-	m[1] = b;
-	m[2] = c;
-	m[3] = d;
-	m[4] = e;
-	m[5] = f;
-	m[6] = g;
-	m[7] = h;
-	m[8] = i;
-	m[9] = j;
-	m[10] = k;
-	m[11] = l;
-	m[12] = mm;
-	m[13] = n;
-	m[14] = o;
-	m[15] = p;
-}
-
 /*-----------------------------PRINT FUNCTIONS--------------------------------*/
 void print( const vec2 &v ) { printf( "[%.2f, %.2f]\n", v.v[0], v.v[1] ); }
 
@@ -139,11 +48,6 @@ float length( const vec3 &v ) {
 	return sqrt( v.v[0] * v.v[0] + v.v[1] * v.v[1] + v.v[2] * v.v[2] );
 }
 
-// squared length
-float length2( const vec3 &v ) {
-	return v.v[0] * v.v[0] + v.v[1] * v.v[1] + v.v[2] * v.v[2];
-}
-
 // note: proper spelling (hehe)
 vec3 normalise( const vec3 &v ) {
 	vec3 vb;
@@ -157,93 +61,6 @@ vec3 normalise( const vec3 &v ) {
 	return vb;
 }
 
-vec3 vec3::operator+( const vec3 &rhs ) {
-	vec3 vc;
-	vc.v[0] = v[0] + rhs.v[0];
-	vc.v[1] = v[1] + rhs.v[1];
-	vc.v[2] = v[2] + rhs.v[2];
-	return vc;
-}
-
-vec3 &vec3::operator+=( const vec3 &rhs ) {
-	v[0] += rhs.v[0];
-	v[1] += rhs.v[1];
-	v[2] += rhs.v[2];
-	return *this; // return self
-}
-
-vec3 vec3::operator-( const vec3 &rhs ) {
-	vec3 vc;
-	vc.v[0] = v[0] - rhs.v[0];
-	vc.v[1] = v[1] - rhs.v[1];
-	vc.v[2] = v[2] - rhs.v[2];
-	return vc;
-}
-
-vec3 &vec3::operator-=( const vec3 &rhs ) {
-	v[0] -= rhs.v[0];
-	v[1] -= rhs.v[1];
-	v[2] -= rhs.v[2];
-	return *this;
-}
-
-vec3 vec3::operator+( float rhs ) {
-	vec3 vc;
-	vc.v[0] = v[0] + rhs;
-	vc.v[1] = v[1] + rhs;
-	vc.v[2] = v[2] + rhs;
-	return vc;
-}
-
-vec3 vec3::operator-( float rhs ) {
-	vec3 vc;
-	vc.v[0] = v[0] - rhs;
-	vc.v[1] = v[1] - rhs;
-	vc.v[2] = v[2] - rhs;
-	return vc;
-}
-
-vec3 vec3::operator*( float rhs ) {
-	vec3 vc;
-	vc.v[0] = v[0] * rhs;
-	vc.v[1] = v[1] * rhs;
-	vc.v[2] = v[2] * rhs;
-	return vc;
-}
-
-vec3 vec3::operator/( float rhs ) {
-	vec3 vc;
-	vc.v[0] = v[0] / rhs;
-	vc.v[1] = v[1] / rhs;
-	vc.v[2] = v[2] / rhs;
-	return vc;
-}
-
-vec3 &vec3::operator*=( float rhs ) {
-	v[0] = v[0] * rhs;
-	v[1] = v[1] * rhs;
-	v[2] = v[2] * rhs;
-	return *this;
-}
-
-vec3 &vec3::operator=( const vec3 &rhs ) {
-	v[0] = rhs.v[0];
-	v[1] = rhs.v[1];
-	v[2] = rhs.v[2];
-	return *this;
-}
-
-float dot( const vec3 &a, const vec3 &b ) {
-	return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
-}
-
-vec3 cross( const vec3 &a, const vec3 &b ) {
-	float x = a.v[1] * b.v[2] - a.v[2] * b.v[1];
-	float y = a.v[2] * b.v[0] - a.v[0] * b.v[2];
-	float z = a.v[0] * b.v[1] - a.v[1] * b.v[0];
-	return vec3( x, y, z );
-}
-
 float get_squared_dist( vec3 from, vec3 to ) {
 	float x = ( to.v[0] - from.v[0] ) * ( to.v[0] - from.v[0] );
 	float y = ( to.v[1] - from.v[1] ) * ( to.v[1] - from.v[1] );
@@ -264,24 +81,6 @@ vec3 heading_to_direction( float degrees ) {
 }
 
 /*-----------------------------MATRIX FUNCTIONS-------------------------------*/
-mat3 zero_mat3() {
-	return mat3( 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f );
-}
-
-mat3 identity_mat3() {
-	return mat3( 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f );
-}
-
-mat4 zero_mat4() {
-	return mat4( 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-							 0.0f, 0.0f, 0.0f, 0.0f, 0.0f );
-}
-
-mat4 identity_mat4() {
-	return mat4( 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-							 0.0f, 0.0f, 0.0f, 0.0f, 1.0f );
-}
-
 /* mat4 array layout
  0  4  8 12
  1  5  9 13
@@ -289,41 +88,6 @@ mat4 identity_mat4() {
  3  7 11 15
 */
 
-vec4 mat4::operator*( const vec4 &rhs ) {
-	// 0x + 4y + 8z + 12w
-	float x = m[0] * rhs.v[0] + m[4] * rhs.v[1] + m[8] * rhs.v[2] + m[12] * rhs.v[3];
-	// 1x + 5y + 9z + 13w
-	float y = m[1] * rhs.v[0] + m[5] * rhs.v[1] + m[9] * rhs.v[2] + m[13] * rhs.v[3];
-	// 2x + 6y + 10z + 14w
-	float z = m[2] * rhs.v[0] + m[6] * rhs.v[1] + m[10] * rhs.v[2] + m[14] * rhs.v[3];
-	// 3x + 7y + 11z + 15w
-	float w = m[3] * rhs.v[0] + m[7] * rhs.v[1] + m[11] * rhs.v[2] + m[15] * rhs.v[3];
-	return vec4( x, y, z, w );
-}
-
-mat4 mat4::operator*( const mat4 &rhs ) {
-	mat4 r = zero_mat4();
-	int r_index = 0;
-	for ( int col = 0; col < 4; col++ ) {
-		for ( int row = 0; row < 4; row++ ) {
-			float sum = 0.0f;
-			for ( int i = 0; i < 4; i++ ) {
-				sum += rhs.m[i + col * 4] * m[row + i * 4];
-			}
-			r.m[r_index] = sum;
-			r_index++;
-		}
-	}
-	return r;
-}
-
-mat4 &mat4::operator=( const mat4 &rhs ) {
-	for ( int i = 0; i < 16; i++ ) {
-		m[i] = rhs.m[i];
-	}
-	return *this;
-}
-
 // returns a scalar value with the determinant for a 4x4 matrix
 // see
 // http://www.euclideanspace.com/maths/algebra/matrix/functions/determinant/fourD/index.htm
@@ -14,6 +14,7 @@
 \******************************************************************************/
 #include "gl_utils.h"
 #include "maths_funcs.h"
+#include "quat_funcs.h"
 #include <GL/glew.h>		// include GLEW and new version of GL on Windows
 #include <GLFW/glfw3.h> // GLFW helper library
 #include <assert.h>
@@ -22,6 +23,7 @@
 #include <assimp/scene.h>				// collects data
 #include <stdio.h>
 #include <stdlib.h>
+#include <vector>
 #define _USE_MATH_DEFINES
 #include <math.h>
 #define GL_LOG_FILE "gl.log"
@@ -31,6 +33,11 @@
 //#define MESH_FILE "Cylinder2.dae"
 /* max bones allowed in a mesh */
 #define MAX_BONES 32
+/* the start-up benchmarks take seconds and lots of memory before the first
+frame, so they only run when this is uncommented */
+//#define RUN_BENCHMARKS
+/* number of versor pairs in the start-up interpolation benchmark */
+#define BENCH_NUM_VERSORS 1000000
 
 /* keep track of window size for things like the viewport and the mouse cursor*/
 int g_gl_width = 640;
@@ -53,6 +60,8 @@ struct Skeleton_Node {
 	int num_pos_keys;
 	int num_rot_keys;
 	int num_sca_keys;
+	/* rotation at the current animation time, from sample_rotations() */
+	versor current_rot;
 
 	/* name of the bone - might be useful to remember for doing interesting stuff
 	in your programme */
@@ -158,6 +167,105 @@ bool import_skeleton_node( aiNode *assimp_node, Skeleton_Node **skeleton_node,
 	return false;
 }
 
+/* nodes that have rotation keys, and for each one the pair of keys either side
+of the current time and how far between them it is. all of the rotations are
+slerped together in one batch before walking the hierarchy */
+std::vector<Skeleton_Node *> g_rot_nodes;
+versor_soa_t g_rot_from, g_rot_to, g_rot_now;
+std::vector<float> g_rot_t;
+
+void collect_rot_nodes( Skeleton_Node *node ) {
+	assert( node );
+	if ( node->num_rot_keys > 0 ) {
+		g_rot_nodes.push_back( node );
+	}
+	for ( int i = 0; i < node->num_children; i++ ) {
+		collect_rot_nodes( node->children[i] );
+	}
+}
+
+/* sets current_rot of every node in g_rot_nodes for time anim_time */
+void sample_rotations( double anim_time ) {
+	int count = (int)g_rot_nodes.size();
+	versor_soa_resize( g_rot_from, count );
+	versor_soa_resize( g_rot_to, count );
+	versor_soa_resize( g_rot_now, count );
+	g_rot_t.resize( count );
+	for ( int n = 0; n < count; n++ ) {
+		Skeleton_Node *node = g_rot_nodes[n];
+		// find next and previous keys
+		int prev_key = 0;
+		int next_key = 0;
+		for ( int i = 0; i < node->num_rot_keys - 1; i++ ) {
+			prev_key = i;
+			next_key = i + 1;
+			if ( node->rot_key_times[next_key] >= anim_time ) {
+				break;
+			}
+		}
+		float total_t = node->rot_key_times[next_key] - node->rot_key_times[prev_key];
+		g_rot_t[n] = 0.0f;
+		if ( total_t > 0.0f ) {
+			g_rot_t[n] = ( anim_time - node->rot_key_times[prev_key] ) / total_t;
+		}
+		versor_soa_set( g_rot_from, n, node->rot_keys[prev_key] );
+		versor_soa_set( g_rot_to, n, node->rot_keys[next_key] );
+	}
+	if ( count > 0 ) {
+		quat_slerp_batch( g_rot_from, g_rot_to, &g_rot_t[0], count, g_rot_now );
+	}
+	for ( int n = 0; n < count; n++ ) {
+		g_rot_nodes[n]->current_rot = versor_soa_get( g_rot_now, n );
+	}
+}
+
+/* times slerp() from maths_funcs against the batch slerp and nlerp on random
+versor pairs, and logs the time per versor and the largest difference in
+rotation angle from slerp() */
+void benchmark_quat_interpolation() {
+	versor_soa_t from, to, out;
+	versor_soa_resize( from, BENCH_NUM_VERSORS );
+	versor_soa_resize( to, BENCH_NUM_VERSORS );
+	versor_soa_resize( out, BENCH_NUM_VERSORS );
+	std::vector<float> t( BENCH_NUM_VERSORS );
+	std::vector<versor> reference( BENCH_NUM_VERSORS );
+	for ( int i = 0; i < BENCH_NUM_VERSORS; i++ ) {
+		versor q = quat_from_axis_deg( (float)( rand() % 360 ), 0.0f, 1.0f, 0.0f );
+		versor r = quat_from_axis_deg( (float)( rand() % 360 ), 1.0f, 0.0f, 0.0f );
+		versor_soa_set( from, i, q );
+		versor_soa_set( to, i, r * q );
+		t[i] = (float)rand() / (float)RAND_MAX;
+	}
+	double start = glfwGetTime();
+	for ( int i = 0; i < BENCH_NUM_VERSORS; i++ ) {
+		versor q = versor_soa_get( from, i );
+		versor r = versor_soa_get( to, i );
+		reference[i] = slerp( q, r, t[i] );
+	}
+	double slerp_ns = ( glfwGetTime() - start ) / BENCH_NUM_VERSORS * 1e9;
+	double batch_ns[2];
+	float max_err_deg[2];
+	for ( int k = 0; k < 2; k++ ) {
+		start = glfwGetTime();
+		if ( 0 == k ) {
+			quat_slerp_batch( from, to, &t[0], BENCH_NUM_VERSORS, out );
+		} else {
+			quat_nlerp_batch( from, to, &t[0], BENCH_NUM_VERSORS, out );
+		}
+		batch_ns[k] = ( glfwGetTime() - start ) / BENCH_NUM_VERSORS * 1e9;
+		// q and -q are the same rotation, so compare with the absolute dot product
+		float min_dot = 1.0f;
+		for ( int i = 0; i < BENCH_NUM_VERSORS; i++ ) {
+			min_dot = fminf( min_dot, fabsf( dot( reference[i], versor_soa_get( out, i ) ) ) );
+		}
+		max_err_deg[k] = 2.0f * acosf( fminf( min_dot, 1.0f ) ) * ONE_RAD_IN_DEG;
+	}
+	gl_log( "interpolating %i versors: slerp() %.2fns, batch slerp %.2fns (max error "
+					"%f deg), batch nlerp %.2fns (max difference %f deg)\n",
+					BENCH_NUM_VERSORS, slerp_ns, batch_ns[0], max_err_deg[0], batch_ns[1],
+					max_err_deg[1] );
+}
+
 /* recursive animation using hierarchy. animate node, children inherit
 animation */
 void skeleton_animate( Skeleton_Node *node, double anim_time, mat4 parent_mat,
@@ -195,22 +303,7 @@ void skeleton_animate( Skeleton_Node *node, double anim_time, mat4 parent_mat,
 
 	mat4 node_R = identity_mat4();
 	if ( node->num_rot_keys > 0 ) {
-		// find next and previous keys
-		int prev_key = 0;
-		int next_key = 0;
-		for ( int i = 0; i < node->num_rot_keys - 1; i++ ) {
-			prev_key = i;
-			next_key = i + 1;
-			if ( node->rot_key_times[next_key] >= anim_time ) {
-				break;
-			}
-		}
-		float total_t = node->rot_key_times[next_key] - node->rot_key_times[prev_key];
-		float t = ( anim_time - node->rot_key_times[prev_key] ) / total_t;
-		versor qi = node->rot_keys[prev_key];
-		versor qf = node->rot_keys[next_key];
-		versor slerped = slerp( qi, qf, t );
-		node_R = quat_to_mat4( slerped );
+		node_R = quat_to_mat4( node->current_rot );
 	}
 
 	local_anim = node_T * node_R;
@@ -499,6 +592,10 @@ int main() {
 										 monkey_bone_offset_matrices, &monkey_bone_count,
 										 &monkey_root_node, &monkey_anim_duration ) );
 	printf( "monkey bone count %i\n", monkey_bone_count );
+	collect_rot_nodes( monkey_root_node );
+#ifdef RUN_BENCHMARKS
+	benchmark_quat_interpolation();
+#endif
 
 	/* create a buffer of bone positions for visualising the bones */
 	float bone_positions[3 * 256];
@@ -661,6 +758,7 @@ int main() {
 			glUseProgram( bones_shader_programme );
 			glUniformMatrix4fv( bones_view_mat_location, 1, GL_FALSE, view_mat.m );
 		}
+		sample_rotations( anim_time );
 		skeleton_animate( monkey_root_node, anim_time, identity_mat4(),
 											monkey_bone_offset_matrices, monkey_bone_animation_mats );
 		glUseProgram( shader_programme );
@@ -0,0 +1,292 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| More quaternion functions. See quat_funcs.h                                  |
+\******************************************************************************/
+#include "quat_funcs.h"
+#include <math.h>
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define QUAT_FUNCS_SSE
+#endif
+
+/* below this sin(angle) slerp's divide gets inaccurate, and a straight lerp
+is just as good */
+#define SLERP_MIN_SIN 0.001f
+
+void versor_soa_resize( versor_soa_t &soa, int count ) {
+	soa.w.resize( count );
+	soa.x.resize( count );
+	soa.y.resize( count );
+	soa.z.resize( count );
+}
+
+void versor_soa_set( versor_soa_t &soa, int i, const versor &q ) {
+	soa.w[i] = q.q[0];
+	soa.x[i] = q.q[1];
+	soa.y[i] = q.q[2];
+	soa.z[i] = q.q[3];
+}
+
+versor versor_soa_get( const versor_soa_t &soa, int i ) {
+	versor q;
+	q.q[0] = soa.w[i];
+	q.q[1] = soa.x[i];
+	q.q[2] = soa.y[i];
+	q.q[3] = soa.z[i];
+	return q;
+}
+
+/*--------------------------------POLYNOMIALS---------------------------------*/
+/* acos(x) for x in 0 to 1, from Abramowitz and Stegun 4.4.46. max error 2e-8 */
+static float acos_poly( float x ) {
+	float p = -0.0012624911f;
+	p = p * x + 0.0066700901f;
+	p = p * x - 0.0170881256f;
+	p = p * x + 0.0308918810f;
+	p = p * x - 0.0501743046f;
+	p = p * x + 0.0889789874f;
+	p = p * x - 0.2145988016f;
+	p = p * x + 1.5707963050f;
+	return sqrtf( 1.0f - x ) * p;
+}
+
+/* sin(x) for x in 0 to pi/2, Taylor series to x^11. max error 6e-8 */
+static float sin_poly( float x ) {
+	float x2 = x * x;
+	float p = -2.5052108e-8f;
+	p = p * x2 + 2.7557319e-6f;
+	p = p * x2 - 1.9841270e-4f;
+	p = p * x2 + 8.3333333e-3f;
+	p = p * x2 - 1.6666667e-1f;
+	p = p * x2 + 1.0f;
+	return p * x;
+}
+
+/* weights a, b so that slerp = q * a + r * b, where cos_half_theta = dot( q, r )
+is already made positive */
+static void slerp_weights( float cos_half_theta, float t, float &a, float &b ) {
+	float sin_half_theta = sqrtf( fmaxf( 1.0f - cos_half_theta * cos_half_theta, 0.0f ) );
+	if ( sin_half_theta < SLERP_MIN_SIN ) {
+		a = 1.0f - t;
+		b = t;
+		return;
+	}
+	float half_theta = acos_poly( fminf( cos_half_theta, 1.0f ) );
+	a = sin_poly( ( 1.0f - t ) * half_theta ) / sin_half_theta;
+	b = sin_poly( t * half_theta ) / sin_half_theta;
+}
+
+/*----------------------------------SCALAR------------------------------------*/
+/* q, negated if needed to take the short way around to r. returns the dot
+product of the two after that */
+static float shortest_path( const versor &q, const versor &r, versor &q_near ) {
+	float d = ( q.q[0] * r.q[0] + q.q[1] * r.q[1] ) + ( q.q[2] * r.q[2] + q.q[3] * r.q[3] );
+	float sign = d < 0.0f ? -1.0f : 1.0f;
+	for ( int i = 0; i < 4; i++ ) {
+		q_near.q[i] = q.q[i] * sign;
+	}
+	return d * sign;
+}
+
+versor slerp_shortest( const versor &q, const versor &r, float t ) {
+	versor q_near;
+	float c = shortest_path( q, r, q_near );
+	float a, b;
+	slerp_weights( c, t, a, b );
+	versor result;
+	for ( int i = 0; i < 4; i++ ) {
+		result.q[i] = q_near.q[i] * a + r.q[i] * b;
+	}
+	return result;
+}
+
+versor nlerp( const versor &q, const versor &r, float t ) {
+	versor q_near;
+	shortest_path( q, r, q_near );
+	versor result;
+	for ( int i = 0; i < 4; i++ ) {
+		result.q[i] = q_near.q[i] * ( 1.0f - t ) + r.q[i] * t;
+	}
+	float len = sqrtf( ( result.q[0] * result.q[0] + result.q[1] * result.q[1] ) +
+										 ( result.q[2] * result.q[2] + result.q[3] * result.q[3] ) );
+	for ( int i = 0; i < 4; i++ ) {
+		result.q[i] = result.q[i] / len;
+	}
+	return result;
+}
+
+/*-----------------------------------BATCH------------------------------------*/
+#ifdef QUAT_FUNCS_SSE
+/* from components of 4 versors, negated where needed to take the short way
+around to the to components. returns the dot products after that */
+static __m128 shortest_path_4( __m128 &fw, __m128 &fx, __m128 &fy, __m128 &fz, __m128 tw,
+															 __m128 tx, __m128 ty, __m128 tz ) {
+	__m128 d = _mm_add_ps( _mm_add_ps( _mm_mul_ps( fw, tw ), _mm_mul_ps( fx, tx ) ),
+												 _mm_add_ps( _mm_mul_ps( fy, ty ), _mm_mul_ps( fz, tz ) ) );
+	__m128 sign = _mm_and_ps( d, _mm_set1_ps( -0.0f ) );
+	fw = _mm_xor_ps( fw, sign );
+	fx = _mm_xor_ps( fx, sign );
+	fy = _mm_xor_ps( fy, sign );
+	fz = _mm_xor_ps( fz, sign );
+	return _mm_xor_ps( d, sign );
+}
+
+/* if mask then a else b */
+static __m128 select_ps( __m128 mask, __m128 a, __m128 b ) {
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+
+static __m128 acos_poly_4( __m128 x ) {
+	__m128 p = _mm_set1_ps( -0.0012624911f );
+	p = _mm_add_ps( _mm_mul_ps( p, x ), _mm_set1_ps( 0.0066700901f ) );
+	p = _mm_sub_ps( _mm_mul_ps( p, x ), _mm_set1_ps( 0.0170881256f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, x ), _mm_set1_ps( 0.0308918810f ) );
+	p = _mm_sub_ps( _mm_mul_ps( p, x ), _mm_set1_ps( 0.0501743046f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, x ), _mm_set1_ps( 0.0889789874f ) );
+	p = _mm_sub_ps( _mm_mul_ps( p, x ), _mm_set1_ps( 0.2145988016f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, x ), _mm_set1_ps( 1.5707963050f ) );
+	return _mm_mul_ps( _mm_sqrt_ps( _mm_sub_ps( _mm_set1_ps( 1.0f ), x ) ), p );
+}
+
+static __m128 sin_poly_4( __m128 x ) {
+	__m128 x2 = _mm_mul_ps( x, x );
+	__m128 p = _mm_set1_ps( -2.5052108e-8f );
+	p = _mm_add_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( 2.7557319e-6f ) );
+	p = _mm_sub_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( 1.9841270e-4f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( 8.3333333e-3f ) );
+	p = _mm_sub_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( 1.6666667e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( 1.0f ) );
+	return _mm_mul_ps( p, x );
+}
+#endif
+
+void quat_slerp_batch( const versor_soa_t &from, const versor_soa_t &to, const float *t,
+											 int count, versor_soa_t &out ) {
+	int i = 0;
+#ifdef QUAT_FUNCS_SSE
+	__m128 one = _mm_set1_ps( 1.0f );
+	for ( ; i + 4 <= count; i += 4 ) {
+		__m128 fw = _mm_loadu_ps( &from.w[i] ), fx = _mm_loadu_ps( &from.x[i] );
+		__m128 fy = _mm_loadu_ps( &from.y[i] ), fz = _mm_loadu_ps( &from.z[i] );
+		__m128 tw = _mm_loadu_ps( &to.w[i] ), tx = _mm_loadu_ps( &to.x[i] );
+		__m128 ty = _mm_loadu_ps( &to.y[i] ), tz = _mm_loadu_ps( &to.z[i] );
+		__m128 tt = _mm_loadu_ps( &t[i] );
+		__m128 c = shortest_path_4( fw, fx, fy, fz, tw, tx, ty, tz );
+
+		// same steps as slerp_weights(), with the lerp case picked per lane
+		__m128 s = _mm_sqrt_ps( _mm_max_ps( _mm_sub_ps( one, _mm_mul_ps( c, c ) ), _mm_setzero_ps() ) );
+		__m128 half_theta = acos_poly_4( _mm_min_ps( c, one ) );
+		__m128 one_minus_t = _mm_sub_ps( one, tt );
+		__m128 use_lerp = _mm_cmplt_ps( s, _mm_set1_ps( SLERP_MIN_SIN ) );
+		// stops the divide in lanes that don't use it from producing inf
+		__m128 safe_s = select_ps( use_lerp, one, s );
+		__m128 a = _mm_div_ps( sin_poly_4( _mm_mul_ps( one_minus_t, half_theta ) ), safe_s );
+		__m128 b = _mm_div_ps( sin_poly_4( _mm_mul_ps( tt, half_theta ) ), safe_s );
+		a = select_ps( use_lerp, one_minus_t, a );
+		b = select_ps( use_lerp, tt, b );
+
+		_mm_storeu_ps( &out.w[i], _mm_add_ps( _mm_mul_ps( fw, a ), _mm_mul_ps( tw, b ) ) );
+		_mm_storeu_ps( &out.x[i], _mm_add_ps( _mm_mul_ps( fx, a ), _mm_mul_ps( tx, b ) ) );
+		_mm_storeu_ps( &out.y[i], _mm_add_ps( _mm_mul_ps( fy, a ), _mm_mul_ps( ty, b ) ) );
+		_mm_storeu_ps( &out.z[i], _mm_add_ps( _mm_mul_ps( fz, a ), _mm_mul_ps( tz, b ) ) );
+	}
+#endif
+	for ( ; i < count; i++ ) {
+		versor_soa_set( out, i, slerp_shortest( versor_soa_get( from, i ), versor_soa_get( to, i ), t[i] ) );
+	}
+}
+
+void quat_nlerp_batch( const versor_soa_t &from, const versor_soa_t &to, const float *t,
+											 int count, versor_soa_t &out ) {
+	int i = 0;
+#ifdef QUAT_FUNCS_SSE
+	__m128 one = _mm_set1_ps( 1.0f );
+	for ( ; i + 4 <= count; i += 4 ) {
+		__m128 fw = _mm_loadu_ps( &from.w[i] ), fx = _mm_loadu_ps( &from.x[i] );
+		__m128 fy = _mm_loadu_ps( &from.y[i] ), fz = _mm_loadu_ps( &from.z[i] );
+		__m128 tw = _mm_loadu_ps( &to.w[i] ), tx = _mm_loadu_ps( &to.x[i] );
+		__m128 ty = _mm_loadu_ps( &to.y[i] ), tz = _mm_loadu_ps( &to.z[i] );
+		__m128 b = _mm_loadu_ps( &t[i] );
+		shortest_path_4( fw, fx, fy, fz, tw, tx, ty, tz );
+		__m128 a = _mm_sub_ps( one, b );
+		__m128 w = _mm_add_ps( _mm_mul_ps( fw, a ), _mm_mul_ps( tw, b ) );
+		__m128 x = _mm_add_ps( _mm_mul_ps( fx, a ), _mm_mul_ps( tx, b ) );
+		__m128 y = _mm_add_ps( _mm_mul_ps( fy, a ), _mm_mul_ps( ty, b ) );
+		__m128 z = _mm_add_ps( _mm_mul_ps( fz, a ), _mm_mul_ps( tz, b ) );
+		__m128 len = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( w, w ), _mm_mul_ps( x, x ) ),
+																					_mm_add_ps( _mm_mul_ps( y, y ), _mm_mul_ps( z, z ) ) ) );
+		_mm_storeu_ps( &out.w[i], _mm_div_ps( w, len ) );
+		_mm_storeu_ps( &out.x[i], _mm_div_ps( x, len ) );
+		_mm_storeu_ps( &out.y[i], _mm_div_ps( y, len ) );
+		_mm_storeu_ps( &out.z[i], _mm_div_ps( z, len ) );
+	}
+#endif
+	for ( ; i < count; i++ ) {
+		versor_soa_set( out, i, nlerp( versor_soa_get( from, i ), versor_soa_get( to, i ), t[i] ) );
+	}
+}
+
+/*--------------------------------CONVERSIONS---------------------------------*/
+mat3 quat_to_mat3( const versor &q ) {
+	float w = q.q[0];
+	float x = q.q[1];
+	float y = q.q[2];
+	float z = q.q[3];
+	// same as quat_to_mat4() in maths_funcs, in columns
+	return mat3( 1.0f - 2.0f * y * y - 2.0f * z * z, 2.0f * x * y + 2.0f * w * z,
+							 2.0f * x * z - 2.0f * w * y, 2.0f * x * y - 2.0f * w * z,
+							 1.0f - 2.0f * x * x - 2.0f * z * z, 2.0f * y * z + 2.0f * w * x,
+							 2.0f * x * z + 2.0f * w * y, 2.0f * y * z - 2.0f * w * x,
+							 1.0f - 2.0f * x * x - 2.0f * y * y );
+}
+
+/* Shepperd's method: find the largest of w, x, y, z from the diagonal first,
+and divide by that one, so there's never a divide by something near zero.
+mRC is row R, column C of the rotation */
+static versor rotation_to_quat( float m00, float m01, float m02, float m10, float m11,
+																float m12, float m20, float m21, float m22 ) {
+	versor q;
+	float trace = m00 + m11 + m22;
+	if ( trace > 0.0f ) {
+		float s = sqrtf( trace + 1.0f ) * 2.0f; // 4w
+		q.q[0] = 0.25f * s;
+		q.q[1] = ( m21 - m12 ) / s;
+		q.q[2] = ( m02 - m20 ) / s;
+		q.q[3] = ( m10 - m01 ) / s;
+	} else if ( m00 > m11 && m00 > m22 ) {
+		float s = sqrtf( 1.0f + m00 - m11 - m22 ) * 2.0f; // 4x
+		q.q[0] = ( m21 - m12 ) / s;
+		q.q[1] = 0.25f * s;
+		q.q[2] = ( m01 + m10 ) / s;
+		q.q[3] = ( m02 + m20 ) / s;
+	} else if ( m11 > m22 ) {
+		float s = sqrtf( 1.0f + m11 - m00 - m22 ) * 2.0f; // 4y
+		q.q[0] = ( m02 - m20 ) / s;
+		q.q[1] = ( m01 + m10 ) / s;
+		q.q[2] = 0.25f * s;
+		q.q[3] = ( m12 + m21 ) / s;
+	} else {
+		float s = sqrtf( 1.0f + m22 - m00 - m11 ) * 2.0f; // 4z
+		q.q[0] = ( m10 - m01 ) / s;
+		q.q[1] = ( m02 + m20 ) / s;
+		q.q[2] = ( m12 + m21 ) / s;
+		q.q[3] = 0.25f * s;
+	}
+	return q;
+}
+
+versor mat3_to_quat( const mat3 &m ) {
+	return rotation_to_quat( m.m[0], m.m[3], m.m[6], m.m[1], m.m[4], m.m[7], m.m[2], m.m[5],
+													 m.m[8] );
+}
+
+versor mat4_to_quat( const mat4 &m ) {
+	return rotation_to_quat( m.m[0], m.m[4], m.m[8], m.m[1], m.m[5], m.m[9], m.m[2], m.m[6],
+													 m.m[10] );
+}
@@ -0,0 +1,53 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| More quaternion functions                                                    |
+| Conversion between versors and rotation matrices, and interpolation of a     |
+| whole batch of versors at once - e.g. every bone of a skeleton each frame.   |
+| Batches are stored one array per component so that SSE can do 4 at a time.   |
+| acos() and sin() are replaced by polynomials, accurate to about 1e-7 over    |
+| the range slerp needs; each component of a result is within 5e-5, and its    |
+| rotation within 1e-4 degrees, of a double-precision slerp. Both kernels take |
+| the short way around.                                                        |
+\******************************************************************************/
+#ifndef _QUAT_FUNCS_H_
+#define _QUAT_FUNCS_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+/* a batch of versors. w is the real part, same as versor::q[0] */
+struct versor_soa_t {
+	std::vector<float> w, x, y, z;
+};
+
+void versor_soa_resize( versor_soa_t &soa, int count );
+void versor_soa_set( versor_soa_t &soa, int i, const versor &q );
+versor versor_soa_get( const versor_soa_t &soa, int i );
+
+/* out[i] = interpolation from from[i] at t[i] = 0 to to[i] at t[i] = 1, for
+count versors. out must already have room for count. out can be from or to */
+void quat_slerp_batch( const versor_soa_t &from, const versor_soa_t &to, const float *t,
+											 int count, versor_soa_t &out );
+/* normalised linear interpolation. cheaper than slerp but the speed of
+rotation isn't constant across t, which is fine for closely-spaced key frames */
+void quat_nlerp_batch( const versor_soa_t &from, const versor_soa_t &to, const float *t,
+											 int count, versor_soa_t &out );
+
+/* single-versor versions that don't modify their inputs. these give exactly
+the same results as the batch functions */
+versor slerp_shortest( const versor &q, const versor &r, float t );
+versor nlerp( const versor &q, const versor &r, float t );
+
+/* q must be unit length */
+mat3 quat_to_mat3( const versor &q );
+/* m must be a pure rotation. for a mat4 only the top-left 3x3 is used */
+versor mat3_to_quat( const mat3 &m );
+versor mat4_to_quat( const mat4 &m );
+
+#endif
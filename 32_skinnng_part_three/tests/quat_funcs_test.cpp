@@ -0,0 +1,217 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Quaternion function tests                                                    |
+| Checks the batch slerp, with its acos() and sin() polynomials, against       |
+| slerp() from maths_funcs and a double-precision slerp: for random versor     |
+| pairs, nearly the same rotation, nearly opposite versors, and rotations      |
+| nearly 180 degrees apart. Also checks that the batch kernels match their     |
+| single-versor versions and that versor-matrix conversions go both ways.      |
+| Build and run with "make -f Makefile.linux64 test".                          |
+\******************************************************************************/
+#include "quat_funcs.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// not a multiple of 4, so the scalar tail of the batch runs too
+#define TEST_PAIRS 100003
+// largest angle allowed between the batch slerp's rotation and the reference's
+#define TEST_MAX_ERROR_DEG 1e-4
+// largest difference allowed in any component from a double-precision slerp
+#define TEST_MAX_COMPONENT_ERROR 5e-5
+
+static int g_failures = 0;
+
+#define CHECK( cond )                                                         \
+	do {                                                                        \
+		if ( !( cond ) ) {                                                        \
+			fprintf( stderr, "FAILED %s:%i: %s\n", __FILE__, __LINE__, #cond );     \
+			g_failures++;                                                           \
+		}                                                                         \
+	} while ( 0 )
+
+enum pair_kind_t { PAIRS_RANDOM, PAIRS_NEAR_PARALLEL, PAIRS_NEAR_ANTIPODAL, PAIRS_NEAR_180_DEG };
+
+static float random_float( float lo, float hi ) {
+	return lo + ( hi - lo ) * (float)rand() / (float)RAND_MAX;
+}
+
+/* evenly spread over all rotations */
+static versor random_versor() {
+	versor q;
+	float len_sq;
+	do {
+		for ( int i = 0; i < 4; i++ ) {
+			q.q[i] = random_float( -1.0f, 1.0f );
+		}
+		len_sq = q.q[0] * q.q[0] + q.q[1] * q.q[1] + q.q[2] * q.q[2] + q.q[3] * q.q[3];
+	} while ( len_sq > 1.0f || len_sq < 0.01f );
+	return q / sqrtf( len_sq );
+}
+
+/* a rotation by radians about a random axis */
+static versor random_turn( float radians ) {
+	vec3 axis;
+	do {
+		axis = vec3( random_float( -1.0f, 1.0f ), random_float( -1.0f, 1.0f ),
+								 random_float( -1.0f, 1.0f ) );
+	} while ( length2( axis ) > 1.0f || length2( axis ) < 0.01f );
+	axis = normalise( axis );
+	return quat_from_axis_rad( radians, axis.v[0], axis.v[1], axis.v[2] );
+}
+
+/* angle in degrees between the rotations of two versors, which needn't be
+unit length. q and -q are the same rotation. worked out in double from the
+sine and cosine, as acos() of a float near 1 can't tell small angles apart */
+static double rotation_angle_deg( const versor &a, const versor &b ) {
+	double d = 0.0, aa = 0.0, bb = 0.0;
+	for ( int i = 0; i < 4; i++ ) {
+		d += (double)a.q[i] * b.q[i];
+		aa += (double)a.q[i] * a.q[i];
+		bb += (double)b.q[i] * b.q[i];
+	}
+	double s = sqrt( fmax( aa * bb - d * d, 0.0 ) );
+	return 2.0 * atan2( s, fabs( d ) ) * 180.0 / M_PI;
+}
+
+/* slerp the short way around in double, with the same straight lerp as
+slerp() where the two are too close for the divide */
+static void slerp_double( const versor &q, const versor &r, float t, double *out ) {
+	double c = 0.0;
+	for ( int i = 0; i < 4; i++ ) {
+		c += (double)q.q[i] * r.q[i];
+	}
+	double sign = c < 0.0 ? -1.0 : 1.0;
+	c *= sign;
+	double s = sqrt( fmax( 1.0 - c * c, 0.0 ) );
+	double a = 1.0 - t, b = t;
+	if ( s >= 0.001 ) {
+		double half_theta = acos( fmin( c, 1.0 ) );
+		a = sin( ( 1.0 - t ) * half_theta ) / s;
+		b = sin( t * half_theta ) / s;
+	}
+	for ( int i = 0; i < 4; i++ ) {
+		out[i] = sign * q.q[i] * a + r.q[i] * b;
+	}
+}
+
+/* slerps TEST_PAIRS pairs of one kind in a batch and one at a time */
+static void test_slerp( pair_kind_t kind, const char *name ) {
+	versor_soa_t from, to, out, out_nlerp;
+	versor_soa_resize( from, TEST_PAIRS );
+	versor_soa_resize( to, TEST_PAIRS );
+	versor_soa_resize( out, TEST_PAIRS );
+	versor_soa_resize( out_nlerp, TEST_PAIRS );
+	std::vector<float> t( TEST_PAIRS );
+	for ( int i = 0; i < TEST_PAIRS; i++ ) {
+		versor q = random_versor();
+		versor r;
+		// on both sides of where slerp switches to a straight lerp
+		float small = powf( 10.0f, random_float( -6.0f, -1.0f ) );
+		switch ( kind ) {
+		case PAIRS_NEAR_PARALLEL: r = random_turn( small ) * q; break;
+		case PAIRS_NEAR_ANTIPODAL: r = random_turn( small ) * q * -1.0f; break;
+		case PAIRS_NEAR_180_DEG: r = random_turn( (float)M_PI - small ) * q; break;
+		default: r = random_versor(); break;
+		}
+		versor_soa_set( from, i, q );
+		versor_soa_set( to, i, r );
+		t[i] = i % 8 == 0 ? 0.0f : ( i % 8 == 1 ? 1.0f : random_float( 0.0f, 1.0f ) );
+	}
+	quat_slerp_batch( from, to, &t[0], TEST_PAIRS, out );
+	quat_nlerp_batch( from, to, &t[0], TEST_PAIRS, out_nlerp );
+
+	double max_error_deg = 0.0, max_slerp_error_deg = 0.0, max_component_error = 0.0;
+	int batch_matches = 0, nlerp_matches = 0;
+	for ( int i = 0; i < TEST_PAIRS; i++ ) {
+		versor q = versor_soa_get( from, i ), r = versor_soa_get( to, i );
+		versor result = versor_soa_get( out, i );
+
+		/* nearly 180 degrees apart, float and double may go around opposite ways,
+		which gives the same rotation with the opposite sign */
+		double reference[4];
+		slerp_double( q, r, t[i], reference );
+		versor reference_f;
+		double same = 0.0, opposite = 0.0;
+		for ( int k = 0; k < 4; k++ ) {
+			reference_f.q[k] = (float)reference[k];
+			same = fmax( same, fabs( result.q[k] - reference[k] ) );
+			opposite = fmax( opposite, fabs( result.q[k] + reference[k] ) );
+		}
+		max_component_error = fmax( max_component_error, fmin( same, opposite ) );
+		max_error_deg = fmax( max_error_deg, rotation_angle_deg( result, reference_f ) );
+
+		/* slerp() gives back q whatever t is when their dot product rounds to 1,
+		which can be a few hundredths of a degree out, so those pairs are only
+		checked against the double slerp. it also negates q in place */
+		if ( fabsf( dot( q, r ) ) < 1.0f ) {
+			versor q_copy = q, r_copy = r;
+			max_slerp_error_deg =
+				fmax( max_slerp_error_deg, rotation_angle_deg( result, slerp( q_copy, r_copy, t[i] ) ) );
+		}
+
+		versor single = slerp_shortest( q, r, t[i] );
+		versor single_nlerp = nlerp( q, r, t[i] );
+		versor batch_nlerp = versor_soa_get( out_nlerp, i );
+		bool match = true, match_nlerp = true;
+		for ( int k = 0; k < 4; k++ ) {
+			match = match && single.q[k] == result.q[k];
+			match_nlerp = match_nlerp && single_nlerp.q[k] == batch_nlerp.q[k];
+		}
+		batch_matches += match ? 1 : 0;
+		nlerp_matches += match_nlerp ? 1 : 0;
+	}
+	printf( "%s: largest angle from a double slerp %g deg, from slerp() %g deg, largest "
+					"component error %g\n",
+					name, max_error_deg, max_slerp_error_deg, max_component_error );
+	CHECK( max_error_deg <= TEST_MAX_ERROR_DEG );
+	CHECK( max_slerp_error_deg <= TEST_MAX_ERROR_DEG );
+	CHECK( max_component_error <= TEST_MAX_COMPONENT_ERROR );
+	CHECK( TEST_PAIRS == batch_matches );
+	CHECK( TEST_PAIRS == nlerp_matches );
+}
+
+/* versor to matrix and back gives the same rotation, and the matrix agrees
+with quat_to_mat4() from maths_funcs */
+static void test_conversions() {
+	double max_error_deg = 0.0;
+	float max_matrix_diff = 0.0f;
+	for ( int i = 0; i < 10000; i++ ) {
+		// include turns of nearly 180 degrees, where w is nearly 0
+		versor q = i % 2 ? random_versor() : random_turn( (float)M_PI - random_float( 0.0f, 1e-3f ) );
+		mat3 m3 = quat_to_mat3( q );
+		mat4 m4 = quat_to_mat4( q );
+		for ( int c = 0; c < 3; c++ ) {
+			for ( int r = 0; r < 3; r++ ) {
+				max_matrix_diff = fmaxf( max_matrix_diff, fabsf( m3.m[c * 3 + r] - m4.m[c * 4 + r] ) );
+			}
+		}
+		max_error_deg = fmax( max_error_deg, rotation_angle_deg( q, mat3_to_quat( m3 ) ) );
+		max_error_deg = fmax( max_error_deg, rotation_angle_deg( q, mat4_to_quat( m4 ) ) );
+	}
+	printf( "conversions: largest round-trip angle %g deg, matrix difference %g\n", max_error_deg,
+					max_matrix_diff );
+	CHECK( max_error_deg <= 0.01 );
+	CHECK( max_matrix_diff <= 1e-6f );
+}
+
+int main() {
+	srand( 1 );
+	test_slerp( PAIRS_RANDOM, "random pairs" );
+	test_slerp( PAIRS_NEAR_PARALLEL, "nearly the same rotation" );
+	test_slerp( PAIRS_NEAR_ANTIPODAL, "nearly opposite versors" );
+	test_slerp( PAIRS_NEAR_180_DEG, "nearly 180 degrees apart" );
+	test_conversions();
+	if ( g_failures ) {
+		fprintf( stderr, "%i checks failed\n", g_failures );
+		return 1;
+	}
+	printf( "quat_funcs_test passed\n" );
+	return 0;
+}
@@ -0,0 +1,262 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU rasteriser for the picking ID buffer. See id_raster.h                    |
+\******************************************************************************/
+#include "id_raster.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <math.h>
+#include <thread>
+
+/* a triangle after transform, clipping, and viewport mapping. x and y are in
+buffer pixels, z is window-space depth */
+struct screen_tri_t {
+	float x[3], y[3], z[3];
+	unsigned int id;
+};
+
+/* runs func( thread_index ) on thread_count threads, including this one */
+static void run_on_threads( int thread_count, const std::function<void( int )> &func ) {
+	std::vector<std::thread> threads;
+	for ( int t = 1; t < thread_count; t++ ) {
+		threads.push_back( std::thread( func, t ) );
+	}
+	func( 0 );
+	for ( size_t t = 0; t < threads.size(); t++ ) {
+		threads[t].join();
+	}
+}
+
+void id_buffer_resize( id_buffer_t &buffer, int width, int height ) {
+	buffer.width = width;
+	buffer.height = height;
+	buffer.depths.resize( width * height );
+	buffer.ids.resize( width * height );
+}
+
+/* clip a triangle against the near plane (z >= -w in clip space), the only
+plane where skipping clipping breaks the perspective divide. the others are
+handled by clamping to the buffer. writes up to 4 polygon vertices */
+static int clip_near( const vec4 in[3], vec4 out[4] ) {
+	int n = 0;
+	for ( int i = 0; i < 3; i++ ) {
+		const vec4 &a = in[i];
+		const vec4 &b = in[( i + 1 ) % 3];
+		float da = a.v[2] + a.v[3];
+		float db = b.v[2] + b.v[3];
+		if ( da >= 0.0f ) {
+			out[n++] = a;
+		}
+		if ( ( da >= 0.0f ) != ( db >= 0.0f ) ) {
+			float t = da / ( da - db );
+			out[n++] = vec4( a.v[0] + ( b.v[0] - a.v[0] ) * t, a.v[1] + ( b.v[1] - a.v[1] ) * t,
+											 a.v[2] + ( b.v[2] - a.v[2] ) * t, a.v[3] + ( b.v[3] - a.v[3] ) * t );
+		}
+	}
+	return n;
+}
+
+/* transform, clip and project one triangle, appending 0-2 screen triangles */
+static void setup_triangle( const id_buffer_t &buffer, const mat4 &PVM,
+														const float *p, unsigned int id,
+														std::vector<screen_tri_t> &out ) {
+	vec4 clip[3];
+	for ( int i = 0; i < 3; i++ ) {
+		const float *q = p + i * 3;
+		for ( int r = 0; r < 4; r++ ) {
+			clip[i].v[r] = PVM.m[r] * q[0] + PVM.m[4 + r] * q[1] + PVM.m[8 + r] * q[2] +
+										 PVM.m[12 + r];
+		}
+	}
+	vec4 poly[4];
+	int n = clip_near( clip, poly );
+	if ( n < 3 ) {
+		return;
+	}
+	float sx[4], sy[4], sz[4];
+	for ( int i = 0; i < n; i++ ) {
+		float inv_w = 1.0f / poly[i].v[3];
+		sx[i] = ( poly[i].v[0] * inv_w * 0.5f + 0.5f ) * buffer.width;
+		sy[i] = ( poly[i].v[1] * inv_w * 0.5f + 0.5f ) * buffer.height;
+		sz[i] = poly[i].v[2] * inv_w * 0.5f + 0.5f;
+	}
+	// fan-triangulate the clipped polygon
+	for ( int i = 1; i + 1 < n; i++ ) {
+		screen_tri_t tri;
+		int idx[3] = { 0, i, i + 1 };
+		for ( int k = 0; k < 3; k++ ) {
+			tri.x[k] = sx[idx[k]];
+			tri.y[k] = sy[idx[k]];
+			tri.z[k] = sz[idx[k]];
+		}
+		tri.id = id;
+		out.push_back( tri );
+	}
+}
+
+/* edge function. positive if p is to the left of a->b */
+static inline float edge( float ax, float ay, float bx, float by, float px, float py ) {
+	return ( bx - ax ) * ( py - ay ) - ( by - ay ) * ( px - ax );
+}
+
+/* GL's top-left fill rule: a pixel centre exactly on an edge belongs to the
+triangle only if it is a top or left edge, so shared edges are drawn once */
+static inline bool is_top_left( float ax, float ay, float bx, float by ) {
+	return ( ay == by && bx < ax ) || ( by < ay );
+}
+
+/* rasterise one triangle, restricted to one tile's pixel rectangle */
+static void raster_tri_in_tile( id_buffer_t &buffer, const screen_tri_t &t,
+																int tx0, int ty0, int tx1, int ty1 ) {
+	float x0 = t.x[0], y0 = t.y[0];
+	float x1 = t.x[1], y1 = t.y[1];
+	float x2 = t.x[2], y2 = t.y[2];
+	float z0 = t.z[0], z1 = t.z[1], z2 = t.z[2];
+	float area = edge( x0, y0, x1, y1, x2, y2 );
+	if ( 0.0f == area ) {
+		return;
+	}
+	// GL draws both windings unless culling is on, so make every triangle CCW
+	if ( area < 0.0f ) {
+		std::swap( x1, x2 );
+		std::swap( y1, y2 );
+		std::swap( z1, z2 );
+		area = -area;
+	}
+	int min_x = std::max( tx0, (int)floorf( std::min( x0, std::min( x1, x2 ) ) ) );
+	int max_x = std::min( tx1 - 1, (int)ceilf( std::max( x0, std::max( x1, x2 ) ) ) );
+	int min_y = std::max( ty0, (int)floorf( std::min( y0, std::min( y1, y2 ) ) ) );
+	int max_y = std::min( ty1 - 1, (int)ceilf( std::max( y0, std::max( y1, y2 ) ) ) );
+	bool tl0 = is_top_left( x1, y1, x2, y2 );
+	bool tl1 = is_top_left( x2, y2, x0, y0 );
+	bool tl2 = is_top_left( x0, y0, x1, y1 );
+	float inv_area = 1.0f / area;
+	for ( int y = min_y; y <= max_y; y++ ) {
+		float py = (float)y + 0.5f;
+		float *depth_row = &buffer.depths[y * buffer.width];
+		unsigned int *id_row = &buffer.ids[y * buffer.width];
+		for ( int x = min_x; x <= max_x; x++ ) {
+			float px = (float)x + 0.5f;
+			float w0 = edge( x1, y1, x2, y2, px, py );
+			float w1 = edge( x2, y2, x0, y0, px, py );
+			float w2 = edge( x0, y0, x1, y1, px, py );
+			if ( w0 < 0.0f || w1 < 0.0f || w2 < 0.0f ) {
+				continue;
+			}
+			if ( ( 0.0f == w0 && !tl0 ) || ( 0.0f == w1 && !tl1 ) || ( 0.0f == w2 && !tl2 ) ) {
+				continue;
+			}
+			float z = ( w0 * z0 + w1 * z1 + w2 * z2 ) * inv_area;
+			// GL_LESS, and depth is clamped to the far plane like GL
+			if ( z < 0.0f || z >= depth_row[x] ) {
+				continue;
+			}
+			depth_row[x] = z;
+			id_row[x] = t.id;
+		}
+	}
+}
+
+void id_raster_draw( id_buffer_t &buffer, const mat4 &P, const mat4 &V,
+										 const id_raster_draw_t *draws, int draw_count, int thread_count ) {
+	if ( thread_count < 1 ) {
+		thread_count = 1;
+	}
+	// combined matrix for each draw, and where its triangles start in the
+	// overall list so that threads can split the list evenly
+	std::vector<mat4> PVMs( draw_count );
+	std::vector<int> first_tri( draw_count + 1, 0 );
+	mat4 PV = P;
+	PV = PV * V;
+	for ( int d = 0; d < draw_count; d++ ) {
+		mat4 M = draws[d].M;
+		PVMs[d] = PV * M;
+		first_tri[d + 1] = first_tri[d] + draws[d].point_count / 3;
+	}
+	int tri_count = first_tri[draw_count];
+
+	// 1. transform and set up triangles. each thread does a contiguous chunk, and
+	// chunks are kept in order so the depth test resolves ties like GL does
+	std::vector<std::vector<screen_tri_t> > thread_tris( thread_count );
+	run_on_threads( thread_count, [&]( int t ) {
+		int start = (int)( (long long)tri_count * t / thread_count );
+		int end = (int)( (long long)tri_count * ( t + 1 ) / thread_count );
+		int d = (int)( std::upper_bound( first_tri.begin(), first_tri.end(), start ) -
+									 first_tri.begin() ) - 1;
+		for ( int i = start; i < end; i++ ) {
+			while ( i >= first_tri[d + 1] ) {
+				d++;
+			}
+			const float *p = draws[d].points + ( i - first_tri[d] ) * 9;
+			setup_triangle( buffer, PVMs[d], p, draws[d].id, thread_tris[t] );
+		}
+	} );
+
+	// 2. bin triangles into every tile their bounding box touches
+	int tiles_x = ( buffer.width + ID_RASTER_TILE_SIZE - 1 ) / ID_RASTER_TILE_SIZE;
+	int tiles_y = ( buffer.height + ID_RASTER_TILE_SIZE - 1 ) / ID_RASTER_TILE_SIZE;
+	std::vector<screen_tri_t> tris;
+	for ( int t = 0; t < thread_count; t++ ) {
+		tris.insert( tris.end(), thread_tris[t].begin(), thread_tris[t].end() );
+	}
+	std::vector<std::vector<int> > bins( tiles_x * tiles_y );
+	for ( size_t i = 0; i < tris.size(); i++ ) {
+		const screen_tri_t &t = tris[i];
+		float min_x = std::min( t.x[0], std::min( t.x[1], t.x[2] ) );
+		float max_x = std::max( t.x[0], std::max( t.x[1], t.x[2] ) );
+		float min_y = std::min( t.y[0], std::min( t.y[1], t.y[2] ) );
+		float max_y = std::max( t.y[0], std::max( t.y[1], t.y[2] ) );
+		if ( max_x < 0.0f || max_y < 0.0f || min_x >= buffer.width || min_y >= buffer.height ) {
+			continue;
+		}
+		int bx0 = std::max( 0, (int)min_x / ID_RASTER_TILE_SIZE );
+		int bx1 = std::min( tiles_x - 1, (int)max_x / ID_RASTER_TILE_SIZE );
+		int by0 = std::max( 0, (int)min_y / ID_RASTER_TILE_SIZE );
+		int by1 = std::min( tiles_y - 1, (int)max_y / ID_RASTER_TILE_SIZE );
+		for ( int by = by0; by <= by1; by++ ) {
+			for ( int bx = bx0; bx <= bx1; bx++ ) {
+				bins[by * tiles_x + bx].push_back( (int)i );
+			}
+		}
+	}
+
+	// 3. threads take whole tiles: clear them, then draw their bins in order
+	std::atomic<int> next_tile( 0 );
+	run_on_threads( thread_count, [&]( int ) {
+		for ( int tile = next_tile++; tile < tiles_x * tiles_y; tile = next_tile++ ) {
+			int x0 = ( tile % tiles_x ) * ID_RASTER_TILE_SIZE;
+			int y0 = ( tile / tiles_x ) * ID_RASTER_TILE_SIZE;
+			int x1 = std::min( buffer.width, x0 + ID_RASTER_TILE_SIZE );
+			int y1 = std::min( buffer.height, y0 + ID_RASTER_TILE_SIZE );
+			for ( int y = y0; y < y1; y++ ) {
+				std::fill( &buffer.depths[y * buffer.width + x0], &buffer.depths[y * buffer.width + x1], 1.0f );
+				std::fill( &buffer.ids[y * buffer.width + x0], &buffer.ids[y * buffer.width + x1], (unsigned int)ID_RASTER_NO_ID );
+			}
+			const std::vector<int> &bin = bins[tile];
+			for ( size_t i = 0; i < bin.size(); i++ ) {
+				raster_tri_in_tile( buffer, tris[bin[i]], x0, y0, x1, y1 );
+			}
+		}
+	} );
+}
+
+unsigned int id_buffer_pick( const id_buffer_t &buffer, double mouse_x,
+														 double mouse_y, int window_width, int window_height ) {
+	if ( buffer.width < 1 || buffer.height < 1 || window_width < 1 || window_height < 1 ) {
+		return ID_RASTER_NO_ID;
+	}
+	// window y goes down from the top, but the buffer's rows go up like GL's
+	int x = (int)floor( mouse_x * buffer.width / window_width );
+	int y = (int)floor( ( window_height - mouse_y ) * buffer.height / window_height );
+	if ( x < 0 || y < 0 || x >= buffer.width || y >= buffer.height ) {
+		return ID_RASTER_NO_ID;
+	}
+	return buffer.ids[y * buffer.width + x];
+}
@@ -0,0 +1,53 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU rasteriser for the picking ID buffer.                                    |
+| Draws the same triangles as pick.vert, with the same P * V * M transform,    |
+| into a small depth + 32-bit ID buffer in system memory. Picking then becomes |
+| a plain array lookup - no glReadPixels() stall, and no GL context needed.    |
+| The screen is split into tiles; triangles are binned into the tiles they     |
+| touch, then each thread rasterises whole tiles so no two threads ever write  |
+| the same pixel.                                                              |
+\******************************************************************************/
+#ifndef _ID_RASTER_H_
+#define _ID_RASTER_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+// pixels along each side of a tile
+#define ID_RASTER_TILE_SIZE 32
+// value of a pixel that no triangle covered
+#define ID_RASTER_NO_ID 0
+
+/* one mesh to draw with a unique id. points are x,y,z triangle soup like the
+ones from load_obj_file() */
+struct id_raster_draw_t {
+	const float *points;
+	int point_count;
+	mat4 M;
+	unsigned int id;
+};
+
+struct id_buffer_t {
+	int width, height;
+	std::vector<float> depths;			// window-space depth, 0 near to 1 far
+	std::vector<unsigned int> ids; // rows bottom to top, like GL
+};
+
+void id_buffer_resize( id_buffer_t &buffer, int width, int height );
+/* draws all meshes into the buffer with a GL_LESS depth test, clearing it
+first. uses thread_count threads */
+void id_raster_draw( id_buffer_t &buffer, const mat4 &P, const mat4 &V,
+										 const id_raster_draw_t *draws, int draw_count, int thread_count );
+/* id under a mouse position given in window coordinates (0,0 top-left), for a
+window of window_width x window_height. the buffer need not be the same size */
+unsigned int id_buffer_pick( const id_buffer_t &buffer, double mouse_x,
+														 double mouse_y, int window_width, int window_height );
+
+#endif
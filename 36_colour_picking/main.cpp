@@ -10,18 +10,22 @@
 \******************************************************************************/
 
 #include "gl_utils.h"
+#include "id_raster.h"
 #include "maths_funcs.h"
 #include "obj_parser.h"
 #include <GL/glew.h>		// include GLEW and new version of GL on Windows
 #include <GLFW/glfw3.h> // GLFW helper library
 #include <assert.h>
 #include <stdio.h>
+#include <thread>
 
 #define PICK_VS "pick.vert"
 #define PICK_FS "pick.frag"
 #define SPHERE_VS "sphere.vert"
 #define SPHERE_FS "sphere.frag"
 #define MESH_FILE "sphere.obj"
+/* the CPU ID buffer is this many times smaller than the window on each side */
+#define ID_BUFFER_DIVISOR 4
 
 /* window global variables */
 int g_gl_width = 800;
@@ -40,6 +44,13 @@ GLint g_pick_M_loc = -1;
 /* sphere */
 GLuint g_sphere_vao = 0;
 int g_sphere_point_count = 0;
+/* we keep a CPU copy of the sphere's points for the CPU ID rasteriser */
+float *g_sphere_points = NULL;
+
+/* CPU-side picking buffer. holds the same IDs as the GL one but lives in
+system memory, so reading it back doesn't wait on the GPU */
+id_buffer_t g_id_buffer;
+int g_num_threads = 1;
 
 // encode an unique ID into a colour with components in range of 0.0 to 1.0
 vec3 encode_id( int id ) {
@@ -122,6 +133,7 @@ void load_sphere() {
 	g_sphere_point_count = 0;
 	assert(
 		load_obj_file( MESH_FILE, points, tex_coords, normals, g_sphere_point_count ) );
+	g_sphere_points = points;
 	glGenVertexArrays( 1, &g_sphere_vao );
 	glBindVertexArray( g_sphere_vao );
 	GLuint vbo;
@@ -172,9 +184,31 @@ void draw_picker_colours( mat4 P, mat4 V, mat4 M[3] ) {
 
 int decode_id( int r, int g, int b ) { return b + g * 256 + r * 256 * 256; }
 
+/* same scene and IDs as draw_picker_colours(), but drawn on the CPU at low
+resolution. returns the time it took in milliseconds */
+double draw_cpu_picker_ids( mat4 P, mat4 V, mat4 M[3] ) {
+	int ids[3] = { 255, 65280, 16711680 };
+	id_raster_draw_t draws[3];
+	for ( int i = 0; i < 3; i++ ) {
+		draws[i].points = g_sphere_points;
+		draws[i].point_count = g_sphere_point_count;
+		draws[i].M = M[i];
+		draws[i].id = (unsigned int)ids[i];
+	}
+	id_buffer_resize( g_id_buffer, g_gl_width / ID_BUFFER_DIVISOR,
+										g_gl_height / ID_BUFFER_DIVISOR );
+	double start = glfwGetTime();
+	id_raster_draw( g_id_buffer, P, V, draws, 3, g_num_threads );
+	return ( glfwGetTime() - start ) * 1000.0;
+}
+
 int main() {
 	( restart_gl_log() );
 	( start_gl() );
+	g_num_threads = (int)std::thread::hardware_concurrency();
+	if ( g_num_threads < 1 ) {
+		g_num_threads = 1;
+	}
 	/* load a mesh to draw in the main scene */
 	load_sphere();
 	/* set up framebuffer with texture attachment */
@@ -244,9 +278,17 @@ int main() {
 		}
 		debug_colours = glfwGetKey( g_window, GLFW_KEY_SPACE );
 		if ( glfwGetMouseButton( g_window, 0 ) ) {
-			glBindFramebuffer( GL_FRAMEBUFFER, g_fb );
 			double xpos, ypos;
 			glfwGetCursorPos( g_window, &xpos, &ypos );
+			/* CPU pick first - no GPU round trip */
+			double cpu_ms = draw_cpu_picker_ids( P, V, Ms );
+			int cpu_id =
+				(int)id_buffer_pick( g_id_buffer, xpos, ypos, g_gl_width, g_gl_height );
+			printf( "CPU ID buffer %ix%i drawn in %.3fms -> id was %i\n",
+							g_id_buffer.width, g_id_buffer.height, cpu_ms, cpu_id );
+
+			/* then the GL readback, to check the CPU path against */
+			glBindFramebuffer( GL_FRAMEBUFFER, g_fb );
 			int mx = (int)xpos;
 			int my = (int)ypos;
 			unsigned char data[4] = { 0, 0, 0, 0 };
@@ -264,6 +306,10 @@ int main() {
 			}
 			printf( "%i,%i,%i means -> id was %i, and monkey number is %i\n", data[0],
 							data[1], data[2], id, mid );
+			/* the CPU buffer is lower resolution so they can differ right on an edge */
+			if ( cpu_id != id ) {
+				printf( "CPU and GL picking IDs differ (%i vs %i)\n", cpu_id, id );
+			}
 			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 		}
 	}
@@ -0,0 +1,276 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU version of the deferred lighting pass. See deferred_resolve.h            |
+\******************************************************************************/
+#include "deferred_resolve.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <vector>
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define DEFERRED_RESOLVE_SSE
+#endif
+
+/* tiles are square. pixels per tile must be a multiple of 4 for SSE */
+#define RESOLVE_TILE_SIZE 16
+#define RESOLVE_TILE_PIXELS ( RESOLVE_TILE_SIZE * RESOLVE_TILE_SIZE )
+/* second_pass.frag discards pixels with a position z above this */
+#define RESOLVE_BACKGROUND_Z -0.0001f
+
+phong_material_t default_phong_material() {
+	phong_material_t m;
+	m.kd = vec3( 0.9f, 0.9f, 0.9f );
+	m.ks = vec3( 0.5f, 0.5f, 0.5f );
+	m.specular_exponent = 200;
+	m.light_range = 10.0f;
+	m.clear_colour = vec3( 0.2f, 0.2f, 0.2f );
+	return m;
+}
+
+/* one tile's G-buffer rearranged as one array per component, so 4 pixels'
+worth of any component is one aligned load */
+struct resolve_tile_t {
+	float px[RESOLVE_TILE_PIXELS], py[RESOLVE_TILE_PIXELS], pz[RESOLVE_TILE_PIXELS];
+	float nx[RESOLVE_TILE_PIXELS], ny[RESOLVE_TILE_PIXELS], nz[RESOLVE_TILE_PIXELS];
+	float ex[RESOLVE_TILE_PIXELS], ey[RESOLVE_TILE_PIXELS], ez[RESOLVE_TILE_PIXELS];
+	float lit[RESOLVE_TILE_PIXELS]; // 1 for geometry, 0 for background
+	float r[RESOLVE_TILE_PIXELS], g[RESOLVE_TILE_PIXELS], b[RESOLVE_TILE_PIXELS];
+};
+
+/* one light in eye space, with its colours already multiplied by the material */
+struct resolve_light_t {
+	float x, y, z;
+	float dr, dg, db; // ld * kd
+	float sr, sg, sb; // ls * ks
+};
+
+#ifdef DEFERRED_RESOLVE_SSE
+static inline __m128 pow_int_sse( __m128 x, int n ) {
+	__m128 result = _mm_set1_ps( 1.0f );
+	while ( n > 0 ) {
+		if ( n & 1 ) {
+			result = _mm_mul_ps( result, x );
+		}
+		x = _mm_mul_ps( x, x );
+		n >>= 1;
+	}
+	return result;
+}
+
+static void shade_tile( resolve_tile_t &t, const resolve_light_t &l,
+												const phong_material_t &m ) {
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps( 1.0f );
+	__m128 two = _mm_set1_ps( 2.0f );
+	__m128 inv_range = _mm_set1_ps( 1.0f / m.light_range );
+	__m128 lx = _mm_set1_ps( l.x ), ly = _mm_set1_ps( l.y ), lz = _mm_set1_ps( l.z );
+	for ( int i = 0; i < RESOLVE_TILE_PIXELS; i += 4 ) {
+		__m128 px = _mm_load_ps( t.px + i ), py = _mm_load_ps( t.py + i ), pz = _mm_load_ps( t.pz + i );
+		__m128 nx = _mm_load_ps( t.nx + i ), ny = _mm_load_ps( t.ny + i ), nz = _mm_load_ps( t.nz + i );
+		__m128 ex = _mm_load_ps( t.ex + i ), ey = _mm_load_ps( t.ey + i ), ez = _mm_load_ps( t.ez + i );
+		// direction and distance to light
+		__m128 dx = _mm_sub_ps( lx, px ), dy = _mm_sub_ps( ly, py ), dz = _mm_sub_ps( lz, pz );
+		__m128 dist = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) ) );
+		__m128 atten = _mm_max_ps( zero, _mm_sub_ps( one, _mm_mul_ps( dist, inv_range ) ) );
+		atten = _mm_mul_ps( atten, _mm_load_ps( t.lit + i ) );
+		if ( 0 == _mm_movemask_ps( _mm_cmpgt_ps( atten, zero ) ) ) {
+			continue;
+		}
+		__m128 inv_dist = _mm_div_ps( one, _mm_max_ps( dist, _mm_set1_ps( 1e-12f ) ) );
+		dx = _mm_mul_ps( dx, inv_dist );
+		dy = _mm_mul_ps( dy, inv_dist );
+		dz = _mm_mul_ps( dz, inv_dist );
+		// diffuse
+		__m128 n_dot_l = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, dx ), _mm_mul_ps( ny, dy ) ), _mm_mul_ps( nz, dz ) );
+		__m128 diffuse = _mm_max_ps( n_dot_l, zero );
+		// specular. reflect( -l, n ) = 2 * dot( n, l ) * n - l
+		__m128 k = _mm_mul_ps( two, n_dot_l );
+		__m128 rx = _mm_sub_ps( _mm_mul_ps( k, nx ), dx );
+		__m128 ry = _mm_sub_ps( _mm_mul_ps( k, ny ), dy );
+		__m128 rz = _mm_sub_ps( _mm_mul_ps( k, nz ), dz );
+		__m128 r_dot_e = _mm_add_ps( _mm_add_ps( _mm_mul_ps( rx, ex ), _mm_mul_ps( ry, ey ) ), _mm_mul_ps( rz, ez ) );
+		__m128 specular = pow_int_sse( _mm_max_ps( r_dot_e, zero ), m.specular_exponent );
+		diffuse = _mm_mul_ps( diffuse, atten );
+		specular = _mm_mul_ps( specular, atten );
+		__m128 r = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( l.dr ), diffuse ), _mm_mul_ps( _mm_set1_ps( l.sr ), specular ) );
+		__m128 g = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( l.dg ), diffuse ), _mm_mul_ps( _mm_set1_ps( l.sg ), specular ) );
+		__m128 b = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( l.db ), diffuse ), _mm_mul_ps( _mm_set1_ps( l.sb ), specular ) );
+		_mm_store_ps( t.r + i, _mm_add_ps( _mm_load_ps( t.r + i ), r ) );
+		_mm_store_ps( t.g + i, _mm_add_ps( _mm_load_ps( t.g + i ), g ) );
+		_mm_store_ps( t.b + i, _mm_add_ps( _mm_load_ps( t.b + i ), b ) );
+	}
+}
+#else
+static inline float pow_int( float x, int n ) {
+	float result = 1.0f;
+	while ( n > 0 ) {
+		if ( n & 1 ) {
+			result *= x;
+		}
+		x *= x;
+		n >>= 1;
+	}
+	return result;
+}
+
+static void shade_tile( resolve_tile_t &t, const resolve_light_t &l,
+												const phong_material_t &m ) {
+	for ( int i = 0; i < RESOLVE_TILE_PIXELS; i++ ) {
+		float dx = l.x - t.px[i], dy = l.y - t.py[i], dz = l.z - t.pz[i];
+		float dist = sqrtf( dx * dx + dy * dy + dz * dz );
+		float atten = std::max( 0.0f, 1.0f - dist / m.light_range ) * t.lit[i];
+		if ( atten <= 0.0f ) {
+			continue;
+		}
+		float inv_dist = 1.0f / std::max( dist, 1e-12f );
+		dx *= inv_dist;
+		dy *= inv_dist;
+		dz *= inv_dist;
+		float n_dot_l = t.nx[i] * dx + t.ny[i] * dy + t.nz[i] * dz;
+		float diffuse = std::max( n_dot_l, 0.0f ) * atten;
+		float rx = 2.0f * n_dot_l * t.nx[i] - dx;
+		float ry = 2.0f * n_dot_l * t.ny[i] - dy;
+		float rz = 2.0f * n_dot_l * t.nz[i] - dz;
+		float r_dot_e = rx * t.ex[i] + ry * t.ey[i] + rz * t.ez[i];
+		float specular = pow_int( std::max( r_dot_e, 0.0f ), m.specular_exponent ) * atten;
+		t.r[i] += l.dr * diffuse + l.sr * specular;
+		t.g[i] += l.dg * diffuse + l.sg * specular;
+		t.b[i] += l.db * diffuse + l.sb * specular;
+	}
+}
+#endif
+
+/* copy one tile out of the G-buffer, normalising normals and working out the
+direction to the viewer once per pixel instead of once per light. returns
+false if the whole tile is background. bounds of the lit pixels go in
+box_min/box_max */
+static bool load_tile( resolve_tile_t &t, const float *positions, const float *normals,
+											 int width, int height, int x0, int y0, float *box_min,
+											 float *box_max ) {
+	bool any = false;
+	for ( int a = 0; a < 3; a++ ) {
+		box_min[a] = 1e30f;
+		box_max[a] = -1e30f;
+	}
+	for ( int j = 0; j < RESOLVE_TILE_SIZE; j++ ) {
+		for ( int i = 0; i < RESOLVE_TILE_SIZE; i++ ) {
+			int k = j * RESOLVE_TILE_SIZE + i;
+			int x = x0 + i, y = y0 + j;
+			t.r[k] = t.g[k] = t.b[k] = 0.0f;
+			t.px[k] = t.py[k] = t.pz[k] = 0.0f;
+			t.nx[k] = t.ny[k] = t.nz[k] = 0.0f;
+			t.ex[k] = t.ey[k] = t.ez[k] = 0.0f;
+			t.lit[k] = 0.0f;
+			if ( x >= width || y >= height ) {
+				continue;
+			}
+			const float *p = positions + ( y * width + x ) * 3;
+			if ( p[2] > RESOLVE_BACKGROUND_Z ) {
+				continue;
+			}
+			const float *n = normals + ( y * width + x ) * 3;
+			float n_len = sqrtf( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+			float p_len = sqrtf( p[0] * p[0] + p[1] * p[1] + p[2] * p[2] );
+			if ( n_len <= 0.0f || p_len <= 0.0f ) {
+				continue;
+			}
+			t.px[k] = p[0];
+			t.py[k] = p[1];
+			t.pz[k] = p[2];
+			t.nx[k] = n[0] / n_len;
+			t.ny[k] = n[1] / n_len;
+			t.nz[k] = n[2] / n_len;
+			t.ex[k] = -p[0] / p_len;
+			t.ey[k] = -p[1] / p_len;
+			t.ez[k] = -p[2] / p_len;
+			t.lit[k] = 1.0f;
+			for ( int a = 0; a < 3; a++ ) {
+				box_min[a] = std::min( box_min[a], p[a] );
+				box_max[a] = std::max( box_max[a], p[a] );
+			}
+			any = true;
+		}
+	}
+	return any;
+}
+
+void deferred_resolve( const float *positions, const float *normals, int width,
+											 int height, const mat4 &V, const vec3 *light_p,
+											 const vec3 *light_d, const vec3 *light_s, int light_count,
+											 const phong_material_t &material, float *out_rgb,
+											 int thread_count ) {
+	if ( thread_count < 1 ) {
+		thread_count = 1;
+	}
+	/* lights into eye space once, like lp_eye in the shader */
+	std::vector<resolve_light_t> lights( light_count );
+	for ( int i = 0; i < light_count; i++ ) {
+		const float *p = light_p[i].v;
+		resolve_light_t &l = lights[i];
+		l.x = V.m[0] * p[0] + V.m[4] * p[1] + V.m[8] * p[2] + V.m[12];
+		l.y = V.m[1] * p[0] + V.m[5] * p[1] + V.m[9] * p[2] + V.m[13];
+		l.z = V.m[2] * p[0] + V.m[6] * p[1] + V.m[10] * p[2] + V.m[14];
+		l.dr = light_d[i].v[0] * material.kd.v[0];
+		l.dg = light_d[i].v[1] * material.kd.v[1];
+		l.db = light_d[i].v[2] * material.kd.v[2];
+		l.sr = light_s[i].v[0] * material.ks.v[0];
+		l.sg = light_s[i].v[1] * material.ks.v[1];
+		l.sb = light_s[i].v[2] * material.ks.v[2];
+	}
+
+	int tiles_x = ( width + RESOLVE_TILE_SIZE - 1 ) / RESOLVE_TILE_SIZE;
+	int tiles_y = ( height + RESOLVE_TILE_SIZE - 1 ) / RESOLVE_TILE_SIZE;
+	std::atomic<int> next_tile( 0 );
+	run_on_threads( thread_count, [&]( int ) {
+		/* tiles are a few KB each, so keep one per thread off the stack. the
+		SSE loads need 16-byte alignment, which new doesn't promise pre-C++17 */
+		std::vector<char> storage( sizeof( resolve_tile_t ) + 16 );
+		size_t aligned = ( (size_t)&storage[0] + 15 ) & ~(size_t)15;
+		resolve_tile_t &tile = *(resolve_tile_t *)aligned;
+		for ( int ti = next_tile++; ti < tiles_x * tiles_y; ti = next_tile++ ) {
+			int x0 = ( ti % tiles_x ) * RESOLVE_TILE_SIZE;
+			int y0 = ( ti / tiles_x ) * RESOLVE_TILE_SIZE;
+			float box_min[3], box_max[3];
+			if ( load_tile( tile, positions, normals, width, height, x0, y0, box_min, box_max ) ) {
+				for ( int i = 0; i < light_count; i++ ) {
+					/* skip lights whose range doesn't reach the tile's bounding box */
+					const resolve_light_t &l = lights[i];
+					float c[3] = { l.x, l.y, l.z };
+					float d2 = 0.0f;
+					for ( int a = 0; a < 3; a++ ) {
+						float d = std::max( 0.0f, std::max( box_min[a] - c[a], c[a] - box_max[a] ) );
+						d2 += d * d;
+					}
+					if ( d2 >= material.light_range * material.light_range ) {
+						continue;
+					}
+					shade_tile( tile, l, material );
+				}
+			}
+			for ( int j = 0; j < RESOLVE_TILE_SIZE && y0 + j < height; j++ ) {
+				for ( int i = 0; i < RESOLVE_TILE_SIZE && x0 + i < width; i++ ) {
+					int k = j * RESOLVE_TILE_SIZE + i;
+					float *o = out_rgb + ( ( y0 + j ) * width + x0 + i ) * 3;
+					o[0] = material.clear_colour.v[0] + tile.r[k];
+					o[1] = material.clear_colour.v[1] + tile.g[k];
+					o[2] = material.clear_colour.v[2] + tile.b[k];
+				}
+			}
+		}
+	} );
+}
+
+void resolve_to_rgb8( const float *rgb, int pixel_count, unsigned char *out ) {
+	for ( int i = 0; i < pixel_count * 3; i++ ) {
+		float c = std::min( std::max( rgb[i], 0.0f ), 1.0f );
+		out[i] = (unsigned char)( c * 255.0f + 0.5f );
+	}
+}
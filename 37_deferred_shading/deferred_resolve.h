@@ -0,0 +1,48 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU version of the deferred lighting pass in second_pass.frag.               |
+| Takes the G-buffer as plain float arrays - eye-space positions and normals,  |
+| 3 floats per pixel, rows bottom to top like glGetTexImage() gives - and      |
+| adds up the same Phong lighting as the GPU does with additive blending on    |
+| top of the clear colour. No GL needed, so it gives a reference image that    |
+| can be made and compared anywhere.                                           |
+| The image is cut into tiles shared out between threads. Each tile skips      |
+| lights that can't reach any of its pixels, and the lighting sums run on 4    |
+| pixels at a time with SSE.                                                   |
+\******************************************************************************/
+#ifndef _DEFERRED_RESOLVE_H_
+#define _DEFERRED_RESOLVE_H_
+
+#include "maths_funcs.h"
+
+/* the constants hard-coded in second_pass.frag */
+struct phong_material_t {
+	vec3 kd;									// diffuse reflectance
+	vec3 ks;									// specular reflectance
+	int specular_exponent;		// whole numbers only, so pow() is exact squaring
+	float light_range;				// light falls off to nothing at this distance
+	vec3 clear_colour;				// lights are blended on top of this
+};
+
+/* material values that match second_pass.frag and draw_second_pass() */
+phong_material_t default_phong_material();
+
+/* lights every pixel into out_rgb (3 floats per pixel, not clamped). light
+positions are in world space and are moved into eye space with V, like the
+shader does. background pixels (z > -0.0001) get just the clear colour */
+void deferred_resolve( const float *positions, const float *normals, int width,
+											 int height, const mat4 &V, const vec3 *light_p,
+											 const vec3 *light_d, const vec3 *light_s, int light_count,
+											 const phong_material_t &material, float *out_rgb,
+											 int thread_count );
+
+/* clamps and rounds to 8 bits per channel, the way the framebuffer stores it */
+void resolve_to_rgb8( const float *rgb, int pixel_count, unsigned char *out );
+
+#endif
@@ -0,0 +1,99 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Compact G-buffer encoding. See gbuffer_pack.h                                |
+\******************************************************************************/
+#include "gbuffer_pack.h"
+#include <math.h>
+
+/* like GLSL sign(), but never 0, so normals on the octahedron's edges don't
+collapse to the middle */
+static float sign_not_zero( float f ) { return f >= 0.0f ? 1.0f : -1.0f; }
+
+/* -1 to 1 into 16 bits the way GL converts a fragment output for a unorm
+texture: clamp to 0-1 and round to nearest */
+static unsigned short to_unorm16( float f ) {
+	f = f * 0.5f + 0.5f;
+	f = f < 0.0f ? 0.0f : ( f > 1.0f ? 1.0f : f );
+	return (unsigned short)( f * 65535.0f + 0.5f );
+}
+
+static float from_unorm16( unsigned short u ) {
+	return (float)u / 65535.0f * 2.0f - 1.0f;
+}
+
+void oct_encode_normal( const float *n, unsigned short *rg ) {
+	/* project onto the octahedron |x|+|y|+|z| = 1 */
+	float l1 = fabsf( n[0] ) + fabsf( n[1] ) + fabsf( n[2] );
+	float x = n[0] / l1;
+	float y = n[1] / l1;
+	/* fold the back half over the front half's corners */
+	if ( n[2] < 0.0f ) {
+		float fx = ( 1.0f - fabsf( y ) ) * sign_not_zero( x );
+		float fy = ( 1.0f - fabsf( x ) ) * sign_not_zero( y );
+		x = fx;
+		y = fy;
+	}
+	rg[0] = to_unorm16( x );
+	rg[1] = to_unorm16( y );
+}
+
+void oct_decode_normal( const unsigned short *rg, float *n ) {
+	float x = from_unorm16( rg[0] );
+	float y = from_unorm16( rg[1] );
+	float z = 1.0f - fabsf( x ) - fabsf( y );
+	if ( z < 0.0f ) {
+		float fx = ( 1.0f - fabsf( y ) ) * sign_not_zero( x );
+		float fy = ( 1.0f - fabsf( x ) ) * sign_not_zero( y );
+		x = fx;
+		y = fy;
+	}
+	float len = sqrtf( x * x + y * y + z * z );
+	n[0] = x / len;
+	n[1] = y / len;
+	n[2] = z / len;
+}
+
+void reconstruct_eye_position( const mat4 &inv_P, float window_x, float window_y,
+															 float depth, int width, int height, float *p ) {
+	/* back to normalised device coordinates, then through the inverse
+	projection and the perspective divide */
+	float ndc[4] = { window_x / (float)width * 2.0f - 1.0f,
+									 window_y / (float)height * 2.0f - 1.0f, depth * 2.0f - 1.0f,
+									 1.0f };
+	float e[4];
+	for ( int r = 0; r < 4; r++ ) {
+		e[r] = inv_P.m[r] * ndc[0] + inv_P.m[4 + r] * ndc[1] + inv_P.m[8 + r] * ndc[2] +
+					 inv_P.m[12 + r] * ndc[3];
+	}
+	p[0] = e[0] / e[3];
+	p[1] = e[1] / e[3];
+	p[2] = e[2] / e[3];
+}
+
+void unpack_g_buffer( const float *depths, const unsigned short *packed_normals,
+											int width, int height, const mat4 &P, float *positions,
+											float *normals ) {
+	mat4 inv_P = inverse( P );
+	for ( int y = 0; y < height; y++ ) {
+		for ( int x = 0; x < width; x++ ) {
+			int i = y * width + x;
+			float *p = positions + i * 3;
+			float *n = normals + i * 3;
+			if ( depths[i] >= 1.0f ) {
+				p[0] = p[1] = p[2] = 0.0f;
+				n[0] = n[1] = n[2] = 0.0f;
+				continue;
+			}
+			/* sample at the pixel centre, like gl_FragCoord */
+			reconstruct_eye_position( inv_P, (float)x + 0.5f, (float)y + 0.5f, depths[i],
+																width, height, p );
+			oct_decode_normal( packed_normals + i * 2, n );
+		}
+	}
+}
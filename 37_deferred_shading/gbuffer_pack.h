@@ -0,0 +1,41 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Compact G-buffer encoding.                                                   |
+| Instead of a full float position per pixel we keep only the depth buffer     |
+| value and get the eye-space position back with the inverse projection        |
+| matrix. Normals are folded onto an octahedron and unwrapped into a square,   |
+| which fits a unit vector into 2 numbers; these go in an RG16 texture.        |
+| The functions here do exactly what first_pass_compact.frag and               |
+| second_pass_compact.frag do, so a G-buffer read back from GL can be          |
+| unpacked on the CPU, and the encoding can be checked without a GL context.   |
+\******************************************************************************/
+#ifndef _GBUFFER_PACK_H_
+#define _GBUFFER_PACK_H_
+
+#include "maths_funcs.h"
+
+/* unit normal to 2 16-bit values, stored like GL stores a GL_RG16 texel */
+void oct_encode_normal( const float *n, unsigned short *rg );
+/* 2 16-bit values back to a unit normal */
+void oct_decode_normal( const unsigned short *rg, float *n );
+
+/* eye-space position from a window position in pixels, a depth buffer value
+(0 to 1), the viewport size, and the inverse of the projection matrix */
+void reconstruct_eye_position( const mat4 &inv_P, float window_x, float window_y,
+															 float depth, int width, int height, float *p );
+
+/* turns a whole compact G-buffer (1 depth and 2 normal values per pixel, rows
+bottom to top) back into 3-float positions and normals, like the full-float
+G-buffer textures hold. background pixels (depth 1) get a zero position and
+normal. this is the input deferred_resolve() wants */
+void unpack_g_buffer( const float *depths, const unsigned short *packed_normals,
+											int width, int height, const mat4 &P, float *positions,
+											float *normals );
+
+#endif
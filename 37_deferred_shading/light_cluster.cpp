@@ -0,0 +1,288 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Clustered light culling. See light_cluster.h                                 |
+\******************************************************************************/
+#include "light_cluster.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <atomic>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define LIGHT_CLUSTER_SSE
+#endif
+
+void light_grid_init( light_grid_t &grid, const mat4 &P, int viewport_width,
+											int viewport_height, int tile_size, int slices ) {
+	grid.viewport_width = viewport_width;
+	grid.viewport_height = viewport_height;
+	grid.tile_size = tile_size;
+	grid.tiles_x = ( viewport_width + tile_size - 1 ) / tile_size;
+	grid.tiles_y = ( viewport_height + tile_size - 1 ) / tile_size;
+	grid.slices = slices;
+	/* recover the clip planes from the matrix perspective() builds:
+	m[10] = -(f+n)/(f-n), m[14] = -2fn/(f-n) */
+	grid.near = P.m[14] / ( P.m[10] - 1.0f );
+	grid.far = P.m[14] / ( P.m[10] + 1.0f );
+	int cluster_count = grid.tiles_x * grid.tiles_y * slices;
+	grid.offsets.assign( cluster_count, 0 );
+	grid.counts.assign( cluster_count, 0 );
+	grid.indices.clear();
+	grid.tile_lists.resize( grid.tiles_x * grid.tiles_y );
+}
+
+int light_grid_slice( const light_grid_t &grid, float view_depth ) {
+	if ( view_depth <= grid.near ) {
+		return 0;
+	}
+	int s = (int)( logf( view_depth / grid.near ) / logf( grid.far / grid.near ) *
+								 grid.slices );
+	return std::min( s, grid.slices - 1 );
+}
+
+int light_grid_cluster( const light_grid_t &grid, int pixel_x, int pixel_y,
+												float view_depth ) {
+	int tx = std::min( std::max( pixel_x / grid.tile_size, 0 ), grid.tiles_x - 1 );
+	int ty = std::min( std::max( pixel_y / grid.tile_size, 0 ), grid.tiles_y - 1 );
+	return ( ty * grid.tiles_x + tx ) * grid.slices +
+				 light_grid_slice( grid, view_depth );
+}
+
+/* the 4 side planes of one tile's frustum column, in view space. all pass
+through the eye so only need a normal. a point p is inside when dot(n,p) >= 0.
+the planes never lean in y for left/right or in x for top/bottom, so just 2
+components each are stored */
+struct tile_planes_t {
+	float left_x, left_z, right_x, right_z;
+	float bottom_y, bottom_z, top_y, top_z;
+};
+
+/* planes around the pixel rectangle [x0,x1) x [y0,y1) */
+static tile_planes_t get_rect_planes( const light_grid_t &grid, const mat4 &P,
+																			int px0, int py0, int px1, int py1 ) {
+	float x0 = 2.0f * (float)px0 / grid.viewport_width - 1.0f;
+	float x1 = 2.0f * (float)px1 / grid.viewport_width - 1.0f;
+	float y0 = 2.0f * (float)py0 / grid.viewport_height - 1.0f;
+	float y1 = 2.0f * (float)py1 / grid.viewport_height - 1.0f;
+	/* x_ndc = ( sx * x + m8 * z ) / -z, so x_ndc >= x0 becomes
+	sx * x + ( m8 + x0 ) * z >= 0 for points in front of the camera */
+	float sx = P.m[0], sy = P.m[5], ox = P.m[8], oy = P.m[9];
+	tile_planes_t t;
+	float len;
+	len = sqrtf( sx * sx + ( ox + x0 ) * ( ox + x0 ) );
+	t.left_x = sx / len;
+	t.left_z = ( ox + x0 ) / len;
+	len = sqrtf( sx * sx + ( ox + x1 ) * ( ox + x1 ) );
+	t.right_x = -sx / len;
+	t.right_z = -( ox + x1 ) / len;
+	len = sqrtf( sy * sy + ( oy + y0 ) * ( oy + y0 ) );
+	t.bottom_y = sy / len;
+	t.bottom_z = ( oy + y0 ) / len;
+	len = sqrtf( sy * sy + ( oy + y1 ) * ( oy + y1 ) );
+	t.top_y = -sy / len;
+	t.top_z = -( oy + y1 ) / len;
+	return t;
+}
+
+static tile_planes_t get_tile_planes( const light_grid_t &grid, const mat4 &P,
+																			int tx, int ty ) {
+	return get_rect_planes( grid, P, tx * grid.tile_size, ty * grid.tile_size,
+													std::min( ( tx + 1 ) * grid.tile_size, grid.viewport_width ),
+													std::min( ( ty + 1 ) * grid.tile_size, grid.viewport_height ) );
+}
+
+/* appends indices of all lights touching the tile's column, between the near
+and far planes. light arrays are padded to a multiple of 4 */
+static void cull_tile( const light_grid_t &grid, const tile_planes_t &t,
+											 int padded_count, int light_count,
+											 std::vector<unsigned int> &out ) {
+	const float *vx = &grid.view_x[0];
+	const float *vy = &grid.view_y[0];
+	const float *vz = &grid.view_z[0];
+	const float *vr = &grid.radii[0];
+#ifdef LIGHT_CLUSTER_SSE
+	__m128 lx = _mm_set1_ps( t.left_x ), lz = _mm_set1_ps( t.left_z );
+	__m128 rx = _mm_set1_ps( t.right_x ), rz = _mm_set1_ps( t.right_z );
+	__m128 by = _mm_set1_ps( t.bottom_y ), bz = _mm_set1_ps( t.bottom_z );
+	__m128 ty = _mm_set1_ps( t.top_y ), tz = _mm_set1_ps( t.top_z );
+	__m128 near = _mm_set1_ps( -grid.near ), far = _mm_set1_ps( -grid.far );
+	__m128 zero = _mm_setzero_ps();
+	for ( int i = 0; i < padded_count; i += 4 ) {
+		__m128 x = _mm_loadu_ps( vx + i );
+		__m128 y = _mm_loadu_ps( vy + i );
+		__m128 z = _mm_loadu_ps( vz + i );
+		__m128 r = _mm_loadu_ps( vr + i );
+		__m128 neg_r = _mm_sub_ps( zero, r );
+		/* sphere is outside a plane if its centre is more than r behind it */
+		__m128 in = _mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( lx, x ), _mm_mul_ps( lz, z ) ), neg_r );
+		in = _mm_and_ps( in, _mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( rx, x ), _mm_mul_ps( rz, z ) ), neg_r ) );
+		in = _mm_and_ps( in, _mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( by, y ), _mm_mul_ps( bz, z ) ), neg_r ) );
+		in = _mm_and_ps( in, _mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( ty, y ), _mm_mul_ps( tz, z ) ), neg_r ) );
+		/* view z is negative in front of the camera: need z - r <= -near and
+		z + r >= -far */
+		in = _mm_and_ps( in, _mm_cmple_ps( _mm_sub_ps( z, r ), near ) );
+		in = _mm_and_ps( in, _mm_cmpge_ps( _mm_add_ps( z, r ), far ) );
+		int mask = _mm_movemask_ps( in );
+		while ( mask ) {
+			int bit = 0;
+			while ( !( mask & ( 1 << bit ) ) ) {
+				bit++;
+			}
+			mask &= ~( 1 << bit );
+			if ( i + bit < light_count ) {
+				out.push_back( (unsigned int)( i + bit ) );
+			}
+		}
+	}
+#else
+	(void)padded_count;
+	for ( int i = 0; i < light_count; i++ ) {
+		float x = vx[i], y = vy[i], z = vz[i], r = vr[i];
+		if ( t.left_x * x + t.left_z * z < -r || t.right_x * x + t.right_z * z < -r ||
+				 t.bottom_y * y + t.bottom_z * z < -r || t.top_y * y + t.top_z * z < -r ||
+				 z - r > -grid.near || z + r < -grid.far ) {
+			continue;
+		}
+		out.push_back( (unsigned int)i );
+	}
+#endif
+}
+
+/* fill [from, to) with lights that sit behind the camera with no radius, so
+they never pass a test */
+static void pad_lights( light_grid_t &grid, int from, int to ) {
+	for ( int i = from; i < to; i++ ) {
+		grid.view_x[i] = grid.view_y[i] = 0.0f;
+		grid.view_z[i] = FLT_MAX;
+		grid.radii[i] = 0.0f;
+	}
+}
+
+void light_grid_cull_view( light_grid_t &grid, const mat4 &P, const mat4 &V,
+													 const vec3 *light_pos_wor, const float *light_radii,
+													 int light_count ) {
+	grid.light_ids.clear();
+	if ( light_count <= 0 ) {
+		return;
+	}
+	/* lights into view space, as separate x,y,z,radius arrays so 4 lights at a
+	time can be loaded straight into SSE registers */
+	int padded_count = ( light_count + 3 ) & ~3;
+	grid.view_x.resize( padded_count );
+	grid.view_y.resize( padded_count );
+	grid.view_z.resize( padded_count );
+	grid.radii.resize( padded_count );
+	for ( int i = 0; i < light_count; i++ ) {
+		const float *p = light_pos_wor[i].v;
+		grid.view_x[i] = V.m[0] * p[0] + V.m[4] * p[1] + V.m[8] * p[2] + V.m[12];
+		grid.view_y[i] = V.m[1] * p[0] + V.m[5] * p[1] + V.m[9] * p[2] + V.m[13];
+		grid.view_z[i] = V.m[2] * p[0] + V.m[6] * p[1] + V.m[10] * p[2] + V.m[14];
+		grid.radii[i] = light_radii[i];
+	}
+	pad_lights( grid, light_count, padded_count );
+
+	/* most lights are usually off-screen, so cull against the whole view once */
+	tile_planes_t view_planes =
+		get_rect_planes( grid, P, 0, 0, grid.viewport_width, grid.viewport_height );
+	cull_tile( grid, view_planes, padded_count, light_count, grid.light_ids );
+}
+
+void light_grid_build( light_grid_t &grid, const mat4 &P, const mat4 &V,
+											 const vec3 *light_pos_wor, const float *light_radii,
+											 int light_count, int thread_count ) {
+	if ( thread_count < 1 ) {
+		thread_count = 1;
+	}
+	light_grid_cull_view( grid, P, V, light_pos_wor, light_radii, light_count );
+	const std::vector<unsigned int> &visible = grid.light_ids;
+	int visible_count = (int)visible.size();
+	/* every cluster is empty, and the light arrays may be too */
+	if ( 0 == visible_count ) {
+		std::fill( grid.offsets.begin(), grid.offsets.end(), 0 );
+		std::fill( grid.counts.begin(), grid.counts.end(), 0 );
+		grid.indices.clear();
+		return;
+	}
+	/* squash the survivors to the front of the arrays, so tiles only test
+	those. survivors stay in index order, so compacting in place is safe */
+	for ( int k = 0; k < visible_count; k++ ) {
+		unsigned int i = visible[k];
+		grid.view_x[k] = grid.view_x[i];
+		grid.view_y[k] = grid.view_y[i];
+		grid.view_z[k] = grid.view_z[i];
+		grid.radii[k] = grid.radii[i];
+	}
+	int padded_visible = ( visible_count + 3 ) & ~3;
+	pad_lights( grid, visible_count, padded_visible );
+
+	/* cull each tile's lights then split them into the tile's slices. tiles
+	write to their own lists and to their own range of counts, so no locks */
+	float log_ratio = logf( grid.far / grid.near );
+	int tile_count = grid.tiles_x * grid.tiles_y;
+	std::atomic<int> next_tile( 0 );
+	run_on_threads( thread_count, [&]( int ) {
+		std::vector<unsigned int> candidates;
+		std::vector<int> first_slice, last_slice;
+		std::vector<unsigned int> slice_start( grid.slices );
+		for ( int tile = next_tile++; tile < tile_count; tile = next_tile++ ) {
+			tile_planes_t planes = get_tile_planes( grid, P, tile % grid.tiles_x, tile / grid.tiles_x );
+			candidates.clear();
+			cull_tile( grid, planes, padded_visible, visible_count, candidates );
+			/* depth slices each candidate covers */
+			first_slice.resize( candidates.size() );
+			last_slice.resize( candidates.size() );
+			unsigned int *counts = &grid.counts[tile * grid.slices];
+			memset( counts, 0, sizeof( unsigned int ) * grid.slices );
+			for ( size_t c = 0; c < candidates.size(); c++ ) {
+				unsigned int l = candidates[c];
+				float depth = -grid.view_z[l];
+				float d0 = std::max( depth - grid.radii[l], grid.near );
+				float d1 = std::min( depth + grid.radii[l], grid.far );
+				first_slice[c] = std::min( grid.slices - 1, (int)( logf( d0 / grid.near ) / log_ratio * grid.slices ) );
+				last_slice[c] = std::min( grid.slices - 1, (int)( logf( d1 / grid.near ) / log_ratio * grid.slices ) );
+				for ( int s = first_slice[c]; s <= last_slice[c]; s++ ) {
+					counts[s]++;
+				}
+			}
+			/* counting sort into slice order, keeping lights in index order */
+			std::vector<unsigned int> &list = grid.tile_lists[tile];
+			unsigned int total = 0;
+			for ( int s = 0; s < grid.slices; s++ ) {
+				slice_start[s] = total;
+				total += counts[s];
+			}
+			list.resize( total );
+			for ( size_t c = 0; c < candidates.size(); c++ ) {
+				for ( int s = first_slice[c]; s <= last_slice[c]; s++ ) {
+					list[slice_start[s]++] = visible[candidates[c]];
+				}
+			}
+		}
+	} );
+
+	/* pack every tile's list into the one flat index array */
+	unsigned int total = 0;
+	for ( int c = 0; c < tile_count * grid.slices; c++ ) {
+		grid.offsets[c] = total;
+		total += grid.counts[c];
+	}
+	grid.indices.resize( total );
+	next_tile = 0;
+	run_on_threads( thread_count, [&]( int ) {
+		for ( int tile = next_tile++; tile < tile_count; tile = next_tile++ ) {
+			const std::vector<unsigned int> &list = grid.tile_lists[tile];
+			if ( !list.empty() ) {
+				memcpy( &grid.indices[grid.offsets[tile * grid.slices]], &list[0],
+								sizeof( unsigned int ) * list.size() );
+			}
+		}
+	} );
+}
@@ -0,0 +1,65 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Clustered light culling.                                                     |
+| The view frustum is cut into a grid of screen tiles, and each tile's column  |
+| is cut into depth slices that get exponentially thicker with distance. Each  |
+| of these "froxels" (clusters) gets a list of the lights whose spheres touch  |
+| it, so shading a pixel only needs to loop over its own cluster's lights.     |
+| 1. all lights are tested against the whole view frustum, 4 at a time with    |
+|    SSE, then every tile tests the survivors against its own 4 side planes,   |
+|    giving a short candidate list for that tile                               |
+| 2. candidates are sorted into the tile's depth slices by their depth range   |
+| 3. all tile lists are packed into one flat index array                       |
+| Tiles are independent so they are shared out between threads. Nothing here   |
+| calls GL, so it can be tested and timed on its own.                          |
+\******************************************************************************/
+#ifndef _LIGHT_CLUSTER_H_
+#define _LIGHT_CLUSTER_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+struct light_grid_t {
+	int viewport_width, viewport_height;
+	int tile_size; // in pixels
+	int tiles_x, tiles_y, slices;
+	float near, far; // view depth range that is sliced, from the projection matrix
+	/* per-cluster start and length in indices. clusters are ordered by tile then
+	by slice, so a cluster index is ( tile_y * tiles_x + tile_x ) * slices + slice */
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> counts;
+	std::vector<unsigned int> indices; // light indices, all clusters back to back
+	/* every light that reaches into the view at all, in index order */
+	std::vector<unsigned int> light_ids;
+	/* scratch space kept between builds to avoid re-allocating every frame */
+	std::vector<float> view_x, view_y, view_z, radii;
+	std::vector<std::vector<unsigned int> > tile_lists;
+};
+
+/* sets up an empty grid. P must be a perspective matrix from perspective() */
+void light_grid_init( light_grid_t &grid, const mat4 &P, int viewport_width,
+											int viewport_height, int tile_size, int slices );
+/* fills only grid.light_ids with the lights, given in world space, that reach
+into the view of a camera with view matrix V and the P that the grid was set up
+with. this is step 1's whole-view test, on this thread, without the clusters */
+void light_grid_cull_view( light_grid_t &grid, const mat4 &P, const mat4 &V,
+													 const vec3 *light_pos_wor, const float *light_radii,
+													 int light_count );
+/* bins light spheres, given in world space, into the grid's clusters, for a
+camera with view matrix V and the P that the grid was set up with */
+void light_grid_build( light_grid_t &grid, const mat4 &P, const mat4 &V,
+											 const vec3 *light_pos_wor, const float *light_radii,
+											 int light_count, int thread_count );
+/* depth slice containing a positive view-space depth, clamped to the grid */
+int light_grid_slice( const light_grid_t &grid, float view_depth );
+/* cluster for a pixel (0,0 is bottom-left like gl_FragCoord) and view depth */
+int light_grid_cluster( const light_grid_t &grid, int pixel_x, int pixel_y,
+												float view_depth );
+
+#endif
@@ -1,19 +1,46 @@
 
 
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h" // Sean Barrett's image writer
+#include "deferred_resolve.h"
+#include "gbuffer_pack.h"
 #include "gl_utils.h"
+#include "light_cluster.h"
 #include "maths_funcs.h"
 #include "obj_parser.h"
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <thread>
 
+/* compact G-buffer: keep just depth and 2x16-bit normals, and work positions
+out from depth. comment out to use full float position and normal textures */
+#define COMPACT_G_BUFFER
 #define FIRST_PASS_VS "first_pass.vert"
-#define FIRST_PASS_FS "first_pass.frag"
 #define SECOND_PASS_VS "second_pass.vert"
+#ifdef COMPACT_G_BUFFER
+#define FIRST_PASS_FS "first_pass_compact.frag"
+#define SECOND_PASS_FS "second_pass_compact.frag"
+#else
+#define FIRST_PASS_FS "first_pass.frag"
 #define SECOND_PASS_FS "second_pass.frag"
+#endif
 #define SPHERE_FILE "sphere.obj"
 #define PLANE_FILE "plane.obj"
 #define NUM_LIGHTS 64
+/* light culling grid: tile size in pixels and number of depth slices */
+#define LIGHT_TILE_SIZE 32
+#define LIGHT_DEPTH_SLICES 16
+/* the start-up benchmarks take seconds and lots of memory before the first
+frame, so they only run when this is uncommented */
+//#define RUN_BENCHMARKS
+/* number of lights in the start-up light culling benchmark */
+#define BENCH_NUM_LIGHTS 10000
+/* image written by the CPU reference resolve */
+#define CPU_RESOLVE_FILE "cpu_resolve.png"
+/* colour difference, out of 255, that counts as a mismatch with the GPU image */
+#define RESOLVE_TOLERANCE 2
 
 int g_gl_width = 800;
 int g_gl_height = 800;
@@ -23,6 +50,7 @@ GLFWwindow *g_window;
 GLuint g_fb;
 GLuint g_fb_tex_p; /* G-buffer hog_L_ding positions in a texture */
 GLuint g_fb_tex_n; /* G-buffer hog_L_ding normag_L_s in a texture */
+GLuint g_fb_tex_depth; /* depth buffer, also read back for positions */
 /* 3d sphere representing light coverage area */
 GLuint g_sphere_vao;
 int g_sphere_point_count;
@@ -44,6 +72,8 @@ GLint g_second_pass_L_d_loc = -1;		/* light diffuse colour uniform location */
 GLint g_second_pass_L_s_loc = -1;		/* light specular colour uniform location */
 GLint g_second_pass_p_tex_loc = -1; /* positions texture uniform location */
 GLint g_second_pass_n_tex_loc = -1; /* normals texture uniform location */
+GLint g_second_pass_depth_tex_loc = -1; /* depth texture uniform location */
+GLint g_second_pass_inv_P_loc = -1; /* inverse projection uniform location */
 
 /* objects to be lit. model matrices */
 mat4 g_plane_M;
@@ -54,6 +84,12 @@ mat4 g_L_M[NUM_LIGHTS];
 /* light colours */
 vec3 g_L_d[NUM_LIGHTS];
 vec3 g_L_s[NUM_LIGHTS];
+/* radius of each light's area of effect */
+float g_L_r[NUM_LIGHTS];
+
+/* per-cluster light lists, rebuilt every frame */
+light_grid_t g_light_grid;
+int g_num_threads = 1;
 
 /* virtual camera projection and view matrices */
 mat4 g_P;
@@ -65,6 +101,19 @@ the framebuffer. we will attach a renderbuffer which allows us to depth sort
 and write the front-most geometry data into each texture's texel */
 bool init_fb() {
 	glGenFramebuffers( 1, &g_fb );
+	glBindFramebuffer( GL_FRAMEBUFFER, g_fb );
+#ifdef COMPACT_G_BUFFER
+	/* positions come from the depth texture, so only normals need a texture.
+	octahedral-encoded into 2 channels of 16 bits (see gbuffer_pack.h) */
+	glGenTextures( 1, &g_fb_tex_n );
+	glBindTexture( GL_TEXTURE_2D, g_fb_tex_n );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RG16, g_gl_width, g_gl_height, 0, GL_RG,
+								GL_UNSIGNED_SHORT, NULL );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+#else
 	glGenTextures( 1, &g_fb_tex_p );
 	glBindTexture( GL_TEXTURE_2D, g_fb_tex_p );
 	/* note 16-bit float RGB format used for positions */
@@ -85,12 +134,12 @@ bool init_fb() {
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+#endif
 
 	/* depth texture instead of a renderbuffer */
-	GLuint depth_tex;
-	glGenTextures( 1, &depth_tex );
+	glGenTextures( 1, &g_fb_tex_depth );
 	glActiveTexture( GL_TEXTURE0 );
-	glBindTexture( GL_TEXTURE_2D, depth_tex );
+	glBindTexture( GL_TEXTURE_2D, g_fb_tex_depth );
 	glTexImage2D( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, g_gl_width, g_gl_height, 0,
 								GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, NULL );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
@@ -99,12 +148,17 @@ bool init_fb() {
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 	// attach depth texture to framebuffer
 	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
-													depth_tex, 0 );
+													g_fb_tex_depth, 0 );
 
 	/* attach textures to framebuffer. the attachment numbers 0 and 1 don't
 	automatically corresponed to frament shader output locations 0 and 1, so we
 	specify that afterwards */
-	glBindFramebuffer( GL_FRAMEBUFFER, g_fb );
+#ifdef COMPACT_G_BUFFER
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+													g_fb_tex_n, 0 );
+	GLenum draw_bufs[] = { GL_COLOR_ATTACHMENT0 };
+	glDrawBuffers( 1, draw_bufs );
+#else
 	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
 													g_fb_tex_p, 0 );
 	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D,
@@ -112,6 +166,7 @@ bool init_fb() {
 	/* the first item in this array matches fragment shader output location 0 */
 	GLenum draw_bufs[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
 	glDrawBuffers( 2, draw_bufs );
+#endif
 
 	/* validate g_fb and return false on error */
 	GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
@@ -122,6 +177,24 @@ bool init_fb() {
 	return true;
 }
 
+/* bytes of G-buffer each lit pixel reads per light, and each first-pass
+fragment writes (depth included), for the format in use */
+void log_g_buffer_bandwidth() {
+	int full_read = 12 + 6;			 // RGB32F position + RGB16F normal
+	int full_write = full_read + 4; // + 32-bit depth
+#ifdef COMPACT_G_BUFFER
+	int read = 4 + 4; // 32-bit depth + RG16 normal
+	int write = read;
+	gl_log( "compact G-buffer: %i bytes read per pixel per light, %i written per "
+					"fragment (full-float G-buffer: %i and %i)\n",
+					read, write, full_read, full_write );
+#else
+	gl_log( "full-float G-buffer: %i bytes read per pixel per light, %i written per "
+					"fragment\n",
+					full_read, full_write );
+#endif
+}
+
 /* load the ground plane */
 bool load_plane() {
 	float *points = NULL;
@@ -222,7 +295,11 @@ void draw_second_pass() {
 	glDepthMask( GL_FALSE );
 
 	glActiveTexture( GL_TEXTURE0 );
+#ifdef COMPACT_G_BUFFER
+	glBindTexture( GL_TEXTURE_2D, g_fb_tex_depth );
+#else
 	glBindTexture( GL_TEXTURE_2D, g_fb_tex_p );
+#endif
 	glActiveTexture( GL_TEXTURE1 );
 	glBindTexture( GL_TEXTURE_2D, g_fb_tex_n );
 
@@ -232,8 +309,15 @@ void draw_second_pass() {
 	/* virtual camera matrices */
 	glUniformMatrix4fv( g_second_pass_P_loc, 1, GL_FALSE, g_P.m );
 	glUniformMatrix4fv( g_second_pass_V_loc, 1, GL_FALSE, g_V.m );
-
-	for ( int i = 0; i < NUM_LIGHTS; i++ ) {
+#ifdef COMPACT_G_BUFFER
+	/* for getting eye-space positions back from depth */
+	glUniformMatrix4fv( g_second_pass_inv_P_loc, 1, GL_FALSE, inverse( g_P ).m );
+#endif
+
+	/* only lights whose spheres reach into the view need a light volume drawn */
+	light_grid_cull_view( g_light_grid, g_P, g_V, g_L_p, g_L_r, NUM_LIGHTS );
+	for ( size_t l = 0; l < g_light_grid.light_ids.size(); l++ ) {
+		int i = (int)g_light_grid.light_ids[l];
 		/* world position */
 		glUniform3f( g_second_pass_L_p_loc, g_L_p[i].v[0], g_L_p[i].v[1],
 								 g_L_p[i].v[2] );
@@ -249,10 +333,118 @@ void draw_second_pass() {
 	}
 }
 
+/* times light_grid_build() with lots of lights scattered over the plane, and
+writes the results to the log */
+void benchmark_light_culling() {
+	light_grid_t grid;
+	light_grid_init( grid, g_P, g_gl_width, g_gl_height, LIGHT_TILE_SIZE,
+									 LIGHT_DEPTH_SLICES );
+	vec3 *positions = (vec3 *)malloc( sizeof( vec3 ) * BENCH_NUM_LIGHTS );
+	float *radii = (float *)malloc( sizeof( float ) * BENCH_NUM_LIGHTS );
+	for ( int i = 0; i < BENCH_NUM_LIGHTS; i++ ) {
+		positions[i] = vec3( (float)( rand() % 4000 ) * 0.1f - 200.0f, 2.0f,
+												 (float)( rand() % 4000 ) * 0.1f - 200.0f );
+		radii[i] = 10.0f;
+	}
+	const int runs = 20;
+	double start = glfwGetTime();
+	for ( int r = 0; r < runs; r++ ) {
+		light_grid_build( grid, g_P, g_V, positions, radii, BENCH_NUM_LIGHTS,
+											g_num_threads );
+	}
+	double ms = ( glfwGetTime() - start ) * 1000.0 / runs;
+	gl_log( "clustered culling of %i lights into %ix%ix%i clusters, %i threads: "
+					"%.3fms. %i lights visible, %i cluster entries\n",
+					BENCH_NUM_LIGHTS, grid.tiles_x, grid.tiles_y, grid.slices,
+					g_num_threads, ms, (int)grid.light_ids.size(),
+					(int)grid.indices.size() );
+	free( positions );
+	free( radii );
+}
+
+/* lights the current G-buffer on the CPU, writes the result to an image, and
+compares it with what draw_second_pass() just put in the back buffer. call
+before swapping buffers */
+void compare_cpu_resolve() {
+	int pixel_count = g_gl_width * g_gl_height;
+	float *positions = (float *)malloc( sizeof( float ) * 3 * pixel_count );
+	float *normals = (float *)malloc( sizeof( float ) * 3 * pixel_count );
+	float *rgb = (float *)malloc( sizeof( float ) * 3 * pixel_count );
+	unsigned char *cpu = (unsigned char *)malloc( 3 * pixel_count );
+	unsigned char *gpu = (unsigned char *)malloc( 3 * pixel_count );
+
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+#ifdef COMPACT_G_BUFFER
+	/* decode the compact G-buffer the same way second_pass_compact.frag does */
+	float *depths = (float *)malloc( sizeof( float ) * pixel_count );
+	unsigned short *packed_normals =
+		(unsigned short *)malloc( sizeof( unsigned short ) * 2 * pixel_count );
+	glBindTexture( GL_TEXTURE_2D, g_fb_tex_depth );
+	glGetTexImage( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, depths );
+	glBindTexture( GL_TEXTURE_2D, g_fb_tex_n );
+	glGetTexImage( GL_TEXTURE_2D, 0, GL_RG, GL_UNSIGNED_SHORT, packed_normals );
+	unpack_g_buffer( depths, packed_normals, g_gl_width, g_gl_height, g_P, positions,
+									 normals );
+	free( depths );
+	free( packed_normals );
+#else
+	glBindTexture( GL_TEXTURE_2D, g_fb_tex_p );
+	glGetTexImage( GL_TEXTURE_2D, 0, GL_RGB, GL_FLOAT, positions );
+	glBindTexture( GL_TEXTURE_2D, g_fb_tex_n );
+	glGetTexImage( GL_TEXTURE_2D, 0, GL_RGB, GL_FLOAT, normals );
+#endif
+	glReadPixels( 0, 0, g_gl_width, g_gl_height, GL_RGB, GL_UNSIGNED_BYTE, gpu );
+
+	double start = glfwGetTime();
+	deferred_resolve( positions, normals, g_gl_width, g_gl_height, g_V, g_L_p, g_L_d,
+										g_L_s, NUM_LIGHTS, default_phong_material(), rgb,
+										g_num_threads );
+	double secs = glfwGetTime() - start;
+	resolve_to_rgb8( rgb, pixel_count, cpu );
+
+	int max_diff = 0;
+	int mismatches = 0;
+	for ( int i = 0; i < pixel_count; i++ ) {
+		int pixel_diff = 0;
+		for ( int c = 0; c < 3; c++ ) {
+			int d = abs( (int)cpu[i * 3 + c] - (int)gpu[i * 3 + c] );
+			pixel_diff = d > pixel_diff ? d : pixel_diff;
+		}
+		max_diff = pixel_diff > max_diff ? pixel_diff : max_diff;
+		if ( pixel_diff > RESOLVE_TOLERANCE ) {
+			mismatches++;
+		}
+	}
+	gl_log( "CPU resolve of %ix%i with %i lights, %i threads: %.3fms (%.1f M "
+					"pixel-lights/s). max difference from GPU %i/255, %i pixels over "
+					"%i/255\n",
+					g_gl_width, g_gl_height, NUM_LIGHTS, g_num_threads, secs * 1000.0,
+					(double)pixel_count * NUM_LIGHTS / secs / 1e6, max_diff, mismatches,
+					RESOLVE_TOLERANCE );
+
+	/* GL rows go bottom to top so write the last row first */
+	unsigned char *last_row = cpu + ( g_gl_width * 3 * ( g_gl_height - 1 ) );
+	if ( !stbi_write_png( CPU_RESOLVE_FILE, g_gl_width, g_gl_height, 3, last_row,
+												-3 * g_gl_width ) ) {
+		gl_log_err( "ERROR: could not write %s\n", CPU_RESOLVE_FILE );
+	} else {
+		gl_log( "wrote %s\n", CPU_RESOLVE_FILE );
+	}
+	free( positions );
+	free( normals );
+	free( rgb );
+	free( cpu );
+	free( gpu );
+}
+
 int main() {
 	/* initialise GL context and window */
 	( restart_gl_log() );
 	( start_gl() );
+	g_num_threads = (int)std::thread::hardware_concurrency();
+	if ( g_num_threads < 1 ) {
+		g_num_threads = 1;
+	}
 	/* initialise framebuffer and G-buffer */
 
 	/* object positions and matrices */
@@ -276,9 +468,16 @@ int main() {
 	g_second_pass_L_s_loc = glGetUniformLocation( g_second_pass_sp, "ls" );
 	g_second_pass_p_tex_loc = glGetUniformLocation( g_second_pass_sp, "p_tex" );
 	g_second_pass_n_tex_loc = glGetUniformLocation( g_second_pass_sp, "n_tex" );
+	g_second_pass_depth_tex_loc = glGetUniformLocation( g_second_pass_sp, "depth_tex" );
+	g_second_pass_inv_P_loc = glGetUniformLocation( g_second_pass_sp, "inv_P" );
 	glUseProgram( g_second_pass_sp );
+#ifdef COMPACT_G_BUFFER
+	glUniform1i( g_second_pass_depth_tex_loc, 0 );
+#else
 	glUniform1i( g_second_pass_p_tex_loc, 0 );
+#endif
 	glUniform1i( g_second_pass_n_tex_loc, 1 );
+	log_g_buffer_bandwidth();
 
 	/* load sphere mesh */
 	( load_sphere() );
@@ -302,6 +501,7 @@ int main() {
 		g_L_d[i] = vec3( (float)( ( redi + 1 ) / 3 ), (float)( ( greeni + 1 ) / 3 ),
 										 (float)( ( bluei + 1 ) / 3 ) );
 		g_L_s[i] = vec3( 1.0, 1.0, 1.0 );
+		g_L_r[i] = light_radius;
 		redi = ( redi + 1 ) % 3;
 		bluei = ( bluei + 1 ) % 3;
 		greeni = ( greeni + 1 ) % 3;
@@ -318,14 +518,27 @@ int main() {
 	vec3 cam_pos( 0.0f, 30.0f, 30.0f );
 	g_V = look_at( cam_pos, targ_pos, up );
 
+	light_grid_init( g_light_grid, g_P, g_gl_width, g_gl_height, LIGHT_TILE_SIZE,
+									 LIGHT_DEPTH_SLICES );
+#ifdef RUN_BENCHMARKS
+	benchmark_light_culling();
+#endif
+
 	glViewport( 0, 0, g_gl_width, g_gl_height );
 	glEnable( GL_CULL_FACE ); // cull face
 	glCullFace( GL_BACK );		// cull back face
 	glFrontFace( GL_CCW );		// GL_CCW for counter clock-wise
+	bool r_was_down = false;
 	while ( !glfwWindowShouldClose( g_window ) ) {
 		_update_fps_counter( g_window );
 		draw_first_pass();
 		draw_second_pass();
+		/* R compares the frame with the CPU reference resolve */
+		bool r_is_down = GLFW_PRESS == glfwGetKey( g_window, GLFW_KEY_R );
+		if ( r_is_down && !r_was_down ) {
+			compare_cpu_resolve();
+		}
+		r_was_down = r_is_down;
 
 		glfwSwapBuffers( g_window );
 		glfwPollEvents();
@@ -0,0 +1,39 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Worker threads                                                               |
+| Splits work over std::threads. Shared by the modules of this demo that do    |
+| their work on more than one thread.                                          |
+\******************************************************************************/
+#ifndef _RUN_THREADS_H_
+#define _RUN_THREADS_H_
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+/* runs func( thread_index ) on thread_count threads, including this one, and
+returns once they have all finished */
+inline void run_on_threads( int thread_count, const std::function<void( int )> &func ) {
+	std::vector<std::thread> threads;
+	for ( int t = 1; t < thread_count; t++ ) {
+		threads.push_back( std::thread( func, t ) );
+	}
+	func( 0 );
+	for ( size_t t = 0; t < threads.size(); t++ ) {
+		threads[t].join();
+	}
+}
+
+/* first of count items that thread t of thread_count starts at. its share
+ends where thread t + 1's starts */
+inline int share_start( int count, int t, int thread_count ) {
+	return (int)( (long long)count * t / thread_count );
+}
+
+#endif
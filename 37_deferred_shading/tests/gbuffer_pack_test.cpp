@@ -0,0 +1,253 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Compact G-buffer tests                                                       |
+| Checks gbuffer_pack.h without GL: octahedral normals round-trip to within a  |
+| small angle all over the sphere, including the poles, the axes, and either   |
+| side of the z = 0 seam where the back half is folded. Positions projected    |
+| with the demo's camera come back from the depth value, and a whole G-buffer  |
+| unpacks to the same positions and normals, with zeros for the background.    |
+| Build and run with "make -f Makefile.linux64 test".                          |
+\******************************************************************************/
+#include "gbuffer_pack.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// points spread evenly over the sphere
+#define TEST_NORMALS 200000
+// 16 bits per channel should keep normals this close, in degrees
+#define TEST_MAX_NORMAL_ERROR_DEG 0.01
+// eye-space points put through the projection and back
+#define TEST_POSITIONS 100000
+// largest error in a reconstructed position, relative to its distance
+#define TEST_MAX_POSITION_ERROR 1e-4f
+// the demo's camera
+#define TEST_FOVY 67.0f
+#define TEST_NEAR 0.1f
+#define TEST_FAR 1000.0f
+#define TEST_WIDTH 640
+#define TEST_HEIGHT 480
+
+static int g_failures = 0;
+
+#define CHECK( cond )                                                         \
+	do {                                                                        \
+		if ( !( cond ) ) {                                                        \
+			fprintf( stderr, "FAILED %s:%i: %s\n", __FILE__, __LINE__, #cond );     \
+			g_failures++;                                                           \
+		}                                                                         \
+	} while ( 0 )
+
+static float random_float( float lo, float hi ) {
+	return lo + ( hi - lo ) * (float)rand() / (float)RAND_MAX;
+}
+
+/* angle in degrees between two unit vectors, from the sine and cosine so that
+small angles come out right */
+static double angle_deg( const float *a, const float *b ) {
+	double cx = (double)a[1] * b[2] - (double)a[2] * b[1];
+	double cy = (double)a[2] * b[0] - (double)a[0] * b[2];
+	double cz = (double)a[0] * b[1] - (double)a[1] * b[0];
+	double d = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+	return atan2( sqrt( cx * cx + cy * cy + cz * cz ), d ) * 180.0 / M_PI;
+}
+
+/* encodes and decodes n, which is normalised first. returns the angle
+between n and what came back, and checks that it came back unit length */
+static double round_trip_deg( float x, float y, float z ) {
+	float len = sqrtf( x * x + y * y + z * z );
+	float n[3] = { x / len, y / len, z / len };
+	unsigned short rg[2];
+	float back[3];
+	oct_encode_normal( n, rg );
+	oct_decode_normal( rg, back );
+	float back_len = sqrtf( back[0] * back[0] + back[1] * back[1] + back[2] * back[2] );
+	CHECK( fabsf( back_len - 1.0f ) < 1e-5f );
+	return angle_deg( n, back );
+}
+
+static void test_normals() {
+	/* a Fibonacci spiral from one pole to the other */
+	double max_deg = 0.0;
+	for ( int i = 0; i < TEST_NORMALS; i++ ) {
+		double z = 1.0 - ( 2.0 * i + 1.0 ) / TEST_NORMALS;
+		double r = sqrt( 1.0 - z * z );
+		double a = i * M_PI * ( 3.0 - sqrt( 5.0 ) );
+		max_deg = fmax( max_deg, round_trip_deg( (float)( r * cos( a ) ), (float)( r * sin( a ) ),
+																						 (float)z ) );
+	}
+	printf( "%i normals over the sphere: largest error %g deg\n", TEST_NORMALS, max_deg );
+	CHECK( max_deg <= TEST_MAX_NORMAL_ERROR_DEG );
+
+	/* the poles, the axes, the octahedron's edges, and normals just either
+	side of the seam, including ones on the x = 0 and y = 0 edges of the back
+	half, where sign_not_zero() decides which corner they fold to */
+	const float specials[][3] = { { 0.0f, 0.0f, 1.0f },		{ 0.0f, 0.0f, -1.0f },
+																{ 1.0f, 0.0f, 0.0f },		{ -1.0f, 0.0f, 0.0f },
+																{ 0.0f, 1.0f, 0.0f },		{ 0.0f, -1.0f, 0.0f },
+																{ 1.0f, 1.0f, 0.0f },		{ -1.0f, 1.0f, 0.0f },
+																{ 1.0f, -1.0f, 0.0f },	{ -1.0f, -1.0f, 0.0f },
+																{ 0.0f, 0.6f, -0.8f },	{ -0.0f, 0.6f, -0.8f },
+																{ 0.6f, 0.0f, -0.8f },	{ 0.6f, -0.0f, -0.8f },
+																{ 0.0f, -0.6f, -0.8f }, { -0.6f, 0.0f, -0.8f },
+																{ 1e-7f, 0.6f, -0.8f }, { -1e-7f, 0.6f, -0.8f },
+																{ 0.3f, 0.4f, 1e-7f },	{ 0.3f, 0.4f, -1e-7f },
+																{ -0.3f, 0.4f, 1e-7f }, { -0.3f, 0.4f, -1e-7f },
+																{ 1e-7f, 1e-7f, 1.0f }, { 1e-7f, 1e-7f, -1.0f },
+																{ -1e-7f, -1e-7f, -1.0f } };
+	int count = (int)( sizeof( specials ) / sizeof( specials[0] ) );
+	double max_special_deg = 0.0;
+	for ( int i = 0; i < count; i++ ) {
+		max_special_deg =
+			fmax( max_special_deg, round_trip_deg( specials[i][0], specials[i][1], specials[i][2] ) );
+	}
+
+	/* random normals within a hair of the seam, on both sides */
+	for ( int i = 0; i < TEST_NORMALS / 10; i++ ) {
+		float a = random_float( 0.0f, 2.0f * (float)M_PI );
+		float z = random_float( -1e-3f, 1e-3f );
+		max_special_deg = fmax( max_special_deg, round_trip_deg( cosf( a ), sinf( a ), z ) );
+	}
+	printf( "poles, axes, edges and the seam: largest error %g deg\n", max_special_deg );
+	CHECK( max_special_deg <= TEST_MAX_NORMAL_ERROR_DEG );
+
+	/* +z is the middle of the square, 32767.5, which GL rounds to nearest when
+	it writes a unorm texel, as the shaders' output is */
+	const float up[3] = { 0.0f, 0.0f, 1.0f };
+	unsigned short rg[2];
+	oct_encode_normal( up, rg );
+	CHECK( 32768 == rg[0] && 32768 == rg[1] );
+}
+
+/* eye-space point to window x, y and depth, the way GL does it. done in
+double, so the only rounding is storing the results as floats, like a
+GL_DEPTH_COMPONENT32F depth buffer */
+static void project( const mat4 &P, const float *p, int width, int height, float *window_x,
+										 float *window_y, float *depth ) {
+	double clip[4];
+	for ( int r = 0; r < 4; r++ ) {
+		clip[r] = (double)P.m[r] * p[0] + (double)P.m[4 + r] * p[1] + (double)P.m[8 + r] * p[2] +
+							P.m[12 + r];
+	}
+	*window_x = (float)( ( clip[0] / clip[3] * 0.5 + 0.5 ) * width );
+	*window_y = (float)( ( clip[1] / clip[3] * 0.5 + 0.5 ) * height );
+	*depth = (float)( clip[2] / clip[3] * 0.5 + 0.5 );
+}
+
+/* a random point in view, between distance near_d and far_d */
+static void random_eye_point( float near_d, float far_d, float *p ) {
+	float tan_y = tanf( TEST_FOVY * 0.5f * (float)M_PI / 180.0f );
+	float tan_x = tan_y * (float)TEST_WIDTH / (float)TEST_HEIGHT;
+	float d = near_d * powf( far_d / near_d, random_float( 0.0f, 1.0f ) );
+	p[0] = random_float( -tan_x, tan_x ) * d;
+	p[1] = random_float( -tan_y, tan_y ) * d;
+	p[2] = -d;
+}
+
+static void test_positions() {
+	mat4 P = perspective( TEST_FOVY, (float)TEST_WIDTH / (float)TEST_HEIGHT, TEST_NEAR, TEST_FAR );
+	mat4 inv_P = inverse( P );
+	float max_error = 0.0f;
+	for ( int i = 0; i < TEST_POSITIONS; i++ ) {
+		// the demo's scene is within 100 units of the camera
+		float p[3], back[3];
+		random_eye_point( TEST_NEAR * 2.0f, 100.0f, p );
+		float wx, wy, depth;
+		project( P, p, TEST_WIDTH, TEST_HEIGHT, &wx, &wy, &depth );
+		reconstruct_eye_position( inv_P, wx, wy, depth, TEST_WIDTH, TEST_HEIGHT, back );
+		float dx = back[0] - p[0], dy = back[1] - p[1], dz = back[2] - p[2];
+		float dist = sqrtf( p[0] * p[0] + p[1] * p[1] + p[2] * p[2] );
+		max_error = fmaxf( max_error, sqrtf( dx * dx + dy * dy + dz * dz ) / dist );
+	}
+	printf( "%i positions from depth: largest error %g of the distance\n", TEST_POSITIONS,
+					max_error );
+	CHECK( max_error <= TEST_MAX_POSITION_ERROR );
+
+	/* the middle of the near plane, and just inside the far plane */
+	float p[3], depth, wx, wy;
+	reconstruct_eye_position( inv_P, TEST_WIDTH * 0.5f, TEST_HEIGHT * 0.5f, 0.0f, TEST_WIDTH,
+														TEST_HEIGHT, p );
+	CHECK( fabsf( p[0] ) < 1e-6f && fabsf( p[1] ) < 1e-6f && fabsf( p[2] + TEST_NEAR ) < 1e-6f );
+	float far_point[3] = { 0.0f, 0.0f, -TEST_FAR * 0.9f };
+	project( P, far_point, TEST_WIDTH, TEST_HEIGHT, &wx, &wy, &depth );
+	reconstruct_eye_position( inv_P, wx, wy, depth, TEST_WIDTH, TEST_HEIGHT, p );
+	CHECK( fabsf( p[2] - far_point[2] ) < 0.01f * TEST_FAR );
+}
+
+/* a small G-buffer with a point and a normal behind each pixel centre, and
+some background */
+static void test_unpack() {
+	const int width = 16, height = 12;
+	mat4 P = perspective( TEST_FOVY, (float)width / (float)height, TEST_NEAR, TEST_FAR );
+	mat4 inv_P = inverse( P );
+	std::vector<float> depths( width * height ), expected( width * height * 3 );
+	std::vector<unsigned short> packed( width * height * 2 );
+	std::vector<float> positions( width * height * 3, -1.0f ), normals( width * height * 3, -1.0f );
+	for ( int i = 0; i < width * height; i++ ) {
+		if ( i % 7 == 3 ) {
+			depths[i] = 1.0f;
+			continue;
+		}
+		// a point somewhere along the ray through this pixel's centre
+		float ray[3];
+		reconstruct_eye_position( inv_P, (float)( i % width ) + 0.5f, (float)( i / width ) + 0.5f,
+															0.0f, width, height, ray );
+		float scale = random_float( 2.0f, 500.0f );
+		float p[3] = { ray[0] * scale, ray[1] * scale, ray[2] * scale };
+		float wx, wy;
+		project( P, p, width, height, &wx, &wy, &depths[i] );
+		for ( int k = 0; k < 3; k++ ) {
+			expected[i * 3 + k] = p[k];
+		}
+		float n[3] = { random_float( -1.0f, 1.0f ), random_float( -1.0f, 1.0f ),
+									 random_float( -1.0f, 1.0f ) };
+		float len = sqrtf( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+		for ( int k = 0; k < 3; k++ ) {
+			n[k] /= len;
+		}
+		oct_encode_normal( n, &packed[i * 2] );
+	}
+	unpack_g_buffer( &depths[0], &packed[0], width, height, P, &positions[0], &normals[0] );
+
+	bool background_zero = true, normals_match = true;
+	float max_error = 0.0f;
+	for ( int i = 0; i < width * height; i++ ) {
+		const float *p = &positions[i * 3], *n = &normals[i * 3];
+		if ( depths[i] >= 1.0f ) {
+			background_zero = background_zero && p[0] == 0.0f && p[1] == 0.0f && p[2] == 0.0f &&
+												n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f;
+			continue;
+		}
+		const float *e = &expected[i * 3];
+		float dx = p[0] - e[0], dy = p[1] - e[1], dz = p[2] - e[2];
+		float dist = sqrtf( e[0] * e[0] + e[1] * e[1] + e[2] * e[2] );
+		max_error = fmaxf( max_error, sqrtf( dx * dx + dy * dy + dz * dz ) / dist );
+		float decoded[3];
+		oct_decode_normal( &packed[i * 2], decoded );
+		normals_match = normals_match && n[0] == decoded[0] && n[1] == decoded[1] &&
+										n[2] == decoded[2];
+	}
+	CHECK( background_zero );
+	CHECK( normals_match );
+	CHECK( max_error <= TEST_MAX_POSITION_ERROR );
+}
+
+int main() {
+	srand( 1 );
+	test_normals();
+	test_positions();
+	test_unpack();
+	if ( g_failures ) {
+		fprintf( stderr, "%i checks failed\n", g_failures );
+		return 1;
+	}
+	printf( "gbuffer_pack_test passed\n" );
+	return 0;
+}
@@ -0,0 +1,148 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Clustered light culling tests                                                |
+| Checks light_grid_build() without GL: no lights, no visible lights, the same |
+| clusters on 1 and 4 threads, and that no cluster misses a light whose sphere |
+| holds a point in it. Build and run with "make -f Makefile.linux64 test".     |
+\******************************************************************************/
+#include "light_cluster.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_WIDTH 640
+#define TEST_HEIGHT 480
+#define TEST_TILE_SIZE 32
+#define TEST_SLICES 16
+#define TEST_LIGHTS 2000
+#define TEST_POINTS 20000
+
+static int g_failures = 0;
+
+#define CHECK( cond )                                                         \
+	do {                                                                        \
+		if ( !( cond ) ) {                                                        \
+			fprintf( stderr, "FAILED %s:%i: %s\n", __FILE__, __LINE__, #cond );     \
+			g_failures++;                                                           \
+		}                                                                         \
+	} while ( 0 )
+
+static float random_float( float lo, float hi ) {
+	return lo + ( hi - lo ) * (float)rand() / (float)RAND_MAX;
+}
+
+static bool grid_is_empty( const light_grid_t &grid ) {
+	for ( size_t c = 0; c < grid.counts.size(); c++ ) {
+		if ( grid.counts[c] != 0 ) {
+			return false;
+		}
+	}
+	return grid.indices.empty() && grid.light_ids.empty();
+}
+
+static void test_no_lights( const mat4 &P, const mat4 &V ) {
+	light_grid_t grid;
+	light_grid_init( grid, P, TEST_WIDTH, TEST_HEIGHT, TEST_TILE_SIZE, TEST_SLICES );
+	light_grid_build( grid, P, V, NULL, NULL, 0, 4 );
+	CHECK( grid_is_empty( grid ) );
+	light_grid_cull_view( grid, P, V, NULL, NULL, 0 );
+	CHECK( grid.light_ids.empty() );
+
+	/* lights that were there last build, then all behind the camera */
+	vec3 pos[5];
+	float radii[5];
+	for ( int i = 0; i < 5; i++ ) {
+		pos[i] = vec3( 0.0f, 0.0f, -5.0f );
+		radii[i] = 1.0f;
+	}
+	light_grid_build( grid, P, V, pos, radii, 5, 2 );
+	CHECK( grid.light_ids.size() == 5 );
+	for ( int i = 0; i < 5; i++ ) {
+		pos[i] = vec3( 0.0f, 0.0f, 5.0f );
+	}
+	light_grid_build( grid, P, V, pos, radii, 5, 2 );
+	CHECK( grid_is_empty( grid ) );
+}
+
+static void test_clusters( const mat4 &P, const mat4 &V ) {
+	std::vector<vec3> pos( TEST_LIGHTS );
+	std::vector<float> radii( TEST_LIGHTS );
+	for ( int i = 0; i < TEST_LIGHTS; i++ ) {
+		pos[i] = vec3( random_float( -40.0f, 40.0f ), random_float( -10.0f, 10.0f ),
+									 random_float( -60.0f, 10.0f ) );
+		radii[i] = random_float( 0.2f, 4.0f );
+	}
+	light_grid_t one, four;
+	light_grid_init( one, P, TEST_WIDTH, TEST_HEIGHT, TEST_TILE_SIZE, TEST_SLICES );
+	light_grid_init( four, P, TEST_WIDTH, TEST_HEIGHT, TEST_TILE_SIZE, TEST_SLICES );
+	light_grid_build( one, P, V, &pos[0], &radii[0], TEST_LIGHTS, 1 );
+	light_grid_build( four, P, V, &pos[0], &radii[0], TEST_LIGHTS, 4 );
+	CHECK( one.offsets == four.offsets );
+	CHECK( one.counts == four.counts );
+	CHECK( one.indices == four.indices );
+	CHECK( one.light_ids == four.light_ids );
+	CHECK( !one.light_ids.empty() && (int)one.light_ids.size() < TEST_LIGHTS );
+
+	light_grid_t view_only;
+	light_grid_init( view_only, P, TEST_WIDTH, TEST_HEIGHT, TEST_TILE_SIZE, TEST_SLICES );
+	light_grid_cull_view( view_only, P, V, &pos[0], &radii[0], TEST_LIGHTS );
+	CHECK( view_only.light_ids == one.light_ids );
+
+	/* every cluster's lights are visible ones, in index order */
+	for ( size_t c = 0; c < one.counts.size(); c++ ) {
+		const unsigned int *list = one.counts[c] ? &one.indices[one.offsets[c]] : NULL;
+		for ( unsigned int k = 0; k < one.counts[c]; k++ ) {
+			CHECK( std::binary_search( one.light_ids.begin(), one.light_ids.end(), list[k] ) );
+			if ( k > 0 ) {
+				CHECK( list[k - 1] < list[k] );
+			}
+		}
+	}
+
+	/* a point inside a light's sphere must find that light in its cluster */
+	int checked = 0;
+	for ( int n = 0; n < TEST_POINTS; n++ ) {
+		int px = rand() % TEST_WIDTH, py = rand() % TEST_HEIGHT;
+		float depth = random_float( one.near, one.far * 0.5f );
+		float x_ndc = 2.0f * ( px + 0.5f ) / TEST_WIDTH - 1.0f;
+		float y_ndc = 2.0f * ( py + 0.5f ) / TEST_HEIGHT - 1.0f;
+		vec4 p_eye( ( x_ndc + P.m[8] ) * depth / P.m[0], ( y_ndc + P.m[9] ) * depth / P.m[5],
+								-depth, 1.0f );
+		vec4 p_wor = inverse( V ) * p_eye;
+		int cluster = light_grid_cluster( one, px, py, depth );
+		const unsigned int *begin = &one.indices[0] + one.offsets[cluster];
+		const unsigned int *end = begin + one.counts[cluster];
+		for ( int i = 0; i < TEST_LIGHTS; i++ ) {
+			vec3 d = vec3( p_wor ) - pos[i];
+			if ( dot( d, d ) < radii[i] * radii[i] * 0.999f ) {
+				checked++;
+				CHECK( std::binary_search( begin, end, (unsigned int)i ) );
+			}
+		}
+	}
+	CHECK( checked > 0 );
+	printf( "%i lights, %i visible, %i cluster entries, %i lit points checked\n", TEST_LIGHTS,
+					(int)one.light_ids.size(), (int)one.indices.size(), checked );
+}
+
+int main() {
+	srand( 1 );
+	mat4 P = perspective( 67.0f, (float)TEST_WIDTH / TEST_HEIGHT, 0.1f, 100.0f );
+	mat4 V = look_at( vec3( 0.0f, 2.0f, 5.0f ), vec3( 0.0f, 0.0f, -10.0f ),
+										vec3( 0.0f, 1.0f, 0.0f ) );
+	test_no_lights( P, V );
+	test_clusters( P, V );
+	if ( g_failures ) {
+		fprintf( stderr, "%i checks failed\n", g_failures );
+		return 1;
+	}
+	printf( "light_cluster_test passed\n" );
+	return 0;
+}
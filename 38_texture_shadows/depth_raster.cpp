@@ -0,0 +1,342 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU depth-only rasteriser. See depth_raster.h                                |
+\******************************************************************************/
+#include "depth_raster.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define DEPTH_RASTER_SSE
+#endif
+
+/* a triangle after transform, clipping, and viewport mapping. x and y are in
+buffer pixels, z is window-space depth. always wound counter-clockwise */
+struct screen_tri_t {
+	float x[3], y[3], z[3];
+};
+
+void depth_buffer_resize( depth_buffer_t &buffer, int width, int height ) {
+	buffer.width = width;
+	buffer.height = height;
+	buffer.stride = ( width + 3 ) & ~3;
+	buffer.depths.assign( buffer.stride * height, 1.0f );
+}
+
+/* clip a triangle against the near plane (z >= -w in clip space), the only
+plane where skipping clipping breaks the perspective divide. the others are
+handled by clamping to the buffer. writes up to 4 polygon vertices */
+static int clip_near( const vec4 in[3], vec4 out[4] ) {
+	int n = 0;
+	for ( int i = 0; i < 3; i++ ) {
+		const vec4 &a = in[i];
+		const vec4 &b = in[( i + 1 ) % 3];
+		float da = a.v[2] + a.v[3];
+		float db = b.v[2] + b.v[3];
+		if ( da >= 0.0f ) {
+			out[n++] = a;
+		}
+		if ( ( da >= 0.0f ) != ( db >= 0.0f ) ) {
+			float t = da / ( da - db );
+			out[n++] = vec4( a.v[0] + ( b.v[0] - a.v[0] ) * t, a.v[1] + ( b.v[1] - a.v[1] ) * t,
+											 a.v[2] + ( b.v[2] - a.v[2] ) * t, a.v[3] + ( b.v[3] - a.v[3] ) * t );
+		}
+	}
+	return n;
+}
+
+/* edge function. positive if p is to the left of a->b */
+static inline float edge( float ax, float ay, float bx, float by, float px, float py ) {
+	return ( bx - ax ) * ( py - ay ) - ( by - ay ) * ( px - ax );
+}
+
+/* transform, clip and project one triangle, appending 0-2 screen triangles */
+static void setup_triangle( const depth_buffer_t &buffer, const mat4 &PVM,
+														const float *p, bool cull_back_faces,
+														std::vector<screen_tri_t> &out ) {
+	vec4 clip[3];
+	for ( int i = 0; i < 3; i++ ) {
+		const float *q = p + i * 3;
+		for ( int r = 0; r < 4; r++ ) {
+			clip[i].v[r] = PVM.m[r] * q[0] + PVM.m[4 + r] * q[1] + PVM.m[8 + r] * q[2] +
+										 PVM.m[12 + r];
+		}
+	}
+	// trivially reject triangles wholly outside one side of the view
+	for ( int a = 0; a < 3; a++ ) {
+		if ( ( clip[0].v[a] > clip[0].v[3] && clip[1].v[a] > clip[1].v[3] &&
+					 clip[2].v[a] > clip[2].v[3] ) ||
+				 ( clip[0].v[a] < -clip[0].v[3] && clip[1].v[a] < -clip[1].v[3] &&
+					 clip[2].v[a] < -clip[2].v[3] ) ) {
+			return;
+		}
+	}
+	vec4 poly[4];
+	int n = clip_near( clip, poly );
+	if ( n < 3 ) {
+		return;
+	}
+	float sx[4], sy[4], sz[4];
+	for ( int i = 0; i < n; i++ ) {
+		float inv_w = 1.0f / poly[i].v[3];
+		sx[i] = ( poly[i].v[0] * inv_w * 0.5f + 0.5f ) * buffer.width;
+		sy[i] = ( poly[i].v[1] * inv_w * 0.5f + 0.5f ) * buffer.height;
+		sz[i] = poly[i].v[2] * inv_w * 0.5f + 0.5f;
+	}
+	// clipping keeps the winding, so the whole polygon faces one way
+	float area = 0.0f;
+	for ( int i = 1; i + 1 < n; i++ ) {
+		area += edge( sx[0], sy[0], sx[i], sy[i], sx[i + 1], sy[i + 1] );
+	}
+	if ( 0.0f == area || ( cull_back_faces && area < 0.0f ) ) {
+		return;
+	}
+	// fan-triangulate the clipped polygon, making every triangle CCW
+	for ( int i = 1; i + 1 < n; i++ ) {
+		screen_tri_t tri;
+		int idx[3] = { 0, i, i + 1 };
+		if ( area < 0.0f ) {
+			std::swap( idx[1], idx[2] );
+		}
+		for ( int k = 0; k < 3; k++ ) {
+			tri.x[k] = sx[idx[k]];
+			tri.y[k] = sy[idx[k]];
+			tri.z[k] = sz[idx[k]];
+		}
+		out.push_back( tri );
+	}
+}
+
+/* GL's top-left fill rule: a pixel centre exactly on an edge belongs to the
+triangle only if it is a top or left edge, so shared edges are drawn once */
+static inline bool is_top_left( float ax, float ay, float bx, float by ) {
+	return ( ay == by && bx < ax ) || ( by < ay );
+}
+
+/* rasterise one triangle, restricted to one tile's pixel rectangle. tx0 is a
+multiple of 4 so SSE groups of pixels never straddle two tiles */
+static void raster_tri_in_tile( depth_buffer_t &buffer, const screen_tri_t &t,
+																int tx0, int ty0, int tx1, int ty1 ) {
+	float x0 = t.x[0], y0 = t.y[0];
+	float x1 = t.x[1], y1 = t.y[1];
+	float x2 = t.x[2], y2 = t.y[2];
+	float z0 = t.z[0], z1 = t.z[1], z2 = t.z[2];
+	float area = edge( x0, y0, x1, y1, x2, y2 );
+	if ( area <= 0.0f ) {
+		return;
+	}
+	int min_x = std::max( tx0, (int)floorf( std::min( x0, std::min( x1, x2 ) ) ) );
+	int max_x = std::min( tx1 - 1, (int)ceilf( std::max( x0, std::max( x1, x2 ) ) ) );
+	int min_y = std::max( ty0, (int)floorf( std::min( y0, std::min( y1, y2 ) ) ) );
+	int max_y = std::min( ty1 - 1, (int)ceilf( std::max( y0, std::max( y1, y2 ) ) ) );
+	if ( min_x > max_x || min_y > max_y ) {
+		return;
+	}
+	bool tl0 = is_top_left( x1, y1, x2, y2 );
+	bool tl1 = is_top_left( x2, y2, x0, y0 );
+	bool tl2 = is_top_left( x0, y0, x1, y1 );
+	float inv_area = 1.0f / area;
+#ifdef DEPTH_RASTER_SSE
+	/* same sums as edge() in each lane, so results match the scalar path */
+	__m128 zero = _mm_setzero_ps();
+	__m128 all = _mm_cmpeq_ps( zero, zero );
+	__m128 tl0_mask = tl0 ? all : zero, tl1_mask = tl1 ? all : zero, tl2_mask = tl2 ? all : zero;
+	__m128 e0_dx = _mm_set1_ps( x2 - x1 ), e0_dy = _mm_set1_ps( y2 - y1 );
+	__m128 e1_dx = _mm_set1_ps( x0 - x2 ), e1_dy = _mm_set1_ps( y0 - y2 );
+	__m128 e2_dx = _mm_set1_ps( x1 - x0 ), e2_dy = _mm_set1_ps( y1 - y0 );
+	__m128 vx0 = _mm_set1_ps( x0 ), vx1 = _mm_set1_ps( x1 ), vx2 = _mm_set1_ps( x2 );
+	__m128 vz0 = _mm_set1_ps( z0 * inv_area ), vz1 = _mm_set1_ps( z1 * inv_area ),
+				 vz2 = _mm_set1_ps( z2 * inv_area );
+	__m128 lane = _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f );
+	int start_x = min_x & ~3;
+	for ( int y = min_y; y <= max_y; y++ ) {
+		float py = (float)y + 0.5f;
+		__m128 e0_py = _mm_mul_ps( e0_dx, _mm_set1_ps( py - y1 ) );
+		__m128 e1_py = _mm_mul_ps( e1_dx, _mm_set1_ps( py - y2 ) );
+		__m128 e2_py = _mm_mul_ps( e2_dx, _mm_set1_ps( py - y0 ) );
+		float *row = &buffer.depths[y * buffer.stride];
+		for ( int x = start_x; x <= max_x; x += 4 ) {
+			__m128 px = _mm_add_ps( _mm_set1_ps( (float)x ), lane );
+			__m128 w0 = _mm_sub_ps( e0_py, _mm_mul_ps( e0_dy, _mm_sub_ps( px, vx1 ) ) );
+			__m128 w1 = _mm_sub_ps( e1_py, _mm_mul_ps( e1_dy, _mm_sub_ps( px, vx2 ) ) );
+			__m128 w2 = _mm_sub_ps( e2_py, _mm_mul_ps( e2_dy, _mm_sub_ps( px, vx0 ) ) );
+			__m128 in0 = _mm_or_ps( _mm_cmpgt_ps( w0, zero ), _mm_and_ps( _mm_cmpeq_ps( w0, zero ), tl0_mask ) );
+			__m128 in1 = _mm_or_ps( _mm_cmpgt_ps( w1, zero ), _mm_and_ps( _mm_cmpeq_ps( w1, zero ), tl1_mask ) );
+			__m128 in2 = _mm_or_ps( _mm_cmpgt_ps( w2, zero ), _mm_and_ps( _mm_cmpeq_ps( w2, zero ), tl2_mask ) );
+			__m128 inside = _mm_and_ps( in0, _mm_and_ps( in1, in2 ) );
+			if ( 0 == _mm_movemask_ps( inside ) ) {
+				continue;
+			}
+			__m128 z = _mm_add_ps( _mm_add_ps( _mm_mul_ps( w0, vz0 ), _mm_mul_ps( w1, vz1 ) ), _mm_mul_ps( w2, vz2 ) );
+			__m128 old = _mm_loadu_ps( row + x );
+			// GL_LESS, and depth is clamped to the far plane like GL
+			__m128 pass = _mm_and_ps( inside, _mm_and_ps( _mm_cmplt_ps( z, old ), _mm_cmpge_ps( z, zero ) ) );
+			// lanes outside the triangle's box are in another tile or past the edge
+			__m128 in_box = _mm_and_ps( _mm_cmpge_ps( px, _mm_set1_ps( (float)min_x ) ),
+																	_mm_cmplt_ps( px, _mm_set1_ps( (float)max_x + 1.0f ) ) );
+			pass = _mm_and_ps( pass, in_box );
+			_mm_storeu_ps( row + x, _mm_or_ps( _mm_and_ps( pass, z ), _mm_andnot_ps( pass, old ) ) );
+		}
+	}
+#else
+	for ( int y = min_y; y <= max_y; y++ ) {
+		float py = (float)y + 0.5f;
+		float *row = &buffer.depths[y * buffer.stride];
+		for ( int x = min_x; x <= max_x; x++ ) {
+			float px = (float)x + 0.5f;
+			float w0 = edge( x1, y1, x2, y2, px, py );
+			float w1 = edge( x2, y2, x0, y0, px, py );
+			float w2 = edge( x0, y0, x1, y1, px, py );
+			if ( w0 < 0.0f || w1 < 0.0f || w2 < 0.0f ) {
+				continue;
+			}
+			if ( ( 0.0f == w0 && !tl0 ) || ( 0.0f == w1 && !tl1 ) || ( 0.0f == w2 && !tl2 ) ) {
+				continue;
+			}
+			float z = w0 * ( z0 * inv_area ) + w1 * ( z1 * inv_area ) + w2 * ( z2 * inv_area );
+			// GL_LESS, and depth is clamped to the far plane like GL
+			if ( z < 0.0f || z >= row[x] ) {
+				continue;
+			}
+			row[x] = z;
+		}
+	}
+#endif
+}
+
+int depth_raster_draw( depth_buffer_t &buffer, const mat4 &P, const mat4 &V,
+											 const depth_raster_draw_t *draws, int draw_count,
+											 bool cull_back_faces, int thread_count ) {
+	if ( thread_count < 1 ) {
+		thread_count = 1;
+	}
+	// combined matrix for each draw, and where its triangles start in the
+	// overall list so that threads can split the list evenly
+	std::vector<mat4> PVMs( draw_count );
+	std::vector<int> first_tri( draw_count + 1, 0 );
+	mat4 PV = P;
+	PV = PV * V;
+	for ( int d = 0; d < draw_count; d++ ) {
+		mat4 M = draws[d].M;
+		PVMs[d] = PV * M;
+		first_tri[d + 1] = first_tri[d] + draws[d].point_count / 3;
+	}
+	int tri_count = first_tri[draw_count];
+
+	// 1. transform and set up triangles. each thread does a contiguous chunk
+	std::vector<std::vector<screen_tri_t> > thread_tris( thread_count );
+	run_on_threads( thread_count, [&]( int t ) {
+		int start = (int)( (long long)tri_count * t / thread_count );
+		int end = (int)( (long long)tri_count * ( t + 1 ) / thread_count );
+		int d = (int)( std::upper_bound( first_tri.begin(), first_tri.end(), start ) -
+									 first_tri.begin() ) - 1;
+		for ( int i = start; i < end; i++ ) {
+			while ( i >= first_tri[d + 1] ) {
+				d++;
+			}
+			const float *p = draws[d].points + ( i - first_tri[d] ) * 9;
+			setup_triangle( buffer, PVMs[d], p, cull_back_faces, thread_tris[t] );
+		}
+	} );
+
+	// 2. bin triangles into every tile their bounding box touches
+	int tiles_x = ( buffer.width + DEPTH_RASTER_TILE_SIZE - 1 ) / DEPTH_RASTER_TILE_SIZE;
+	int tiles_y = ( buffer.height + DEPTH_RASTER_TILE_SIZE - 1 ) / DEPTH_RASTER_TILE_SIZE;
+	std::vector<screen_tri_t> tris;
+	for ( int t = 0; t < thread_count; t++ ) {
+		tris.insert( tris.end(), thread_tris[t].begin(), thread_tris[t].end() );
+	}
+	std::vector<std::vector<int> > bins( tiles_x * tiles_y );
+	for ( size_t i = 0; i < tris.size(); i++ ) {
+		const screen_tri_t &t = tris[i];
+		float min_x = std::min( t.x[0], std::min( t.x[1], t.x[2] ) );
+		float max_x = std::max( t.x[0], std::max( t.x[1], t.x[2] ) );
+		float min_y = std::min( t.y[0], std::min( t.y[1], t.y[2] ) );
+		float max_y = std::max( t.y[0], std::max( t.y[1], t.y[2] ) );
+		if ( max_x < 0.0f || max_y < 0.0f || min_x >= buffer.width || min_y >= buffer.height ) {
+			continue;
+		}
+		int bx0 = std::max( 0, (int)min_x / DEPTH_RASTER_TILE_SIZE );
+		int bx1 = std::min( tiles_x - 1, (int)max_x / DEPTH_RASTER_TILE_SIZE );
+		int by0 = std::max( 0, (int)min_y / DEPTH_RASTER_TILE_SIZE );
+		int by1 = std::min( tiles_y - 1, (int)max_y / DEPTH_RASTER_TILE_SIZE );
+		for ( int by = by0; by <= by1; by++ ) {
+			for ( int bx = bx0; bx <= bx1; bx++ ) {
+				bins[by * tiles_x + bx].push_back( (int)i );
+			}
+		}
+	}
+
+	// 3. threads take whole tiles: clear them, then draw their bins
+	std::atomic<int> next_tile( 0 );
+	run_on_threads( thread_count, [&]( int ) {
+		for ( int tile = next_tile++; tile < tiles_x * tiles_y; tile = next_tile++ ) {
+			int x0 = ( tile % tiles_x ) * DEPTH_RASTER_TILE_SIZE;
+			int y0 = ( tile / tiles_x ) * DEPTH_RASTER_TILE_SIZE;
+			int x1 = std::min( buffer.width, x0 + DEPTH_RASTER_TILE_SIZE );
+			int y1 = std::min( buffer.height, y0 + DEPTH_RASTER_TILE_SIZE );
+			for ( int y = y0; y < y1; y++ ) {
+				std::fill( &buffer.depths[y * buffer.stride + x0],
+									 &buffer.depths[y * buffer.stride] + x1, 1.0f );
+			}
+			const std::vector<int> &bin = bins[tile];
+			for ( size_t i = 0; i < bin.size(); i++ ) {
+				raster_tri_in_tile( buffer, tris[bin[i]], x0, y0, x1, y1 );
+			}
+		}
+	} );
+	return (int)tris.size();
+}
+
+bool depth_buffer_test_aabb( const depth_buffer_t &buffer, const mat4 &PV,
+														 const vec3 &box_min, const vec3 &box_max ) {
+	float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f;
+	float min_z = 1e30f;
+	for ( int c = 0; c < 8; c++ ) {
+		float p[3] = { ( c & 1 ) ? box_max.v[0] : box_min.v[0],
+									 ( c & 2 ) ? box_max.v[1] : box_min.v[1],
+									 ( c & 4 ) ? box_max.v[2] : box_min.v[2] };
+		float clip[4];
+		for ( int r = 0; r < 4; r++ ) {
+			clip[r] = PV.m[r] * p[0] + PV.m[4 + r] * p[1] + PV.m[8 + r] * p[2] + PV.m[12 + r];
+		}
+		// a corner behind the near plane: can't project the box, so assume visible
+		if ( clip[2] < -clip[3] || clip[3] <= 0.0f ) {
+			return true;
+		}
+		float inv_w = 1.0f / clip[3];
+		float sx = ( clip[0] * inv_w * 0.5f + 0.5f ) * buffer.width;
+		float sy = ( clip[1] * inv_w * 0.5f + 0.5f ) * buffer.height;
+		float sz = clip[2] * inv_w * 0.5f + 0.5f;
+		min_x = std::min( min_x, sx );
+		max_x = std::max( max_x, sx );
+		min_y = std::min( min_y, sy );
+		max_y = std::max( max_y, sy );
+		min_z = std::min( min_z, sz );
+	}
+	if ( max_x < 0.0f || max_y < 0.0f || min_x >= buffer.width || min_y >= buffer.height ||
+			 min_z >= 1.0f ) {
+		return false;
+	}
+	int x0 = std::max( 0, (int)floorf( min_x ) );
+	int x1 = std::min( buffer.width - 1, (int)floorf( max_x ) );
+	int y0 = std::max( 0, (int)floorf( min_y ) );
+	int y1 = std::min( buffer.height - 1, (int)floorf( max_y ) );
+	for ( int y = y0; y <= y1; y++ ) {
+		const float *row = &buffer.depths[y * buffer.stride];
+		for ( int x = x0; x <= x1; x++ ) {
+			if ( min_z < row[x] ) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,55 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU depth-only rasteriser.                                                   |
+| Draws the same triangles as depth.vert, with the same P * V * M transform,   |
+| into a float depth buffer in system memory. At shadow map size it gives the  |
+| same depth map as render_shadow_casting() with no GL context; at a small     |
+| size it is an occlusion buffer that bounding boxes can be tested against.    |
+| The buffer is split into tiles; triangles are binned into the tiles they     |
+| touch, then each thread rasterises whole tiles, testing 4 pixels at a time   |
+| against the triangle's edges with SSE.                                       |
+\******************************************************************************/
+#ifndef _DEPTH_RASTER_H_
+#define _DEPTH_RASTER_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+// pixels along each side of a tile. must be a multiple of 4
+#define DEPTH_RASTER_TILE_SIZE 32
+
+/* one mesh to draw. points are x,y,z triangle soup like the ones from
+load_obj_file() */
+struct depth_raster_draw_t {
+	const float *points;
+	int point_count;
+	mat4 M;
+};
+
+struct depth_buffer_t {
+	int width, height;
+	int stride;								 // floats per row. width rounded up to a multiple of 4
+	std::vector<float> depths; // window-space depth, 0 near to 1 far. rows bottom to top
+};
+
+void depth_buffer_resize( depth_buffer_t &buffer, int width, int height );
+/* clears the buffer to 1 and draws all meshes into it with a GL_LESS depth
+test. if cull_back_faces is set, clockwise triangles are skipped like
+glCullFace( GL_BACK ) with glFrontFace( GL_CCW ). uses thread_count threads.
+returns the number of triangles that were not culled or clipped away */
+int depth_raster_draw( depth_buffer_t &buffer, const mat4 &P, const mat4 &V,
+											 const depth_raster_draw_t *draws, int draw_count,
+											 bool cull_back_faces, int thread_count );
+/* occlusion test for a world-space box against a buffer drawn with the same
+P * V. false only if the box is outside the view or every pixel it covers
+already holds something nearer than the box's nearest point */
+bool depth_buffer_test_aabb( const depth_buffer_t &buffer, const mat4 &PV,
+														 const vec3 &box_min, const vec3 &box_max );
+
+#endif
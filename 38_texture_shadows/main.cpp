@@ -18,14 +18,20 @@
 | I wrote a little Wavefront .obj loader to load a mesh from a file            |
 | It's in obj_parser.h and .cpp                                                |
 \******************************************************************************/
+#include "depth_raster.h" // CPU depth-only rasteriser
 #include "gl_utils.h"		 // common opengl functions and small utilities like logs
 #include "maths_funcs.h" // my maths functions
 #include "obj_parser.h"	// my little Wavefront .obj mesh loader
+#include "render_queue.h" // sorted draw recording and replay
+#include "shadow_cascades.h" // cascaded shadow map planner
+#include "shadow_casters.h" // shadow caster culling and draw lists
 #include <GL/glew.h>		 // include GLEW and new version of GL on Windows
 #include <GLFW/glfw3.h>	// GLFW helper library
+#include <algorithm>
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <thread>
 #define _USE_MATH_DEFINES
 #include <math.h>
 #define MESH_FILE "suzanne.obj"
@@ -36,6 +42,39 @@
 #define DEPTH_VS "depth.vert"
 #define DEPTH_FS "depth.frag"
 #define NUM_SPHERES 4
+/* largest difference between CPU and GL shadow map depths counted as a match.
+GL stores 24-bit depth here so the two can't be exactly equal */
+#define SHADOW_DEPTH_TOLERANCE 1e-4f
+/* the start-up benchmarks take seconds and lots of memory before the first
+frame, so they only run when this is uncommented */
+//#define RUN_BENCHMARKS
+/* times the CPU shadow map is drawn for its triangles/s figure */
+#define SHADOW_RASTER_RUNS 20
+/* cascaded shadow map plan that is logged at start-up */
+#define NUM_CASCADES 4
+#define CASCADE_SPLIT_LAMBDA 0.75f
+/* objects and different meshes in the start-up caster culling benchmark */
+#define BENCH_NUM_CASTERS 100000
+#define BENCH_NUM_MESHES 8
+/* draws, and kinds of state, in the start-up render queue benchmark */
+#define BENCH_RENDER_DRAWS 100000
+#define BENCH_RENDER_PASSES 2
+#define BENCH_RENDER_SHADERS 8
+#define BENCH_RENDER_MATERIALS 64
+#define BENCH_RENDER_MESHES 32
+/* passes, shaders, materials and meshes, as the render queue knows them */
+#define PASS_SHADOW 0
+#define PASS_SCENE 1
+#define PASS_OVERLAY 2
+#define SHADER_DEPTH 0
+#define SHADER_PLAIN 1
+#define SHADER_DEBUG 2
+#define MATERIAL_NONE 0
+#define MATERIAL_GROUND 1 /* green */
+#define MATERIAL_SPHERE 2 /* red */
+#define MESH_GROUND 0
+#define MESH_SPHERE 1
+#define MESH_SS_QUAD 2
 
 /* resolution of the shadow map - this is the critical performance/quality
 variable  try changing this*/
@@ -45,15 +84,20 @@ GLuint g_ground_plane_vao;
 int g_ground_plane_point_count;
 GLuint g_sphere_vao;
 int g_sphere_point_count;
+GLfloat *g_sphere_vp; /* kept in memory for the CPU rasteriser */
 GLuint g_ss_quad_vao;
 int g_ss_quad_point_count;
 /* shadow caster's view and projection matrices. in practice each light source
 will be a shadow caster have a set of these. we only have one caster here */
 mat4 g_caster_V;
 mat4 g_caster_P;
+float g_caster_far;
 /* the virtual camera's view and projection matrices */
 mat4 g_camera_V;
 mat4 g_camera_P;
+float g_camera_far;
+/* look from the shadow caster instead of the camera */
+bool g_view_from_caster;
 /* shader used for ground and other objects */
 GLuint g_plain_sp;
 GLint g_plain_M_loc;				/* model matrix location */
@@ -75,6 +119,23 @@ GLuint g_depth_fb;
 GLuint g_depth_fb_tex;
 /* unique model matrix for each sphere */
 mat4 g_sphere_Ms[NUM_SPHERES];
+// a world position for each sphere in the scene
+vec3 sphere_pos_wor[] = { vec3( -2.0, 0.0, 0.0 ), vec3( 2.0, 0.0, 0.0 ),
+													vec3( -2.0, 0.0, -2.0 ), vec3( 1.5, 1.0, -1.0 ) };
+/* everything that casts shadows, and the ones that need drawing this frame */
+shadow_caster_set_t g_casters;
+shadow_draw_list_t g_shadow_draws;
+/* the part of the scene the camera can see, where shadows need to be right */
+vec3 g_receiver_min, g_receiver_max;
+bool g_receivers_visible = true;
+/* bounds of the ground plane and everything floating above it */
+vec3 g_scene_min( -20.0f, -1.0f, -20.0f );
+vec3 g_scene_max( 20.0f, 2.0f, 20.0f );
+/* CPU copy of the shadow map */
+depth_buffer_t g_cpu_shadow_map;
+/* each frame's draws, recorded then sorted and replayed */
+render_queue_t g_render_queue;
+int g_num_threads = 1;
 
 void init_ground_plane() {
 	GLuint points_vbo;
@@ -105,6 +166,7 @@ void create_shadow_caster() {
 	float fov = 35.0f;
 	float aspect = 1.0f;
 	g_caster_P = perspective( fov, aspect, near, far );
+	g_caster_far = far;
 }
 
 /* some floating objects to cast shadows */
@@ -117,6 +179,8 @@ void init_spheres() {
 	glGenVertexArrays( 1, &g_sphere_vao );
 	glBindVertexArray( g_sphere_vao );
 
+	g_sphere_vp = vp;
+
 	GLuint points_vbo = 0;
 	if ( NULL != vp ) {
 		glGenBuffers( 1, &points_vbo );
@@ -188,49 +252,292 @@ void init_shadow_fb() {
 	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 }
 
-/* do a rendering pass writing just the depth to a texture */
-void render_shadow_casting() {
-	/* similar to epsilon offset */
-	/*
-		glEnable (GL_POLYGON_OFFSET_FILL);
-		glPolygonOffset (-1,-1); */
+/* 0 at the eye to 1 at far, for sorting draws near to far */
+float view_depth( const mat4 &V, const vec3 &pos, float far ) {
+	float z = V.m[2] * pos.v[0] + V.m[6] * pos.v[1] + V.m[10] * pos.v[2] + V.m[14];
+	return -z / far;
+}
 
-	// bind framebuffer that renders to texture instead of screen
-	glBindFramebuffer( GL_FRAMEBUFFER, g_depth_fb );
-	// set the viewport to the size of the shadow map
-	glViewport( 0, 0, g_shadow_size, g_shadow_size );
-	// clear the shadow map to black (or white)
-	glClearColor( 0.0, 0.0, 0.0, 1.0 );
-	// no need to clear the colour buffer
-	glClear( GL_DEPTH_BUFFER_BIT );
-	// bind out shadow-casting shader from the previous section
-	glUseProgram( g_depth_sp );
-	// send in the view and projection matrices from the light
-	glUniformMatrix4fv( g_depth_V_loc, 1, GL_FALSE, g_caster_V.m );
-	glUniformMatrix4fv( g_depth_P_loc, 1, GL_FALSE, g_caster_P.m );
-	// model matrix does nothing for the monkey - make it an identity matrix
-
-	// bind the sphere vao and draw them
-	glBindVertexArray( g_sphere_vao );
+/* record the draws of a pass writing just the depth to a texture */
+void record_shadow_casting( render_queue_t &q ) {
+	// only draw casters whose shadows can land somewhere the camera sees. every
+	// object here uses the sphere mesh
+	g_shadow_draws.objects.clear();
+	g_shadow_draws.batches.clear();
+	if ( g_receivers_visible ) {
+		build_shadow_draw_list( g_casters, g_caster_P * g_caster_V, g_receiver_min,
+														g_receiver_max, g_shadow_draws, 1 );
+	}
+	for ( size_t j = 0; j < g_shadow_draws.objects.size(); j++ ) {
+		int i = g_shadow_draws.objects[j];
+		float depth = view_depth( g_caster_V, sphere_pos_wor[i], g_caster_far );
+		render_draw_t *draw =
+			render_queue_add( q, render_key( PASS_SHADOW, SHADER_DEPTH, MATERIAL_NONE,
+																			 MESH_SPHERE, depth ) );
+		draw->M = g_sphere_Ms[i];
+		draw->first = 0;
+		draw->count = g_sphere_point_count;
+	}
+}
+
+/* record the draws of the normal pass, which reads the depth texture, and the
+little box showing it */
+void record_scene( render_queue_t &q ) {
+	/* ground plane (receives shadows). MATERIAL_GROUND sorts before
+	MATERIAL_SPHERE, so the ground is the first of the plain draws whatever its
+	depth */
+	render_draw_t *draw = render_queue_add(
+		q, render_key( PASS_SCENE, SHADER_PLAIN, MATERIAL_GROUND, MESH_GROUND, 1.0f ) );
+	draw->M = identity_mat4();
+	draw->first = 0;
+	draw->count = g_ground_plane_point_count;
+
+	/* spheres (cast and receive shadows) */
 	for ( int i = 0; i < NUM_SPHERES; i++ ) {
-		glUniformMatrix4fv( g_depth_M_loc, 1, GL_FALSE, g_sphere_Ms[i].m );
-		glDrawArrays( GL_TRIANGLES, 0, g_sphere_point_count );
+		float depth = view_depth( g_camera_V, sphere_pos_wor[i], g_camera_far );
+		draw = render_queue_add(
+			q, render_key( PASS_SCENE, SHADER_PLAIN, MATERIAL_SPHERE, MESH_SPHERE, depth ) );
+		draw->M = g_sphere_Ms[i];
+		draw->first = 0;
+		draw->count = g_sphere_point_count;
 	}
-	// bind the default framebuffer again
-	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 
-	glDisable( GL_POLYGON_OFFSET_FILL );
+	/* draw ss quad */
+	draw = render_queue_add(
+		q, render_key( PASS_OVERLAY, SHADER_DEBUG, MATERIAL_NONE, MESH_SS_QUAD, 0.0f ) );
+	draw->M = identity_mat4();
+	draw->first = 0;
+	draw->count = g_ss_quad_point_count;
 }
 
-// a world position for each sphere in the scene
-vec3 sphere_pos_wor[] = { vec3( -2.0, 0.0, 0.0 ), vec3( 2.0, 0.0, 0.0 ),
-													vec3( -2.0, 0.0, -2.0 ), vec3( 1.5, 1.0, -1.0 ) };
+/* the render queue's state changes and draws, in GL */
+render_backend_t gl_render_backend() {
+	render_backend_t backend;
+	backend.begin_pass = []( int pass ) {
+		if ( PASS_SHADOW == pass ) {
+			// bind framebuffer that renders to texture instead of screen
+			glBindFramebuffer( GL_FRAMEBUFFER, g_depth_fb );
+			// set the viewport to the size of the shadow map
+			glViewport( 0, 0, g_shadow_size, g_shadow_size );
+			// clear the shadow map to black (or white)
+			glClearColor( 0.0, 0.0, 0.0, 1.0 );
+			// no need to clear the colour buffer
+			glClear( GL_DEPTH_BUFFER_BIT );
+		} else if ( PASS_SCENE == pass ) {
+			/* reset the culling information, clear colour, and viewport dimensions,
+			because these are changed in the shadow casting pass */
+			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+			glCullFace( GL_BACK ); // cull back face
+			glFrontFace( GL_CCW ); // set counter-clock-wise vertex order to mean the front
+			glClearColor( 0.2, 0.2, 0.2, 1.0 ); // grey background to help spot mistakes
+			glViewport( 0, 0, g_gl_width, g_gl_height );
+			// wipe the drawing surface clear
+			glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+			glActiveTexture( GL_TEXTURE0 );
+			glBindTexture( GL_TEXTURE_2D, g_depth_fb_tex );
+		}
+	};
+	backend.use_shader = []( int shader ) {
+		if ( SHADER_DEPTH == shader ) {
+			glUseProgram( g_depth_sp );
+			// send in the view and projection matrices from the light
+			glUniformMatrix4fv( g_depth_V_loc, 1, GL_FALSE, g_caster_V.m );
+			glUniformMatrix4fv( g_depth_P_loc, 1, GL_FALSE, g_caster_P.m );
+		} else if ( SHADER_PLAIN == shader ) {
+			glUseProgram( g_plain_sp );
+			/* switch between looking from virtual camera and shadow caster matrices */
+			const mat4 &V = g_view_from_caster ? g_caster_V : g_camera_V;
+			const mat4 &P = g_view_from_caster ? g_caster_P : g_camera_P;
+			glUniformMatrix4fv( g_plain_V_loc, 1, GL_FALSE, V.m );
+			glUniformMatrix4fv( g_plain_P_loc, 1, GL_FALSE, P.m );
+		} else {
+			glUseProgram( g_debug_sp );
+		}
+	};
+	backend.bind_material = []( int shader, int material ) {
+		if ( SHADER_PLAIN == shader && MATERIAL_GROUND == material ) {
+			glUniform3f( g_plain_colour_loc, 0.0, 1.0, 0.0 ); /* green */
+		} else if ( SHADER_PLAIN == shader && MATERIAL_SPHERE == material ) {
+			glUniform3f( g_plain_colour_loc, 1.0, 0.0, 0.0 ); /* red */
+		}
+	};
+	backend.bind_mesh = []( int mesh ) {
+		GLuint vaos[] = { g_ground_plane_vao, g_sphere_vao, g_ss_quad_vao };
+		glBindVertexArray( vaos[mesh] );
+	};
+	backend.draw = []( int shader, const render_draw_t &draw ) {
+		if ( SHADER_DEPTH == shader ) {
+			glUniformMatrix4fv( g_depth_M_loc, 1, GL_FALSE, draw.M.m );
+		} else if ( SHADER_PLAIN == shader ) {
+			glUniformMatrix4fv( g_plain_M_loc, 1, GL_FALSE, draw.M.m );
+		}
+		glDrawArrays( GL_TRIANGLES, draw.first, draw.count );
+	};
+	return backend;
+}
+
+/* draws the shadow casters into g_cpu_shadow_map, logs how fast, and compares
+it with the depth texture that the shadow pass just made */
+void compare_cpu_shadow_map() {
+	/* the same casters the GL pass drew */
+	depth_raster_draw_t draws[NUM_SPHERES];
+	int draw_count = (int)g_shadow_draws.objects.size();
+	for ( int j = 0; j < draw_count; j++ ) {
+		int i = g_shadow_draws.objects[j];
+		draws[j].points = g_sphere_vp;
+		draws[j].point_count = g_sphere_point_count;
+		draws[j].M = g_sphere_Ms[i];
+	}
+	depth_buffer_resize( g_cpu_shadow_map, g_shadow_size, g_shadow_size );
+	int drawn = 0;
+	double start = glfwGetTime();
+	for ( int r = 0; r < SHADOW_RASTER_RUNS; r++ ) {
+		/* culling is on with the default back faces in the shadow pass */
+		drawn = depth_raster_draw( g_cpu_shadow_map, g_caster_P, g_caster_V, draws,
+															 draw_count, true, g_num_threads );
+	}
+	double secs = ( glfwGetTime() - start ) / SHADOW_RASTER_RUNS;
+	int submitted = draw_count * g_sphere_point_count / 3;
+	gl_log( "CPU shadow map %ix%i, %i threads: %.3fms. %i triangles (%i after "
+					"culling), %.2f M triangles/s\n",
+					g_shadow_size, g_shadow_size, g_num_threads, secs * 1000.0, submitted,
+					drawn, (double)submitted / secs / 1e6 );
+
+	/* read the GL shadow map back and count pixels that agree */
+	int pixel_count = g_shadow_size * g_shadow_size;
+	float *gl_depths = (float *)malloc( sizeof( float ) * pixel_count );
+	glBindTexture( GL_TEXTURE_2D, g_depth_fb_tex );
+	glGetTexImage( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, gl_depths );
+	int matches = 0;
+	float max_diff = 0.0f;
+	for ( int y = 0; y < g_shadow_size; y++ ) {
+		for ( int x = 0; x < g_shadow_size; x++ ) {
+			float diff = fabsf( gl_depths[y * g_shadow_size + x] -
+													g_cpu_shadow_map.depths[y * g_cpu_shadow_map.stride + x] );
+			if ( diff <= SHADOW_DEPTH_TOLERANCE ) {
+				matches++;
+			} else if ( diff > max_diff ) {
+				max_diff = diff;
+			}
+		}
+	}
+	gl_log( "CPU shadow map matches GL within %g on %i of %i pixels (%.3f%%). "
+					"largest other difference %g (coverage at triangle edges)\n",
+					SHADOW_DEPTH_TOLERANCE, matches, pixel_count,
+					100.0 * matches / pixel_count, max_diff );
+	free( gl_depths );
+}
+
+/* works out a cascaded shadow map plan for the current camera, treating the
+caster as a directional light, and logs it with the casters in each cascade */
+void log_shadow_cascades( float fovy, float aspect, float near, float far ) {
+	vec3 light_dir = normalise( vec3( -7.0f, -7.0f, 0.0f ) );
+	shadow_cascade_plan_t plan;
+	plan_shadow_cascades( g_camera_V, fovy, aspect, near, far, light_dir, NUM_CASCADES,
+												CASCADE_SPLIT_LAMBDA, g_shadow_size, true, g_scene_min,
+												g_scene_max, plan );
+	caster_bounds_t casters;
+	for ( int i = 0; i < NUM_SPHERES; i++ ) {
+		vec3 p = vec3( g_sphere_Ms[i].m[12], g_sphere_Ms[i].m[13], g_sphere_Ms[i].m[14] );
+		caster_bounds_add( casters, p - 1.0f, p + 1.0f );
+	}
+	int ids[NUM_SPHERES];
+	for ( int i = 0; i < plan.count; i++ ) {
+		const shadow_cascade_t &c = plan.cascades[i];
+		int n = cull_cascade_casters( c.planes, SHADOW_CASCADE_PLANES, casters, 0, NUM_SPHERES, ids );
+		gl_log( "cascade %i: %.2f to %.2f, %.4f units per texel, %i of %i casters\n", i,
+						c.split_near, c.split_far, c.texel_size, n, NUM_SPHERES );
+	}
+}
+
+/* times build_shadow_draw_list() on lots of casters scattered over the scene,
+and logs how many draws and mesh changes it saves */
+void benchmark_shadow_culling() {
+	shadow_caster_set_t set;
+	for ( int i = 0; i < BENCH_NUM_CASTERS; i++ ) {
+		vec3 centre( (float)( rand() % 4000 ) * 0.01f - 20.0f,
+								 (float)( rand() % 300 ) * 0.01f - 1.0f,
+								 (float)( rand() % 4000 ) * 0.01f - 20.0f );
+		float half = 0.1f + (float)( rand() % 100 ) * 0.005f;
+		shadow_caster_set_add( set, centre - half, centre + half, rand() % BENCH_NUM_MESHES );
+	}
+	shadow_draw_list_t list;
+	const int runs = 20;
+	double start = glfwGetTime();
+	for ( int r = 0; r < runs; r++ ) {
+		build_shadow_draw_list( set, g_caster_P * g_caster_V, g_receiver_min,
+														g_receiver_max, list, g_num_threads );
+	}
+	double ms = ( glfwGetTime() - start ) * 1000.0 / runs;
+	gl_log( "shadow caster culling of %i objects, %i threads: %.3fms. %i draws in "
+					"%i mesh batches (unculled: %i draws)\n",
+					BENCH_NUM_CASTERS, g_num_threads, ms, (int)list.objects.size(),
+					(int)list.batches.size(), BENCH_NUM_CASTERS );
+}
+
+/* records BENCH_RENDER_DRAWS draws with random state into a render queue,
+sorts them with the radix sort and with std::sort, and replays them into the
+mock backend, logging how long each takes and how many state changes the
+sort saves */
+void benchmark_render_queue() {
+	render_queue_t q;
+	std::vector<uint64_t> keys( BENCH_RENDER_DRAWS );
+	for ( int i = 0; i < BENCH_RENDER_DRAWS; i++ ) {
+		keys[i] = render_key( rand() % BENCH_RENDER_PASSES, rand() % BENCH_RENDER_SHADERS,
+													rand() % BENCH_RENDER_MATERIALS, rand() % BENCH_RENDER_MESHES,
+													(float)rand() / (float)RAND_MAX );
+	}
+	mat4 M = identity_mat4();
+	double record_ms = 0.0;
+	/* the second frame is the one that matters: the queue has its memory by then */
+	for ( int frame = 0; frame < 2; frame++ ) {
+		double start = glfwGetTime();
+		render_queue_clear( q );
+		for ( int i = 0; i < BENCH_RENDER_DRAWS; i++ ) {
+			render_draw_t *draw = render_queue_add( q, keys[i] );
+			draw->M = M;
+			draw->first = i;
+			draw->count = 3;
+		}
+		record_ms = ( glfwGetTime() - start ) * 1000.0;
+	}
+
+	render_mock_t mock;
+	mock.calls.reserve( BENCH_RENDER_DRAWS * 5 );
+	render_stats_t unsorted = render_queue_replay( q, render_mock_backend( mock ) );
+
+	std::vector<render_item_t> copy( q.items );
+	double start = glfwGetTime();
+	std::stable_sort( copy.begin(), copy.end(),
+										[]( const render_item_t &a, const render_item_t &b ) {
+											return a.key < b.key;
+										} );
+	double std_sort_ms = ( glfwGetTime() - start ) * 1000.0;
+	start = glfwGetTime();
+	render_queue_sort( q );
+	double radix_ms = ( glfwGetTime() - start ) * 1000.0;
+
+	mock.calls.clear();
+	start = glfwGetTime();
+	render_stats_t sorted = render_queue_replay( q, render_mock_backend( mock ) );
+	double replay_ms = ( glfwGetTime() - start ) * 1000.0;
+	gl_log( "render queue of %i draws: record %.3fms, radix sort %.3fms (std::stable_sort "
+					"%.3fms), mock replay %.3fms. shader/material/mesh changes unsorted %i/%i/%i, "
+					"sorted %i/%i/%i\n",
+					BENCH_RENDER_DRAWS, record_ms, radix_ms, std_sort_ms, replay_ms, unsorted.shaders,
+					unsorted.materials, unsorted.meshes, sorted.shaders, sorted.materials,
+					sorted.meshes );
+}
 
 int main() {
 	/*--------------------------------START OPENGL--------------------------------*/
 	( restart_gl_log() );
 	/* start GL context and O/S window using the GLFW helper library */
 	( start_gl() );
+	g_num_threads = (int)std::thread::hardware_concurrency();
+	if ( g_num_threads < 1 ) {
+		g_num_threads = 1;
+	}
 	/*---------------------CREATE FRAMEBUFFER TO CAPTURE DEPTH--------------------*/
 	init_shadow_fb();
 	/*------------------------------CREATE GEOMETRY-------------------------------*/
@@ -263,6 +570,7 @@ int main() {
 	float fov = 67.0f;	// convert 67 degrees to radians
 	float aspect = (float)g_gl_width / (float)g_gl_height; // aspect ratio
 	g_camera_P = perspective( fov, aspect, near, far );
+	g_camera_far = far;
 
 	float cam_speed = 5.0f;						// 1 unit per second
 	float cam_heading_speed = 100.0f; // 10 degrees per second
@@ -277,14 +585,24 @@ int main() {
 
 	/*---------------------------SET RENDERING DEFAULTS---------------------------*/
 	glUseProgram( g_plain_sp );
-	glUniformMatrix4fv( g_plain_V_loc, 1, GL_FALSE, g_camera_V.m );
-	glUniformMatrix4fv( g_plain_P_loc, 1, GL_FALSE, g_camera_P.m );
 	glUniformMatrix4fv( g_plain_caster_V_loc, 1, GL_FALSE, g_caster_V.m );
 	glUniformMatrix4fv( g_plain_caster_P_loc, 1, GL_FALSE, g_caster_P.m );
 	glUniform1f( g_plain_shad_resolution_loc, (GLfloat)g_shadow_size );
 	for ( int i = 0; i < NUM_SPHERES; i++ ) {
 		g_sphere_Ms[i] = translate( identity_mat4(), sphere_pos_wor[i] );
+		/* the monkey head fits in a 2x2x2 box */
+		shadow_caster_set_add( g_casters, sphere_pos_wor[i] - 1.0f, sphere_pos_wor[i] + 1.0f,
+													 0 );
 	}
+	g_receivers_visible = camera_receiver_bounds( g_camera_V, fov, aspect, near, far,
+																								g_scene_min, g_scene_max,
+																								g_receiver_min, g_receiver_max );
+	log_shadow_cascades( fov, aspect, near, far );
+#ifdef RUN_BENCHMARKS
+	benchmark_shadow_culling();
+	benchmark_render_queue();
+#endif
+	render_backend_t gl_backend = gl_render_backend();
 
 	glEnable( GL_CULL_FACE );	// cull face
 	glEnable( GL_DEPTH_TEST ); // enable depth-testing
@@ -305,37 +623,30 @@ int main() {
 		/* back-face rendering only to remove self-shadowing issues. usually helps
 		in this demo it made it worse */
 		// glCullFace (GL_FRONT);
-		render_shadow_casting();
+		render_queue_clear( g_render_queue );
+		record_shadow_casting( g_render_queue );
 		/*------------------------DEPTH READING RENDERING PASS--------------------------
 		normal rendering here, but we can sample the depth map and use the shadow
 		caster's view and projection matrices to work out what part of the depth map
-		should cover the rendered parts of our scene. note that i reset the culling
-		information, clear colour, and viewport dimensions here, because these are
-		changed in the shadow casting pass */
-		glCullFace( GL_BACK ); // cull back face
-		glFrontFace( GL_CCW ); // set counter-clock-wise vertex order to mean the front
-		glClearColor( 0.2, 0.2, 0.2, 1.0 ); // grey background to help spot mistakes
-		glViewport( 0, 0, g_gl_width, g_gl_height );
-		// wipe the drawing surface clear
-		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-
-		glUseProgram( g_plain_sp );
-		glActiveTexture( GL_TEXTURE0 );
-		glBindTexture( GL_TEXTURE_2D, g_depth_fb_tex );
-
-		/* ground plane (receives shadows) */
-		glUniform3f( g_plain_colour_loc, 0.0, 1.0, 0.0 ); /* green */
-		glBindVertexArray( g_ground_plane_vao );
-		glUniformMatrix4fv( g_plain_M_loc, 1, GL_FALSE, identity_mat4().m );
-		glDrawArrays( GL_TRIANGLES, 0, g_ground_plane_point_count );
-
-		/* spheres (cast and receive shadows) */
-		glUniform3f( g_plain_colour_loc, 1.0, 0.0, 0.0 ); /* red */
-		glBindVertexArray( g_sphere_vao );
-		for ( int i = 0; i < NUM_SPHERES; i++ ) {
-			glUniformMatrix4fv( g_plain_M_loc, 1, GL_FALSE, g_sphere_Ms[i].m );
-			glDrawArrays( GL_TRIANGLES, 0, g_sphere_point_count );
+		should cover the rendered parts of our scene */
+		record_scene( g_render_queue );
+		/* sorted by pass first, so the shadow map is drawn before it's read */
+		render_queue_sort( g_render_queue );
+		/* a pass with no draws isn't started, but the shadow map still needs
+		clearing when nothing casts a shadow */
+		if ( g_shadow_draws.objects.empty() ) {
+			gl_backend.begin_pass( PASS_SHADOW );
+		}
+		render_queue_replay( g_render_queue, gl_backend );
+#ifdef RUN_BENCHMARKS
+		/* the casters don't move, so checking the CPU version once is enough */
+		static bool compared_shadow_map = false;
+		if ( !compared_shadow_map ) {
+			compare_cpu_shadow_map();
+			compared_shadow_map = true;
 		}
+#endif
+
 		// update other events like input handling
 		glfwPollEvents();
 
@@ -418,23 +729,12 @@ int main() {
 			cam_pos = cam_pos + vec3( rgt ) * move.v[0];
 			mat4 T = translate( identity_mat4(), cam_pos );
 			g_camera_V = inverse( R ) * inverse( T );
-			glUniformMatrix4fv( g_plain_V_loc, 1, GL_FALSE, g_camera_V.m );
+			g_receivers_visible = camera_receiver_bounds( g_camera_V, fov, aspect, near,
+																										far, g_scene_min, g_scene_max,
+																										g_receiver_min, g_receiver_max );
 		}
 		/* switch between looking from virtual camera and shadow caster matrices */
-		if ( glfwGetKey( g_window, GLFW_KEY_SPACE ) ) {
-			glUniformMatrix4fv( g_plain_V_loc, 1, GL_FALSE, g_caster_V.m );
-			glUniformMatrix4fv( g_plain_P_loc, 1, GL_FALSE, g_caster_P.m );
-		} else {
-			glUniformMatrix4fv( g_plain_V_loc, 1, GL_FALSE, g_camera_V.m );
-			glUniformMatrix4fv( g_plain_P_loc, 1, GL_FALSE, g_camera_P.m );
-		}
-
-		/* draw ss quad */
-		glActiveTexture( GL_TEXTURE0 );
-		glBindTexture( GL_TEXTURE_2D, g_depth_fb_tex );
-		glUseProgram( g_debug_sp );
-		glBindVertexArray( g_ss_quad_vao );
-		glDrawArrays( GL_TRIANGLES, 0, g_ss_quad_point_count );
+		g_view_from_caster = glfwGetKey( g_window, GLFW_KEY_SPACE ) ? true : false;
 
 		if ( GLFW_PRESS == glfwGetKey( g_window, GLFW_KEY_ESCAPE ) ) {
 			glfwSetWindowShouldClose( g_window, 1 );
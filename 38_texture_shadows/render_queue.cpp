@@ -0,0 +1,178 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Render queue. See render_queue.h                                             |
+\******************************************************************************/
+#include "render_queue.h"
+#include <assert.h>
+#include <string.h>
+
+#define RENDER_KEY_DEPTH_SHIFT 0
+#define RENDER_KEY_MESH_SHIFT ( RENDER_KEY_DEPTH_SHIFT + RENDER_KEY_DEPTH_BITS )
+#define RENDER_KEY_MATERIAL_SHIFT ( RENDER_KEY_MESH_SHIFT + RENDER_KEY_MESH_BITS )
+#define RENDER_KEY_SHADER_SHIFT ( RENDER_KEY_MATERIAL_SHIFT + RENDER_KEY_MATERIAL_BITS )
+#define RENDER_KEY_PASS_SHIFT ( RENDER_KEY_SHADER_SHIFT + RENDER_KEY_SHADER_BITS )
+static_assert( RENDER_KEY_PASS_SHIFT + RENDER_KEY_PASS_BITS == 64,
+							 "the parts of a render key should fill 64 bits" );
+
+static inline uint64_t field( int value, int shift, int bits ) {
+	assert( value >= 0 && value < ( 1 << bits ) );
+	return (uint64_t)value << shift;
+}
+
+static inline int get_field( uint64_t key, int shift, int bits ) {
+	return (int)( ( key >> shift ) & ( ( (uint64_t)1 << bits ) - 1 ) );
+}
+
+uint64_t render_key( int pass, int shader, int material, int mesh, float depth ) {
+	// in double, as floats can't hold every 24-bit step and round 1 up past it
+	const double depth_max = (double)( ( 1 << RENDER_KEY_DEPTH_BITS ) - 1 );
+	depth = depth < 0.0f ? 0.0f : ( depth > 1.0f ? 1.0f : depth );
+	return field( pass, RENDER_KEY_PASS_SHIFT, RENDER_KEY_PASS_BITS ) |
+				 field( shader, RENDER_KEY_SHADER_SHIFT, RENDER_KEY_SHADER_BITS ) |
+				 field( material, RENDER_KEY_MATERIAL_SHIFT, RENDER_KEY_MATERIAL_BITS ) |
+				 field( mesh, RENDER_KEY_MESH_SHIFT, RENDER_KEY_MESH_BITS ) |
+				 field( (int)( depth * depth_max + 0.5 ), RENDER_KEY_DEPTH_SHIFT,
+								RENDER_KEY_DEPTH_BITS );
+}
+
+int render_key_pass( uint64_t key ) {
+	return get_field( key, RENDER_KEY_PASS_SHIFT, RENDER_KEY_PASS_BITS );
+}
+
+int render_key_shader( uint64_t key ) {
+	return get_field( key, RENDER_KEY_SHADER_SHIFT, RENDER_KEY_SHADER_BITS );
+}
+
+int render_key_material( uint64_t key ) {
+	return get_field( key, RENDER_KEY_MATERIAL_SHIFT, RENDER_KEY_MATERIAL_BITS );
+}
+
+int render_key_mesh( uint64_t key ) {
+	return get_field( key, RENDER_KEY_MESH_SHIFT, RENDER_KEY_MESH_BITS );
+}
+
+void render_queue_clear( render_queue_t &q ) {
+	q.draws.clear();
+	q.items.clear();
+}
+
+render_draw_t *render_queue_add( render_queue_t &q, uint64_t key ) {
+	render_item_t item;
+	item.key = key;
+	item.draw = (uint32_t)q.draws.size();
+	q.items.push_back( item );
+	q.draws.resize( q.draws.size() + 1 );
+	return &q.draws.back();
+}
+
+void render_queue_sort( render_queue_t &q ) {
+	size_t count = q.items.size();
+	if ( count < 2 ) {
+		return;
+	}
+	/* counts every byte of the keys in one read, then does a stable counting
+	sort pass per byte, least significant first. most keys share their pass,
+	shader and material bytes, and a byte that is the same in every key needs
+	no pass */
+	static const int bytes = 8;
+	size_t counts[bytes][256];
+	memset( counts, 0, sizeof( counts ) );
+	for ( size_t i = 0; i < count; i++ ) {
+		uint64_t key = q.items[i].key;
+		for ( int b = 0; b < bytes; b++ ) {
+			counts[b][( key >> ( b * 8 ) ) & 255]++;
+		}
+	}
+	q.scratch.resize( count );
+	render_item_t *from = &q.items[0];
+	render_item_t *to = &q.scratch[0];
+	for ( int b = 0; b < bytes; b++ ) {
+		size_t *digit_counts = counts[b];
+		int shift = b * 8;
+		if ( digit_counts[( from[0].key >> shift ) & 255] == count ) {
+			continue;
+		}
+		size_t sum = 0;
+		for ( int d = 0; d < 256; d++ ) {
+			size_t c = digit_counts[d];
+			digit_counts[d] = sum;
+			sum += c;
+		}
+		for ( size_t i = 0; i < count; i++ ) {
+			to[digit_counts[( from[i].key >> shift ) & 255]++] = from[i];
+		}
+		render_item_t *swap = from;
+		from = to;
+		to = swap;
+	}
+	// an odd number of passes leaves the result in scratch
+	if ( from != &q.items[0] ) {
+		q.items.swap( q.scratch );
+	}
+}
+
+render_stats_t render_queue_replay( const render_queue_t &q, const render_backend_t &backend ) {
+	render_stats_t stats;
+	memset( &stats, 0, sizeof( stats ) );
+	int pass = -1, shader = -1, material = -1, mesh = -1;
+	for ( size_t i = 0; i < q.items.size(); i++ ) {
+		uint64_t key = q.items[i].key;
+		int p = render_key_pass( key );
+		if ( p != pass ) {
+			backend.begin_pass( p );
+			pass = p;
+			shader = material = mesh = -1;
+			stats.passes++;
+		}
+		int s = render_key_shader( key );
+		if ( s != shader ) {
+			backend.use_shader( s );
+			shader = s;
+			material = -1; // its uniforms belong to the last shader
+			stats.shaders++;
+		}
+		int m = render_key_material( key );
+		if ( m != material ) {
+			backend.bind_material( s, m );
+			material = m;
+			stats.materials++;
+		}
+		int v = render_key_mesh( key );
+		if ( v != mesh ) {
+			backend.bind_mesh( v );
+			mesh = v;
+			stats.meshes++;
+		}
+		backend.draw( s, q.draws[q.items[i].draw] );
+		stats.draws++;
+	}
+	return stats;
+}
+
+static void mock_call( render_mock_t *mock, render_call_type_t type, int id ) {
+	render_call_t call;
+	call.type = type;
+	call.id = id;
+	mock->calls.push_back( call );
+}
+
+render_backend_t render_mock_backend( render_mock_t &mock ) {
+	render_mock_t *m = &mock;
+	render_backend_t backend;
+	backend.begin_pass = [m]( int pass ) { mock_call( m, RENDER_CALL_PASS, pass ); };
+	backend.use_shader = [m]( int shader ) { mock_call( m, RENDER_CALL_SHADER, shader ); };
+	backend.bind_material = [m]( int, int material ) {
+		mock_call( m, RENDER_CALL_MATERIAL, material );
+	};
+	backend.bind_mesh = [m]( int mesh ) { mock_call( m, RENDER_CALL_MESH, mesh ); };
+	backend.draw = [m]( int, const render_draw_t &draw ) {
+		mock_call( m, RENDER_CALL_DRAW, draw.first );
+	};
+	return backend;
+}
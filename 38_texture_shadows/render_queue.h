@@ -0,0 +1,120 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Render queue                                                                 |
+| Draws are recorded, not issued. Each one is a packet: a 64-bit sort key,     |
+| which holds its pass, shader, material, mesh, and depth from most to least   |
+| significant, and what changes with every draw - its model matrix and         |
+| vertices. The packets go on the end of arrays that keep their memory from    |
+| frame to frame, so after the first frame recording doesn't allocate. The     |
+| keys are then radix sorted, which puts draws with the same state next to     |
+| each other, nearest first. Replaying calls a backend only when the pass,     |
+| shader, material, or mesh differs from the last draw's. The backend is a     |
+| set of callbacks, so GL can be swapped for render_mock_backend(), which      |
+| just writes down the calls.                                                  |
+\******************************************************************************/
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include "maths_funcs.h"
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+/* bits of the sort key for each part, most significant first. a new pass
+starts all state over */
+#define RENDER_KEY_PASS_BITS 4
+#define RENDER_KEY_SHADER_BITS 8
+#define RENDER_KEY_MATERIAL_BITS 16
+#define RENDER_KEY_MESH_BITS 12
+#define RENDER_KEY_DEPTH_BITS 24
+
+/* makes a sort key. ids must fit in their bits. depth is from 0 to 1 and is
+clamped; nearer draws sort first, so pass 1 - depth to draw far to near */
+uint64_t render_key( int pass, int shader, int material, int mesh, float depth );
+
+int render_key_pass( uint64_t key );
+int render_key_shader( uint64_t key );
+int render_key_material( uint64_t key );
+int render_key_mesh( uint64_t key );
+
+/* what changes with every draw */
+struct render_draw_t {
+	mat4 M;
+	int first; // vertex
+	int count; // of vertices
+};
+
+/* a draw's key and where its packet is */
+struct render_item_t {
+	uint64_t key;
+	uint32_t draw;
+};
+
+struct render_queue_t {
+	std::vector<render_draw_t> draws; // packets, in the order they were recorded
+	std::vector<render_item_t> items; // in order of key after render_queue_sort()
+	std::vector<render_item_t> scratch;
+};
+
+/* how a replay talks to GL. material and draw are given the shader in use, so
+they can look up its uniforms */
+struct render_backend_t {
+	std::function<void( int pass )> begin_pass;
+	std::function<void( int shader )> use_shader;
+	std::function<void( int shader, int material )> bind_material;
+	std::function<void( int mesh )> bind_mesh;
+	std::function<void( int shader, const render_draw_t &draw )> draw;
+};
+
+/* calls a replay made. a shader change sets its material again, and a new
+pass sets everything again */
+struct render_stats_t {
+	int draws;
+	int passes;
+	int shaders;
+	int materials;
+	int meshes;
+};
+
+/* empties the queue for a new frame, keeping its memory */
+void render_queue_clear( render_queue_t &q );
+
+/* adds a packet with key, and returns it to be filled in. it stays valid until
+the next render_queue_add() */
+render_draw_t *render_queue_add( render_queue_t &q, uint64_t key );
+
+/* orders the packets by key. draws with equal keys keep the order they were
+recorded in */
+void render_queue_sort( render_queue_t &q );
+
+/* calls the backend for each packet in turn, skipping state that is already
+set */
+render_stats_t render_queue_replay( const render_queue_t &q, const render_backend_t &backend );
+
+/* one call a replay made to render_mock_backend() */
+enum render_call_type_t {
+	RENDER_CALL_PASS,
+	RENDER_CALL_SHADER,
+	RENDER_CALL_MATERIAL,
+	RENDER_CALL_MESH,
+	RENDER_CALL_DRAW
+};
+struct render_call_t {
+	render_call_type_t type;
+	int id; // pass, shader, material, or mesh, or the first vertex of a draw
+};
+
+struct render_mock_t {
+	std::vector<render_call_t> calls;
+};
+
+/* a backend that appends every call to mock.calls instead of drawing */
+render_backend_t render_mock_backend( render_mock_t &mock );
+
+#endif
@@ -0,0 +1,223 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Cascaded shadow map planner. See shadow_cascades.h                           |
+\******************************************************************************/
+#include "shadow_cascades.h"
+#include <algorithm>
+#include <math.h>
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define SHADOW_CASCADES_SSE
+#endif
+
+/* GL-style orthographic projection of the box l-r, b-t, -n to -f in view
+space */
+static mat4 ortho( float l, float r, float b, float t, float n, float f ) {
+	mat4 m = identity_mat4();
+	m.m[0] = 2.0f / ( r - l );
+	m.m[5] = 2.0f / ( t - b );
+	m.m[10] = -2.0f / ( f - n );
+	m.m[12] = -( r + l ) / ( r - l );
+	m.m[13] = -( t + b ) / ( t - b );
+	m.m[14] = -( f + n ) / ( f - n );
+	return m;
+}
+
+static vec3 transform_point( const mat4 &m, const vec3 &p ) {
+	return vec3( m.m[0] * p.v[0] + m.m[4] * p.v[1] + m.m[8] * p.v[2] + m.m[12],
+							 m.m[1] * p.v[0] + m.m[5] * p.v[1] + m.m[9] * p.v[2] + m.m[13],
+							 m.m[2] * p.v[0] + m.m[6] * p.v[1] + m.m[10] * p.v[2] + m.m[14] );
+}
+
+/* plane from rows of a projection * view matrix (Gribb and Hartmann),
+scaled so that the normal has unit length. sign picks row3 + or - row */
+static void extract_plane( const mat4 &PV, int row, float sign, float *plane ) {
+	for ( int c = 0; c < 4; c++ ) {
+		plane[c] = PV.m[c * 4 + 3] + sign * PV.m[c * 4 + row];
+	}
+	float len = sqrtf( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+	for ( int c = 0; c < 4; c++ ) {
+		plane[c] /= len;
+	}
+}
+
+void shadow_cascade_splits( float near, float far, int count, float lambda, float *splits ) {
+	for ( int i = 0; i <= count; i++ ) {
+		float f = (float)i / (float)count;
+		float log_split = near * powf( far / near, f );
+		float even_split = near + ( far - near ) * f;
+		splits[i] = lambda * log_split + ( 1.0f - lambda ) * even_split;
+	}
+	// exact ends, so cascades meet the camera's clip planes with no gaps
+	splits[0] = near;
+	splits[count] = far;
+}
+
+void plan_shadow_cascades( const mat4 &camera_V, float fovy, float aspect, float near,
+													 float far, const vec3 &light_dir, int count, float lambda,
+													 int resolution, bool stable, const vec3 &scene_min,
+													 const vec3 &scene_max, shadow_cascade_plan_t &plan ) {
+	count = std::max( 1, std::min( count, MAX_SHADOW_CASCADES ) );
+	plan.count = count;
+	float splits[MAX_SHADOW_CASCADES + 1];
+	shadow_cascade_splits( near, far, count, lambda, splits );
+
+	/* one light rotation shared by every cascade, centred on the world origin,
+	so texel snapping is to the same grid for all of them */
+	vec3 up( 0.0f, 1.0f, 0.0f );
+	if ( fabsf( normalise( light_dir ).v[1] ) > 0.99f ) {
+		up = vec3( 1.0f, 0.0f, 0.0f );
+	}
+	mat4 light_V = look_at( vec3( 0.0f, 0.0f, 0.0f ), light_dir, up );
+	mat4 inv_camera_V = inverse( camera_V );
+	float tan_half_fov = tanf( fovy * 0.5f * (float)ONE_DEG_IN_RAD );
+
+	/* how far toward the light anything in the scene reaches */
+	float scene_top = -1e30f;
+	for ( int c = 0; c < 8; c++ ) {
+		vec3 corner( ( c & 1 ) ? scene_max.v[0] : scene_min.v[0],
+								 ( c & 2 ) ? scene_max.v[1] : scene_min.v[1],
+								 ( c & 4 ) ? scene_max.v[2] : scene_min.v[2] );
+		scene_top = std::max( scene_top, transform_point( light_V, corner ).v[2] );
+	}
+
+	for ( int i = 0; i < count; i++ ) {
+		shadow_cascade_t &cascade = plan.cascades[i];
+		cascade.split_near = splits[i];
+		cascade.split_far = splits[i + 1];
+
+		/* corners of the camera's view slice, in world then light space */
+		vec3 corners[8];
+		for ( int c = 0; c < 8; c++ ) {
+			float d = ( c & 4 ) ? splits[i + 1] : splits[i];
+			float y = ( ( c & 2 ) ? 1.0f : -1.0f ) * d * tan_half_fov;
+			float x = ( ( c & 1 ) ? 1.0f : -1.0f ) * d * tan_half_fov * aspect;
+			corners[c] = transform_point( inv_camera_V, vec3( x, y, -d ) );
+		}
+		float min_x = 1e30f, min_y = 1e30f, min_z = 1e30f;
+		float max_x = -1e30f, max_y = -1e30f, max_z = -1e30f;
+		for ( int c = 0; c < 8; c++ ) {
+			vec3 l = transform_point( light_V, corners[c] );
+			min_x = std::min( min_x, l.v[0] );
+			max_x = std::max( max_x, l.v[0] );
+			min_y = std::min( min_y, l.v[1] );
+			max_y = std::max( max_y, l.v[1] );
+			min_z = std::min( min_z, l.v[2] );
+			max_z = std::max( max_z, l.v[2] );
+		}
+
+		float size;
+		if ( stable ) {
+			/* bounding sphere of the slice. its size depends only on the split
+			distances, never on which way the camera faces */
+			vec3 centre( 0.0f, 0.0f, 0.0f );
+			for ( int c = 0; c < 8; c++ ) {
+				centre += corners[c];
+			}
+			centre = centre * 0.125f;
+			float radius = 0.0f;
+			for ( int c = 0; c < 8; c++ ) {
+				radius = std::max( radius, length( corners[c] - centre ) );
+			}
+			// round up so tiny float differences frame to frame don't change it
+			radius = ceilf( radius * 16.0f ) / 16.0f;
+			vec3 l = transform_point( light_V, centre );
+			min_x = l.v[0] - radius;
+			min_y = l.v[1] - radius;
+			size = radius * 2.0f;
+		} else {
+			size = std::max( max_x - min_x, max_y - min_y );
+		}
+
+		/* move the box's corner onto a whole texel. one texel is kept spare so
+		that rounding down never uncovers the far edge of the slice */
+		float texel = size / (float)( resolution - 1 );
+		min_x = floorf( min_x / texel ) * texel;
+		min_y = floorf( min_y / texel ) * texel;
+		max_x = min_x + texel * resolution;
+		max_y = min_y + texel * resolution;
+		cascade.texel_size = texel;
+
+		/* reach back toward the light far enough to include every caster */
+		max_z = std::max( max_z, scene_top );
+		cascade.V = light_V;
+		cascade.P = ortho( min_x, max_x, min_y, max_y, -max_z, -min_z );
+
+		mat4 PV = cascade.P * cascade.V;
+		extract_plane( PV, 0, 1.0f, cascade.planes[0] );	// left
+		extract_plane( PV, 0, -1.0f, cascade.planes[1] ); // right
+		extract_plane( PV, 1, 1.0f, cascade.planes[2] );	// bottom
+		extract_plane( PV, 1, -1.0f, cascade.planes[3] ); // top
+		extract_plane( PV, 2, -1.0f, cascade.planes[4] ); // far
+	}
+}
+
+void caster_bounds_add( caster_bounds_t &bounds, const vec3 &box_min, const vec3 &box_max ) {
+	bounds.min_x.push_back( box_min.v[0] );
+	bounds.min_y.push_back( box_min.v[1] );
+	bounds.min_z.push_back( box_min.v[2] );
+	bounds.max_x.push_back( box_max.v[0] );
+	bounds.max_y.push_back( box_max.v[1] );
+	bounds.max_z.push_back( box_max.v[2] );
+}
+
+/* a box is outside a plane if even its corner furthest along the plane's
+normal is behind it */
+static bool box_outside_planes( const float ( *planes )[4], int plane_count,
+														const caster_bounds_t &b, int i ) {
+	for ( int p = 0; p < plane_count; p++ ) {
+		const float *n = planes[p];
+		float x = n[0] >= 0.0f ? b.max_x[i] : b.min_x[i];
+		float y = n[1] >= 0.0f ? b.max_y[i] : b.min_y[i];
+		float z = n[2] >= 0.0f ? b.max_z[i] : b.min_z[i];
+		if ( ( n[0] * x + n[1] * y ) + ( n[2] * z + n[3] ) < 0.0f ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int cull_cascade_casters( const float ( *planes )[4], int plane_count,
+													const caster_bounds_t &bounds, int start, int end, int *out_ids ) {
+	int n = 0;
+	int i = start;
+#ifdef SHADOW_CASCADES_SSE
+	/* 4 boxes at a time. which of min or max to use is the same for all 4, as
+	it depends only on the plane */
+	for ( ; i + 4 <= end; i += 4 ) {
+		__m128 outside = _mm_setzero_ps();
+		for ( int p = 0; p < plane_count; p++ ) {
+			const float *pl = planes[p];
+			__m128 x = _mm_loadu_ps( pl[0] >= 0.0f ? &bounds.max_x[i] : &bounds.min_x[i] );
+			__m128 y = _mm_loadu_ps( pl[1] >= 0.0f ? &bounds.max_y[i] : &bounds.min_y[i] );
+			__m128 z = _mm_loadu_ps( pl[2] >= 0.0f ? &bounds.max_z[i] : &bounds.min_z[i] );
+			__m128 xy = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( pl[0] ), x ),
+															_mm_mul_ps( _mm_set1_ps( pl[1] ), y ) );
+			__m128 zw = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( pl[2] ), z ), _mm_set1_ps( pl[3] ) );
+			__m128 d = _mm_add_ps( xy, zw );
+			outside = _mm_or_ps( outside, _mm_cmplt_ps( d, _mm_setzero_ps() ) );
+		}
+		int mask = _mm_movemask_ps( outside );
+		if ( 0xF == mask ) {
+			continue;
+		}
+		for ( int k = 0; k < 4; k++ ) {
+			if ( !( mask & ( 1 << k ) ) ) {
+				out_ids[n++] = i + k;
+			}
+		}
+	}
+#endif
+	for ( ; i < end; i++ ) {
+		if ( !box_outside_planes( planes, plane_count, bounds, i ) ) {
+			out_ids[n++] = i;
+		}
+	}
+	return n;
+}
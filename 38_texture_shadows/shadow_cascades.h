@@ -0,0 +1,72 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Cascaded shadow map planner for a directional light.                         |
+| The camera's view range is cut into slices, near ones short and far ones     |
+| long, and each slice gets its own orthographic shadow map fitted around it.  |
+| Map edges are snapped to whole shadow map texels so shadows don't crawl as   |
+| the camera moves. Each cascade also has frustum planes for culling casters.  |
+| Pure CPU - gives the V and P matrices to render each cascade with.           |
+\******************************************************************************/
+#ifndef _SHADOW_CASCADES_H_
+#define _SHADOW_CASCADES_H_
+
+#include "maths_funcs.h"
+#include <vector>
+
+#define MAX_SHADOW_CASCADES 4
+#define SHADOW_CASCADE_PLANES 5
+
+struct shadow_cascade_t {
+	float split_near, split_far; // camera distances this cascade covers
+	mat4 V, P;									 // light view and orthographic projection
+	float texel_size;						 // world units per shadow map texel
+	/* world-space planes of the light's box as a, b, c, d with a*x+b*y+c*z+d >= 0
+	inside: left, right, bottom, top, far. there is no near plane, so casters
+	between the light and the slice are kept */
+	float planes[SHADOW_CASCADE_PLANES][4];
+};
+
+struct shadow_cascade_plan_t {
+	int count;
+	shadow_cascade_t cascades[MAX_SHADOW_CASCADES];
+};
+
+/* world-space boxes of shadow casters, one array per component so that 4
+boxes can be tested at once */
+struct caster_bounds_t {
+	std::vector<float> min_x, min_y, min_z;
+	std::vector<float> max_x, max_y, max_z;
+};
+
+/* the "practical" split scheme: lambda 0 gives even splits, 1 gives
+logarithmic splits. writes count + 1 distances from near to far */
+void shadow_cascade_splits( float near, float far, int count, float lambda, float *splits );
+
+/* fits count cascades (up to MAX_SHADOW_CASCADES) to a camera with view matrix
+camera_V and a perspective( fovy, aspect, near, far ) projection, for a light
+shining along light_dir. each map is resolution texels square. with stable
+set each cascade bounds its slice with a sphere, so the map's size never
+changes as the camera turns; otherwise it is a tight box around the slice,
+which is sharper but shimmers when turning. scene_min/scene_max bound
+everything that can cast a shadow, and set how far back toward the light
+each map reaches */
+void plan_shadow_cascades( const mat4 &camera_V, float fovy, float aspect, float near,
+													 float far, const vec3 &light_dir, int count, float lambda,
+													 int resolution, bool stable, const vec3 &scene_min,
+													 const vec3 &scene_max, shadow_cascade_plan_t &plan );
+
+void caster_bounds_add( caster_bounds_t &bounds, const vec3 &box_min, const vec3 &box_max );
+/* writes indices of boxes start to end - 1 that touch the inside of all
+plane_count planes, given like shadow_cascade_t::planes, into out_ids and
+returns how many there were. out_ids needs room for every box in the range.
+for a cascade pass its planes and SHADOW_CASCADE_PLANES */
+int cull_cascade_casters( const float ( *planes )[4], int plane_count,
+													const caster_bounds_t &bounds, int start, int end, int *out_ids );
+
+#endif
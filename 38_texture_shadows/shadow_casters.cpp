@@ -0,0 +1,168 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Shadow caster culling and draw lists. See shadow_casters.h                   |
+\******************************************************************************/
+#include "shadow_casters.h"
+#include "run_threads.h"
+#include <algorithm>
+#include <math.h>
+
+#define NUM_CULL_PLANES 6
+
+void shadow_caster_set_add( shadow_caster_set_t &set, const vec3 &box_min,
+														const vec3 &box_max, int mesh_id ) {
+	caster_bounds_add( set.bounds, box_min, box_max );
+	set.mesh_ids.push_back( mesh_id );
+	set.mesh_count = std::max( set.mesh_count, mesh_id + 1 );
+}
+
+bool camera_receiver_bounds( const mat4 &camera_V, float fovy, float aspect, float near,
+														 float far, const vec3 &scene_min, const vec3 &scene_max,
+														 vec3 &receiver_min, vec3 &receiver_max ) {
+	mat4 inv_V = inverse( camera_V );
+	float tan_half_fov = tanf( fovy * 0.5f * (float)ONE_DEG_IN_RAD );
+	receiver_min = vec3( 1e30f, 1e30f, 1e30f );
+	receiver_max = vec3( -1e30f, -1e30f, -1e30f );
+	for ( int c = 0; c < 8; c++ ) {
+		float d = ( c & 4 ) ? far : near;
+		vec4 p( ( ( c & 1 ) ? 1.0f : -1.0f ) * d * tan_half_fov * aspect,
+						( ( c & 2 ) ? 1.0f : -1.0f ) * d * tan_half_fov, -d, 1.0f );
+		vec4 w = inv_V * p;
+		for ( int a = 0; a < 3; a++ ) {
+			receiver_min.v[a] = std::min( receiver_min.v[a], w.v[a] );
+			receiver_max.v[a] = std::max( receiver_max.v[a], w.v[a] );
+		}
+	}
+	for ( int a = 0; a < 3; a++ ) {
+		receiver_min.v[a] = std::max( receiver_min.v[a], scene_min.v[a] );
+		receiver_max.v[a] = std::min( receiver_max.v[a], scene_max.v[a] );
+		if ( receiver_min.v[a] > receiver_max.v[a] ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* plane a*row3 + b*row of a column-major matrix */
+static void combine_rows( const mat4 &m, float a, int row, float b, float *plane ) {
+	for ( int c = 0; c < 4; c++ ) {
+		plane[c] = a * m.m[c * 4 + 3] + b * m.m[c * 4 + row];
+	}
+}
+
+/* planes of the light frustum cropped to the receivers: the box's footprint
+in the light's normalised device coordinates bounds the sides, and its
+furthest point from the light sets the far plane. returns false if the
+receivers are all outside the light */
+static bool cropped_light_planes( const mat4 &PV, const vec3 &receiver_min,
+																	const vec3 &receiver_max,
+																	float planes[NUM_CULL_PLANES][4] ) {
+	float x0 = 1.0f, x1 = -1.0f, y0 = 1.0f, y1 = -1.0f, z1 = -1.0f;
+	bool behind = false;
+	for ( int c = 0; c < 8; c++ ) {
+		float p[3] = { ( c & 1 ) ? receiver_max.v[0] : receiver_min.v[0],
+									 ( c & 2 ) ? receiver_max.v[1] : receiver_min.v[1],
+									 ( c & 4 ) ? receiver_max.v[2] : receiver_min.v[2] };
+		float clip[4];
+		for ( int r = 0; r < 4; r++ ) {
+			clip[r] = PV.m[r] * p[0] + PV.m[4 + r] * p[1] + PV.m[8 + r] * p[2] + PV.m[12 + r];
+		}
+		if ( clip[3] <= 0.0f ) {
+			behind = true;
+			break;
+		}
+		x0 = std::min( x0, clip[0] / clip[3] );
+		x1 = std::max( x1, clip[0] / clip[3] );
+		y0 = std::min( y0, clip[1] / clip[3] );
+		y1 = std::max( y1, clip[1] / clip[3] );
+		z1 = std::max( z1, clip[2] / clip[3] );
+	}
+	if ( behind ) {
+		/* the receivers wrap around the light, so their footprint can't be
+		found from the corners. fall back to the whole frustum */
+		x0 = y0 = -1.0f;
+		x1 = y1 = z1 = 1.0f;
+	}
+	x0 = std::max( x0, -1.0f );
+	y0 = std::max( y0, -1.0f );
+	x1 = std::min( x1, 1.0f );
+	y1 = std::min( y1, 1.0f );
+	z1 = std::min( z1, 1.0f );
+	if ( x0 > x1 || y0 > y1 || z1 < -1.0f ) {
+		return false;
+	}
+	combine_rows( PV, -x0, 0, 1.0f, planes[0] ); // x >= x0 * w
+	combine_rows( PV, x1, 0, -1.0f, planes[1] ); // x <= x1 * w
+	combine_rows( PV, -y0, 1, 1.0f, planes[2] ); // y >= y0 * w
+	combine_rows( PV, y1, 1, -1.0f, planes[3] ); // y <= y1 * w
+	combine_rows( PV, 1.0f, 2, 1.0f, planes[4] ); // near: z >= -w
+	combine_rows( PV, z1, 2, -1.0f, planes[5] ); // z <= z1 * w
+	return true;
+}
+
+void build_shadow_draw_list( const shadow_caster_set_t &set, const mat4 &light_PV,
+														 const vec3 &receiver_min, const vec3 &receiver_max,
+														 shadow_draw_list_t &list, int thread_count ) {
+	list.objects.clear();
+	list.batches.clear();
+	float planes[NUM_CULL_PLANES][4];
+	if ( !cropped_light_planes( light_PV, receiver_min, receiver_max, planes ) ) {
+		return;
+	}
+	if ( thread_count < 1 ) {
+		thread_count = 1;
+	}
+	int object_count = (int)set.mesh_ids.size();
+	int mesh_count = set.mesh_count;
+
+	/* 1. each thread culls a contiguous chunk and counts survivors per mesh */
+	std::vector<std::vector<int> > visible( thread_count );
+	std::vector<int> mesh_counts( thread_count * mesh_count, 0 );
+	run_on_threads( thread_count, [&]( int t ) {
+		int start = (int)( (long long)object_count * t / thread_count );
+		int end = (int)( (long long)object_count * ( t + 1 ) / thread_count );
+		visible[t].resize( end - start );
+		int kept = cull_cascade_casters( planes, NUM_CULL_PLANES, set.bounds, start, end,
+																		 visible[t].empty() ? NULL : &visible[t][0] );
+		visible[t].resize( kept );
+		int *counts = &mesh_counts[t * mesh_count];
+		for ( size_t i = 0; i < visible[t].size(); i++ ) {
+			counts[set.mesh_ids[visible[t][i]]]++;
+		}
+	} );
+
+	/* 2. where each thread's objects of each mesh start. ordered mesh first,
+	then thread, so the list comes out sorted by mesh then object index */
+	std::vector<int> offsets( thread_count * mesh_count );
+	int total = 0;
+	for ( int m = 0; m < mesh_count; m++ ) {
+		int mesh_start = total;
+		for ( int t = 0; t < thread_count; t++ ) {
+			offsets[t * mesh_count + m] = total;
+			total += mesh_counts[t * mesh_count + m];
+		}
+		if ( total > mesh_start ) {
+			shadow_draw_batch_t batch;
+			batch.mesh = m;
+			batch.first = mesh_start;
+			batch.count = total - mesh_start;
+			list.batches.push_back( batch );
+		}
+	}
+
+	/* 3. counting-sort scatter */
+	list.objects.resize( total );
+	run_on_threads( thread_count, [&]( int t ) {
+		int *next = &offsets[t * mesh_count];
+		for ( size_t i = 0; i < visible[t].size(); i++ ) {
+			int object = visible[t][i];
+			list.objects[next[set.mesh_ids[object]]++] = object;
+		}
+	} );
+}
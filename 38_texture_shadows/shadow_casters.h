@@ -0,0 +1,62 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Shadow caster culling and draw lists.                                        |
+| An object only needs drawing into a light's shadow map if its shadow can     |
+| land on something the camera sees. The light's frustum is cropped to the     |
+| part that covers the receivers - the visible bit of the scene - and ends at  |
+| the furthest receiver; anything between the light and that is kept, as its   |
+| shadow falls toward them. Boxes are tested 4 at a time with SSE, split over  |
+| threads, and the survivors are grouped by mesh so that each mesh is bound    |
+| once per light.                                                              |
+\******************************************************************************/
+#ifndef _SHADOW_CASTERS_H_
+#define _SHADOW_CASTERS_H_
+
+#include "maths_funcs.h"
+#include "shadow_cascades.h"
+#include <vector>
+
+/* everything that might cast a shadow */
+struct shadow_caster_set_t {
+	caster_bounds_t bounds;			// world-space box of each object
+	std::vector<int> mesh_ids; // which mesh each object draws, 0 to mesh_count - 1
+	int mesh_count;
+	shadow_caster_set_t() : mesh_count( 0 ) {}
+};
+
+/* a run of objects in a draw list that all use the same mesh */
+struct shadow_draw_batch_t {
+	int mesh;
+	int first; // index into shadow_draw_list_t::objects
+	int count;
+};
+
+/* objects to draw into one light's shadow map, grouped by mesh */
+struct shadow_draw_list_t {
+	std::vector<int> objects;
+	std::vector<shadow_draw_batch_t> batches;
+};
+
+void shadow_caster_set_add( shadow_caster_set_t &set, const vec3 &box_min,
+														const vec3 &box_max, int mesh_id );
+
+/* box around the part of the scene a camera can see: its view frustum's box,
+clipped to scene_min/scene_max. returns false if they don't overlap */
+bool camera_receiver_bounds( const mat4 &camera_V, float fovy, float aspect, float near,
+														 float far, const vec3 &scene_min, const vec3 &scene_max,
+														 vec3 &receiver_min, vec3 &receiver_max );
+
+/* culls the set against a light with projection * view light_PV, keeping
+objects that can shadow the receiver box, and fills list with them sorted by
+mesh (and by object index within a mesh). uses thread_count threads */
+void build_shadow_draw_list( const shadow_caster_set_t &set, const mat4 &light_PV,
+														 const vec3 &receiver_min, const vec3 &receiver_max,
+														 shadow_draw_list_t &list, int thread_count );
+
+#endif
@@ -0,0 +1,152 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Render queue tests                                                           |
+| Checks that sort keys give back their parts and order draws by pass, then    |
+| shader, material, mesh, and depth, that a small replay on the mock backend   |
+| makes exactly the calls it should, and that the radix sort puts random keys  |
+| in the same order as std::stable_sort(), ties included.                      |
+| Build and run with "make -f Makefile.linux64 test".                          |
+\******************************************************************************/
+#include "render_queue.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static int g_failures = 0;
+
+#define CHECK( cond )                                                         \
+	do {                                                                        \
+		if ( !( cond ) ) {                                                        \
+			fprintf( stderr, "FAILED %s:%i: %s\n", __FILE__, __LINE__, #cond );     \
+			g_failures++;                                                           \
+		}                                                                         \
+	} while ( 0 )
+
+static void test_keys() {
+	uint64_t key = render_key( 3, 200, 60000, 4000, 0.5f );
+	CHECK( 3 == render_key_pass( key ) );
+	CHECK( 200 == render_key_shader( key ) );
+	CHECK( 60000 == render_key_material( key ) );
+	CHECK( 4000 == render_key_mesh( key ) );
+	// each part outweighs everything after it
+	CHECK( render_key( 1, 0, 0, 0, 0.0f ) > render_key( 0, 255, 65535, 4095, 1.0f ) );
+	CHECK( render_key( 0, 1, 0, 0, 0.0f ) > render_key( 0, 0, 65535, 4095, 1.0f ) );
+	CHECK( render_key( 0, 0, 1, 0, 0.0f ) > render_key( 0, 0, 0, 4095, 1.0f ) );
+	CHECK( render_key( 0, 0, 0, 1, 0.0f ) > render_key( 0, 0, 0, 0, 1.0f ) );
+	CHECK( render_key( 0, 0, 0, 0, 0.2f ) < render_key( 0, 0, 0, 0, 0.3f ) );
+	// depth is clamped, and 1 doesn't round up into the mesh bits
+	CHECK( render_key( 0, 0, 0, 0, -5.0f ) == render_key( 0, 0, 0, 0, 0.0f ) );
+	CHECK( render_key( 0, 0, 0, 0, 7.0f ) == render_key( 0, 0, 0, 0, 1.0f ) );
+	CHECK( 0 == render_key_mesh( render_key( 0, 0, 0, 0, 1.0f ) ) );
+}
+
+/* the mock's calls as letters and ids: P for pass, S shader, M material, V
+mesh, and D a draw's first vertex */
+static std::string replay_calls( const render_queue_t &q, render_stats_t *stats ) {
+	render_mock_t mock;
+	*stats = render_queue_replay( q, render_mock_backend( mock ) );
+	const char *letters = "PSMVD";
+	std::string calls;
+	for ( size_t i = 0; i < mock.calls.size(); i++ ) {
+		calls += letters[mock.calls[i].type];
+		calls += (char)( '0' + mock.calls[i].id );
+	}
+	return calls;
+}
+
+/* six draws recorded out of order. the replay should set each piece of state
+once per run of draws that share it, starting again at a new pass and setting
+the material again after a new shader */
+static void test_replay() {
+	const int parts[6][4] = { // pass, shader, material, mesh
+		{ 1, 1, 2, 1 }, { 0, 0, 0, 1 }, { 1, 1, 1, 0 }, { 1, 2, 0, 2 }, { 1, 1, 2, 1 }, { 0, 0, 0, 1 }
+	};
+	render_queue_t q;
+	for ( int i = 0; i < 6; i++ ) {
+		render_draw_t *draw = render_queue_add(
+			q, render_key( parts[i][0], parts[i][1], parts[i][2], parts[i][3], 0.1f * i ) );
+		draw->M = identity_mat4();
+		draw->first = i;
+		draw->count = 3;
+	}
+	render_queue_sort( q );
+	render_stats_t stats;
+	CHECK( replay_calls( q, &stats ) == "P0S0M0V1D1D5P1S1M1V0D2M2V1D0D4S2M0V2D3" );
+	CHECK( 6 == stats.draws && 2 == stats.passes && 3 == stats.shaders );
+	CHECK( 4 == stats.materials && 4 == stats.meshes );
+
+	// clearing keeps the memory for the next frame
+	size_t capacity = q.items.capacity();
+	render_queue_clear( q );
+	CHECK( q.items.empty() && q.draws.empty() && q.items.capacity() == capacity );
+	CHECK( replay_calls( q, &stats ).empty() && 0 == stats.draws );
+
+	/* the same material and mesh under another shader. the material's uniforms
+	belong to the shader, so it is set again, but the mesh is not */
+	render_queue_add( q, render_key( 0, 1, 5, 0, 0.0f ) )->first = 0;
+	render_queue_add( q, render_key( 0, 2, 5, 0, 0.0f ) )->first = 1;
+	render_queue_sort( q );
+	CHECK( replay_calls( q, &stats ) == "P0S1M5V0D0S2M5D1" );
+}
+
+static uint64_t random_bits() {
+	return ( (uint64_t)rand() << 42 ) ^ ( (uint64_t)rand() << 21 ) ^ (uint64_t)rand();
+}
+
+/* empty, one key, all the same key (every pass skipped), full 64-bit keys,
+keys like the demo's that share their high bytes, and a lot of ties */
+static void test_sort() {
+	render_queue_t q;
+	for ( int trial = 0; trial < 7; trial++ ) {
+		render_queue_clear( q );
+		int n = trial == 0 ? 0 : ( trial == 1 ? 1 : 1000 + rand() % 50000 );
+		for ( int i = 0; i < n; i++ ) {
+			uint64_t key;
+			if ( trial == 2 ) {
+				key = render_key( 1, 2, 3, 4, 0.5f );
+			} else if ( trial == 3 ) {
+				key = random_bits();
+			} else if ( trial == 4 ) {
+				key = render_key( rand() % 2, rand() % 8, rand() % 64, rand() % 32,
+													(float)rand() / (float)RAND_MAX );
+			} else if ( trial == 5 ) {
+				key = render_key( rand() % 2, 0, rand() % 3, 0, 0.0f );
+			} else {
+				key = render_key( rand() % 16, rand() % 256, rand() % 65536, rand() % 4096,
+													(float)rand() / (float)RAND_MAX );
+			}
+			render_queue_add( q, key )->first = i;
+		}
+		std::vector<render_item_t> expected( q.items );
+		std::stable_sort( expected.begin(), expected.end(),
+											[]( const render_item_t &a, const render_item_t &b ) {
+												return a.key < b.key;
+											} );
+		render_queue_sort( q );
+		bool same = q.items.size() == expected.size();
+		for ( size_t i = 0; same && i < expected.size(); i++ ) {
+			same = q.items[i].key == expected[i].key && q.items[i].draw == expected[i].draw;
+		}
+		CHECK( same );
+	}
+}
+
+int main() {
+	srand( 1 );
+	test_keys();
+	test_replay();
+	test_sort();
+	if ( g_failures ) {
+		fprintf( stderr, "%i checks failed\n", g_failures );
+		return 1;
+	}
+	printf( "render_queue_test passed\n" );
+	return 0;
+}
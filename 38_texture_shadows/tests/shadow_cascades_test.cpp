@@ -0,0 +1,224 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| Shadow cascade planner tests                                                 |
+| Plans cascades for 200 random cameras and checks that every point of each    |
+| view slice lands inside its cascade's clip box, that map edges sit on whole  |
+| texels, that turning the camera never changes the stable cascade sizes, and  |
+| that the SSE caster culling keeps the same boxes as a plain loop does.       |
+| Build and run with "make -f Makefile.linux64 test".                          |
+\******************************************************************************/
+#include "shadow_cascades.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_CAMERAS 200
+#define TEST_BOXES 10003 // not a multiple of 4, so the scalar tail runs too
+#define TEST_FOVY 67.0f
+#define TEST_ASPECT 1.5f
+#define TEST_NEAR 0.1f
+#define TEST_FAR 100.0f
+#define TEST_CASCADES 4
+#define TEST_LAMBDA 0.75f
+#define TEST_RESOLUTION 1024
+// of the clip box's half-size of 1, for float error in the corners
+#define TEST_CLIP_TOLERANCE 1e-4f
+
+static int g_failures = 0;
+
+#define CHECK( cond )                                                         \
+	do {                                                                        \
+		if ( !( cond ) ) {                                                        \
+			fprintf( stderr, "FAILED %s:%i: %s\n", __FILE__, __LINE__, #cond );     \
+			g_failures++;                                                           \
+		}                                                                         \
+	} while ( 0 )
+
+static float random_float( float lo, float hi ) {
+	return lo + ( hi - lo ) * (float)rand() / (float)RAND_MAX;
+}
+
+static vec3 random_direction() {
+	for ( ;; ) {
+		vec3 d( random_float( -1.0f, 1.0f ), random_float( -1.0f, 1.0f ),
+						random_float( -1.0f, 1.0f ) );
+		float len = length( d );
+		if ( len > 0.1f && len <= 1.0f ) {
+			return d / len;
+		}
+	}
+}
+
+static mat4 camera_looking( const vec3 &pos, const vec3 &dir ) {
+	vec3 up( 0.0f, 1.0f, 0.0f );
+	if ( fabsf( dir.v[1] ) > 0.99f ) {
+		up = vec3( 1.0f, 0.0f, 0.0f );
+	}
+	return look_at( pos, pos + dir, up );
+}
+
+static vec3 clip_point( const shadow_cascade_t &cascade, const vec3 &p_wor ) {
+	vec4 p = cascade.P * ( cascade.V * vec4( p_wor, 1.0f ) );
+	return vec3( p ); // orthographic, so w is 1
+}
+
+/* random points in each cascade's slice of the camera's view, including its
+corners, must all be inside the cascade's box */
+static void check_slices_covered( const mat4 &V, const shadow_cascade_plan_t &plan ) {
+	mat4 inv_V = inverse( V );
+	float tan_half_fov = tanf( TEST_FOVY * 0.5f * (float)ONE_DEG_IN_RAD );
+	for ( int i = 0; i < plan.count; i++ ) {
+		const shadow_cascade_t &cascade = plan.cascades[i];
+		if ( i > 0 ) {
+			CHECK( cascade.split_near == plan.cascades[i - 1].split_far );
+		}
+		for ( int n = 0; n < 64; n++ ) {
+			float d, fx, fy;
+			if ( n < 8 ) {
+				d = ( n & 4 ) ? cascade.split_far : cascade.split_near;
+				fx = ( n & 1 ) ? 1.0f : -1.0f;
+				fy = ( n & 2 ) ? 1.0f : -1.0f;
+			} else {
+				d = random_float( cascade.split_near, cascade.split_far );
+				fx = random_float( -1.0f, 1.0f );
+				fy = random_float( -1.0f, 1.0f );
+			}
+			vec4 p_eye( fx * d * tan_half_fov * TEST_ASPECT, fy * d * tan_half_fov, -d, 1.0f );
+			vec3 p = clip_point( cascade, vec3( inv_V * p_eye ) );
+			bool inside = true;
+			for ( int c = 0; c < 3; c++ ) {
+				inside = inside && fabsf( p.v[c] ) <= 1.0f + TEST_CLIP_TOLERANCE;
+			}
+			CHECK( inside );
+		}
+	}
+}
+
+/* the box's left and bottom edges in light space are whole numbers of texels
+from the light's origin, and the box is resolution texels across */
+static void check_texel_snapped( const shadow_cascade_plan_t &plan ) {
+	for ( int i = 0; i < plan.count; i++ ) {
+		const shadow_cascade_t &cascade = plan.cascades[i];
+		float texel = cascade.texel_size;
+		for ( int axis = 0; axis < 2; axis++ ) {
+			float scale = cascade.P.m[axis * 5];
+			float offset = cascade.P.m[12 + axis];
+			float lo = ( -1.0f - offset ) / scale;
+			float hi = ( 1.0f - offset ) / scale;
+			float texels = lo / texel;
+			CHECK( fabsf( texels - floorf( texels + 0.5f ) ) < 1e-2f );
+			CHECK( fabsf( ( hi - lo ) / texel - (float)TEST_RESOLUTION ) < 1e-2f );
+		}
+	}
+}
+
+static void test_random_cameras() {
+	vec3 scene_min( -20.0f, -1.0f, -20.0f ), scene_max( 20.0f, 2.0f, 20.0f );
+	for ( int cam = 0; cam < TEST_CAMERAS; cam++ ) {
+		vec3 light_dir = random_direction();
+		if ( light_dir.v[1] > 0.0f ) {
+			light_dir.v[1] = -light_dir.v[1];
+		}
+		vec3 pos( random_float( -30.0f, 30.0f ), random_float( 0.5f, 20.0f ),
+							random_float( -30.0f, 30.0f ) );
+		mat4 V = camera_looking( pos, random_direction() );
+		shadow_cascade_plan_t stable, tight;
+		plan_shadow_cascades( V, TEST_FOVY, TEST_ASPECT, TEST_NEAR, TEST_FAR, light_dir,
+													TEST_CASCADES, TEST_LAMBDA, TEST_RESOLUTION, true, scene_min,
+													scene_max, stable );
+		plan_shadow_cascades( V, TEST_FOVY, TEST_ASPECT, TEST_NEAR, TEST_FAR, light_dir,
+													TEST_CASCADES, TEST_LAMBDA, TEST_RESOLUTION, false, scene_min,
+													scene_max, tight );
+		CHECK( stable.count == TEST_CASCADES && tight.count == TEST_CASCADES );
+		check_slices_covered( V, stable );
+		check_slices_covered( V, tight );
+		check_texel_snapped( stable );
+		check_texel_snapped( tight );
+		CHECK( stable.cascades[0].split_near == TEST_NEAR );
+		CHECK( stable.cascades[TEST_CASCADES - 1].split_far == TEST_FAR );
+
+		/* turning in place must leave every stable map the same size */
+		mat4 turned_V = camera_looking( pos, random_direction() );
+		shadow_cascade_plan_t turned;
+		plan_shadow_cascades( turned_V, TEST_FOVY, TEST_ASPECT, TEST_NEAR, TEST_FAR, light_dir,
+													TEST_CASCADES, TEST_LAMBDA, TEST_RESOLUTION, true, scene_min,
+													scene_max, turned );
+		for ( int i = 0; i < TEST_CASCADES; i++ ) {
+			CHECK( turned.cascades[i].texel_size == stable.cascades[i].texel_size );
+		}
+	}
+}
+
+/* the same p-vertex test as the planner's, one box at a time and in the same
+order of operations, so the results must match exactly */
+static bool box_outside_reference( const float planes[SHADOW_CASCADE_PLANES][4], const vec3 &mn,
+																		 const vec3 &mx ) {
+	for ( int p = 0; p < SHADOW_CASCADE_PLANES; p++ ) {
+		const float *n = planes[p];
+		float x = n[0] >= 0.0f ? mx.v[0] : mn.v[0];
+		float y = n[1] >= 0.0f ? mx.v[1] : mn.v[1];
+		float z = n[2] >= 0.0f ? mx.v[2] : mn.v[2];
+		if ( ( n[0] * x + n[1] * y ) + ( n[2] * z + n[3] ) < 0.0f ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void test_caster_culling() {
+	vec3 scene_min( -50.0f, -1.0f, -50.0f ), scene_max( 50.0f, 10.0f, 50.0f );
+	std::vector<vec3> mins( TEST_BOXES ), maxs( TEST_BOXES );
+	caster_bounds_t bounds;
+	for ( int i = 0; i < TEST_BOXES; i++ ) {
+		mins[i] = vec3( random_float( -50.0f, 50.0f ), random_float( -1.0f, 8.0f ),
+										random_float( -50.0f, 50.0f ) );
+		maxs[i] = mins[i] + vec3( random_float( 0.1f, 3.0f ), random_float( 0.1f, 3.0f ),
+															random_float( 0.1f, 3.0f ) );
+		caster_bounds_add( bounds, mins[i], maxs[i] );
+	}
+	std::vector<int> ids( TEST_BOXES );
+	int kept_total = 0;
+	for ( int cam = 0; cam < 20; cam++ ) {
+		vec3 pos( random_float( -20.0f, 20.0f ), random_float( 1.0f, 10.0f ),
+							random_float( -20.0f, 20.0f ) );
+		mat4 V = camera_looking( pos, random_direction() );
+		shadow_cascade_plan_t plan;
+		plan_shadow_cascades( V, TEST_FOVY, TEST_ASPECT, TEST_NEAR, TEST_FAR,
+													normalise( vec3( -1.0f, -2.0f, 0.5f ) ), TEST_CASCADES,
+													TEST_LAMBDA, TEST_RESOLUTION, true, scene_min, scene_max, plan );
+		for ( int c = 0; c < plan.count; c++ ) {
+			int kept = cull_cascade_casters( plan.cascades[c].planes, SHADOW_CASCADE_PLANES, bounds, 0,
+																			 TEST_BOXES, &ids[0] );
+			int k = 0;
+			bool same = true;
+			for ( int i = 0; i < TEST_BOXES; i++ ) {
+				if ( !box_outside_reference( plan.cascades[c].planes, mins[i], maxs[i] ) ) {
+					same = same && k < kept && ids[k] == i;
+					k++;
+				}
+			}
+			CHECK( same && k == kept );
+			kept_total += kept;
+		}
+	}
+	CHECK( kept_total > 0 );
+	printf( "%i boxes, %i kept over 80 cascades\n", TEST_BOXES, kept_total );
+}
+
+int main() {
+	srand( 1 );
+	test_random_cameras();
+	test_caster_culling();
+	if ( g_failures ) {
+		fprintf( stderr, "%i checks failed\n", g_failures );
+		return 1;
+	}
+	printf( "shadow_cascades_test passed\n" );
+	return 0;
+}
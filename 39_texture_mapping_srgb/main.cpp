@@ -9,12 +9,17 @@
 | Texture Mapping                                                              |
 | * I used Sean Barrett's stb_image library to load an image file into memory  |
 | * I made a load_texture() function to copy this into a GL texture            |
+| * load_texture() goes through texture_loader.h, which caches decoded images  |
+| * mipmaps are made on the CPU in linear space by mipmap.h, so that the sRGB  |
+|   colours are averaged correctly                                             |
 \******************************************************************************/
 
 #include "gl_utils.h"
 #include "maths_funcs.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"	// Sean Barrett's image loader - http://nothings.org/
+#include "mipmap.h"
+#include "texture_loader.h"
 #include <GL/glew.h>		// include GLEW and new version of GL on Windows
 #include <GLFW/glfw3.h> // GLFW helper library
 #include <assert.h>
@@ -23,48 +28,72 @@
 #include <string.h>
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <thread>
+#include <vector>
 #define GL_LOG_FILE "gl.log"
 
 int g_gl_width = 640;
 int g_gl_height = 480;
 GLFWwindow *g_window = NULL;
 
+/* the repo's other demos' images, for the loading benchmark. run from this
+folder. some are copies of the same file */
+const char *g_bench_images[] = {
+	"skulluvmap.png", "../09_texture_mapping/skulluvmap.png",
+	"../10_screen_capture/skulluvmap.png", "../12_debugging_shaders/ao.png",
+	"../12_debugging_shaders/boulder_diff.png", "../12_debugging_shaders/boulder_spec.png",
+	"../12_debugging_shaders/tileable9b_emiss.png", "../14_multi_tex/ship.png",
+	"../15_phongtextures/ao.png", "../15_phongtextures/boulder_spec.png",
+	"../16_frag_reject/skulluvmap.png", "../17_alpha_blending/blob.png",
+	"../17_alpha_blending/blob2.png", "../20_normal_mapping/brickwork_normal-map.png",
+	"../24_gui_panels/tile2-diamonds256x256.png", "../25_sprite_sheets/shark_anim.png",
+	"../26_bitmap_fonts/handmade2.png", "../27_font_atlas/freemono.png",
+	"../29_particle_systems/Droplet.png", "../37_deferred_shading/g_buffer_normals.png",
+	"../37_deferred_shading/screenshot.png", "../21_cube_mapping/negx.jpg",
+	"../21_cube_mapping/negy.jpg", "../21_cube_mapping/negz.jpg",
+	"../21_cube_mapping/posx.jpg", "../21_cube_mapping/posy.jpg",
+	"../21_cube_mapping/posz.jpg"
+};
+#define BENCH_NUM_IMAGES ( sizeof( g_bench_images ) / sizeof( g_bench_images[0] ) )
+/* the start-up benchmarks take seconds and lots of memory before the first
+frame, so they only run when this is uncommented */
+//#define RUN_BENCHMARKS
+/* the mipmap benchmark builds chains for 4096x4096 images, then twice the
+size, up to this */
+#define BENCH_MIPMAP_MAX_SIZE 16384
+/* filter for the demo texture's mipmaps */
+#define MIP_FILTER MIP_FILTER_KAISER
+
+int g_num_threads = 1;
+texture_cache_t g_textures;
+
 bool load_texture( const char *file_name, GLuint *tex ) {
-	int x, y, n;
-	int force_channels = 4;
-	unsigned char *image_data = stbi_load( file_name, &x, &y, &n, force_channels );
-	if ( !image_data ) {
-		fprintf( stderr, "ERROR: could not load %s\n", file_name );
+	const texture_image_t *image = texture_load( g_textures, file_name, true );
+	if ( !image ) {
 		return false;
 	}
+	int x = image->width;
+	int y = image->height;
 	// NPOT check
 	if ( ( x & ( x - 1 ) ) != 0 || ( y & ( y - 1 ) ) != 0 ) {
 		fprintf( stderr, "WARNING: texture %s is not power-of-2 dimensions\n",
 						 file_name );
 	}
-	int width_in_bytes = x * 4;
-	unsigned char *top = NULL;
-	unsigned char *bottom = NULL;
-	unsigned char temp = 0;
-	int half_height = y / 2;
-
-	for ( int row = 0; row < half_height; row++ ) {
-		top = image_data + row * width_in_bytes;
-		bottom = image_data + ( y - row - 1 ) * width_in_bytes;
-		for ( int col = 0; col < width_in_bytes; col++ ) {
-			temp = *top;
-			*top = *bottom;
-			*bottom = temp;
-			top++;
-			bottom++;
-		}
-	}
+	mip_chain_t mips;
+	mip_settings_t settings;
+	settings.filter = MIP_FILTER;
+	mip_chain_build( mips, image->pixels, x, y, settings, g_num_threads );
+
 	glGenTextures( 1, tex );
 	glActiveTexture( GL_TEXTURE0 );
 	glBindTexture( GL_TEXTURE_2D, *tex );
 	glTexImage2D( GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, x, y, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-								image_data );
-	glGenerateMipmap( GL_TEXTURE_2D );
+								image->pixels );
+	for ( size_t l = 0; l < mips.levels.size(); l++ ) {
+		glTexImage2D( GL_TEXTURE_2D, (GLint)l + 1, GL_SRGB_ALPHA, mips.levels[l].width,
+									mips.levels[l].height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+									mip_level_pixels( mips, (int)l ) );
+	}
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
@@ -76,10 +105,146 @@ bool load_texture( const char *file_name, GLuint *tex ) {
 	return true;
 }
 
+/* reads every benchmark file once, untimed, so that whichever loader runs
+first isn't the only one to wait for the disk */
+static void read_bench_files() {
+	std::vector<char> buffer( 1 << 16 );
+	for ( size_t i = 0; i < BENCH_NUM_IMAGES; i++ ) {
+		FILE *fp = fopen( g_bench_images[i], "rb" );
+		if ( !fp ) {
+			continue;
+		}
+		while ( fread( &buffer[0], 1, buffer.size(), fp ) == buffer.size() ) {
+		}
+		fclose( fp );
+	}
+}
+
+/* loads the benchmark images one at a time the way load_texture() used to,
+flipping a byte at a time, then all together through a new cache, then again
+from the same cache. also times the two flips on their own. the files are
+read once first, so all of the times are with them in the OS's file cache */
+void benchmark_texture_loading() {
+	read_bench_files();
+	double start = glfwGetTime();
+	double flip_secs = 0.0;
+	int serial_loaded = 0;
+	for ( size_t i = 0; i < BENCH_NUM_IMAGES; i++ ) {
+		int x, y, n;
+		unsigned char *image_data = stbi_load( g_bench_images[i], &x, &y, &n, 4 );
+		if ( !image_data ) {
+			continue;
+		}
+		double flip_start = glfwGetTime();
+		int width_in_bytes = x * 4;
+		for ( int row = 0; row < y / 2; row++ ) {
+			unsigned char *top = image_data + row * width_in_bytes;
+			unsigned char *bottom = image_data + ( y - row - 1 ) * width_in_bytes;
+			for ( int col = 0; col < width_in_bytes; col++ ) {
+				unsigned char temp = *top;
+				*top = *bottom;
+				*bottom = temp;
+				top++;
+				bottom++;
+			}
+		}
+		flip_secs += glfwGetTime() - flip_start;
+		stbi_image_free( image_data );
+		serial_loaded++;
+	}
+	double serial_ms = ( glfwGetTime() - start ) * 1000.0;
+
+	texture_cache_t cache;
+	std::vector<const texture_image_t *> images( BENCH_NUM_IMAGES );
+	start = glfwGetTime();
+	int loaded = texture_load_many( cache, g_bench_images, (int)BENCH_NUM_IMAGES, true, &images[0],
+																	g_num_threads );
+	double first_ms = ( glfwGetTime() - start ) * 1000.0;
+	int decodes = cache.decodes;
+	start = glfwGetTime();
+	texture_load_many( cache, g_bench_images, (int)BENCH_NUM_IMAGES, true, &images[0],
+										 g_num_threads );
+	double warm_ms = ( glfwGetTime() - start ) * 1000.0;
+
+	// flipping them all back with whole rows
+	start = glfwGetTime();
+	for ( size_t i = 0; i < BENCH_NUM_IMAGES; i++ ) {
+		if ( images[i] ) {
+			texture_flip_rows( images[i]->pixels, images[i]->width * 4, images[i]->height );
+		}
+	}
+	double row_flip_ms = ( glfwGetTime() - start ) * 1000.0;
+	texture_cache_clear( cache );
+
+	gl_log( "loading %i images already in the OS's file cache, %i threads: one at a time "
+					"%.3fms (byte flips %.3fms), cached loader %.3fms (%i of %i decoded), again "
+					"%.3fms. row flips %.3fms\n",
+					(int)BENCH_NUM_IMAGES, g_num_threads, serial_ms, flip_secs * 1000.0, first_ms,
+					decodes, loaded, warm_ms, row_flip_ms );
+	if ( serial_loaded != loaded ) {
+		gl_log_err( "ERROR: loaded %i images one at a time but %i with the cache\n",
+								serial_loaded, loaded );
+	}
+}
+
+/* builds mipmaps for big images with each filter, then for the particle
+demo's droplet sprite with and without keeping its alpha-tested coverage */
+void benchmark_mipmaps() {
+	for ( int size = 4096; size <= BENCH_MIPMAP_MAX_SIZE; size *= 2 ) {
+		std::vector<unsigned char> pixels( (size_t)size * size * 4 );
+		for ( size_t i = 0; i < pixels.size(); i++ ) {
+			pixels[i] = (unsigned char)( ( i * 2654435761u ) >> 24 );
+		}
+		for ( int f = MIP_FILTER_BOX; f <= MIP_FILTER_KAISER; f++ ) {
+			mip_chain_t mips;
+			mip_settings_t settings;
+			settings.filter = (mip_filter_t)f;
+			double start = glfwGetTime();
+			mip_chain_build( mips, &pixels[0], size, size, settings, g_num_threads );
+			double secs = glfwGetTime() - start;
+			gl_log( "mipmaps for %ix%i, %s %s, %i threads: %.3fms (%.1fM texels/s)\n", size, size,
+							f == MIP_FILTER_BOX ? "box" : "Kaiser", mip_path(), g_num_threads, secs * 1000.0,
+							(double)size * size / secs / 1000000.0 );
+		}
+	}
+
+	const texture_image_t *sprite =
+		texture_load( g_textures, "../29_particle_systems/Droplet.png", true );
+	if ( !sprite ) {
+		return;
+	}
+	const float cutoff = 0.5f;
+	for ( int keep = 0; keep < 2; keep++ ) {
+		mip_chain_t mips;
+		mip_settings_t settings;
+		settings.alpha_cutoff = keep ? cutoff : 0.0f;
+		mip_chain_build( mips, sprite->pixels, sprite->width, sprite->height, settings,
+										 g_num_threads );
+		char line[1024];
+		int len = sprintf( line, "%.3f",
+											 mip_alpha_coverage( sprite->pixels, sprite->width * sprite->height, cutoff ) );
+		for ( size_t l = 0; l < mips.levels.size() && len < 1000; l++ ) {
+			len += sprintf( line + len, " %.3f", mip_alpha_coverage( mip_level_pixels( mips, (int)l ),
+																												 mips.levels[l].width * mips.levels[l].height,
+																												 cutoff ) );
+		}
+		gl_log( "Droplet.png alpha >= %.1f by level, %s: %s\n", cutoff,
+						keep ? "coverage kept" : "plain box filter", line );
+	}
+}
+
 int main() {
 	( restart_gl_log() );
 	// use GLFW and GLEW to start GL context. see gl_utils.cpp for details
 	( start_gl() );
+	g_num_threads = (int)std::thread::hardware_concurrency();
+	if ( g_num_threads < 1 ) {
+		g_num_threads = 1;
+	}
+#ifdef RUN_BENCHMARKS
+	benchmark_texture_loading();
+	benchmark_mipmaps();
+#endif
 
 	// tell GL to only draw onto a pixel if the shape is closer to the viewer
 	glEnable( GL_DEPTH_TEST ); // enable depth-testing
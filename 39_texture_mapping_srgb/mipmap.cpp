@@ -0,0 +1,371 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| First version 27 Jan 2014                                                    |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries' separate legal notices                             |
+|******************************************************************************|
+| CPU mipmap generation. See mipmap.h                                          |
+\******************************************************************************/
+#include "mipmap.h"
+#include "run_threads.h"
+#include <algorithm>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <string.h>
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define MIPMAP_SSE
+#endif
+
+// a thread is only worth starting for this many output texels
+#define MIP_MIN_PER_THREAD 16384
+/* linear values are rounded to one of this many steps to look up their sRGB
+byte. every byte is reachable, and a few in a hundred come out one off from
+exact rounding */
+#define MIP_SRGB_TABLE_SIZE 8192
+#define KAISER_TAPS 8
+#define KAISER_ALPHA 4.0
+
+struct mip_tables_t {
+	float to_linear[256]; // sRGB byte to linear 0 to 1
+	float unorm[256];			// byte to 0 to 1
+	unsigned char to_srgb[MIP_SRGB_TABLE_SIZE];
+	float kaiser[KAISER_TAPS];
+};
+
+/* zeroth order modified Bessel function of the first kind, for the window */
+static double bessel_i0( double x ) {
+	double sum = 1.0, term = 1.0;
+	for ( int k = 1; k < 32; k++ ) {
+		term *= ( x * 0.5 / k ) * ( x * 0.5 / k );
+		sum += term;
+	}
+	return sum;
+}
+
+static mip_tables_t make_tables() {
+	mip_tables_t t;
+	for ( int i = 0; i < 256; i++ ) {
+		double c = i / 255.0;
+		t.to_linear[i] = (float)( c <= 0.04045 ? c / 12.92 : pow( ( c + 0.055 ) / 1.055, 2.4 ) );
+		t.unorm[i] = (float)c;
+	}
+	for ( int i = 0; i < MIP_SRGB_TABLE_SIZE; i++ ) {
+		double l = (double)i / ( MIP_SRGB_TABLE_SIZE - 1 );
+		double c = l <= 0.0031308 ? l * 12.92 : 1.055 * pow( l, 1.0 / 2.4 ) - 0.055;
+		t.to_srgb[i] = (unsigned char)( c * 255.0 + 0.5 );
+	}
+	/* output pixel x is centred between input pixels 2x and 2x+1, so tap k, on
+	input pixel 2x - 3 + k, is k - 3.5 input pixels from it. sinc cuts off at
+	the output's frequency, half the input's */
+	double sum = 0.0;
+	for ( int k = 0; k < KAISER_TAPS; k++ ) {
+		double d = k - 3.5;
+		double x = M_PI * d * 0.5;
+		double r = d / ( KAISER_TAPS * 0.5 );
+		double window = bessel_i0( KAISER_ALPHA * sqrt( 1.0 - r * r ) ) / bessel_i0( KAISER_ALPHA );
+		t.kaiser[k] = (float)( sin( x ) / x * window );
+		sum += t.kaiser[k];
+	}
+	for ( int k = 0; k < KAISER_TAPS; k++ ) {
+		t.kaiser[k] = (float)( t.kaiser[k] / sum );
+	}
+	return t;
+}
+
+#ifdef MIPMAP_SSE
+typedef __m128 pixel_t;
+static inline pixel_t px_load( const float *p ) { return _mm_loadu_ps( p ); }
+static inline pixel_t px_zero() { return _mm_setzero_ps(); }
+static inline pixel_t px_add( pixel_t a, pixel_t b ) { return _mm_add_ps( a, b ); }
+static inline pixel_t px_mul( pixel_t a, float s ) { return _mm_mul_ps( a, _mm_set1_ps( s ) ); }
+static inline void px_store( float *p, pixel_t a ) { _mm_storeu_ps( p, a ); }
+/* clamps to 0 to 1, scales, and rounds */
+static inline void px_round( pixel_t a, pixel_t scale, int *out ) {
+	a = _mm_min_ps( _mm_max_ps( a, _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) );
+	a = _mm_add_ps( _mm_mul_ps( a, scale ), _mm_set1_ps( 0.5f ) );
+	_mm_storeu_si128( (__m128i *)out, _mm_cvttps_epi32( a ) );
+}
+static inline pixel_t px_scale( float rgb, float a ) { return _mm_setr_ps( rgb, rgb, rgb, a ); }
+#else
+struct pixel_t {
+	float v[4];
+};
+static inline pixel_t px_load( const float *p ) {
+	pixel_t r = { { p[0], p[1], p[2], p[3] } };
+	return r;
+}
+static inline pixel_t px_zero() {
+	pixel_t r = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+	return r;
+}
+static inline pixel_t px_add( pixel_t a, pixel_t b ) {
+	for ( int c = 0; c < 4; c++ ) {
+		a.v[c] += b.v[c];
+	}
+	return a;
+}
+static inline pixel_t px_mul( pixel_t a, float s ) {
+	for ( int c = 0; c < 4; c++ ) {
+		a.v[c] *= s;
+	}
+	return a;
+}
+static inline void px_store( float *p, pixel_t a ) { memcpy( p, a.v, sizeof( a.v ) ); }
+static inline void px_round( pixel_t a, pixel_t scale, int *out ) {
+	for ( int c = 0; c < 4; c++ ) {
+		float v = std::min( std::max( a.v[c], 0.0f ), 1.0f );
+		out[c] = (int)( v * scale.v[c] + 0.5f );
+	}
+}
+static inline pixel_t px_scale( float rgb, float a ) {
+	pixel_t r = { { rgb, rgb, rgb, a } };
+	return r;
+}
+#endif
+
+const char *mip_path() {
+#ifdef MIPMAP_SSE
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
+
+/* one level's source and destination, and what to do */
+struct mip_job_t {
+	const unsigned char *src;
+	int src_width, src_height;
+	unsigned char *dst;
+	int width, height;
+	const mip_settings_t *settings;
+	const mip_tables_t *tables;
+};
+
+/* a row of bytes to linear floats, with pad copies of the end pixels either
+side */
+static void decode_row( const mip_job_t &job, int row, float *out, int pad_left, int pad_right ) {
+	const unsigned char *in = job.src + (size_t)row * job.src_width * 4;
+	const float *rgb = job.settings->srgb ? job.tables->to_linear : job.tables->unorm;
+	const float *alpha = job.tables->unorm;
+	float *p = out + pad_left * 4;
+	for ( int x = 0; x < job.src_width; x++, in += 4, p += 4 ) {
+		p[0] = rgb[in[0]];
+		p[1] = rgb[in[1]];
+		p[2] = rgb[in[2]];
+		p[3] = alpha[in[3]];
+	}
+	for ( int x = 0; x < pad_left; x++ ) {
+		memcpy( out + x * 4, out + pad_left * 4, 4 * sizeof( float ) );
+	}
+	for ( int x = 0; x < pad_right; x++ ) {
+		memcpy( p + x * 4, p - 4, 4 * sizeof( float ) );
+	}
+}
+
+static inline void encode_pixel( const mip_job_t &job, pixel_t p, pixel_t scale, unsigned char *out ) {
+	int v[4];
+	px_round( p, scale, v );
+	if ( job.settings->srgb ) {
+		out[0] = job.tables->to_srgb[v[0]];
+		out[1] = job.tables->to_srgb[v[1]];
+		out[2] = job.tables->to_srgb[v[2]];
+	} else {
+		out[0] = (unsigned char)v[0];
+		out[1] = (unsigned char)v[1];
+		out[2] = (unsigned char)v[2];
+	}
+	out[3] = (unsigned char)v[3];
+}
+
+static pixel_t encode_scale( const mip_job_t &job ) {
+	return px_scale( job.settings->srgb ? (float)( MIP_SRGB_TABLE_SIZE - 1 ) : 255.0f, 255.0f );
+}
+
+/* a size of 1 is averaged with itself, through decode_row()'s padding. when an
+odd size above 1 is halved, the last output texel takes the last three input
+rows or columns, so none is dropped */
+static void box_rows( const mip_job_t &job, int first_row, int end_row ) {
+	std::vector<float> rows[3];
+	for ( int r = 0; r < 3; r++ ) {
+		rows[r].resize( job.src_width * 4 + 4 );
+	}
+	bool odd_width = job.src_width > 1 && job.src_width % 2 == 1;
+	bool odd_height = job.src_height > 1 && job.src_height % 2 == 1;
+	pixel_t scale = encode_scale( job );
+	for ( int y = first_row; y < end_row; y++ ) {
+		int row_count = odd_height && y == job.height - 1 ? 3 : 2;
+		for ( int r = 0; r < row_count; r++ ) {
+			decode_row( job, std::min( 2 * y + r, job.src_height - 1 ), &rows[r][0], 0, 1 );
+		}
+		unsigned char *out = job.dst + (size_t)y * job.width * 4;
+		for ( int x = 0; x < job.width; x++, out += 4 ) {
+			int i = 8 * x;
+			bool three_columns = odd_width && x == job.width - 1;
+			pixel_t sum = px_zero();
+			for ( int r = 0; r < row_count; r++ ) {
+				sum = px_add( sum, px_add( px_load( &rows[r][i] ), px_load( &rows[r][i + 4] ) ) );
+				if ( three_columns ) {
+					sum = px_add( sum, px_load( &rows[r][i + 8] ) );
+				}
+			}
+			float texels = (float)( row_count * ( three_columns ? 3 : 2 ) );
+			encode_pixel( job, px_mul( sum, 1.0f / texels ), scale, out );
+		}
+	}
+}
+
+static void kaiser_rows( const mip_job_t &job, int first_row, int end_row ) {
+	const float *w = job.tables->kaiser;
+	// input rows padded with 3 copies of the first pixel and 4 of the last
+	std::vector<float> decoded( ( job.src_width + KAISER_TAPS - 1 ) * 4 );
+	// the last KAISER_TAPS input rows, filtered across, by row number mod KAISER_TAPS
+	std::vector<float> filtered( KAISER_TAPS * job.width * 4 );
+	pixel_t scale = encode_scale( job );
+	// rows above the top are numbered from -1 up, and are copies of the top row
+	int next_row = 2 * first_row - 3;
+	for ( int y = first_row; y < end_row; y++ ) {
+		for ( ; next_row <= 2 * y + 4; next_row++ ) {
+			int row = std::min( std::max( next_row, 0 ), job.src_height - 1 );
+			decode_row( job, row, &decoded[0], 3, 4 );
+			float *out = &filtered[( ( next_row + KAISER_TAPS ) % KAISER_TAPS ) * job.width * 4];
+			for ( int x = 0; x < job.width; x++ ) {
+				// padded pixel 2x + k is input pixel 2x - 3 + k
+				const float *in = &decoded[8 * x];
+				pixel_t sum = px_zero();
+				for ( int k = 0; k < KAISER_TAPS; k++ ) {
+					sum = px_add( sum, px_mul( px_load( in + 4 * k ), w[k] ) );
+				}
+				px_store( out + 4 * x, sum );
+			}
+		}
+		const float *rows[KAISER_TAPS];
+		for ( int k = 0; k < KAISER_TAPS; k++ ) {
+			rows[k] = &filtered[( ( 2 * y - 3 + k + KAISER_TAPS ) % KAISER_TAPS ) * job.width * 4];
+		}
+		unsigned char *out = job.dst + (size_t)y * job.width * 4;
+		for ( int x = 0; x < job.width; x++, out += 4 ) {
+			pixel_t sum = px_zero();
+			for ( int k = 0; k < KAISER_TAPS; k++ ) {
+				sum = px_add( sum, px_mul( px_load( rows[k] + 4 * x ), w[k] ) );
+			}
+			encode_pixel( job, sum, scale, out );
+		}
+	}
+}
+
+/* how many alpha values in hist pass cutoff_byte once multiplied by scale */
+static int passing( const int *hist, float scale, float cutoff_byte ) {
+	int n = 0;
+	for ( int a = 0; a < 256; a++ ) {
+		if ( std::min( (float)(int)( a * scale + 0.5f ), 255.0f ) >= cutoff_byte ) {
+			n += hist[a];
+		}
+	}
+	return n;
+}
+
+/* scales a level's alpha so that as many of its texels pass the cutoff as the
+fraction coverage. returns the scale */
+static float keep_coverage( unsigned char *pixels, int count, float cutoff, float coverage ) {
+	int hist[256] = { 0 };
+	for ( int i = 0; i < count; i++ ) {
+		hist[pixels[i * 4 + 3]]++;
+	}
+	float cutoff_byte = cutoff * 255.0f;
+	int target = (int)( coverage * count + 0.5f );
+	// the smallest scale passing at least target texels
+	float lo = 0.0f, hi = 256.0f;
+	for ( int i = 0; i < 24; i++ ) {
+		float mid = ( lo + hi ) * 0.5f;
+		if ( passing( hist, mid, cutoff_byte ) >= target ) {
+			hi = mid;
+		} else {
+			lo = mid;
+		}
+	}
+	unsigned char scaled[256];
+	for ( int a = 0; a < 256; a++ ) {
+		scaled[a] = (unsigned char)std::min( (int)( a * hi + 0.5f ), 255 );
+	}
+	for ( int i = 0; i < count; i++ ) {
+		pixels[i * 4 + 3] = scaled[pixels[i * 4 + 3]];
+	}
+	return hi;
+}
+
+float mip_alpha_coverage( const unsigned char *pixels, int count, float cutoff ) {
+	if ( count <= 0 ) {
+		return 0.0f;
+	}
+	float cutoff_byte = cutoff * 255.0f;
+	int n = 0;
+	for ( int i = 0; i < count; i++ ) {
+		if ( pixels[i * 4 + 3] >= cutoff_byte ) {
+			n++;
+		}
+	}
+	return (float)n / (float)count;
+}
+
+unsigned char *mip_level_pixels( mip_chain_t &chain, int level ) {
+	return &chain.pixels[chain.levels[level].offset];
+}
+
+void mip_chain_build( mip_chain_t &chain, const unsigned char *pixels, int width, int height,
+											const mip_settings_t &settings, int thread_count ) {
+	// made once, before any threads start
+	static const mip_tables_t tables = make_tables();
+
+	chain.levels.clear();
+	size_t total = 0;
+	for ( int w = width, h = height; w > 1 || h > 1; ) {
+		w = std::max( w / 2, 1 );
+		h = std::max( h / 2, 1 );
+		mip_level_t level = { w, h, total, 1.0f };
+		chain.levels.push_back( level );
+		total += (size_t)w * h * 4;
+	}
+	chain.pixels.resize( total );
+
+	float coverage = 0.0f;
+	if ( settings.alpha_cutoff > 0.0f ) {
+		coverage = mip_alpha_coverage( pixels, width * height, settings.alpha_cutoff );
+	}
+	for ( size_t l = 0; l < chain.levels.size(); l++ ) {
+		mip_level_t &level = chain.levels[l];
+		mip_job_t job;
+		if ( l == 0 ) {
+			job.src = pixels;
+			job.src_width = width;
+			job.src_height = height;
+		} else {
+			job.src = mip_level_pixels( chain, (int)l - 1 );
+			job.src_width = chain.levels[l - 1].width;
+			job.src_height = chain.levels[l - 1].height;
+		}
+		job.dst = mip_level_pixels( chain, (int)l );
+		job.width = level.width;
+		job.height = level.height;
+		job.settings = &settings;
+		job.tables = &tables;
+
+		int texels = level.width * level.height;
+		int threads = std::max( 1, std::min( thread_count, texels / MIP_MIN_PER_THREAD ) );
+		threads = std::min( threads, level.height );
+		run_on_threads( threads, [&]( int t ) {
+			int first = share_start( level.height, t, threads );
+			int end = share_start( level.height, t + 1, threads );
+			if ( settings.filter == MIP_FILTER_KAISER ) {
+				kaiser_rows( job, first, end );
+			} else {
+				box_rows( job, first, end );
+			}
+		} );
+		if ( coverage > 0.0f ) {
+			level.alpha_scale = keep_coverage( job.dst, texels, settings.alpha_cutoff, coverage );
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#version 410
+
+in vec3 pos_eye;
+in vec3 n_eye;
+uniform samplerCube specular_texture; // blurred for rougher surfaces down its mip levels
+uniform vec3 sh[9]; // light off a white diffuse surface, as spherical harmonics
+uniform float roughness;
+uniform float max_level; // mip level for a roughness of 1
+uniform mat4 V; // view matrix
+out vec4 frag_colour;
+
+vec3 albedo = vec3 (0.5, 0.5, 0.5);
+float f0 = 0.04; // reflectance looking straight on, for most non-metals
+
+vec3 diffuse_light (vec3 n) {
+	return sh[0] * 0.282095 +
+		sh[1] * 0.488603 * n.y + sh[2] * 0.488603 * n.z + sh[3] * 0.488603 * n.x +
+		sh[4] * 1.092548 * n.x * n.y + sh[5] * 1.092548 * n.y * n.z +
+		sh[6] * 0.315392 * (3.0 * n.z * n.z - 1.0) + sh[7] * 1.092548 * n.x * n.z +
+		sh[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
+void main () {
+	vec3 incident_eye = normalize (pos_eye);
+	vec3 normal = normalize (n_eye);
+	vec3 reflected = reflect (incident_eye, normal);
+	// convert from eye to world space
+	mat4 inv_V = inverse (V);
+	vec3 n_world = normalize (vec3 (inv_V * vec4 (normal, 0.0)));
+	reflected = vec3 (inv_V * vec4 (reflected, 0.0));
+
+	vec3 diffuse = albedo * max (diffuse_light (n_world), vec3 (0.0));
+	vec3 specular = textureLod (specular_texture, reflected, roughness * max_level).rgb;
+	// Schlick's Fresnel, with less of it as the surface gets rougher
+	float cos_theta = max (dot (-incident_eye, normal), 0.0);
+	float fresnel = f0 + (max (1.0 - roughness, f0) - f0) * pow (1.0 - cos_theta, 5.0);
+	vec3 colour = mix (diffuse, specular, fresnel);
+	// the lighting is linear, and the sky-box images are sRGB
+	frag_colour = vec4 (pow (colour, vec3 (1.0 / 2.2)), 1.0);
+}
@@ -0,0 +1,22 @@
+#version 410
+
+in vec3 p_eye;
+in vec3 n_eye;
+
+/* compact G-buffer: position comes back from the depth buffer later, so only
+the normal is written, folded into 2 numbers. must match oct_encode_normal() */
+layout (location = 0) out vec2 def_n;
+
+vec2 sign_not_zero (vec2 v) {
+	return vec2 (v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+void main () {
+	vec3 n = n_eye / (abs (n_eye.x) + abs (n_eye.y) + abs (n_eye.z));
+	vec2 oct = n.xy;
+	if (n.z < 0.0) {
+		oct = (1.0 - abs (n.yx)) * sign_not_zero (n.xy);
+	}
+	/* RG16 holds 0 to 1 */
+	def_n = oct * 0.5 + 0.5;
+}